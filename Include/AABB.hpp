@@ -12,6 +12,12 @@ struct AABB
 		max = glm::max(max, point);
 	}
 
+	void expand(const AABB& other)
+	{
+		min = glm::min(min, other.min);
+		max = glm::max(max, other.max);
+	}
+
 	AABB transform(const glm::mat4& matrix) const
 	{
 		// optimized AABB transform
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "AABB.hpp"
+#include "Frustum.hpp"
+
+#include <span>
+#include <vector>
+
+// Bounding volume hierarchy over object world bounds, built with binned SAH. Objects that move afterwards
+// are refit in place, the topology stays the one of the build. Every subtree owns a contiguous range of
+// objects, so frustum culling accepts subtrees that lie fully inside without visiting them.
+class BVH
+{
+public:
+	struct Node
+	{
+		AABB bounds;
+		uint32_t firstObject; // range in leaf order, inner nodes cover their whole subtree
+		uint32_t objectCount;
+		uint32_t leftChild; // right child follows it, 0 marks a leaf since the root is never a child
+	};
+
+	static constexpr uint32_t MAX_LEAF_SIZE = 4;
+	static constexpr uint32_t BIN_COUNT = 16;
+
+	// Object indices are positions in 'worldBounds'
+	void build(std::span<const AABB> worldBounds);
+
+	// Moves one object's bounds and grows or shrinks its ancestors to match
+	void refit(uint32_t object, const AABB& worldBounds);
+
+	// Appends objects whose bounds pass the positive-vertex test of every plane, in traversal order
+	void cullFrustum(const Frustum& frustum, std::vector<uint32_t>& visibleIndices) const;
+
+	// Appends objects whose bounds overlap 'bounds'
+	void queryOverlaps(const AABB& bounds, std::vector<uint32_t>& results) const;
+
+	const AABB& getBounds(uint32_t object) const { return m_leafBounds[m_objectSlots[object]]; }
+	const std::vector<Node>& getNodes() const { return m_nodes; }
+	uint32_t getObjectCount() const { return static_cast<uint32_t>(m_objectIndices.size()); }
+
+private:
+	std::vector<Node> m_nodes;
+	std::vector<uint32_t> m_parents; // per node
+
+	// Leaf order, subtree ranges index these
+	std::vector<uint32_t> m_objectIndices;
+	std::vector<AABB> m_leafBounds;
+
+	// Per object, where refit finds it
+	std::vector<uint32_t> m_objectSlots;
+	std::vector<uint32_t> m_objectLeaves;
+
+	AABB computeBounds(const Node& node) const;
+	void split(uint32_t nodeIndex, std::span<const AABB> worldBounds, const std::vector<glm::vec3>& centroids);
+};
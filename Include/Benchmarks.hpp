@@ -0,0 +1,48 @@
+#pragma once
+
+#include "Vertex.hpp"
+
+#include <vector>
+
+// CPU micro-benchmarks for engine hot paths, run from main() when RUN_BENCHMARKS is defined.
+// Inputs are generated procedurally so the results don't depend on which models are on disk.
+class Benchmarks
+{
+public:
+	static void runAll();
+
+	// unordered_map<Vertex> welding (previous loadModel path) against VertexWelder
+	static void vertexWelding();
+
+	// Cache statistics and run time of MeshOptimizer on triangles in shuffled (OBJ export like) order
+	static void meshOptimization();
+
+	// Triangle counts, errors and run time of the LOD chain MeshSimplifier builds for a terrain
+	static void meshSimplification();
+
+	// Backface cones MeshletBuilder computes for concave and convex folds, checked against the triangles they reject
+	static void meshletCones();
+
+	// Compiling a 100k instance text scene against loading its binary form
+	static void sceneLoading();
+
+	// Per-object transform, sphere test and serial compaction (previous culling path) against FrustumCuller, 1k to 1M objects
+	static void frustumCulling();
+
+	// BVH build, traversal and overlap queries against the flat culler, scene area grows with the object count
+	static void bvhCulling();
+
+	// Occluder rasterization and box tests of OcclusionCuller for a street of buildings with small objects behind
+	static void occlusionCulling();
+
+	// Draws and triangles buildDrawCommands submits along camera paths through a Sponza-like atrium, with and
+	// without its per-submesh frustum test
+	static void submeshCulling();
+
+private:
+	// Un-welded corner stream of a heightfield grid, every interior vertex is shared by 6 corners
+	static std::vector<Vertex> makeTerrainCorners(uint32_t gridSize);
+
+	// Corner stream with hard-edged chunks, roughly Sponza's triangle count
+	static std::vector<Vertex> makeSponzaCorners();
+};
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstdint>
+
+// CPU encoders for the block-compressed formats of cooked textures. Every call encodes one 4x4 block
+// given as 16 RGBA8 texels in row order, edge blocks are padded by the caller. No GPU is involved,
+// so textures can be cooked on any machine.
+class BlockEncoder
+{
+public:
+	// One channel of the block into 8 bytes (BC4, or either half of BC5)
+	static void encodeBC4(const uint8_t rgba[64], uint32_t channel, uint8_t out[8]);
+
+	// Red and green into 16 bytes, the usual encoding for tangent space normal maps
+	static void encodeBC5(const uint8_t rgba[64], uint8_t out[16]);
+
+	// RGBA into 16 bytes using BC7 mode 6 (one subset, 7-bit endpoints with p-bits, 4-bit indices).
+	// Endpoints are fitted along the principal axis and refined with least squares.
+	static void encodeBC7(const uint8_t rgba[64], uint8_t out[16]);
+};
@@ -30,8 +30,8 @@ public:
     float MouseSensitivity{ 0.2f };
     float Zoom{ 60.0f };
 
-    // Default Constructor
-    Camera(glm::vec3 position = { 0.0f, 2.0f, 8.0f });
+    // Default Constructor, yaw and pitch in degrees
+    Camera(glm::vec3 position = { 0.0f, 2.0f, 8.0f }, float yaw = -90.0f, float pitch = 0.0f);
 
     inline glm::mat4 GetViewMatrix() const {
         return glm::lookAt(Position, Position + Front, Up);
@@ -16,6 +16,9 @@ public:
 
 	void updateTextureArray(const std::vector<VkImageView>& textureViews, VkSampler sampler);
 
+	// Rewrites single bindless slots, they must not be sampled by any frame still in flight
+	void updateTextureSlots(const std::vector<uint32_t>& slots, const std::vector<VkImageView>& textureViews, VkSampler sampler);
+
 	VkDescriptorSetLayout getDescriptorSetLayout() const { return m_descriptorSetLayout; }
 	VkDescriptorPool getDescriptorPool() const { return m_descriptorPool; }
 	VkDescriptorSet getDescriptorSet() const { return m_descriptorSet; }
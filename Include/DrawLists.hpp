@@ -0,0 +1,46 @@
+#pragma once
+
+#include "Frustum.hpp"
+#include "Mesh.hpp"
+#include "SceneFile.hpp"
+
+#include <vector>
+
+static constexpr float LOD_PIXEL_ERROR = 1.0f; // screen space error a detail level may add
+
+struct DrawCommand
+{
+	uint32_t indexCount;
+	uint32_t instanceCount;
+	uint32_t firstIndex;
+	int32_t vertexOffset;
+	uint32_t firstInstance;
+	VertexFormat vertexFormat; // selects the pipeline
+	IndexFormat indexFormat; // selects the index arena, firstIndex is relative to it
+	uint32_t meshletOffset; // meshlets covering the index range in order, see MeshletBuilder
+	uint32_t meshletCount;
+	Material material;
+	std::vector<uint32_t> objectIndices;
+};
+
+// Draws of one view, indexed by material
+struct DrawLists
+{
+	std::vector<std::vector<DrawCommand>> opaque;
+	std::vector<std::vector<DrawCommand>> transparent;
+	uint32_t objectCount = 0; // leading visible list entries holding every object once, submesh lists follow
+};
+
+// Coarsest detail level whose error stays under LOD_PIXEL_ERROR pixels at the object's distance
+uint32_t selectMeshLod(const Mesh& mesh, const glm::mat4& model, const glm::vec3& cameraPos, float worldPerPixel);
+
+// Instanced draws of the visible objects grouped by mesh and detail level. The visible list is rewritten in draw
+// order, followed by the instance lists of submeshes only some instances see when a submesh frustum is given.
+DrawLists buildDrawCommands(
+	std::vector<uint32_t>& globalVisibleIndices,
+	const std::vector<ObjectData>& objectData,
+	const std::vector<Mesh>& allMeshes,
+	const std::vector<Submesh>& allSubmeshes,
+	const std::vector<Material>& allMaterials,
+	const glm::vec3& cameraPos, float fovY, float viewportHeight,
+	const Frustum* submeshFrustum = nullptr, uint32_t firstInstance = 0);
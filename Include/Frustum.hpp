@@ -11,6 +11,8 @@ struct Plane
 	{
 		return glm::dot(normal, point) + distance;
 	}
+
+	bool operator==(const Plane&) const = default;
 };
 
 class Frustum
@@ -18,6 +20,8 @@ class Frustum
 public:
 	std::array<Plane, 6> planes;
 
+	bool operator==(const Frustum&) const = default;
+
 	void update(const glm::mat4& viewProj)
 	{
         // Extract frustum planes from view-projection matrix
@@ -66,6 +70,13 @@ public:
         }
 	}
 
+    // Drops the near plane, anything between the eye and the volume then counts as inside
+    void removeNearPlane()
+    {
+        planes[4].normal = glm::vec3(0.0f);
+        planes[4].distance = 1.0f;
+    }
+
     bool isBoxVisible(const glm::vec3& minBounds, const glm::vec3& maxBounds) const
     {
         for (const Plane& plane : planes)
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "AABB.hpp"
+#include "Frustum.hpp"
+#include "Mesh.hpp"
+#include "SceneFile.hpp"
+#include "Simd.hpp"
+
+#include <span>
+#include <vector>
+
+// Frustum culling over world-space AABBs stored as structure-of-arrays. A plane test covers LANE_WIDTH objects
+// with the exact positive-vertex test, and visible indices are compacted in parallel, chunk by chunk.
+// The instruction set is the one the translation unit is compiled for (AVX-512, AVX2, SSE2, scalar).
+class FrustumCuller
+{
+public:
+	static constexpr uint32_t LANE_WIDTH = Simd::LANE_WIDTH;
+
+	// Objects per parallel task, a multiple of every lane width
+	static constexpr uint32_t CHUNK_SIZE = 8192;
+
+	static const char* getInstructionSet() { return Simd::INSTRUCTION_SET; }
+
+	// World-space bounds of every object, transformed in parallel. Objects keep their index.
+	void updateBounds(std::span<const ObjectData> objects, std::span<const Mesh> meshes);
+	void setBounds(std::span<const AABB> worldBounds);
+
+	// One moved object, the others keep the bounds they were last given
+	void refit(uint32_t index, const AABB& worldBounds) { writeBounds(index, worldBounds); }
+
+	// Visible object indices in ascending order. Objects, when given, get their isVisible flag written.
+	void cull(const Frustum& frustum, std::vector<uint32_t>& visibleIndices, std::span<ObjectData> objects = {});
+
+	uint32_t getCount() const { return m_count; }
+
+private:
+	uint32_t m_count = 0;
+
+	// Padded to a whole chunk with boxes no plane accepts
+	std::vector<float> m_minX, m_minY, m_minZ;
+	std::vector<float> m_maxX, m_maxY, m_maxZ;
+
+	std::vector<uint32_t> m_laneMasks; // visibility bit per object, one entry per LANE_WIDTH objects
+	std::vector<uint32_t> m_chunkCounts;
+
+	void resize(uint32_t count);
+	void writeBounds(uint32_t index, const AABB& bounds);
+	uint32_t getChunkCount() const { return (m_count + CHUNK_SIZE - 1) / CHUNK_SIZE; }
+};
@@ -1,24 +1,28 @@
 #pragma once
 
 #include "volk.h"
-#include "Vertex.hpp"
+#include "Mesh.hpp"
 
 #include "vk_mem_alloc.h"
 
+#include <cstddef>
 #include <vector>
 
 class VulkanContext;
-class Commands;
+class UploadManager;
 
 class GPUBuffer
 {
 public:
-	GPUBuffer(VulkanContext& context, Commands& commands, const std::vector<Vertex>& vertices, const std::vector<uint32_t> indices, VkDeviceSize objectBufferSize, uint32_t maxFramesInFlight);
+	GPUBuffer(VulkanContext& context, UploadManager& uploads, const std::vector<std::byte>& vertexStream, const std::vector<std::byte>& indexStream, VkDeviceSize wideIndexOffset, VkDeviceSize objectBufferSize, uint32_t maxFramesInFlight);
 	~GPUBuffer();
 
 	VkBuffer getVertexBuffer() const { return m_vertexBuffer; }
 	VkBuffer getIndexBuffer() const { return m_indexBuffer; }
 
+	// Byte offset to bind the index buffer at for meshes of 'format', see IndexPacker
+	VkDeviceSize getIndexArenaOffset(IndexFormat format) const { return format == IndexFormat::UInt16 ? 0 : m_wideIndexOffset; }
+
 	void createOrResizeDebugVertexBuffer(size_t vertexCount);
 	VkBuffer getDebugVertexBuffer() const { return m_debugVertexBuffer; }
 	VmaAllocation getDebugVertexAllocation() const { return m_debugVertexAllocation; }
@@ -40,6 +44,11 @@ public:
 	VkDeviceSize getCascadeBufferSize() const { return m_cascadeBufferSize; }
 	VkDeviceSize getAlignedCascadeSize() const { return m_alignedCascadeSize; }
 
+	// Static per-mesh records, uploaded once
+	void createMeshBuffer(const std::vector<MeshGPUData>& meshData);
+	VkBuffer getMeshBuffer() const { return m_meshBuffer; }
+	VkDeviceSize getMeshBufferSize() const { return m_meshBufferSize; }
+
 	void createVisibleIndexBuffer(size_t maxObjects);
 	VkBuffer getVisibleIndexBuffer() const { return m_visibleIndexBuffer; }
 	VkDeviceSize getVisibleIndexBufferSize() const { return m_visibleIndexBufferSize; }
@@ -52,13 +61,14 @@ public:
 
 private:
 	VulkanContext& m_context;
-	Commands& m_commands;
+	UploadManager& m_uploads;
 
 	VkBuffer m_vertexBuffer = VK_NULL_HANDLE;
 	VmaAllocation m_vertexAllocation = VK_NULL_HANDLE;
 
 	VkBuffer m_indexBuffer = VK_NULL_HANDLE;
 	VmaAllocation m_indexAllocation = VK_NULL_HANDLE;
+	VkDeviceSize m_wideIndexOffset = 0;
 
 	// Debug buffer resources
 	VkBuffer m_debugVertexBuffer = VK_NULL_HANDLE;
@@ -87,6 +97,11 @@ private:
 	VkDeviceSize m_cascadeBufferSize = 0;
 	VkDeviceSize m_alignedCascadeSize = 0;
 
+	// Per-mesh SSBO
+	VkBuffer m_meshBuffer = VK_NULL_HANDLE;
+	VmaAllocation m_meshAllocation = VK_NULL_HANDLE;
+	VkDeviceSize m_meshBufferSize = 0;
+
 	// Visible Instance Index SSBO
 	VkBuffer m_visibleIndexBuffer = VK_NULL_HANDLE;
 	VmaAllocation m_visibleIndexAllocation = VK_NULL_HANDLE;
@@ -96,8 +111,6 @@ private:
 
 	uint32_t m_maxFramesInFlight;
 
-	void createVertexBuffer(const std::vector<Vertex>& vertices);
-	void createIndexBuffer(const std::vector<uint32_t>& indices);
-
-	void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
+	void createVertexBuffer(const std::vector<std::byte>& vertexStream);
+	void createIndexBuffer(const std::vector<std::byte>& indexStream);
 };
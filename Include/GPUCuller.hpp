@@ -0,0 +1,162 @@
+#pragma once
+
+#include "volk.h"
+#include "vk_mem_alloc.h"
+
+#include "Frustum.hpp"
+#include "Mesh.hpp"
+#include "SceneFile.hpp"
+
+#include <span>
+#include <string>
+#include <vector>
+
+class VulkanContext;
+class UploadManager;
+class GPUBuffer;
+
+// Counters the GPU wrote the last time a frame slot was used, read back once its fence has signaled
+struct GPUCullStats
+{
+	uint32_t visibleObjects = 0;
+	uint32_t drawCount = 0; // indirect draws with at least one instance
+};
+
+// GPU-driven culling of opaque geometry. Draw commands are fixed on load, one per mesh, detail level and run of
+// opaque submeshes, and grouped into batches that share a material, vertex format and index format. Every frame
+// a compute pass tests each object against the frustum, picks its detail level like selectMeshLod does and appends
+// it to that level's instance list. A second pass writes the commands of lists that got instances to the front of
+// their batch, so a batch is one vkCmdDrawIndexedIndirectCount whatever the instance count.
+// Every view (the camera and each shadow cascade) has its own instance lists, counters and commands.
+class GPUCuller
+{
+public:
+	// Static description of the draws, no Vulkan objects involved
+	struct Layout
+	{
+		// Per mesh, std430 layout of the cull shader
+		struct MeshRecord
+		{
+			glm::vec4 boundsMin;
+			glm::vec4 boundsMax;
+			glm::vec4 lodErrors;
+			uint32_t lodCount;
+			uint32_t firstGroup; // instance list of level 0, the other levels follow
+			uint32_t firstInstance; // where level 0's list starts in the visible index buffer
+			uint32_t instanceCapacity; // objects using the mesh, every level's list has room for all of them
+		};
+
+		// Per command, std430 layout of the command shader
+		struct DrawRecord
+		{
+			uint32_t indexCount;
+			uint32_t firstIndex;
+			int32_t vertexOffset;
+			uint32_t firstInstance;
+			uint32_t group;
+			uint32_t batch;
+			uint32_t firstCommand; // the batch's first command
+			uint32_t padding;
+		};
+
+		struct Batch
+		{
+			uint32_t materialIndex;
+			VertexFormat vertexFormat;
+			IndexFormat indexFormat;
+			uint32_t firstCommand;
+			uint32_t commandCount; // draws the batch can have, the GPU writes how many it has
+		};
+
+		std::vector<MeshRecord> meshes;
+		std::vector<DrawRecord> draws;
+		std::vector<Batch> batches; // in material order, like the CPU draw lists
+		uint32_t groupCount = 0;
+		uint32_t instanceCount = 0; // entries one view's instance lists need, view v's start 'v * instanceCount' further
+		uint32_t viewCount = 1;
+	};
+
+	static constexpr uint32_t WORKGROUP_SIZE = 64;
+
+	// Instance lists start at 'firstInstance' in the visible index buffer, behind the CPU's own lists which the
+	// blended pass keeps using. The buffer needs room for 'firstInstance + viewCount * instanceCount' entries.
+	static Layout buildLayout(const std::vector<ObjectData>& objects, const std::vector<Mesh>& allMeshes,
+		const std::vector<Submesh>& allSubmeshes, const std::vector<Material>& allMaterials, uint32_t firstInstance, uint32_t viewCount);
+
+	GPUCuller(VulkanContext& context, UploadManager& uploads, GPUBuffer& buffer, Layout layout, uint32_t objectCount, uint32_t maxFramesInFlight,
+		const std::string& cullShaderPath, const std::string& drawShaderPath);
+	~GPUCuller();
+
+	GPUCuller(const GPUCuller&) = delete;
+	GPUCuller& operator=(const GPUCuller&) = delete;
+
+	// Records both passes for every view outside of any rendering, one frustum per view. The commands and visible
+	// indices are ready for the draw indirect and vertex stages afterwards. All views pick the camera's detail levels.
+	void recordCulling(VkCommandBuffer cmd, std::span<const Frustum> frustums, const glm::vec3& cameraPos, float worldPerPixel, float lodPixelError, uint32_t currentFrame);
+
+	void drawBatch(VkCommandBuffer cmd, uint32_t batch, uint32_t currentFrame, uint32_t view) const;
+
+	const std::vector<Layout::Batch>& getBatches() const { return m_layout.batches; }
+
+	// False for meshes no object uses and for fully blended ones
+	bool drawsMesh(uint32_t meshIndex) const { return m_layout.meshes[meshIndex].lodCount > 0; }
+
+	// Call after the frame's fence wait and before recording it again
+	GPUCullStats readStats(uint32_t currentFrame, uint32_t view) const;
+
+private:
+	struct PushConstants
+	{
+		glm::vec4 planes[6];
+		glm::vec3 cameraPos;
+		float worldPerPixel;
+		uint32_t objectCount;
+		uint32_t drawCount;
+		float lodPixelError;
+		uint32_t batchCount; // counters of the instance lists start after the batches' draw counts
+	};
+
+	VulkanContext& m_context;
+	GPUBuffer& m_buffer;
+	Layout m_layout;
+	uint32_t m_objectCount;
+	uint32_t m_maxFramesInFlight;
+
+	// Static records, one copy per view whose instance offsets point at that view's lists
+	VkDeviceSize m_alignedMeshSize = 0;
+	VkDeviceSize m_alignedDrawSize = 0;
+	VkBuffer m_meshBuffer = VK_NULL_HANDLE;
+	VmaAllocation m_meshAllocation = VK_NULL_HANDLE;
+	VkBuffer m_drawBuffer = VK_NULL_HANDLE;
+	VmaAllocation m_drawAllocation = VK_NULL_HANDLE;
+
+	// Per frame and view, batch draw counts followed by instance list sizes
+	VkBuffer m_counterBuffer = VK_NULL_HANDLE;
+	VmaAllocation m_counterAllocation = VK_NULL_HANDLE;
+	VkDeviceSize m_counterSize = 0;
+	VkDeviceSize m_alignedCounterSize = 0;
+
+	// Host copy of the counters, same layout
+	VkBuffer m_readbackBuffer = VK_NULL_HANDLE;
+	VmaAllocation m_readbackAllocation = VK_NULL_HANDLE;
+	void* m_readbackBufferMapped = nullptr;
+
+	// Per frame and view, VkDrawIndexedIndirectCommand per draw record
+	VkBuffer m_commandBuffer = VK_NULL_HANDLE;
+	VmaAllocation m_commandAllocation = VK_NULL_HANDLE;
+	VkDeviceSize m_commandSize = 0;
+	VkDeviceSize m_alignedCommandSize = 0;
+
+	VkDescriptorSetLayout m_descriptorSetLayout = VK_NULL_HANDLE;
+	VkDescriptorPool m_descriptorPool = VK_NULL_HANDLE;
+	std::vector<VkDescriptorSet> m_descriptorSets; // per view
+	VkPipelineLayout m_pipelineLayout = VK_NULL_HANDLE;
+	VkPipeline m_cullPipeline = VK_NULL_HANDLE;
+	VkPipeline m_drawPipeline = VK_NULL_HANDLE;
+
+	void createBuffers(UploadManager& uploads);
+	void createDescriptors();
+	void createPipelines(const std::string& cullShaderPath, const std::string& drawShaderPath);
+	void bindView(VkCommandBuffer cmd, uint32_t view, uint32_t currentFrame) const;
+	VkPipeline createComputePipeline(const std::string& path, const char* name);
+};
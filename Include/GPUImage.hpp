@@ -2,8 +2,11 @@
 
 #include "volk.h"
 #include "VulkanContext.hpp"
+#include "TextureCooker.hpp"
 
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 struct ShadowMap
 {
@@ -17,20 +20,68 @@ struct ShadowMap
 };
 
 class Commands;
+class UploadManager;
+
+// Texture registry counters, bytes are GPU memory of the resident mip levels
+struct TextureStats
+{
+	uint32_t requests = 0;
+	uint32_t uniqueTextures = 0;
+	VkDeviceSize bytesUploaded = 0;
+	VkDeviceSize bytesUncompressed = 0; // what the uploaded textures would take as RGBA8
+	VkDeviceSize bytesSaved = 0;
+
+	// Streaming, zero budget when every texture is fully resident
+	VkDeviceSize streamingBudget = 0;
+	VkDeviceSize bytesFullChains = 0; // resident bytes if every texture had all levels
+	uint32_t promotions = 0;
+	uint32_t evictions = 0;
+};
 
 class GPUImage
 {
 public:
-	GPUImage(VulkanContext& context, Commands& commands);
+	// Every texture owns two bindless slots, a new image is written to the idle one while frames in flight
+	// still sample the other
+	static constexpr uint32_t MAX_TEXTURE_SLOTS = 2000;
+
+	GPUImage(VulkanContext& context, Commands& commands, UploadManager& uploads);
 	~GPUImage();
 
 	// Load a texture and return its index in the bindless array
-	uint32_t loadTexture(const std::string& path, bool is_srgb);
+	uint32_t loadTexture(const std::string& path, TextureType type);
+
+	// Reserve the bindless index of a texture, it is decoded and uploaded by the next uploadQueuedTextures.
+	// A file already requested as the same type returns the existing index and counts another request.
+	uint32_t queueTexture(const std::string& path, TextureType type);
+	// Map (or cook) all queued textures on worker threads and stage them through the upload ring
+	void uploadQueuedTextures();
 
-	// Get all texture views for descriptor update
+	// Get all texture views for descriptor update, indexed by bindless slot
 	const std::vector<VkImageView>& getTextureViews() const { return m_textureViews; }
 	VkSampler getSampler() const { return m_sharedTextureSampler; }
 
+	// Bindless slot the shaders sample a texture index through this frame. UINT32_MAX (no texture) passes through.
+	uint32_t getTextureSlot(uint32_t index) const;
+
+	// Textures queued after this start with their low mip tail only, higher levels are streamed in by
+	// demand while their resident levels fit 'budget' bytes
+	void enableTextureStreaming(VkDeviceSize budget, uint32_t framesInFlight);
+	bool isStreamingEnabled() const { return m_streamingBudget > 0; }
+
+	// Demand for this frame: one screen pixel covers 'uvPerPixel' UV units of the texture
+	void requestTexture(uint32_t index, float uvPerPixel);
+
+	// Call once per frame after the frame's fence wait. Resizes textures to this frame's demand, evicting
+	// the least recently used levels to stay in budget, and frees images the GPU is done with.
+	void updateTextureStreaming(uint64_t frameNumber);
+
+	// Slots rewritten since the last call, their descriptors must be updated before the frame is recorded
+	std::vector<uint32_t> takeChangedTextureSlots();
+
+	uint32_t getTextureRequests(uint32_t index) const { return m_textureRequestCounts[index]; }
+	TextureStats getTextureStats() const;
+
 	// Special images stay separate
 	void createDepthImage(uint32_t width, uint32_t height);
 	void createMSAAColorImage(uint32_t width, uint32_t height, VkFormat colorFormat);
@@ -58,24 +109,66 @@ public:
 private:
 	VulkanContext& m_context;
 	Commands& m_commands;
+	UploadManager& m_uploads;
 
 	struct Texture
 	{
-		VkImage image;
-		VkImageView view;
-		VmaAllocation allocation;
-		uint32_t mipLevels;
+		VkImage image = VK_NULL_HANDLE;
+		VkImageView view = VK_NULL_HANDLE;
+		VmaAllocation allocation = VK_NULL_HANDLE;
+		uint32_t mipLevels = 0; // levels of the full chain
+		VkDeviceSize bytes = 0; // size of the resident mip levels
+		VkDeviceSize rgba8Bytes = 0; // size of the same levels uncompressed
+		VkDeviceSize fullBytes = 0; // size of the full chain
+
+		// Streaming: the image holds levels [residentMip, mipLevels). The cooked file stays mapped so
+		// levels can be uploaded again at any time.
+		CookedTexture source;
+		uint32_t residentMip = 0;
+		uint32_t tailMip = 0; // lowest detail that is always resident
+		uint32_t wantedMip = UINT32_MAX; // this frame's demand, UINT32_MAX without any
+		uint64_t lastUsedFrame = 0;
+		uint32_t activeSlot = 0;
+		uint64_t slotFrame = 0; // frame the active slot was switched
 	};
 
 	std::vector<Texture> m_textures;
 	std::vector<VkImageView> m_textureViews;
 	VkSampler m_sharedTextureSampler = VK_NULL_HANDLE;
 
+	// Streaming state, a zero budget keeps every texture fully resident
+	VkDeviceSize m_streamingBudget = 0;
+	VkDeviceSize m_residentBytes = 0;
+	uint32_t m_framesInFlight = 1;
+	uint64_t m_frameNumber = 0;
+	uint32_t m_promotions = 0;
+	uint32_t m_evictions = 0;
+	std::vector<uint32_t> m_changedSlots;
+
+	// Replaced images, destroyed once no frame in flight can sample them
+	struct RetiredImage
+	{
+		VkImage image;
+		VmaAllocation allocation;
+		VkImageView view;
+		uint64_t frame;
+	};
+	std::vector<RetiredImage> m_retiredImages;
+
 	std::vector<ShadowMap> m_shadowMaps; // For cascaded shadow maps
 	VkSampler m_shadowSampler = VK_NULL_HANDLE;
 
-	// Helper to load a single texture
-	GPUImage::Texture createTextureImageFromFile(const std::string& path, bool is_srgb);
+	struct TextureRequest
+	{
+		std::string path;
+		TextureType type;
+		CookedTexture cooked; // filled when the queue is uploaded
+	};
+	std::vector<TextureRequest> m_queuedTextures;
+
+	// Canonical path plus texture type -> bindless index, so a file is only uploaded once per format
+	std::unordered_map<std::string, uint32_t> m_textureLookup;
+	std::vector<uint32_t> m_textureRequestCounts; // times each texture was queued, indexed like m_textures, queued textures included
 
 	// Depth resources (multisampled)
 	VkImage m_depthImage = VK_NULL_HANDLE;
@@ -94,12 +187,18 @@ private:
 	VmaAllocation m_skyboxImageAllocation = VK_NULL_HANDLE;
 	VkImageView m_skyboxImageView = VK_NULL_HANDLE;
 
-	void generateMipmaps(VkCommandBuffer cmd, VkImage image, uint32_t mipLevels, uint32_t width, uint32_t height);
 	void transitionImageLayout(VkCommandBuffer cmd, VkImageLayout oldLayout, VkImageLayout newLayout, VkImage textureImage, VkImageAspectFlags aspectMask, uint32_t baseMipLevel = 0, uint32_t mipLevelCount = 1, uint32_t baseArrayLayer = 0, uint32_t arrayLayerCount = 1);
-	void copyBufferToImage(VkCommandBuffer cmd, VkBuffer buffer, VkImage image, uint32_t width, uint32_t height);
-	void createImageView(VkImage image, VkFormat format, VkImageAspectFlags aspect, VkImageView& outview, uint32_t mipLevels = 1);
+	void createImageView(VkImage image, VkFormat format, VkImageAspectFlags aspect, VkImageView& outview, uint32_t mipLevels = 1, VkComponentMapping components = {});
 	void createSampler();
 
+	// Creates the image for levels [firstMip, mipLevels) of a texture and stages them from its source
+	void createTextureImage(Texture& tex, uint32_t firstMip);
+	// Failure path of uploadQueuedTextures, clears the queue and forgets the indices it reserved
+	void discardQueuedTextures();
+	// Swaps a texture to a new set of resident levels through its idle bindless slot
+	void setResidentMip(uint32_t index, uint32_t firstMip);
+	VkDeviceSize levelBytes(const Texture& tex, uint32_t firstMip) const;
+
 	VkFormat findSupportedDepthFormat();
 	bool hasStencil(VkFormat format) const;
 };
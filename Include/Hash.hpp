@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+constexpr uint64_t FNV_OFFSET = 14695981039346656037ull;
+constexpr uint64_t FNV_PRIME = 1099511628211ull;
+
+// FNV-1a over 64-bit words with a bytewise tail, several times faster than the classic bytewise loop.
+// Used to key the asset caches on their source files.
+inline uint64_t fnv1a(const std::byte* data, size_t size, uint64_t hash = FNV_OFFSET)
+{
+	size_t i = 0;
+	for (; i + 8 <= size; i += 8)
+	{
+		uint64_t word;
+		memcpy(&word, data + i, sizeof(word));
+		hash = (hash ^ word) * FNV_PRIME;
+	}
+	for (; i < size; ++i)
+	{
+		hash = (hash ^ static_cast<uint64_t>(data[i])) * FNV_PRIME;
+	}
+	return hash;
+}
@@ -11,6 +11,9 @@
 
 class VulkanContext;
 class DescriptorManager;
+struct UploadStats;
+struct TextureStats;
+struct GPUCullStats;
 
 class ImGuiOverlay
 {
@@ -35,7 +38,13 @@ public:
 
 	void drawShadowMapVisualization(
 		const std::array<VkDescriptorSet, 4>& shadowMapDescriptorSets,
-		const std::vector<ShadowCascades::CascadeData>& cascades) const;
+		const std::vector<ShadowCascades::CascadeData>& cascades,
+		const std::array<uint32_t, ShadowCascades::NUM_CASCADES>& casterCounts) const;
+
+	void drawUploadStats(const UploadStats& stats, const TextureStats& textureStats) const;
+
+	// GPU counts lag the CPU reference by the frames in flight, they match while the camera holds still
+	void drawCullingStats(const GPUCullStats& stats, uint32_t cpuVisibleObjects) const;
 
 	inline static bool showMetrics = VK_TRUE;
 	inline static bool enableDepthTest = VK_TRUE;
@@ -46,8 +55,16 @@ public:
 	inline static bool showMeshAABB = VK_FALSE;
 	inline static bool showSubmeshAABB = VK_FALSE;
 	inline static bool enableNormalMaps = VK_TRUE;
+	inline static bool enableSubmeshCulling = VK_TRUE;
+	inline static bool enableMeshletCulling = VK_TRUE;
+	inline static bool enableBVHCulling = VK_TRUE;
+	inline static bool enableOcclusionCulling = VK_TRUE;
+	inline static bool enableGPUCulling = VK_TRUE;
+	inline static bool enableVisibilityReuse = VK_TRUE;
 	inline static bool showShadowMap = VK_TRUE;
 	inline static bool showCascadeColors = VK_FALSE;
+	inline static bool showUploadStats = VK_FALSE;
+	inline static bool showCullingStats = VK_FALSE;
 	inline static float cascadeLambda = 0.80f;
 
 private:
@@ -0,0 +1,23 @@
+#pragma once
+
+#include "Mesh.hpp"
+
+#include <cstddef>
+#include <span>
+#include <vector>
+
+// Builds the GPU index buffer from the 32-bit index array. It holds two arenas: every 16-bit mesh first,
+// then every 32-bit mesh starting at 'wideArenaOffset'. Each arena is bound with its own index type.
+class IndexPacker
+{
+public:
+	// Largest vertex count stored as 16-bit, the highest index stays below the 0xFFFF restart value
+	static constexpr uint32_t MAX_SHORT_VERTICES = 0xFFFF;
+
+	static IndexFormat chooseFormat(uint32_t vertexCount);
+
+	// Writes every mesh and sets its gpuFirstIndex, the 32-bit arena starts at 'wideArenaOffset' bytes
+	static std::vector<std::byte> buildIndexStream(std::span<const uint32_t> indices, std::span<Mesh> meshes, size_t& wideArenaOffset);
+
+	static size_t getIndexSize(IndexFormat format) { return format == IndexFormat::UInt16 ? sizeof(uint16_t) : sizeof(uint32_t); }
+};
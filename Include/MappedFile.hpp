@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+// Read-only memory mapping of an entire file, unmapped on destruction
+class MappedFile
+{
+public:
+	MappedFile() = default;
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+	MappedFile(MappedFile&& other) noexcept;
+	MappedFile& operator=(MappedFile&& other) noexcept;
+
+	// Returns false if the file does not exist or cannot be mapped
+	bool open(const std::string& path);
+	void close();
+
+	bool isOpen() const { return m_open; }
+	const std::byte* data() const { return m_data; }
+	size_t size() const { return m_size; }
+
+private:
+	const std::byte* m_data = nullptr;
+	size_t m_size = 0;
+	bool m_open = false;
+
+#ifdef _WIN32
+	void* m_fileHandle = nullptr;
+	void* m_mappingHandle = nullptr;
+#else
+	int m_fd = -1;
+#endif
+
+	void moveFrom(MappedFile& other);
+};
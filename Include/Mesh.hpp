@@ -0,0 +1,158 @@
+#pragma once
+
+#include "AABB.hpp"
+#include "Vertex.hpp"
+
+#include <algorithm>
+#include <array>
+#include <span>
+#include <string>
+#include <vector>
+
+// Element size of a mesh's indices in the GPU index buffer
+enum class IndexFormat : uint32_t
+{
+	UInt16,
+	UInt32,
+	Count
+};
+
+// Level 0 plus up to 3 simplified index ranges
+static constexpr uint32_t MAX_MESH_LODS = 4;
+
+// Cluster of up to 124 triangles over at most 64 vertices, a contiguous part of its level's index range.
+// Culled on its own against the frustum and, through the normal cone, for facing away from the camera.
+struct Meshlet
+{
+	glm::vec3 center; // bounding sphere, object space
+	float radius;
+
+	// Every triangle faces away from a viewer inside dot(normalize(apex - viewer), coneAxis) >= coneCutoff
+	glm::vec3 coneApex;
+	float coneCutoff; // 1 or more disables the backface test
+	glm::vec3 coneAxis;
+
+	uint32_t indexOffset;
+	uint32_t indexCount;
+	uint32_t padding[3];
+};
+
+// Index range of one detail level, 'error' is the object space distance the simplified surface may deviate by
+struct SubmeshLod
+{
+	uint32_t indexOffset;
+	uint32_t indexCount;
+	float error;
+	uint32_t meshletOffset;
+	uint32_t meshletCount;
+};
+
+struct Submesh
+{
+	uint32_t indexOffset;
+	uint32_t indexCount;
+	uint32_t materialIndex;
+	AABB bounds; // submesh-level AABB will be used for collision
+	float uvDensity = 0.0f; // UV units per world unit, texture streaming turns it into a mip level
+
+	// Clusters of level 0, see MeshletBuilder
+	uint32_t meshletOffset = 0;
+	uint32_t meshletCount = 0;
+
+	// Simplified levels 1..lodCount, they index the same vertices as level 0. See MeshSimplifier.
+	uint32_t lodCount = 0;
+	std::array<SubmeshLod, MAX_MESH_LODS - 1> lods{};
+
+	// Levels past the last generated one fall back to the coarsest
+	SubmeshLod getLod(uint32_t level) const
+	{
+		level = std::min(level, lodCount);
+		return level == 0 ? SubmeshLod{ indexOffset, indexCount, 0.0f, meshletOffset, meshletCount } : lods[level - 1];
+	}
+};
+
+struct Mesh
+{
+	uint32_t vertexOffset;
+	uint32_t vertexCount;
+	uint32_t submeshOffset;
+	uint32_t submeshCount;
+	uint32_t indexOffset;
+	uint32_t indexCount;
+	AABB bounds; // used for frustum culling
+
+	// Detail levels of the mesh, the error of a level is the largest of its submeshes'
+	uint32_t lodCount = 1;
+	std::array<float, MAX_MESH_LODS> lodErrors{};
+
+	// GPU vertex buffer layout, chosen on load and free to be overridden before the buffer is built.
+	// 'gpuVertexOffset' is the draw's vertexOffset in that layout's stride, filled in by VertexPacker.
+	VertexFormat vertexFormat = VertexFormat::Float;
+	uint32_t gpuVertexOffset = 0;
+
+	// GPU index buffer layout, 16-bit when every index of the mesh fits. 'gpuFirstIndex' is where the
+	// mesh's indices start inside the arena of that format, filled in by IndexPacker.
+	IndexFormat indexFormat = IndexFormat::UInt32;
+	uint32_t gpuFirstIndex = 0;
+};
+
+// Per-mesh data for the vertex shader, indexed by the object's meshIndex.
+// Packed positions decode to offset + unorm * scale.
+struct MeshGPUData
+{
+	glm::vec4 positionOffset;
+	glm::vec4 positionScale;
+};
+
+struct Material
+{
+	uint32_t albedoTexture;
+	uint32_t normalTexture;
+	uint32_t specularTexture;
+
+	uint32_t twosided; // cull none, otherwise cull backface
+	uint32_t alphatest; // for foliage
+	uint32_t alphablending; // for windows
+
+	float shininess;
+	float reflectionStrength;
+	float specularStrength;
+	float alphaThreshold;
+};
+
+// Texture file names of a material relative to the model directory, empty if unused.
+// Resolved to bindless texture indices when the model is added to the scene.
+struct MaterialTextures
+{
+	std::string albedo;
+	std::string normal;
+};
+
+// Non-owning view of one model with mesh-local offsets (first vertex, index, submesh and material are 0)
+struct ModelView
+{
+	std::span<const Vertex> vertices;
+	std::span<const uint32_t> indices;
+	std::span<const Submesh> submeshes;
+	std::span<const Meshlet> meshlets;
+	std::span<const Material> materials;
+	std::span<const MaterialTextures> textures;
+	AABB bounds;
+};
+
+// CPU-side result of importing a model, before it is appended to the global geometry arrays
+struct ModelData
+{
+	std::vector<Vertex> vertices;
+	std::vector<uint32_t> indices;
+	std::vector<Submesh> submeshes;
+	std::vector<Meshlet> meshlets;
+	std::vector<Material> materials;
+	std::vector<MaterialTextures> textures;
+	AABB bounds;
+
+	ModelView view() const
+	{
+		return { vertices, indices, submeshes, meshlets, materials, textures, bounds };
+	}
+};
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "Mesh.hpp"
+#include "MappedFile.hpp"
+
+#include <filesystem>
+#include <vector>
+
+// A cooked mesh mapped into memory. The geometry spans in 'view' point straight into the mapping,
+// so the model can be appended to the global arrays with a single memcpy per array.
+struct CachedModel
+{
+	MappedFile file;
+	std::vector<MaterialTextures> textures;
+	ModelView view;
+};
+
+// Binary mesh cache (.vkmesh) written next to the source OBJ after the first import.
+// Holds the final welded vertices with tangents, indices, submeshes, meshlets and materials,
+// keyed by a hash of the OBJ and the MTL libraries it references.
+class MeshCache
+{
+public:
+	static std::filesystem::path getCachePath(const std::filesystem::path& sourcePath);
+
+	// FNV-1a over the OBJ and every 'mtllib' it references
+	static uint64_t hashSource(const std::filesystem::path& sourcePath);
+
+	// Returns false if the cache is missing, stale or was written by an older format version
+	static bool load(const std::filesystem::path& sourcePath, uint64_t sourceHash, CachedModel& out);
+	static void store(const std::filesystem::path& sourcePath, uint64_t sourceHash, const ModelData& model);
+};
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "Mesh.hpp"
+
+#include <span>
+#include <vector>
+
+// Post-transform cache behaviour of an index stream, simulated with a FIFO cache
+struct VertexCacheStats
+{
+	uint32_t triangles = 0;
+	uint32_t uniqueVertices = 0;
+	uint32_t transformedVertices = 0; // cache misses
+
+	// Average cache miss ratio, transformed vertices per triangle (0.5 is the ideal for a large grid, 3 the worst)
+	float acmr() const { return triangles ? static_cast<float>(transformedVertices) / triangles : 0.0f; }
+
+	// Average transform to vertex ratio, 1 means every vertex is shaded once
+	float atvr() const { return uniqueVertices ? static_cast<float>(transformedVertices) / uniqueVertices : 0.0f; }
+
+	VertexCacheStats& operator+=(const VertexCacheStats& other)
+	{
+		triangles += other.triangles;
+		uniqueVertices += other.uniqueVertices;
+		transformedVertices += other.transformedVertices;
+		return *this;
+	}
+};
+
+// Reorders triangles and vertices of imported meshes for the GPU. Every submesh is optimised on its own
+// worker: Tipsify vertex cache ordering, then clusters of that order are sorted so outward facing parts
+// draw first. Finally vertices are renumbered in first-use order so fetches walk the vertex buffer forwards.
+// Submesh index ranges stay where they are, only their contents move.
+class MeshOptimizer
+{
+public:
+	// Simulated cache entries, matches the reuse window of current GPUs closely enough for ordering
+	static constexpr uint32_t CACHE_SIZE = 16;
+
+	// Clusters may split where their ACMR is within this factor of the whole hard cluster's
+	static constexpr float OVERDRAW_THRESHOLD = 1.05f;
+
+	// All three stages, 'before' and 'after' receive the summed cache statistics of the submeshes
+	static void optimize(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, std::span<const Submesh> submeshes,
+		VertexCacheStats* before = nullptr, VertexCacheStats* after = nullptr);
+
+	static VertexCacheStats analyzeVertexCache(std::span<const uint32_t> indices, uint32_t vertexCount, uint32_t cacheSize = CACHE_SIZE);
+
+	// Tipsify (Sander et al. 2007), 'indices' must reference vertices below 'vertexCount'
+	static void optimizeVertexCache(std::span<uint32_t> indices, uint32_t vertexCount, uint32_t cacheSize = CACHE_SIZE);
+
+	// Splits a cache-ordered stream into clusters and sorts them by how much they face away from the mesh centre
+	static void optimizeOverdraw(std::span<uint32_t> indices, std::span<const Vertex> vertices, float threshold = OVERDRAW_THRESHOLD, uint32_t cacheSize = CACHE_SIZE);
+
+	// Renumbers vertices in first-use order, vertices no index references are dropped
+	static void optimizeVertexFetch(std::vector<Vertex>& vertices, std::span<uint32_t> indices);
+};
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "Mesh.hpp"
+
+#include <span>
+#include <vector>
+
+// Builds coarser index ranges for the detail levels of imported meshes. Edges are collapsed onto one of
+// their vertices (Garland-Heckbert quadric error), so every level reuses the vertices of level 0.
+// Attributes are kept by locking vertices on UV and normal seams and by penalising collapses across
+// bent normals; open borders only slide along themselves.
+class MeshSimplifier
+{
+public:
+	// Triangle fraction each level aims for relative to the previous one
+	static constexpr float LOD_TRIANGLE_RATIO = 0.5f;
+
+	// Error budget of level 1 relative to the submesh's bounding radius, doubles with every level
+	static constexpr float LOD_BASE_ERROR = 0.01f;
+
+	// A level has to drop at least this fraction of the previous level's triangles to be kept
+	static constexpr float MIN_LOD_REDUCTION = 0.15f;
+
+	// Appends the levels of every submesh to 'indices' and records them in the submesh, each level vertex cache ordered
+	static void generateLods(std::span<const Vertex> vertices, std::vector<uint32_t>& indices, std::span<Submesh> submeshes);
+
+	// Collapses edges until 'targetIndexCount' is reached or the next collapse would exceed 'maxError'.
+	// Returns the largest error of an applied collapse, in the units of the positions.
+	static float simplify(std::span<const Vertex> vertices, std::span<const uint32_t> indices, size_t targetIndexCount, float maxError,
+		std::vector<uint32_t>& out);
+
+private:
+	// Weight of border planes against surface planes, keeps silhouettes of open meshes in place
+	static constexpr float BORDER_WEIGHT = 10.0f;
+
+	// Weight of the normal change times the edge length, added to the squared geometric error
+	static constexpr float NORMAL_WEIGHT = 0.5f;
+};
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "Mesh.hpp"
+
+#include <span>
+#include <vector>
+
+// Splits the index ranges of every submesh level into meshlets so large submeshes can be culled in parts
+// without mesh shaders. Triangles are regrouped in place, each meshlet ends up as a contiguous index range.
+class MeshletBuilder
+{
+public:
+	// Same limits as the common mesh shader budget, so the clusters stay useful if mesh shaders are added
+	static constexpr uint32_t MAX_VERTICES = 64;
+	static constexpr uint32_t MAX_TRIANGLES = 124;
+
+	// Builds the meshlets of every level of every submesh and records their ranges in the submeshes.
+	// Level 0 meshlets come first in submesh order, so merged level 0 draws keep contiguous meshlet ranges.
+	static void buildMeshlets(std::span<const Vertex> vertices, std::span<uint32_t> indices, std::span<Submesh> submeshes,
+		std::vector<Meshlet>& meshlets);
+
+	// Reorders one index range into meshlets, 'rangeOffset' is the range's position in the index array
+	static void buildRange(std::span<const Vertex> vertices, std::span<uint32_t> range, uint32_t rangeOffset, std::vector<Meshlet>& out);
+
+	static void computeBounds(std::span<const Vertex> vertices, std::span<const uint32_t> triangles, Meshlet& meshlet);
+};
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "Mesh.hpp"
+#include "MeshCache.hpp"
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+class GPUImage;
+
+// Loads models into the global geometry arrays. Each model of a batch is imported (or mapped from its
+// mesh cache) on its own worker into local buffers, then all models are merged in one pass using
+// prefix-sum offsets. The result is identical to loading the models one after another.
+class ModelLoader
+{
+public:
+	ModelLoader(GPUImage& imageClass,
+		std::vector<Vertex>& allVertices,
+		std::vector<uint32_t>& allIndices,
+		std::vector<Mesh>& allMeshes,
+		std::vector<Submesh>& allSubmeshes,
+		std::vector<Meshlet>& allMeshlets,
+		std::vector<Material>& allMaterials);
+
+	// Returns the mesh index of every model, in the order they were given
+	std::vector<uint32_t> loadModels(const std::vector<std::string>& modelPaths);
+	uint32_t loadModel(const std::string& modelPath);
+
+	// Meshes loaded afterwards pick a packed vertex format where it fits, otherwise they stay float
+	void setVertexPacking(bool enabled) { m_packVertices = enabled; }
+
+	// Parse an OBJ with ObjReader (in parallel for large files) and generate MikkTSpace tangents
+	static ModelData importObj(const std::string& modelPath);
+
+	// Offline cook: writes the mesh cache and the cooked texture cache of every model without a GPU
+	static void cookAssets(const std::vector<std::string>& modelPaths, bool blockCompression = true);
+
+private:
+	// Either the mapped mesh cache or a freshly imported model
+	struct LoadedModel
+	{
+		std::filesystem::path directory;
+		CachedModel cached;
+		ModelData imported;
+		ModelView view;
+	};
+
+	GPUImage& m_imageClass;
+	std::vector<Vertex>& m_allVertices;
+	std::vector<uint32_t>& m_allIndices;
+	std::vector<Mesh>& m_allMeshes;
+	std::vector<Submesh>& m_allSubmeshes;
+	std::vector<Meshlet>& m_allMeshlets;
+	std::vector<Material>& m_allMaterials;
+
+	bool m_packVertices = true;
+
+	// Loads every model on its own worker, rethrowing the first failure
+	static void loadAll(const std::vector<std::string>& modelPaths, std::vector<LoadedModel>& models);
+	static void loadSingle(const std::string& modelPath, LoadedModel& out);
+	void resolveTextures(const LoadedModel& model, uint32_t materialOffset);
+};
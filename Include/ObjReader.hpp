@@ -0,0 +1,27 @@
+#pragma once
+
+#include "Mesh.hpp"
+
+#include <tiny_obj_loader.h>
+
+#include <string>
+#include <vector>
+
+// Streaming OBJ reader. The file is memory mapped and parsed in place, chunk by chunk, and every chunk's
+// triangles go straight into the vertex welder, so only the attribute arrays and the welded output are ever
+// held in memory. Faces are triangulated (quads on their shorter diagonal, larger polygons as fans) and a
+// new submesh starts at every 'o'/'g' and at every change of 'usemtl'.
+//
+// Parallel mode splits the file at line boundaries and handles a batch of chunks per step: the attribute
+// lines of every chunk are parsed on all cores, prefix sums place them in the shared arrays, then the faces
+// of every chunk are parsed on all cores and welded in file order. Output is identical to the serial mode.
+class ObjReader
+{
+public:
+	// Files at least this large are parsed in parallel by ModelLoader
+	static constexpr size_t PARALLEL_THRESHOLD = 32ull << 20;
+
+	// Fills vertices, indices, submeshes and bounds of 'model'. MTL libraries are still parsed by tinyobj,
+	// their materials are returned in file order so submesh material indices refer to them.
+	static void read(const std::string& path, ModelData& model, std::vector<tinyobj::material_t>& materials, bool parallel);
+};
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "AABB.hpp"
+#include "Vertex.hpp"
+
+#include <span>
+#include <vector>
+
+// CPU occlusion culling against a low resolution depth buffer. Occluder triangles are clipped, set up and
+// binned into horizontal bands, every band is rasterized by its own task with SIMD rows. Rasterization is
+// conservative: a triangle only writes pixels it covers whole, with the farthest depth it reaches inside
+// them, and every 8x4 tile keeps the farthest of its pixels. A box is only reported hidden where occluder
+// geometry lies in front of all of it. Triangles smaller than a buffer pixel never occlude.
+class OcclusionCuller
+{
+public:
+	static constexpr uint32_t WIDTH = 320;
+	static constexpr uint32_t HEIGHT = 192;
+	static constexpr uint32_t TILE_WIDTH = 8;
+	static constexpr uint32_t TILE_HEIGHT = 4;
+	static constexpr uint32_t BAND_HEIGHT = 16; // rows per raster task, whole tiles
+
+	// Triangles per setup task
+	static constexpr uint32_t SETUP_BATCH = 1024;
+
+	// Starts a frame, 'viewProj' maps to Vulkan clip space (depth 0 at the near plane, y down)
+	void begin(const glm::mat4& viewProj);
+
+	// One occluder's triangles, 'indices' index 'vertices'. Back faces are skipped for single sided materials,
+	// with counter-clockwise front faces as the pipelines use. The spans must live until rasterize() returns.
+	void addOccluder(std::span<const Vertex> vertices, std::span<const uint32_t> indices, const glm::mat4& model, bool cullBackFaces);
+
+	void rasterize();
+
+	// False only if every buffer pixel the box's projection touches holds an occluder nearer than the box
+	bool isVisible(const AABB& worldBounds) const;
+
+	uint32_t getTriangleCount() const { return m_triangleCount; }
+	const std::vector<float>& getDepth() const { return m_depth; }
+
+private:
+	// Screen space triangle ready for the band rasterizers
+	struct ScreenTriangle
+	{
+		float edgeA[3], edgeB[3], edgeC[3]; // edge k is edgeA[k] * x + edgeB[k] * y + edgeC[k], pixel centres covered whole where all three are >= 0
+		float depthA, depthB, depthC; // farthest depth inside the pixel centred at (x, y)
+		float maxDepth;
+		uint16_t minX, maxX, minY, maxY; // pixels that may be covered whole
+	};
+
+	struct Occluder
+	{
+		std::span<const Vertex> vertices;
+		std::span<const uint32_t> indices;
+		glm::mat4 modelViewProj;
+		bool cullBackFaces;
+	};
+
+	glm::mat4 m_viewProj{ 1.0f };
+	std::vector<Occluder> m_occluders;
+
+	// Setup output per batch, band lists hold batch * SETUP_BATCH + index
+	std::vector<std::vector<ScreenTriangle>> m_batchTriangles;
+	std::vector<std::vector<uint32_t>> m_bandTriangles;
+	uint32_t m_triangleCount = 0;
+
+	std::vector<float> m_depth = std::vector<float>(WIDTH * HEIGHT, 1.0f);
+	std::vector<float> m_tileMaxDepth = std::vector<float>((WIDTH / TILE_WIDTH) * (HEIGHT / TILE_HEIGHT), 1.0f);
+
+	void setupBatch(const Occluder& occluder, uint32_t firstTriangle, std::vector<ScreenTriangle>& out) const;
+	void rasterizeBand(uint32_t band);
+};
@@ -5,6 +5,7 @@
 
 #include "volk.h"
 #include "glm.hpp"
+#include "Vertex.hpp"
 
 class VulkanContext;
 class Swapchain;
@@ -22,7 +23,7 @@ enum class PipelineType
 class Pipeline
 {
 public:
-	Pipeline(VulkanContext& context, Swapchain& swapchain, DescriptorManager& descriptors, uint32_t pushConstantsSize, const std::string& vertPath, const std::string& fragPath, VkFormat depthFormat, PipelineType type = PipelineType::Scene);
+	Pipeline(VulkanContext& context, Swapchain& swapchain, DescriptorManager& descriptors, uint32_t pushConstantsSize, const std::string& vertPath, const std::string& fragPath, VkFormat depthFormat, PipelineType type = PipelineType::Scene, VertexFormat vertexFormat = VertexFormat::Float);
 	~Pipeline();
 
 	Pipeline(const Pipeline&) = delete;
@@ -42,7 +43,7 @@ public:
 private:
 	VkShaderModule createShaderModule(const std::vector<char>& code);
 	std::vector<char> readFile(const std::string& filename);
-	void createPipeline(const std::string& vertPath, const std::string& fragPath, VkFormat colorFormat, VkFormat depthFormat, PipelineType type, uint32_t pushConstantsSize);
+	void createPipeline(const std::string& vertPath, const std::string& fragPath, VkFormat colorFormat, VkFormat depthFormat, PipelineType type, VertexFormat vertexFormat, uint32_t pushConstantsSize);
 
 	VulkanContext& m_context;
 	Swapchain& m_swapchain;
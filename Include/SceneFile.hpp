@@ -0,0 +1,93 @@
+#pragma once
+
+#include "Lights.hpp"
+
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Size of the shaders' point light array
+static constexpr uint32_t MAX_POINT_LIGHTS = 128;
+
+// Per-object data as the shaders read it, binary scenes store their instances in this layout
+struct ObjectData
+{
+	glm::mat4 model;
+	uint32_t meshIndex;
+	uint32_t isVisible = 0; // set by frustum culling or game logic
+	uint32_t padding2 = 0;
+	uint32_t padding3 = 0;
+};
+
+struct LightingData
+{
+	DirectionalLight dirLight;
+	uint32_t numPointLights = 0;
+	alignas(16) PointLight pointLights[MAX_POINT_LIGHTS];
+};
+
+// Camera and projection of a scene, stored as-is in the binary header
+struct SceneSettings
+{
+	float nearPlane = 0.1f;
+	float farPlane = 200.0f;
+	float fovY = 60.0f; // degrees
+	float cameraYaw = -90.0f;
+	glm::vec3 cameraPosition{ 0.0f, 2.0f, 8.0f };
+	float cameraPitch = 0.0f;
+	float sunOrbitSpeed = 0.0f; // degrees per second around the vertical axis, the sun keeps its height
+	uint32_t padding[3]{};
+};
+
+// Instance turning around its own vertical axis, model = base * rotation * scale
+struct SceneSpin
+{
+	glm::mat4 base; // translation and authored rotation
+	glm::vec3 scale;
+	float degreesPerSecond;
+	uint32_t objectIndex;
+	uint32_t padding[3];
+};
+
+// Everything of a scene that is not copied into the GPU facing arrays
+struct SceneDescription
+{
+	SceneSettings settings;
+	DirectionalLight sun{ glm::vec4(0.0f, -1.0f, 0.0f, 0.0f), glm::vec4(1.0f) }; // authored sun, animation starts from it
+	std::string skybox;
+	std::vector<std::string> modelPaths; // ObjectData::meshIndex indexes this list, only these models are loaded
+	std::vector<SceneSpin> spins;
+	std::vector<uint32_t> occluders; // objects always rendered into the occlusion buffer while in view
+};
+
+// Scenes are authored as line based text (.scene) and loaded from a compiled binary (.vkscene) written next to it.
+//
+//   skybox <name>
+//   camera [position x y z] [yaw deg] [pitch deg] [fov deg] [near n] [far n]
+//   model <name> <path relative to the scene file>
+//   sun direction x y z color r g b [orbit deg/s]
+//   light position x y z color r g b radius r
+//   instance <model name> [position x y z] [rotation x y z] [scale s | scale x y z] [spin deg/s] [occluder]
+//
+// '#' starts a comment. Rotations are Euler angles in degrees, applied as Y * X * Z.
+class SceneFile
+{
+public:
+	// Text scenes are compiled on first use and while the text changes, '.vkscene' files are loaded as they are.
+	// Objects and point lights are copied straight out of the mapped binary. Model paths come back resolved.
+	static void load(const std::filesystem::path& path, SceneDescription& scene, std::vector<ObjectData>& objects, LightingData& lights);
+
+	static std::filesystem::path getBinaryPath(const std::filesystem::path& textPath);
+
+	// Throws with the file name and line on syntax errors and unknown model names
+	static void parseText(std::string_view text, const std::string& sourceName, SceneDescription& scene,
+		std::vector<ObjectData>& objects, LightingData& lights);
+
+	static void writeBinary(const std::filesystem::path& binaryPath, uint64_t sourceHash, const SceneDescription& scene,
+		const std::vector<ObjectData>& objects, const LightingData& lights);
+
+	// Returns false if the binary is missing, damaged or, for a non-zero 'sourceHash', compiled from other text
+	static bool loadBinary(const std::filesystem::path& binaryPath, uint64_t sourceHash, SceneDescription& scene,
+		std::vector<ObjectData>& objects, LightingData& lights);
+};
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <chrono>
+#include <iostream>
+
+// Timer for CPU benchmarking
+using Clock = std::chrono::high_resolution_clock;
+using ms = std::chrono::duration<double, std::milli>;
+struct ScopedTimer
+{
+	const char* label;
+	Clock::time_point start;
+
+	ScopedTimer(const char* lbl) : label(lbl), start(Clock::now()) {}
+	~ScopedTimer()
+	{
+		auto end = Clock::now();
+		double elapsed = std::chrono::duration_cast<ms>(end - start).count();
+		std::cout << label << ": " << elapsed << " ms" << std::endl;
+	}
+};
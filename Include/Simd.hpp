@@ -0,0 +1,71 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// Float lanes of the instruction set the including file is compiled for (AVX-512, AVX2, SSE2, scalar).
+// Comparisons come back as a bit per lane, so the kernels above read the same on every width.
+class Simd
+{
+public:
+#if defined(__AVX512F__)
+	static constexpr uint32_t LANE_WIDTH = 16;
+	static constexpr const char* INSTRUCTION_SET = "AVX-512";
+	using Floats = __m512;
+	static Floats load(const float* p) { return _mm512_loadu_ps(p); }
+	static void store(float* p, Floats value) { _mm512_storeu_ps(p, value); }
+	static Floats broadcast(float value) { return _mm512_set1_ps(value); }
+	static Floats add(Floats a, Floats b) { return _mm512_add_ps(a, b); }
+	static Floats mulAdd(Floats a, Floats b, Floats c) { return _mm512_fmadd_ps(a, b, c); }
+	static Floats min(Floats a, Floats b) { return _mm512_min_ps(a, b); }
+	static uint32_t nonNegativeMask(Floats value) { return _mm512_cmp_ps_mask(value, _mm512_setzero_ps(), _CMP_GE_OQ); }
+#elif defined(__AVX2__)
+	static constexpr uint32_t LANE_WIDTH = 8;
+	static constexpr const char* INSTRUCTION_SET = "AVX2";
+	using Floats = __m256;
+	static Floats load(const float* p) { return _mm256_loadu_ps(p); }
+	static void store(float* p, Floats value) { _mm256_storeu_ps(p, value); }
+	static Floats broadcast(float value) { return _mm256_set1_ps(value); }
+	static Floats add(Floats a, Floats b) { return _mm256_add_ps(a, b); }
+	static Floats mulAdd(Floats a, Floats b, Floats c) { return _mm256_add_ps(_mm256_mul_ps(a, b), c); }
+	static Floats min(Floats a, Floats b) { return _mm256_min_ps(a, b); }
+	static uint32_t nonNegativeMask(Floats value) { return _mm256_movemask_ps(_mm256_cmp_ps(value, _mm256_setzero_ps(), _CMP_GE_OQ)); }
+#elif defined(_M_X64) || defined(__SSE2__)
+	static constexpr uint32_t LANE_WIDTH = 4;
+	static constexpr const char* INSTRUCTION_SET = "SSE2";
+	using Floats = __m128;
+	static Floats load(const float* p) { return _mm_loadu_ps(p); }
+	static void store(float* p, Floats value) { _mm_storeu_ps(p, value); }
+	static Floats broadcast(float value) { return _mm_set1_ps(value); }
+	static Floats add(Floats a, Floats b) { return _mm_add_ps(a, b); }
+	static Floats mulAdd(Floats a, Floats b, Floats c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+	static Floats min(Floats a, Floats b) { return _mm_min_ps(a, b); }
+	static uint32_t nonNegativeMask(Floats value) { return _mm_movemask_ps(_mm_cmpge_ps(value, _mm_setzero_ps())); }
+#else
+	static constexpr uint32_t LANE_WIDTH = 1;
+	static constexpr const char* INSTRUCTION_SET = "scalar";
+	using Floats = float;
+	static Floats load(const float* p) { return *p; }
+	static void store(float* p, Floats value) { *p = value; }
+	static Floats broadcast(float value) { return value; }
+	static Floats add(Floats a, Floats b) { return a + b; }
+	static Floats mulAdd(Floats a, Floats b, Floats c) { return a * b + c; }
+	static Floats min(Floats a, Floats b) { return std::min(a, b); }
+	static uint32_t nonNegativeMask(Floats value) { return value >= 0.0f ? 1u : 0u; }
+#endif
+
+	static constexpr uint32_t ALL_LANES = (1u << LANE_WIDTH) - 1;
+
+	// 0, 1, 2, ... across the lanes
+	static Floats laneIndices()
+	{
+		static constexpr float INDICES[16] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15 };
+		return load(INDICES);
+	}
+};
@@ -1,36 +1,42 @@
 #pragma once
 
-#include "Vertex.hpp"
+#include "Mesh.hpp"
 #include "mikktspace.h"
 
+#include <span>
 #include <vector>
 
-struct MikkTSpaceData
+// Triangle corners of one submesh, gathered into contiguous arrays so MikkTSpace reads them directly
+// instead of going through the index buffer for every callback
+struct TangentCorners
 {
-	// Pointers to global data buffers
-	std::vector<Vertex>* allVerticesPtr;
-	const std::vector<uint32_t>* allIndicesPtr;
-	
-	// Offsets/Counts for the current mesh/submesh
-	uint32_t vertexOffset;
-	uint32_t indexOffset;
-	uint32_t indexCount;
+	std::vector<glm::vec3> positions;
+	std::vector<glm::vec3> normals;
+	std::vector<glm::vec2> texCoords;
 };
 
 class TangentGenerator
 {
 public:
-	// Call once to get the static interface used for MikkTSpace
-	static SMikkTSpaceInterface& GetInterface();
-
-	// Call to run the calculation for a submesh
-	static void CalculateTangents(MikkTSpaceData& data);
+	// Tangents for all submeshes of a model, every submesh on its own worker. MikkTSpace writes one tangent
+	// per corner; a vertex shared by several corners takes the one of its last corner in index order. That
+	// is what generating the submeshes one after another produced, so the result never depends on scheduling.
+	static void GenerateTangents(std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, std::span<const Submesh> submeshes);
+
+	// Copies the corners of an index range, indices are relative to 'vertices'
+	static void GatherCorners(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices,
+		uint32_t indexOffset, uint32_t indexCount, TangentCorners& out);
+
+	// Runs MikkTSpace over gathered corners, 'tangents' receives one tangent per corner with the
+	// bitangent sign in w. This still goes through the SMikkTSpaceInterface callbacks: the library has
+	// no bulk entry point, and a reimplementation would have to match its vertex welding and splitting
+	// exactly or normal maps baked against MikkTSpace shade wrong. The callbacks are plain array reads
+	// into the gathered corners
+	static void CalculateTangents(const TangentCorners& corners, std::span<glm::vec4> tangents);
 
 private:
-	// Static MikkTSpace callbacks
-
-	// Helper to get the index into the global allVertices array
-	static uint32_t get_global_vertex_index(const SMikkTSpaceContext* context, int iface, int iVert);
+	// Call once to get the static interface used for MikkTSpace
+	static SMikkTSpaceInterface& GetInterface();
 
 	// SMikkTIinterace required functions
 	static int get_num_faces(const SMikkTSpaceContext* context);
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "TextureCooker.hpp"
+
+#include <filesystem>
+#include <string>
+
+// Cooked texture container (.vktex), written next to the source image after the first cook. KTX2-like
+// layout: a header, a level index with the offset and size of every mip, then the encoded levels.
+// Keyed by a hash of the source image, the texture type with its mip settings and whether block
+// compression was used.
+class TextureCache
+{
+public:
+	static std::filesystem::path getCachePath(const std::filesystem::path& sourcePath, TextureType type);
+
+	// FNV-1a over the source image
+	static uint64_t hashSource(const std::filesystem::path& sourcePath);
+
+	// Returns false if the cache is missing, stale or was written by an older format version
+	static bool load(const std::filesystem::path& sourcePath, uint64_t sourceHash, TextureType type, bool blockCompression, CookedTexture& out);
+	static void store(const std::filesystem::path& sourcePath, uint64_t sourceHash, const CookedTexture& texture);
+
+	// Maps the cooked texture, decoding and cooking the source image first if the cache can't be used
+	static void prepare(const std::string& path, TextureType type, bool blockCompression, CookedTexture& out);
+};
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "MappedFile.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+enum class TextureFormat : uint32_t
+{
+	RGBA8, // uncompressed, for devices without BC support
+	BC4, // single channel data
+	BC5, // two channel data, tangent space normal maps
+	BC7 // color, and normal maps with Toksvig factor in alpha
+};
+
+enum class TextureType : uint32_t
+{
+	Color, // sRGB
+	Normal, // tangent space normals, renormalized after filtering
+	Data // any other linear data
+};
+
+enum class MipFilter : uint32_t
+{
+	Box, // exact area average, no ringing
+	Kaiser // Kaiser-windowed sinc, keeps detail sharper in lower mips
+};
+
+struct MipSettings
+{
+	MipFilter filter;
+
+	// Normal maps only. Stores the length of the filtered, unnormalized normal in alpha so the shader can
+	// widen the specular lobe where a texel covers bumpy detail.
+	bool toksvig;
+};
+
+struct TextureLevel
+{
+	uint32_t width;
+	uint32_t height;
+	uint64_t offset; // from the start of the texture's data, 16 byte aligned
+	uint64_t size;
+};
+
+// A texture ready for upload, every mip level already encoded back to back in 'data'. The data is either
+// mapped from the texture cache or owned by 'storage' after a fresh cook.
+struct CookedTexture
+{
+	TextureFormat format = TextureFormat::RGBA8;
+	TextureType type = TextureType::Color;
+	std::vector<TextureLevel> levels;
+
+	MappedFile file;
+	std::vector<std::byte> storage;
+	std::span<const std::byte> data;
+};
+
+// Turns decoded RGBA8 pixels into a CookedTexture. Mips are computed on the CPU and every level is block
+// compressed by BlockEncoder, so uploading a cooked texture is a plain copy per level.
+class TextureCooker
+{
+public:
+	// Color maps become BC7, normal maps BC5 (BC7 with Toksvig), grayscale data BC4 and other data BC7.
+	// Without block compression everything stays RGBA8.
+	static TextureFormat chooseFormat(const uint8_t* rgba, uint32_t width, uint32_t height, TextureType type, bool blockCompression);
+
+	// Filter and Toksvig setting used for every texture of a type
+	static MipSettings getMipSettings(TextureType type);
+
+	// Builds the full mip chain. Color is filtered in linear space, normals as vectors.
+	static void cook(const uint8_t* rgba, uint32_t width, uint32_t height, TextureFormat format, TextureType type, CookedTexture& out);
+
+	static uint64_t levelSize(TextureFormat format, uint32_t width, uint32_t height);
+
+private:
+	static void encodeLevel(const uint8_t* rgba, uint32_t width, uint32_t height, TextureFormat format, std::byte* out);
+};
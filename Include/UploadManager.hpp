@@ -0,0 +1,136 @@
+#pragma once
+
+#include "volk.h"
+#include "vk_mem_alloc.h"
+
+#include <cstddef>
+#include <deque>
+#include <span>
+#include <vector>
+
+class VulkanContext;
+
+// Upload counters since startup, 'ringBytesInUse' is a snapshot
+struct UploadStats
+{
+	uint64_t bytesUploaded = 0;
+	uint32_t submissions = 0;
+	uint32_t stalls = 0; // times an upload had to wait for the GPU to free ring space
+	uint32_t dedicatedBuffers = 0; // uploads too large for the ring
+	bool asyncQueue = false; // uploads run on their own queue
+	VkDeviceSize ringCapacity = 0;
+	VkDeviceSize ringBytesInUse = 0;
+	VkDeviceSize ringPeakBytes = 0;
+
+	// Bytes per second over the batches retired in the last stats window
+	double throughput = 0.0;
+};
+
+// Persistent, mapped staging ring shared by every subsystem that uploads to device local memory.
+// Uploads are copied into the ring right away and their transfer commands collect in one command
+// buffer, which flush() submits as a batch (once per frame in the render loop). Every batch signals
+// a timeline value, ring space is handed back in submission order as those values complete, so nothing
+// waits on the queue unless the ring is full.
+//
+// With a transfer queue the batches run next to rendering. A small acquire batch on the graphics queue
+// waits for each one on the GPU and takes ownership of its resources when the families differ.
+class UploadManager
+{
+public:
+	UploadManager(VulkanContext& context, VkDeviceSize ringCapacity);
+	~UploadManager();
+
+	UploadManager(const UploadManager&) = delete;
+	UploadManager& operator=(const UploadManager&) = delete;
+
+	// Destinations must not be in use on the graphics queue, their ownership moves to the transfer queue.
+	// Large buffers are split into ring sized chunks.
+	void uploadBuffer(VkBuffer dstBuffer, VkDeviceSize dstOffset, const void* data, VkDeviceSize size);
+
+	// 'image' must be in UNDEFINED layout and ends up in SHADER_READ_ONLY_OPTIMAL. The regions' bufferOffset
+	// is relative to 'data'.
+	void uploadImage(VkImage image, uint32_t mipLevels, uint32_t arrayLayers, std::span<const std::byte> data, std::span<const VkBufferImageCopy> regions);
+
+	// Submits the pending batch. Later submissions on the graphics queue see its results.
+	void flush();
+
+	// Submits and blocks until every upload has completed
+	void waitIdle();
+
+	const UploadStats& getStats() const { return m_stats; }
+
+private:
+	struct StagingAllocation
+	{
+		VkBuffer buffer;
+		VmaAllocation allocation;
+		VkDeviceSize offset;
+		std::byte* mapped;
+	};
+
+	// A submitted batch, its ring bytes are released when the transfer timeline reaches 'value'
+	struct Batch
+	{
+		VkCommandBuffer cmd = VK_NULL_HANDLE;
+		uint64_t value = 0;
+		VkDeviceSize ringBytes = 0;
+		VkDeviceSize uploadBytes = 0;
+
+		// Staging buffers of uploads that did not fit the ring
+		std::vector<std::pair<VkBuffer, VmaAllocation>> dedicated;
+
+		// Acquire halves of the queue family ownership transfers, recorded on the graphics queue
+		std::vector<VkBufferMemoryBarrier2> bufferAcquires;
+		std::vector<VkImageMemoryBarrier2> imageAcquires;
+	};
+
+	VulkanContext& m_context;
+
+	// Async: batches go to a queue other than the graphics queue.
+	// Ownership: that queue is in another family, resources are released and acquired.
+	bool m_async = false;
+	bool m_ownershipTransfer = false;
+
+	VkCommandPool m_transferPool = VK_NULL_HANDLE;
+	VkCommandPool m_graphicsPool = VK_NULL_HANDLE;
+	std::vector<VkCommandBuffer> m_freeTransferCommands;
+	std::vector<VkCommandBuffer> m_freeGraphicsCommands;
+
+	// Transfer batches signal 'm_transferTimeline', their acquire batches 'm_graphicsTimeline', with the same value
+	VkSemaphore m_transferTimeline = VK_NULL_HANDLE;
+	VkSemaphore m_graphicsTimeline = VK_NULL_HANDLE;
+	uint64_t m_submitValue = 0;
+
+	// Ring, 'm_head' is where the next allocation goes, 'm_used' counts bytes not yet released
+	VkBuffer m_ringBuffer = VK_NULL_HANDLE;
+	VmaAllocation m_ringAllocation = VK_NULL_HANDLE;
+	std::byte* m_ringMapped = nullptr;
+	VkDeviceSize m_capacity = 0;
+	VkDeviceSize m_head = 0;
+	VkDeviceSize m_used = 0;
+
+	// Batch being recorded
+	Batch m_pending;
+
+	std::deque<Batch> m_inFlight;
+	std::deque<std::pair<uint64_t, VkCommandBuffer>> m_acquiresInFlight;
+
+	UploadStats m_stats;
+	double m_windowStart = 0.0;
+	uint64_t m_windowBytes = 0;
+
+	// Returns false if the ring can't fit 'size' bytes right now
+	bool tryAllocate(VkDeviceSize size, VkDeviceSize alignment, StagingAllocation& out);
+
+	// Ring space if it fits at all, waiting for older batches if needed, else a dedicated staging buffer
+	StagingAllocation allocate(VkDeviceSize size, VkDeviceSize alignment);
+
+	VkCommandBuffer pendingCommands();
+	VkCommandBuffer beginCommands(VkCommandPool pool, std::vector<VkCommandBuffer>& freeList, const char* name);
+
+	// Graphics queue side of a batch, waits for its transfer value on the GPU
+	void submitAcquire(uint64_t value);
+
+	// Releases the ring space of completed batches, optionally waiting for the oldest one first
+	void retire(bool waitForOldest);
+};
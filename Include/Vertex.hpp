@@ -1,12 +1,35 @@
 #pragma once
 
 #include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
 #include "volk.h"
 #include "glm.hpp"
 
 #define GLM_ENABLE_EXPERIMENTAL
 #include <gtx/hash.hpp>
 
+// Layout of a mesh in the GPU vertex buffer, picked per mesh when the buffer is built
+enum class VertexFormat : uint32_t
+{
+	Float, // Vertex as is, 48 bytes
+	Packed, // PackedVertex, 20 bytes
+	PackedNoTangent, // PackedVertex without the tangent, 16 bytes, for meshes without normal maps
+	Count
+};
+
+// Compressed vertex, decoded in the vertex shader.
+// Position is quantised to the mesh AABB (MeshGPUData holds offset and scale), its w stores the tangent sign.
+// Normal and tangent are octahedral encoded, UVs are half floats.
+struct PackedVertex
+{
+	uint16_t pos[4]; // R16G16B16A16_UNORM
+	int16_t normal[2]; // R16G16_SNORM
+	uint16_t texCoord[2]; // R16G16_SFLOAT
+	int16_t tangent[2]; // R16G16_SNORM, left out by PackedNoTangent
+};
+
 struct Vertex
 {
 	glm::vec3 pos;
@@ -14,19 +37,34 @@ struct Vertex
 	glm::vec2 texCoord;
 	glm::vec4 tangent;
 
-	static VkVertexInputBindingDescription getBindingDescription()
+	static uint32_t getStride(VertexFormat format)
+	{
+		switch (format)
+		{
+			case VertexFormat::Packed: return sizeof(PackedVertex);
+			case VertexFormat::PackedNoTangent: return offsetof(PackedVertex, tangent);
+			default: return sizeof(Vertex);
+		}
+	}
+
+	static VkVertexInputBindingDescription getBindingDescription(VertexFormat format = VertexFormat::Float)
 	{
 		VkVertexInputBindingDescription bindingDescription{};
 		bindingDescription.binding = 0;
-		bindingDescription.stride = sizeof(Vertex);
+		bindingDescription.stride = getStride(format);
 		bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
 
 		return bindingDescription;
 	}
 
-	static std::array<VkVertexInputAttributeDescription, 4> getAttributeDescription()
+	static std::vector<VkVertexInputAttributeDescription> getAttributeDescription(VertexFormat format = VertexFormat::Float)
 	{
-		std::array<VkVertexInputAttributeDescription, 4> attributeDescriptions{};
+		if (format != VertexFormat::Float)
+		{
+			return getPackedAttributeDescription(format);
+		}
+
+		std::vector<VkVertexInputAttributeDescription> attributeDescriptions(4);
 
 		// Position
 		attributeDescriptions[0].binding = 0;
@@ -55,6 +93,41 @@ struct Vertex
 		return attributeDescriptions;
 	}
 
+	// Same locations as the float layout, the vertex shader's PACKED_VERTEX variant decodes them
+	static std::vector<VkVertexInputAttributeDescription> getPackedAttributeDescription(VertexFormat format)
+	{
+		std::vector<VkVertexInputAttributeDescription> attributeDescriptions(format == VertexFormat::Packed ? 4 : 3);
+
+		// Quantised position + tangent sign
+		attributeDescriptions[0].binding = 0;
+		attributeDescriptions[0].location = 0;
+		attributeDescriptions[0].format = VK_FORMAT_R16G16B16A16_UNORM;
+		attributeDescriptions[0].offset = offsetof(PackedVertex, pos);
+
+		// Octahedral normal
+		attributeDescriptions[1].binding = 0;
+		attributeDescriptions[1].location = 1;
+		attributeDescriptions[1].format = VK_FORMAT_R16G16_SNORM;
+		attributeDescriptions[1].offset = offsetof(PackedVertex, normal);
+
+		// Half float TexCoord
+		attributeDescriptions[2].binding = 0;
+		attributeDescriptions[2].location = 2;
+		attributeDescriptions[2].format = VK_FORMAT_R16G16_SFLOAT;
+		attributeDescriptions[2].offset = offsetof(PackedVertex, texCoord);
+
+		// Octahedral tangent
+		if (format == VertexFormat::Packed)
+		{
+			attributeDescriptions[3].binding = 0;
+			attributeDescriptions[3].location = 3;
+			attributeDescriptions[3].format = VK_FORMAT_R16G16_SNORM;
+			attributeDescriptions[3].offset = offsetof(PackedVertex, tangent);
+		}
+
+		return attributeDescriptions;
+	}
+
 	bool operator==(const Vertex& other) const {
 		return pos == other.pos && normal == other.normal && texCoord == other.texCoord;
 	}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "Mesh.hpp"
+
+#include <cstddef>
+#include <span>
+#include <vector>
+
+// Builds the GPU vertex buffer from the float vertex arrays. Every mesh is written in its own VertexFormat,
+// starting at a multiple of that format's stride so draws address it with a plain vertexOffset.
+class VertexPacker
+{
+public:
+	// Half float UVs keep a step of 1/1024 or finer below this magnitude, tiled meshes stay float
+	static constexpr float MAX_PACKED_UV = 2.0f;
+
+	// Packed unless the UVs are out of half float range, tangents only when a material has a normal map
+	static VertexFormat chooseFormat(std::span<const Vertex> vertices, bool hasNormalMaps);
+
+	// Writes every mesh and sets its gpuVertexOffset, 'meshData' receives one record per mesh
+	static std::vector<std::byte> buildVertexStream(std::span<const Vertex> vertices, std::span<Mesh> meshes, std::vector<MeshGPUData>& meshData);
+
+	// 'out' holds vertices.size() * Vertex::getStride(format) bytes
+	static void packVertices(std::span<const Vertex> vertices, const AABB& bounds, VertexFormat format, std::byte* out);
+
+	static glm::vec2 encodeOctahedral(const glm::vec3& direction);
+};
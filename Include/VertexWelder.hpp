@@ -0,0 +1,35 @@
+#pragma once
+
+#include "Vertex.hpp"
+
+#include <vector>
+
+// Deduplicates vertices while a mesh is built. Open-addressing table with linear probing, sized up front
+// from the corner count, hashing the raw bits of position, normal and texCoord. A corner costs one hash
+// and one probe sequence, which either finds the existing vertex or claims the empty slot it stopped at.
+class VertexWelder
+{
+public:
+	// Unique vertices are appended to 'vertices', expectedCorners is an upper bound used to pre-size the table
+	VertexWelder(std::vector<Vertex>& vertices, size_t expectedCorners);
+
+	// Returns the index of the vertex in 'vertices', appending it if it hasn't been seen before
+	uint32_t weld(const Vertex& vertex);
+
+	static uint64_t hash(const Vertex& vertex);
+
+private:
+	struct Slot
+	{
+		uint32_t tag; // upper hash bits, rejects most mismatches without touching the vertex array
+		uint32_t index = EMPTY;
+	};
+	static constexpr uint32_t EMPTY = UINT32_MAX;
+
+	std::vector<Vertex>& m_vertices;
+	std::vector<Slot> m_slots;
+	size_t m_mask = 0;
+	size_t m_count = 0;
+
+	void rehash(size_t capacity);
+};
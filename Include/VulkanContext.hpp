@@ -22,9 +22,24 @@ public:
 	VkPhysicalDevice getPhysicalDevice() const { return m_physicalDevice; }
 	VkQueue getGraphicsQueue() const { return m_graphicsQueue; }
 	int getGraphicsQueueFamilyIndex() const { return m_graphicsQueueFamilyIndex; }
+
+	// Queue for uploads. Without a second queue it is the graphics queue itself.
+	VkQueue getTransferQueue() const { return m_transferQueue; }
+	int getTransferQueueFamilyIndex() const { return m_transferQueueFamilyIndex; }
+	bool hasAsyncTransferQueue() const { return m_transferQueue != m_graphicsQueue; }
+
 	VkSurfaceKHR getSurface() const { return m_surface; }
 	VmaAllocator getAllocator() const { return m_allocator; }
 
+	// Cooked textures fall back to RGBA8 when BC formats can't be sampled
+	bool supportsTextureCompressionBC() const { return m_textureCompressionBC; }
+
+	// Shadow casters in front of a cascade's near plane still render when depth is clamped
+	bool supportsDepthClamp() const { return m_depthClamp; }
+
+	// Multi draw indirect with a GPU-written draw count, the GPU-driven path needs both
+	bool supportsDrawIndirectCount() const { return m_drawIndirectCount; }
+
 private:
 	void initInstance();
 	void initDebugMessenger();
@@ -39,6 +54,7 @@ private:
 	VkDevice m_device = VK_NULL_HANDLE;
 	VkQueue m_graphicsQueue = VK_NULL_HANDLE;
 	VkQueue m_presentQueue = VK_NULL_HANDLE;
+	VkQueue m_transferQueue = VK_NULL_HANDLE;
 	VkSurfaceKHR m_surface = VK_NULL_HANDLE;
 
 	VmaAllocator m_allocator = VK_NULL_HANDLE;
@@ -47,6 +63,12 @@ private:
 	
 	int32_t m_graphicsQueueFamilyIndex = -1;
 	int32_t m_presentQueueFamilyIndex = -1;
+	int32_t m_transferQueueFamilyIndex = -1;
+	uint32_t m_transferQueueIndex = 0;
+
+	bool m_textureCompressionBC = false;
+	bool m_depthClamp = false;
+	bool m_drawIndirectCount = false;
 
 	// Validation layer callback
 	static VKAPI_ATTR VkBool32 VKAPI_CALL debugCallback(
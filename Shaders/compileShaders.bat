@@ -3,6 +3,8 @@
 cd /d "%~dp0"
 
 glslc shader.vert -o vert.spv
+glslc -DPACKED_VERTEX shader.vert -o vert_packed.spv
+glslc -DPACKED_VERTEX -DNO_TANGENT shader.vert -o vert_packed_notangent.spv
 glslc shader.frag -o frag.spv
 
 glslc skybox.vert -o skyboxvert.spv
@@ -12,4 +14,8 @@ glslc debug.vert -o debug_vert.spv
 glslc debug.frag -o debug_frag.spv
 
 glslc shadow.vert -o shadow_vert.spv
+glslc -DPACKED_VERTEX shadow.vert -o shadow_vert_packed.spv
 glslc shadow.frag -o shadow_frag.spv
+
+glslc cull.comp -o cull_comp.spv
+glslc cull_draws.comp -o cull_draws_comp.spv
@@ -146,6 +146,8 @@ void main() {
 	//outColor = vec4(normalize(fragNormal) * 0.5 + 0.5, 1.0);
 
     vec3 N = normalize(fragNormal);
+    float specularPower = shininess;
+    float specularScale = specularStrength;
 
     if (pc.normalTextureIndex != NO_TEXTURE && pc.enableNormalMaps != 0)
     {
@@ -155,10 +157,19 @@ void main() {
 
         vec4 normalSample = texture(nonuniformEXT(tex[pc.normalTextureIndex]), fragTexCoord);
 
-        // Transform the sampled RGB [0, 1] into a normal vector in tangent space [-1, 1]
-        vec3 sampledNormal = normalize(normalSample.rgb * 2.0 - 1.0);
+        // Transform the sampled RG [0, 1] into a normal vector in tangent space [-1, 1].
+        // Z is reconstructed, BC5 normal maps only store X and Y
+        vec2 sampledXY = normalSample.rg * 2.0 - 1.0;
+        vec3 sampledNormal = normalize(vec3(sampledXY, sqrt(max(1.0 - dot(sampledXY, sampledXY), 0.0))));
 
         N = normalize(TBN * sampledNormal);
+
+        // Toksvig: alpha holds the length of the filtered normal, short normals widen the highlight.
+        // Normal maps cooked without it read alpha as 1, which leaves the material unchanged.
+        float normalLength = clamp(normalSample.a, 0.0001, 1.0);
+        float toksvig = normalLength / (normalLength + shininess * (1.0 - normalLength));
+        specularPower = toksvig * shininess;
+        specularScale *= (1.0 + specularPower) / (1.0 + shininess);
     }
 
     vec3 V = normalize(pc.cameraPos - fragPos);
@@ -258,8 +269,8 @@ void main() {
         float diff = max(dot(N, Ldir), 0.0);
         diffuse += diff * albedo * lighting.dirLight.color.rgb * shadowFactor;
 
-        float specAmount = pow(max(dot(N, H), 0.0), shininess);
-        specular += specAmount * specularStrength * lighting.dirLight.color.rgb * shadowFactor;
+        float specAmount = pow(max(dot(N, H), 0.0), specularPower);
+        specular += specAmount * specularScale * lighting.dirLight.color.rgb * shadowFactor;
     }
 
     // Point lights
@@ -286,8 +297,8 @@ void main() {
             diffuse += diffPoint * albedo * lighting.pointLights[i].color.rgb * attenuation;
 
             // Specular
-            float specPoint = pow(max(dot(N, Hpoint), 0.0), shininess);
-            specular += specPoint * specularStrength * lighting.pointLights[i].color.rgb * attenuation;
+            float specPoint = pow(max(dot(N, Hpoint), 0.0), specularPower);
+            specular += specPoint * specularScale * lighting.pointLights[i].color.rgb * attenuation;
         };
     }
 
@@ -27,10 +27,31 @@ layout(set = 0, binding = 6) uniform CascadeBuffer
 	vec4 cascadeSplits;
 } cascadeData;
 
+// Dequantisation of packed positions, indexed by the object's meshIndex
+struct MeshData
+{
+	vec4 positionOffset;
+	vec4 positionScale;
+};
+
+layout(std430, set = 0, binding = 7) readonly buffer MeshBuffer
+{
+	MeshData meshes[];
+} meshData;
+
+#ifdef PACKED_VERTEX
+layout(location = 0) in vec4 inPosition; // Unorm within the mesh AABB, w holds the tangent handedness
+layout(location = 1) in vec2 inNormal; // Octahedral
+layout(location = 2) in vec2 inTexCoord; // Half float
+#ifndef NO_TANGENT
+layout(location = 3) in vec2 inTangent; // Octahedral
+#endif
+#else
 layout(location = 0) in vec3 inPosition;
 layout(location = 1) in vec3 inNormal;
 layout(location = 2) in vec2 inTexCoord;
 layout(location = 3) in vec4 inTangent; // Tangent vector (includes handedness in .w)
+#endif
 
 layout(location = 0) out vec3 fragPos;
 layout(location = 1) out vec3 fragNormal; // World space normal
@@ -46,6 +67,16 @@ layout(push_constant) uniform PushConstants
 	mat4 proj;
 } pc;
 
+vec3 decodeOctahedral(vec2 e)
+{
+	vec3 v = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+	if (v.z < 0.0)
+	{
+		v.xy = (1.0 - abs(v.yx)) * vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+	}
+	return normalize(v);
+}
+
 void main() {
 	// Get the local index of the instance being drawn
 	uint filteredInstanceIndex = gl_InstanceIndex;
@@ -57,8 +88,25 @@ void main() {
 	// Use the true global index to fetch the correct unique instance data
 	Object obj = objectData.objects[globalIndex];
 
+	// Decode the vertex into model space
+#ifdef PACKED_VERTEX
+	MeshData mesh = meshData.meshes[obj.meshIndex];
+	vec3 position = mesh.positionOffset.xyz + inPosition.xyz * mesh.positionScale.xyz;
+	vec3 normal = decodeOctahedral(inNormal);
+#ifdef NO_TANGENT
+	// The mesh has no normal maps and the tangent is never sampled, any vector off the normal keeps TBN finite
+	vec4 tangent = vec4(abs(normal.x) < 0.9 ? vec3(1.0, 0.0, 0.0) : vec3(0.0, 1.0, 0.0), 1.0);
+#else
+	vec4 tangent = vec4(decodeOctahedral(inTangent), inPosition.w * 2.0 - 1.0);
+#endif
+#else
+	vec3 position = inPosition;
+	vec3 normal = inNormal;
+	vec4 tangent = inTangent;
+#endif
+
 	mat4 modelMat = obj.model;
-	vec4 worldPos = modelMat * vec4(inPosition, 1.0);
+	vec4 worldPos = modelMat * vec4(position, 1.0);
 
 	// Calculate the position in the light's clip space for all cascades
 	for (int i = 0; i < 4; ++i)
@@ -70,15 +118,15 @@ void main() {
 	mat3 normalMat = mat3(transpose(inverse(modelMat)));
 
 	// Transform N, T to World Space
-	vec3 N = normalize(normalMat * inNormal);
-	vec3 T = normalize(normalMat * inTangent.xyz);
+	vec3 N = normalize(normalMat * normal);
+	vec3 T = normalize(normalMat * tangent.xyz);
 
 	// Optional: Re-orthogonalize T to N to correct for non-uniform scaling/skewing 
     // This makes sure N and T are strictly perpendicular in world space.
 	T = normalize(T - dot(T, N) * N);
 
 	// Calculate Bitangent
-	vec3 B = normalize(cross(N, T) * inTangent.w);
+	vec3 B = normalize(cross(N, T) * tangent.w);
 
 	// Output World Space vectors
 	fragPos = worldPos.xyz;
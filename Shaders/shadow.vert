@@ -25,10 +25,28 @@ layout(push_constant) uniform PushConstants
 	mat4 lightViewProj; // light's view-projection matrix
 } pc;
 
+// Dequantisation of packed positions, indexed by the object's meshIndex
+struct MeshData
+{
+	vec4 positionOffset;
+	vec4 positionScale;
+};
+
+layout(std430, set = 0, binding = 7) readonly buffer MeshBuffer
+{
+	MeshData meshes[];
+} meshData;
+
+// Depth only needs position and UV, the packed variant serves both packed layouts
+#ifdef PACKED_VERTEX
+layout(location = 0) in vec4 inPosition; // Unorm within the mesh AABB
+layout(location = 2) in vec2 inTexCoord; // Half float
+#else
 layout(location = 0) in vec3 inPosition;
 layout(location = 1) in vec3 inNormal;
 layout(location = 2) in vec2 inTexCoord;
 layout(location = 3) in vec4 inTangent; // Tangent vector (includes handedness in .w)
+#endif
 
 layout(location = 0) out vec2 fragTexCoord;
 
@@ -48,6 +66,12 @@ void main()
 	mat4 modelMat = obj.model;
 
 	// 4. Transform vertex position from Model -> World -> Light Clip Space
-	vec4 worldPos = modelMat * vec4(inPosition, 1.0);
+#ifdef PACKED_VERTEX
+	MeshData mesh = meshData.meshes[obj.meshIndex];
+	vec3 position = mesh.positionOffset.xyz + inPosition.xyz * mesh.positionScale.xyz;
+#else
+	vec3 position = inPosition;
+#endif
+	vec4 worldPos = modelMat * vec4(position, 1.0);
 	gl_Position = pc.lightViewProj * worldPos;
 }
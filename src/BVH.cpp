@@ -0,0 +1,339 @@
+#include "BVH.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cfloat>
+#include <numeric>
+#include <utility>
+
+namespace
+{
+	float surfaceArea(const AABB& box)
+	{
+		glm::vec3 extent = box.max - box.min;
+		return extent.x * extent.y + extent.y * extent.z + extent.z * extent.x;
+	}
+
+	AABB rangeBounds(std::span<const uint32_t> objects, std::span<const AABB> worldBounds)
+	{
+		AABB bounds;
+		for (uint32_t object : objects)
+		{
+			bounds.expand(worldBounds[object]);
+		}
+		return bounds;
+	}
+
+	// False if the box lies outside a plane of 'planeMask', clears the planes it lies fully inside of
+	bool classifyBox(const Frustum& frustum, const AABB& box, uint32_t& planeMask)
+	{
+		for (uint32_t p = 0; p < frustum.planes.size(); ++p)
+		{
+			if ((planeMask & (1u << p)) == 0)
+			{
+				continue;
+			}
+
+			const Plane& plane = frustum.planes[p];
+			glm::vec3 positiveVertex;
+			positiveVertex.x = (plane.normal.x >= 0.0f) ? box.max.x : box.min.x;
+			positiveVertex.y = (plane.normal.y >= 0.0f) ? box.max.y : box.min.y;
+			positiveVertex.z = (plane.normal.z >= 0.0f) ? box.max.z : box.min.z;
+			if (plane.distanceToPoint(positiveVertex) < 0.0f)
+			{
+				return false;
+			}
+
+			glm::vec3 negativeVertex;
+			negativeVertex.x = (plane.normal.x >= 0.0f) ? box.min.x : box.max.x;
+			negativeVertex.y = (plane.normal.y >= 0.0f) ? box.min.y : box.max.y;
+			negativeVertex.z = (plane.normal.z >= 0.0f) ? box.min.z : box.max.z;
+			if (plane.distanceToPoint(negativeVertex) >= 0.0f)
+			{
+				planeMask &= ~(1u << p);
+			}
+		}
+		return true;
+	}
+
+	constexpr uint32_t ALL_PLANES = (1u << 6) - 1;
+}
+
+void BVH::build(std::span<const AABB> worldBounds)
+{
+	const uint32_t count = static_cast<uint32_t>(worldBounds.size());
+
+	m_nodes.clear();
+	m_parents.clear();
+	m_objectIndices.resize(count);
+	std::iota(m_objectIndices.begin(), m_objectIndices.end(), 0u);
+	m_leafBounds.resize(count);
+	m_objectSlots.resize(count);
+	m_objectLeaves.resize(count);
+
+	if (count == 0)
+	{
+		return;
+	}
+
+	std::vector<glm::vec3> centroids(count);
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		centroids[i] = worldBounds[i].center();
+	}
+
+	// A binary tree with leaves of at least one object has at most 2n - 1 nodes
+	m_nodes.reserve(size_t(count) * 2);
+	m_parents.reserve(size_t(count) * 2);
+	m_nodes.push_back({ rangeBounds(m_objectIndices, worldBounds), 0, count, 0 });
+	m_parents.push_back(0);
+
+	std::vector<uint32_t> stack{ 0 };
+	while (!stack.empty())
+	{
+		uint32_t nodeIndex = stack.back();
+		stack.pop_back();
+
+		if (m_nodes[nodeIndex].objectCount <= MAX_LEAF_SIZE)
+		{
+			continue;
+		}
+
+		split(nodeIndex, worldBounds, centroids);
+		stack.push_back(m_nodes[nodeIndex].leftChild + 1);
+		stack.push_back(m_nodes[nodeIndex].leftChild);
+	}
+
+	// Leaf order copies of the bounds keep leaf tests and refits on contiguous memory
+	for (uint32_t slot = 0; slot < count; ++slot)
+	{
+		m_leafBounds[slot] = worldBounds[m_objectIndices[slot]];
+		m_objectSlots[m_objectIndices[slot]] = slot;
+	}
+	for (uint32_t n = 0; n < m_nodes.size(); ++n)
+	{
+		const Node& node = m_nodes[n];
+		if (node.leftChild != 0)
+		{
+			continue;
+		}
+		for (uint32_t slot = node.firstObject; slot < node.firstObject + node.objectCount; ++slot)
+		{
+			m_objectLeaves[m_objectIndices[slot]] = n;
+		}
+	}
+}
+
+void BVH::split(uint32_t nodeIndex, std::span<const AABB> worldBounds, const std::vector<glm::vec3>& centroids)
+{
+	const uint32_t first = m_nodes[nodeIndex].firstObject;
+	const uint32_t count = m_nodes[nodeIndex].objectCount;
+	std::span<uint32_t> objects = std::span(m_objectIndices).subspan(first, count);
+
+	AABB centroidBounds;
+	for (uint32_t object : objects)
+	{
+		centroidBounds.expand(centroids[object]);
+	}
+
+	auto binIndex = [&](uint32_t object, int axis, float binScale)
+		{
+			return std::min(BIN_COUNT - 1, static_cast<uint32_t>((centroids[object][axis] - centroidBounds.min[axis]) * binScale));
+		};
+
+	// Cheapest bin boundary over all three axes, cost is surface area times object count on each side
+	float bestCost = FLT_MAX;
+	int bestAxis = -1;
+	uint32_t bestBin = 0;
+	float bestBinScale = 0.0f;
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		float extent = centroidBounds.max[axis] - centroidBounds.min[axis];
+		if (extent <= 0.0f)
+		{
+			continue;
+		}
+
+		const float binScale = BIN_COUNT / extent;
+		std::array<AABB, BIN_COUNT> binBounds;
+		std::array<uint32_t, BIN_COUNT> binCounts{};
+		for (uint32_t object : objects)
+		{
+			uint32_t bin = binIndex(object, axis, binScale);
+			binBounds[bin].expand(worldBounds[object]);
+			++binCounts[bin];
+		}
+
+		// Right sides are swept first, boundary b splits after bin b
+		std::array<float, BIN_COUNT> rightCosts{};
+		std::array<uint32_t, BIN_COUNT> rightCounts{};
+		AABB right;
+		uint32_t rightCount = 0;
+		for (uint32_t b = BIN_COUNT - 1; b > 0; --b)
+		{
+			right.expand(binBounds[b]);
+			rightCount += binCounts[b];
+			rightCounts[b - 1] = rightCount;
+			rightCosts[b - 1] = rightCount > 0 ? surfaceArea(right) * rightCount : 0.0f;
+		}
+
+		AABB left;
+		uint32_t leftCount = 0;
+		for (uint32_t b = 0; b < BIN_COUNT - 1; ++b)
+		{
+			left.expand(binBounds[b]);
+			leftCount += binCounts[b];
+			if (leftCount == 0 || rightCounts[b] == 0)
+			{
+				continue;
+			}
+
+			float cost = surfaceArea(left) * leftCount + rightCosts[b];
+			if (cost < bestCost)
+			{
+				bestCost = cost;
+				bestAxis = axis;
+				bestBin = b;
+				bestBinScale = binScale;
+			}
+		}
+	}
+
+	// Coincident centroids can't be told apart, any even split is as good as another
+	uint32_t leftCount = count / 2;
+	if (bestAxis >= 0)
+	{
+		auto middle = std::partition(objects.begin(), objects.end(),
+			[&](uint32_t object) { return binIndex(object, bestAxis, bestBinScale) <= bestBin; });
+		leftCount = static_cast<uint32_t>(middle - objects.begin());
+	}
+
+	const uint32_t leftChild = static_cast<uint32_t>(m_nodes.size());
+	m_nodes[nodeIndex].leftChild = leftChild;
+	m_nodes.push_back({ rangeBounds(objects.first(leftCount), worldBounds), first, leftCount, 0 });
+	m_nodes.push_back({ rangeBounds(objects.subspan(leftCount), worldBounds), first + leftCount, count - leftCount, 0 });
+	m_parents.push_back(nodeIndex);
+	m_parents.push_back(nodeIndex);
+}
+
+AABB BVH::computeBounds(const Node& node) const
+{
+	AABB bounds;
+	if (node.leftChild != 0)
+	{
+		bounds.expand(m_nodes[node.leftChild].bounds);
+		bounds.expand(m_nodes[node.leftChild + 1].bounds);
+		return bounds;
+	}
+
+	for (uint32_t slot = node.firstObject; slot < node.firstObject + node.objectCount; ++slot)
+	{
+		bounds.expand(m_leafBounds[slot]);
+	}
+	return bounds;
+}
+
+void BVH::refit(uint32_t object, const AABB& worldBounds)
+{
+	m_leafBounds[m_objectSlots[object]] = worldBounds;
+
+	// Once a node keeps its bounds, so does everything above it
+	uint32_t nodeIndex = m_objectLeaves[object];
+	while (true)
+	{
+		Node& node = m_nodes[nodeIndex];
+		AABB bounds = computeBounds(node);
+		if (bounds.min == node.bounds.min && bounds.max == node.bounds.max)
+		{
+			break;
+		}
+
+		node.bounds = bounds;
+		if (nodeIndex == 0)
+		{
+			break;
+		}
+		nodeIndex = m_parents[nodeIndex];
+	}
+}
+
+void BVH::cullFrustum(const Frustum& frustum, std::vector<uint32_t>& visibleIndices) const
+{
+	if (m_nodes.empty())
+	{
+		return;
+	}
+
+	// Planes a node lies fully inside of are skipped for its whole subtree
+	std::vector<std::pair<uint32_t, uint32_t>> stack{ { 0u, ALL_PLANES } };
+	while (!stack.empty())
+	{
+		auto [nodeIndex, planeMask] = stack.back();
+		stack.pop_back();
+
+		const Node& node = m_nodes[nodeIndex];
+		if (!classifyBox(frustum, node.bounds, planeMask))
+		{
+			continue;
+		}
+
+		// Fully inside, the subtree's objects are accepted as one range
+		if (planeMask == 0)
+		{
+			visibleIndices.insert(visibleIndices.end(),
+				m_objectIndices.begin() + node.firstObject, m_objectIndices.begin() + node.firstObject + node.objectCount);
+			continue;
+		}
+
+		if (node.leftChild != 0)
+		{
+			stack.push_back({ node.leftChild + 1, planeMask });
+			stack.push_back({ node.leftChild, planeMask });
+			continue;
+		}
+
+		for (uint32_t slot = node.firstObject; slot < node.firstObject + node.objectCount; ++slot)
+		{
+			uint32_t objectMask = planeMask;
+			if (classifyBox(frustum, m_leafBounds[slot], objectMask))
+			{
+				visibleIndices.push_back(m_objectIndices[slot]);
+			}
+		}
+	}
+}
+
+void BVH::queryOverlaps(const AABB& bounds, std::vector<uint32_t>& results) const
+{
+	if (m_nodes.empty())
+	{
+		return;
+	}
+
+	std::vector<uint32_t> stack{ 0 };
+	while (!stack.empty())
+	{
+		const Node& node = m_nodes[stack.back()];
+		stack.pop_back();
+
+		if (!node.bounds.overlaps(bounds))
+		{
+			continue;
+		}
+
+		if (node.leftChild != 0)
+		{
+			stack.push_back(node.leftChild + 1);
+			stack.push_back(node.leftChild);
+			continue;
+		}
+
+		for (uint32_t slot = node.firstObject; slot < node.firstObject + node.objectCount; ++slot)
+		{
+			if (m_leafBounds[slot].overlaps(bounds))
+			{
+				results.push_back(m_objectIndices[slot]);
+			}
+		}
+	}
+}
@@ -0,0 +1,769 @@
+#include "Benchmarks.hpp"
+#include "ScopedTimer.hpp"
+#include "VertexWelder.hpp"
+#include "MeshOptimizer.hpp"
+#include "MeshSimplifier.hpp"
+#include "MeshletBuilder.hpp"
+#include "SceneFile.hpp"
+#include "FrustumCuller.hpp"
+#include "BVH.hpp"
+#include "OcclusionCuller.hpp"
+#include "DrawLists.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <execution>
+#include <filesystem>
+#include <fstream>
+#include <numeric>
+#include <random>
+#include <ranges>
+#include <unordered_map>
+
+#include <gtc/matrix_transform.hpp>
+
+namespace
+{
+	constexpr int ITERATIONS = 5;
+
+	// Best-of-N wall time in milliseconds
+	template<typename Fn>
+	double timeBest(Fn&& fn)
+	{
+		double best = 1e30;
+		for (int i = 0; i < ITERATIONS; ++i)
+		{
+			auto start = Clock::now();
+			fn();
+			best = std::min(best, std::chrono::duration_cast<ms>(Clock::now() - start).count());
+		}
+		return best;
+	}
+
+	// Two triangles per grid cell, chunkSize > 0 gives each chunk its own normal so vertices on chunk seams don't weld
+	std::vector<Vertex> makeGridCorners(uint32_t cellsX, uint32_t cellsZ, uint32_t chunkSize)
+	{
+		auto makeVertex = [&](uint32_t x, uint32_t z, uint32_t chunk)
+			{
+				Vertex v{};
+				float fx = static_cast<float>(x);
+				float fz = static_cast<float>(z);
+				v.pos = glm::vec3(fx, std::sin(fx * 0.05f) * std::cos(fz * 0.05f) * 8.0f, fz);
+				v.normal = chunk == UINT32_MAX
+					? glm::normalize(glm::vec3(-std::cos(fx * 0.05f), 2.5f, std::sin(fz * 0.05f)))
+					: glm::normalize(glm::vec3(static_cast<float>(chunk % 7) - 3.0f, 4.0f, static_cast<float>(chunk % 5) - 2.0f));
+				v.texCoord = glm::vec2(fx / cellsX, fz / cellsZ);
+				v.tangent = glm::vec4(0.0f);
+				return v;
+			};
+
+		std::vector<Vertex> corners;
+		corners.reserve(size_t(cellsX) * cellsZ * 6);
+
+		for (uint32_t z = 0; z < cellsZ; ++z)
+		{
+			for (uint32_t x = 0; x < cellsX; ++x)
+			{
+				uint32_t chunk = chunkSize == 0 ? UINT32_MAX : (z / chunkSize) * (cellsX / chunkSize + 1) + x / chunkSize;
+
+				Vertex v00 = makeVertex(x, z, chunk);
+				Vertex v10 = makeVertex(x + 1, z, chunk);
+				Vertex v01 = makeVertex(x, z + 1, chunk);
+				Vertex v11 = makeVertex(x + 1, z + 1, chunk);
+
+				corners.push_back(v00); corners.push_back(v01); corners.push_back(v10);
+				corners.push_back(v10); corners.push_back(v01); corners.push_back(v11);
+			}
+		}
+		return corners;
+	}
+
+	// Closed box with outward counter-clockwise faces, appended to a shared vertex and index list
+	void appendBox(const AABB& box, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+	{
+		const uint32_t base = static_cast<uint32_t>(vertices.size());
+		for (uint32_t c = 0; c < 8; ++c)
+		{
+			Vertex v{};
+			v.pos = glm::vec3((c & 1) ? box.max.x : box.min.x, (c & 2) ? box.max.y : box.min.y, (c & 4) ? box.max.z : box.min.z);
+			vertices.push_back(v);
+		}
+
+		// Corner bits are x = 1, y = 2, z = 4
+		constexpr uint32_t FACES[6][4] = {
+			{ 0, 4, 6, 2 }, { 1, 3, 7, 5 }, // -x, +x
+			{ 0, 1, 5, 4 }, { 2, 6, 7, 3 }, // -y, +y
+			{ 0, 2, 3, 1 }, { 4, 5, 7, 6 }, // -z, +z
+		};
+		for (const auto& face : FACES)
+		{
+			indices.insert(indices.end(), { base + face[0], base + face[1], base + face[2], base + face[0], base + face[2], base + face[3] });
+		}
+	}
+}
+
+void Benchmarks::runAll()
+{
+	vertexWelding();
+	meshOptimization();
+	meshSimplification();
+	meshletCones();
+	sceneLoading();
+	frustumCulling();
+	bvhCulling();
+	occlusionCulling();
+	submeshCulling();
+}
+
+std::vector<Vertex> Benchmarks::makeTerrainCorners(uint32_t gridSize)
+{
+	return makeGridCorners(gridSize, gridSize, 0);
+}
+
+std::vector<Vertex> Benchmarks::makeSponzaCorners()
+{
+	// ~264k triangles, 8x8 cell chunks with split normals duplicate every seam vertex
+	return makeGridCorners(400, 330, 8);
+}
+
+void Benchmarks::vertexWelding()
+{
+	struct Input
+	{
+		const char* name;
+		std::vector<Vertex> corners;
+	};
+
+	Input inputs[] = {
+		{ "Sponza-sized", makeSponzaCorners() },
+		{ "Terrain-sized", makeTerrainCorners(1024) },
+	};
+
+	std::cout << "--- Vertex welding (best of " << ITERATIONS << ") ---" << std::endl;
+
+	for (const Input& input : inputs)
+	{
+		std::vector<Vertex> mapVertices;
+		std::vector<uint32_t> mapIndices;
+		double mapMs = timeBest([&]()
+			{
+				// Previous loadModel path: weak XOR-shift hash, contains() followed by two operator[] lookups
+				mapVertices.clear();
+				mapIndices.clear();
+				std::unordered_map<Vertex, uint32_t> uniqueVertices{};
+				for (const Vertex& vertex : input.corners)
+				{
+					if (!uniqueVertices.contains(vertex))
+					{
+						uniqueVertices[vertex] = static_cast<uint32_t>(mapVertices.size());
+						mapVertices.push_back(vertex);
+					}
+					mapIndices.push_back(uniqueVertices[vertex]);
+				}
+			});
+
+		std::vector<Vertex> weldVertices;
+		std::vector<uint32_t> weldIndices;
+		double weldMs = timeBest([&]()
+			{
+				weldVertices.clear();
+				weldIndices.clear();
+				weldIndices.reserve(input.corners.size());
+				VertexWelder welder(weldVertices, input.corners.size());
+				for (const Vertex& vertex : input.corners)
+				{
+					weldIndices.push_back(welder.weld(vertex));
+				}
+			});
+
+		// Both paths number vertices in first-seen order, so their output must match exactly
+		bool identical = mapIndices == weldIndices &&
+			mapVertices.size() == weldVertices.size() &&
+			memcmp(mapVertices.data(), weldVertices.data(), mapVertices.size() * sizeof(Vertex)) == 0;
+
+		std::cout << input.name << ": " << input.corners.size() << " corners -> " << weldVertices.size() << " vertices" << std::endl;
+		std::cout << "  unordered_map: " << mapMs << " ms" << std::endl;
+		std::cout << "  VertexWelder:  " << weldMs << " ms (" << mapMs / weldMs << "x)" << std::endl;
+		std::cout << "  output " << (identical ? "identical" : "MISMATCH") << std::endl;
+	}
+}
+
+void Benchmarks::meshOptimization()
+{
+	std::cout << "--- Mesh optimisation (cache size " << MeshOptimizer::CACHE_SIZE << ") ---" << std::endl;
+
+	const char* names[] = { "Sponza-sized", "Terrain-sized" };
+	std::vector<Vertex> cornerSets[] = { makeSponzaCorners(), makeTerrainCorners(512) };
+
+	for (size_t i = 0; i < std::size(names); ++i)
+	{
+		const std::vector<Vertex>& corners = cornerSets[i];
+
+		// Shuffle whole triangles, then weld, so vertices are numbered in the shuffled order like an OBJ import
+		std::vector<uint32_t> triangleOrder(corners.size() / 3);
+		for (uint32_t t = 0; t < triangleOrder.size(); ++t)
+		{
+			triangleOrder[t] = t;
+		}
+		std::shuffle(triangleOrder.begin(), triangleOrder.end(), std::mt19937(1234));
+
+		std::vector<Vertex> vertices;
+		std::vector<uint32_t> indices;
+		indices.reserve(corners.size());
+		VertexWelder welder(vertices, corners.size());
+		for (uint32_t t : triangleOrder)
+		{
+			for (uint32_t c = 0; c < 3; ++c)
+			{
+				indices.push_back(welder.weld(corners[t * 3 + c]));
+			}
+		}
+
+		Submesh submesh{};
+		submesh.indexOffset = 0;
+		submesh.indexCount = static_cast<uint32_t>(indices.size());
+
+		VertexCacheStats before;
+		VertexCacheStats after;
+		auto start = Clock::now();
+		MeshOptimizer::optimize(vertices, indices, std::span<const Submesh>(&submesh, 1), &before, &after);
+		double optimizeMs = std::chrono::duration_cast<ms>(Clock::now() - start).count();
+
+		std::cout << names[i] << ": " << before.triangles << " triangles, " << before.uniqueVertices << " vertices" << std::endl;
+		std::cout << "  ACMR " << before.acmr() << " -> " << after.acmr() << std::endl;
+		std::cout << "  ATVR " << before.atvr() << " -> " << after.atvr() << std::endl;
+		std::cout << "  optimize: " << optimizeMs << " ms" << std::endl;
+	}
+}
+
+void Benchmarks::meshSimplification()
+{
+	std::cout << "--- Mesh simplification ---" << std::endl;
+
+	std::vector<Vertex> corners = makeTerrainCorners(256);
+
+	std::vector<Vertex> vertices;
+	std::vector<uint32_t> indices;
+	indices.reserve(corners.size());
+	VertexWelder welder(vertices, corners.size());
+	for (const Vertex& corner : corners)
+	{
+		indices.push_back(welder.weld(corner));
+	}
+
+	Submesh submesh{};
+	submesh.indexOffset = 0;
+	submesh.indexCount = static_cast<uint32_t>(indices.size());
+
+	AABB bounds;
+	for (const Vertex& vertex : vertices)
+	{
+		bounds.expand(vertex.pos);
+	}
+
+	auto start = Clock::now();
+	MeshSimplifier::generateLods(vertices, indices, std::span<Submesh>(&submesh, 1));
+	double simplifyMs = std::chrono::duration_cast<ms>(Clock::now() - start).count();
+
+	std::cout << "Terrain-sized: " << submesh.indexCount / 3 << " triangles, radius " << bounds.radius() << std::endl;
+	for (uint32_t l = 1; l <= submesh.lodCount; ++l)
+	{
+		SubmeshLod lod = submesh.getLod(l);
+		std::cout << "  LOD " << l << ": " << lod.indexCount / 3 << " triangles, error " << lod.error << std::endl;
+	}
+	std::cout << "  generateLods: " << simplifyMs << " ms" << std::endl;
+}
+
+void Benchmarks::meshletCones()
+{
+	std::cout << "--- Meshlet normal cones ---" << std::endl;
+
+	// Folded grids with a 45 degree slope on both sides of the crease at x = 0, faces point up for the valley and the ridge alike
+	struct Fold
+	{
+		const char* name;
+		float slope;
+	};
+	for (const Fold& fold : { Fold{ "valley (concave)", 1.0f }, Fold{ "ridge (convex)", -1.0f } })
+	{
+		constexpr uint32_t CELLS = 64;
+		constexpr float CELL_SIZE = 0.25f;
+
+		std::vector<Vertex> vertices;
+		for (uint32_t z = 0; z <= CELLS; ++z)
+		{
+			for (uint32_t x = 0; x <= CELLS; ++x)
+			{
+				Vertex v{};
+				float fx = (static_cast<float>(x) - CELLS * 0.5f) * CELL_SIZE;
+				v.pos = glm::vec3(fx, std::abs(fx) * fold.slope, static_cast<float>(z) * CELL_SIZE);
+				vertices.push_back(v);
+			}
+		}
+
+		std::vector<uint32_t> indices;
+		for (uint32_t z = 0; z < CELLS; ++z)
+		{
+			for (uint32_t x = 0; x < CELLS; ++x)
+			{
+				uint32_t v00 = z * (CELLS + 1) + x;
+				uint32_t v10 = v00 + 1;
+				uint32_t v01 = v00 + CELLS + 1;
+				uint32_t v11 = v01 + 1;
+				indices.insert(indices.end(), { v00, v01, v10, v10, v01, v11 });
+			}
+		}
+
+		std::vector<Meshlet> meshlets;
+		MeshletBuilder::buildRange(vertices, indices, 0, meshlets);
+
+		// Viewers all around the surface, a meshlet counts as wrongly culled if its cone rejects it while one of its triangles faces the viewer
+		std::mt19937 rng(11);
+		std::uniform_real_distribution<float> coordinate(-10.0f, 10.0f);
+		constexpr uint32_t VIEWERS = 4096;
+		uint64_t tests = 0;
+		uint64_t culled = 0;
+		uint64_t wrong = 0;
+		uint32_t coneCount = 0;
+		for (const Meshlet& meshlet : meshlets)
+		{
+			coneCount += meshlet.coneCutoff < 1.0f ? 1 : 0;
+		}
+
+		for (uint32_t v = 0; v < VIEWERS; ++v)
+		{
+			glm::vec3 viewer(coordinate(rng), coordinate(rng), coordinate(rng) + CELLS * CELL_SIZE * 0.5f);
+			for (const Meshlet& meshlet : meshlets)
+			{
+				++tests;
+				if (meshlet.coneCutoff >= 1.0f || glm::dot(glm::normalize(meshlet.coneApex - viewer), meshlet.coneAxis) < meshlet.coneCutoff)
+				{
+					continue;
+				}
+				++culled;
+
+				for (uint32_t i = meshlet.indexOffset; i < meshlet.indexOffset + meshlet.indexCount; i += 3)
+				{
+					const glm::vec3& p0 = vertices[indices[i]].pos;
+					glm::vec3 normal = glm::cross(vertices[indices[i + 1]].pos - p0, vertices[indices[i + 2]].pos - p0);
+					if (glm::dot(viewer - p0, normal) > 0.0f)
+					{
+						++wrong;
+						break;
+					}
+				}
+			}
+		}
+
+		std::cout << "  " << fold.name << ": " << meshlets.size() << " meshlets, " << coneCount << " with a cone, "
+			<< 100.0 * culled / tests << "% of tests culled, " << wrong << " wrongly culled (must be 0)" << std::endl;
+	}
+}
+
+void Benchmarks::sceneLoading()
+{
+	std::cout << "--- Scene loading ---" << std::endl;
+
+	// A forest of 100k instances over four models
+	constexpr uint32_t INSTANCE_COUNT = 100000;
+	const std::filesystem::path textPath = std::filesystem::temp_directory_path() / "VKEngineBenchmark.scene";
+	{
+		std::mt19937 rng(42);
+		std::uniform_real_distribution<float> position(-500.0f, 500.0f);
+		std::uniform_real_distribution<float> angle(0.0f, 360.0f);
+		std::uniform_real_distribution<float> scale(0.5f, 2.0f);
+
+		std::ofstream file(textPath, std::ios::trunc);
+		file << "skybox Maskonaive2\n";
+		for (uint32_t m = 0; m < 4; ++m)
+		{
+			file << "model tree" << m << " Models/Tree" << m << ".obj\n";
+		}
+		file << "sun direction -0.3 -0.7 -0.5 color 1 1 1\n";
+		for (uint32_t i = 0; i < INSTANCE_COUNT; ++i)
+		{
+			file << "instance tree" << i % 4 << " position " << position(rng) << " 0 " << position(rng)
+				<< " rotation 0 " << angle(rng) << " 0 scale " << scale(rng) << "\n";
+		}
+	}
+
+	SceneDescription scene;
+	std::vector<ObjectData> objects;
+	LightingData lights{};
+
+	// The first load compiles, so it runs once against a missing binary
+	std::filesystem::remove(SceneFile::getBinaryPath(textPath));
+	auto start = Clock::now();
+	SceneFile::load(textPath, scene, objects, lights);
+	double compileMs = std::chrono::duration_cast<ms>(Clock::now() - start).count();
+
+	double textLoadMs = timeBest([&]() { SceneFile::load(textPath, scene, objects, lights); });
+	double binaryLoadMs = timeBest([&]() { SceneFile::load(SceneFile::getBinaryPath(textPath), scene, objects, lights); });
+
+	std::cout << INSTANCE_COUNT << " instances, " << std::filesystem::file_size(textPath) / 1024 << " KB text, "
+		<< std::filesystem::file_size(SceneFile::getBinaryPath(textPath)) / 1024 << " KB binary" << std::endl;
+	std::cout << "  parse + compile: " << compileMs << " ms" << std::endl;
+	std::cout << "  load via text (hash + binary): " << textLoadMs << " ms" << std::endl;
+	std::cout << "  load binary: " << binaryLoadMs << " ms" << std::endl;
+
+	std::filesystem::remove(textPath);
+	std::filesystem::remove(SceneFile::getBinaryPath(textPath));
+}
+
+void Benchmarks::frustumCulling()
+{
+	std::cout << "--- Frustum culling (" << FrustumCuller::getInstructionSet() << ", " << FrustumCuller::LANE_WIDTH << " lanes) ---" << std::endl;
+
+	// Unit cube meshes scattered over a 2 km square, seen from its centre with a 60 degree lens and a 500 m far plane
+	std::vector<Mesh> meshes(1);
+	meshes[0].bounds = AABB{ glm::vec3(-0.5f), glm::vec3(0.5f) };
+
+	glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 10.0f, 0.0f), glm::vec3(1.0f, 10.0f, 0.3f), glm::vec3(0.0f, 1.0f, 0.0f));
+	glm::mat4 proj = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 500.0f);
+	Frustum frustum;
+	frustum.update(proj * view);
+
+	for (uint32_t count : { 1000u, 10000u, 100000u, 1000000u })
+	{
+		std::mt19937 rng(7);
+		std::uniform_real_distribution<float> position(-1000.0f, 1000.0f);
+		std::uniform_real_distribution<float> height(0.0f, 20.0f);
+		std::uniform_real_distribution<float> scale(0.5f, 4.0f);
+
+		std::vector<ObjectData> objects(count);
+		for (ObjectData& object : objects)
+		{
+			object.model = glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(position(rng), height(rng), position(rng))), glm::vec3(scale(rng)));
+			object.meshIndex = 0;
+		}
+
+		// Previous path, kept here as the reference
+		std::vector<uint32_t> sphereVisible;
+		double sphereMs = timeBest([&]()
+			{
+				std::vector<uint8_t> visibility(objects.size(), 0);
+				auto indices = std::views::iota(0u, count);
+				std::for_each(std::execution::par_unseq, indices.begin(), indices.end(),
+					[&](uint32_t i)
+					{
+						AABB worldBounds = meshes[objects[i].meshIndex].bounds.transform(objects[i].model);
+						bool visible = frustum.isSphereVisible(worldBounds.center(), worldBounds.radius());
+						objects[i].isVisible = visible ? 1 : 0;
+						visibility[i] = visible ? 1 : 0;
+					});
+
+				sphereVisible.clear();
+				sphereVisible.reserve(objects.size());
+				for (uint32_t i = 0; i < visibility.size(); ++i)
+				{
+					if (visibility[i])
+					{
+						sphereVisible.push_back(i);
+					}
+				}
+			});
+
+		FrustumCuller culler;
+		std::vector<uint32_t> boxVisible;
+		double updateMs = timeBest([&]() { culler.updateBounds(objects, meshes); });
+		double cullMs = timeBest([&]() { culler.cull(frustum, boxVisible, objects); });
+
+		std::cout << count << " objects" << std::endl;
+		std::cout << "  sphere, per object: " << sphereMs << " ms, " << sphereVisible.size() << " visible" << std::endl;
+		std::cout << "  SoA box: " << updateMs << " ms bounds + " << cullMs << " ms cull, " << boxVisible.size() << " visible" << std::endl;
+	}
+}
+
+void Benchmarks::bvhCulling()
+{
+	std::cout << "--- BVH culling ---" << std::endl;
+
+	// Constant density, a 500 m far plane sees about the same number of objects at every scene size
+	glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 10.0f, 0.0f), glm::vec3(1.0f, 10.0f, 0.3f), glm::vec3(0.0f, 1.0f, 0.0f));
+	glm::mat4 proj = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 500.0f);
+	Frustum frustum;
+	frustum.update(proj * view);
+
+	for (uint32_t count : { 1000u, 10000u, 100000u, 1000000u })
+	{
+		std::mt19937 rng(7);
+		const float halfSide = std::sqrt(static_cast<float>(count)) * 2.0f;
+		std::uniform_real_distribution<float> position(-halfSide, halfSide);
+		std::uniform_real_distribution<float> height(0.0f, 20.0f);
+		std::uniform_real_distribution<float> extent(0.25f, 2.0f);
+
+		std::vector<AABB> worldBounds(count);
+		for (AABB& bounds : worldBounds)
+		{
+			glm::vec3 center(position(rng), height(rng), position(rng));
+			glm::vec3 halfSize(extent(rng), extent(rng), extent(rng));
+			bounds = AABB{ center - halfSize, center + halfSize };
+		}
+
+		BVH bvh;
+		auto start = Clock::now();
+		bvh.build(worldBounds);
+		double buildMs = std::chrono::duration_cast<ms>(Clock::now() - start).count();
+
+		FrustumCuller culler;
+		culler.setBounds(worldBounds);
+		std::vector<uint32_t> flatVisible;
+		double flatMs = timeBest([&]() { culler.cull(frustum, flatVisible); });
+
+		std::vector<uint32_t> bvhVisible;
+		double bvhMs = timeBest([&]()
+			{
+				bvhVisible.clear();
+				bvh.cullFrustum(frustum, bvhVisible);
+			});
+
+		// A thousand objects each looking for their neighbours, brute force only runs where it finishes quickly
+		constexpr uint32_t QUERY_COUNT = 1000;
+		std::vector<uint32_t> overlaps;
+		double queryMs = timeBest([&]()
+			{
+				overlaps.clear();
+				for (uint32_t q = 0; q < QUERY_COUNT; ++q)
+				{
+					bvh.queryOverlaps(worldBounds[q * (count / QUERY_COUNT)], overlaps);
+				}
+			});
+
+		std::cout << count << " objects, " << bvh.getNodes().size() << " nodes, build " << buildMs << " ms" << std::endl;
+		std::cout << "  flat SoA cull: " << flatMs << " ms, " << flatVisible.size() << " visible" << std::endl;
+		std::cout << "  BVH cull: " << bvhMs << " ms, " << bvhVisible.size() << " visible" << std::endl;
+		std::cout << "  " << QUERY_COUNT << " overlap queries: " << queryMs << " ms, " << overlaps.size() << " hits";
+		if (count <= 100000)
+		{
+			size_t bruteHits = 0;
+			double bruteMs = timeBest([&]()
+				{
+					bruteHits = 0;
+					for (uint32_t q = 0; q < QUERY_COUNT; ++q)
+					{
+						const AABB& query = worldBounds[q * (count / QUERY_COUNT)];
+						bruteHits += std::count_if(worldBounds.begin(), worldBounds.end(), [&](const AABB& b) { return b.overlaps(query); });
+					}
+				});
+			std::cout << ", pairwise " << bruteMs << " ms, " << bruteHits << " hits";
+		}
+		std::cout << std::endl;
+	}
+}
+
+void Benchmarks::occlusionCulling()
+{
+	std::cout << "--- Occlusion culling (" << Simd::INSTRUCTION_SET << ", " << OcclusionCuller::WIDTH << "x" << OcclusionCuller::HEIGHT << ") ---" << std::endl;
+
+	// A street front of ten buildings with narrow gaps, seen from the pavement, and scattered props behind it
+	glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 1.7f, 0.0f), glm::vec3(0.0f, 1.7f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	glm::mat4 proj = glm::perspectiveRH_ZO(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 500.0f);
+	proj[1][1] *= -1;
+	const glm::mat4 viewProj = proj * view;
+	Frustum frustum;
+	frustum.update(viewProj);
+
+	std::vector<Vertex> occluderVertices;
+	std::vector<uint32_t> occluderIndices;
+	for (int b = 0; b < 10; ++b)
+	{
+		float left = -100.0f + b * 20.0f;
+		appendBox(AABB{ glm::vec3(left, 0.0f, -40.0f), glm::vec3(left + 19.0f, 30.0f, -25.0f) }, occluderVertices, occluderIndices);
+	}
+
+	std::mt19937 rng(11);
+	std::uniform_real_distribution<float> x(-300.0f, 300.0f);
+	std::uniform_real_distribution<float> z(-450.0f, -45.0f);
+	std::uniform_real_distribution<float> size(0.5f, 4.0f);
+	std::vector<AABB> props;
+	while (props.size() < 20000)
+	{
+		glm::vec3 min(x(rng), 0.0f, z(rng));
+		AABB box{ min, min + glm::vec3(size(rng), size(rng) * 2.0f, size(rng)) };
+		if (frustum.isBoxVisible(box.min, box.max))
+		{
+			props.push_back(box);
+		}
+	}
+
+	OcclusionCuller culler;
+	double rasterMs = timeBest([&]()
+		{
+			culler.begin(viewProj);
+			culler.addOccluder(occluderVertices, occluderIndices, glm::mat4(1.0f), true);
+			culler.rasterize();
+		});
+
+	std::vector<uint8_t> visible(props.size());
+	double testMs = timeBest([&]()
+		{
+			auto indices = std::views::iota(0u, static_cast<uint32_t>(props.size()));
+			std::for_each(std::execution::par, indices.begin(), indices.end(),
+				[&](uint32_t i)
+				{
+					visible[i] = culler.isVisible(props[i]) ? 1 : 0;
+				});
+		});
+	size_t hidden = std::count(visible.begin(), visible.end(), uint8_t(0));
+
+	std::cout << "  occluders: " << culler.getTriangleCount() << " triangles set up, raster " << rasterMs << " ms" << std::endl;
+	std::cout << "  " << props.size() << " props in the frustum: tests " << testMs << " ms, " << hidden << " hidden" << std::endl;
+
+	// A dense mesh as the occluder, every grid cell two triangles
+	std::vector<Vertex> terrain = makeTerrainCorners(400);
+	std::vector<uint32_t> terrainIndices(terrain.size());
+	std::iota(terrainIndices.begin(), terrainIndices.end(), 0u);
+	glm::mat4 terrainModel = glm::translate(glm::mat4(1.0f), glm::vec3(-200.0f, -9.0f, -420.0f));
+	double terrainMs = timeBest([&]()
+		{
+			culler.begin(viewProj);
+			culler.addOccluder(terrain, terrainIndices, terrainModel, true);
+			culler.rasterize();
+		});
+	std::cout << "  " << terrainIndices.size() / 3 << " triangle terrain: " << culler.getTriangleCount() << " set up, raster " << terrainMs << " ms" << std::endl;
+}
+
+void Benchmarks::submeshCulling()
+{
+	std::cout << "--- Submesh culling ---" << std::endl;
+
+	// One mesh laid out like Sponza: floor, two storeys of columns and arches around the courtyard,
+	// aisle walls, end walls, curtains and plants, one material per kind of part. Only bounds and index
+	// ranges matter here, the parts are contiguous in the index buffer like an imported model's.
+	enum PartMaterial : uint32_t { FLOOR, COLUMN, ARCH, WALL, CURTAIN, PLANT, MATERIAL_COUNT };
+	std::vector<Material> materials(MATERIAL_COUNT);
+	std::vector<Submesh> submeshes;
+	Mesh mesh{};
+	auto addPart = [&](const glm::vec3& min, const glm::vec3& max, uint32_t triangles, uint32_t materialIndex)
+		{
+			Submesh submesh{};
+			submesh.indexOffset = mesh.indexCount;
+			submesh.indexCount = triangles * 3;
+			submesh.materialIndex = materialIndex;
+			submesh.bounds = AABB{ min, max };
+			mesh.bounds.expand(submesh.bounds);
+			mesh.indexCount += submesh.indexCount;
+			submeshes.push_back(submesh);
+		};
+
+	addPart(glm::vec3(-19.0f, 0.0f, -11.0f), glm::vec3(18.0f, 0.3f, 11.0f), 4000, FLOOR);
+	for (float side : { -1.0f, 1.0f })
+	{
+		for (int c = 0; c < 8; ++c)
+		{
+			float x = -12.0f + c * 3.4f;
+			float z = side * 4.5f;
+			addPart(glm::vec3(x - 0.6f, 0.0f, z - 0.6f), glm::vec3(x + 0.6f, 6.0f, z + 0.6f), 2500, COLUMN);
+			addPart(glm::vec3(x - 0.4f, 7.0f, z - 0.4f), glm::vec3(x + 0.4f, 12.0f, z + 0.4f), 1500, COLUMN);
+			if (c < 7)
+			{
+				addPart(glm::vec3(x, 5.0f, z - 0.7f), glm::vec3(x + 3.4f, 7.5f, z + 0.7f), 2000, ARCH);
+			}
+		}
+		for (int s = 0; s < 6; ++s)
+		{
+			float x = -18.0f + s * 6.0f;
+			addPart(glm::vec3(x, 0.0f, side * 10.0f - 0.5f), glm::vec3(x + 6.0f, 15.0f, side * 10.0f + 0.5f), 3000, WALL);
+		}
+		for (int k = 0; k < 3; ++k)
+		{
+			float x = -10.5f + k * 8.0f;
+			addPart(glm::vec3(x, 7.0f, side * 5.2f - 0.2f), glm::vec3(x + 3.0f, 11.0f, side * 5.2f + 0.2f), 4000, CURTAIN);
+		}
+		for (float x : { -14.0f, -6.0f, 6.0f, 14.0f })
+		{
+			addPart(glm::vec3(x - 0.75f, 0.0f, side * 2.5f - 0.75f), glm::vec3(x + 0.75f, 2.0f, side * 2.5f + 0.75f), 6000, PLANT);
+		}
+		float endX = side < 0.0f ? -19.0f : 17.5f;
+		addPart(glm::vec3(endX, 0.0f, -11.0f), glm::vec3(endX + 1.5f, 15.0f, 11.0f), 6000, WALL);
+	}
+	mesh.submeshCount = static_cast<uint32_t>(submeshes.size());
+
+	const std::vector<Mesh> meshes = { mesh };
+	const std::vector<ObjectData> objects = { ObjectData{ glm::mat4(1.0f), 0 } };
+	std::cout << "  " << submeshes.size() << " submeshes, " << mesh.indexCount / 3 << " triangles" << std::endl;
+
+	// Camera paths at eye height and along the gallery, yaw in degrees around +y with 0 looking down +x
+	struct CameraPath
+	{
+		const char* name;
+		glm::vec3 from, to;
+		float yawFrom, yawTo;
+		float pitch;
+	};
+	const CameraPath paths[] = {
+		{ "nave walk", glm::vec3(-16.0f, 1.7f, 0.0f), glm::vec3(16.0f, 1.7f, 0.0f), 0.0f, 0.0f, 0.0f },
+		{ "turn in place", glm::vec3(0.0f, 1.7f, 0.0f), glm::vec3(0.0f, 1.7f, 0.0f), 0.0f, 360.0f, 0.0f },
+		{ "aisle walk", glm::vec3(-16.0f, 1.7f, 7.5f), glm::vec3(16.0f, 1.7f, 7.5f), -20.0f, 20.0f, 0.0f },
+		{ "gallery", glm::vec3(-14.0f, 8.5f, -7.5f), glm::vec3(14.0f, 8.5f, -7.5f), 30.0f, 150.0f, -15.0f },
+	};
+
+	constexpr uint32_t FRAMES = 240;
+	constexpr float FOV_Y = glm::radians(60.0f);
+	constexpr float VIEWPORT_HEIGHT = 1080.0f;
+	const glm::mat4 proj = glm::perspective(FOV_Y, 16.0f / 9.0f, 0.1f, 100.0f);
+
+	// Draws and triangles the frame's opaque lists submit
+	struct Submitted
+	{
+		uint64_t draws = 0;
+		uint64_t triangles = 0;
+	};
+	auto countDraws = [](const DrawLists& lists, Submitted& submitted)
+		{
+			for (const std::vector<DrawCommand>& draws : lists.opaque)
+			{
+				for (const DrawCommand& draw : draws)
+				{
+					++submitted.draws;
+					submitted.triangles += static_cast<uint64_t>(draw.indexCount / 3) * draw.instanceCount;
+				}
+			}
+		};
+
+	for (const CameraPath& path : paths)
+	{
+		std::vector<Frustum> frustums(FRAMES);
+		std::vector<glm::vec3> eyes(FRAMES);
+		for (uint32_t f = 0; f < FRAMES; ++f)
+		{
+			float t = static_cast<float>(f) / (FRAMES - 1);
+			float yaw = glm::radians(path.yawFrom + (path.yawTo - path.yawFrom) * t);
+			float pitch = glm::radians(path.pitch);
+			eyes[f] = path.from + (path.to - path.from) * t;
+			glm::vec3 front(std::cos(yaw) * std::cos(pitch), std::sin(pitch), std::sin(yaw) * std::cos(pitch));
+			frustums[f].update(proj * glm::lookAt(eyes[f], eyes[f] + front, glm::vec3(0.0f, 1.0f, 0.0f)));
+		}
+
+		// The object test runs first in the frame, buildDrawCommands only sees the mesh when some corner is visible
+		auto runPath = [&](bool cullSubmeshes, Submitted& submitted)
+			{
+				submitted = {};
+				std::vector<uint32_t> visibleIndices;
+				for (uint32_t f = 0; f < FRAMES; ++f)
+				{
+					visibleIndices.clear();
+					AABB worldBounds = mesh.bounds.transform(objects[0].model);
+					if (frustums[f].isBoxVisible(worldBounds.min, worldBounds.max))
+					{
+						visibleIndices.push_back(0);
+					}
+					DrawLists lists = buildDrawCommands(visibleIndices, objects, meshes, submeshes, materials,
+						eyes[f], FOV_Y, VIEWPORT_HEIGHT, cullSubmeshes ? &frustums[f] : nullptr);
+					countDraws(lists, submitted);
+				}
+			};
+
+		Submitted whole;
+		Submitted culled;
+		double wholeMs = timeBest([&]() { runPath(false, whole); });
+		double culledMs = timeBest([&]() { runPath(true, culled); });
+
+		double percent = whole.triangles > 0 ? 100.0 * culled.triangles / whole.triangles : 0.0;
+		std::cout << "  " << path.name << ": " << whole.triangles / FRAMES << " -> " << culled.triangles / FRAMES
+			<< " triangles per frame (" << percent << "%), " << static_cast<double>(whole.draws) / FRAMES << " -> "
+			<< static_cast<double>(culled.draws) / FRAMES << " draws per frame" << std::endl;
+		std::cout << "    buildDrawCommands " << wholeMs / FRAMES << " -> " << culledMs / FRAMES << " ms per frame" << std::endl;
+	}
+}
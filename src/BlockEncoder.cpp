@@ -0,0 +1,399 @@
+#include "BlockEncoder.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+	// BC7 4-bit index interpolation weights, out of 64
+	constexpr int BC7_WEIGHTS[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+	// std::lround is a library call on most compilers, this is the hot path of every encoder
+	inline int roundToInt(float value)
+	{
+		return static_cast<int>(value + (value >= 0.0f ? 0.5f : -0.5f));
+	}
+
+	// Appends fields least significant bit first, the bit order of every BCn format
+	struct BitWriter
+	{
+		uint8_t* out;
+		uint32_t position = 0;
+
+		void write(uint32_t value, uint32_t bits)
+		{
+			for (uint32_t i = 0; i < bits; ++i, ++position)
+			{
+				if ((value >> i) & 1)
+				{
+					out[position >> 3] |= static_cast<uint8_t>(1u << (position & 7));
+				}
+			}
+		}
+	};
+
+	// BC4 in 8-value mode: step s runs from endpoint 0 (s = 0) to endpoint 1 (s = 7), the stored
+	// index order is 0, 2, 3, 4, 5, 6, 7, 1
+	uint8_t bc4Index(int step)
+	{
+		return static_cast<uint8_t>(step == 0 ? 0 : (step == 7 ? 1 : step + 1));
+	}
+
+	float fitBC4(const float values[16], int e0, int e1, uint8_t steps[16])
+	{
+		float error = 0.0f;
+		const float range = static_cast<float>(e1 - e0);
+		for (int i = 0; i < 16; ++i)
+		{
+			int step = roundToInt((values[i] - e0) / range * 7.0f);
+			step = std::clamp(step, 0, 7);
+			steps[i] = static_cast<uint8_t>(step);
+
+			float decoded = e0 + range * step / 7.0f;
+			error += (values[i] - decoded) * (values[i] - decoded);
+		}
+		return error;
+	}
+
+	// Quantizes an 8-bit endpoint to 7 bits for the given p-bit, (q << 1) | p reconstructs it
+	int quantizeBC7(float value, int pBit)
+	{
+		return std::clamp(roundToInt((value - pBit) * 0.5f), 0, 127);
+	}
+
+	// Picks the closest palette entry for every texel, starting from the projection on the endpoint axis
+	float assignBC7(const float texels[16][4], const int a[4], const int b[4], uint8_t indices[16])
+	{
+		int palette[16][4];
+		for (int k = 0; k < 16; ++k)
+		{
+			for (int c = 0; c < 4; ++c)
+			{
+				palette[k][c] = ((64 - BC7_WEIGHTS[k]) * a[c] + BC7_WEIGHTS[k] * b[c] + 32) >> 6;
+			}
+		}
+
+		float axis[4];
+		float axisLength2 = 0.0f;
+		for (int c = 0; c < 4; ++c)
+		{
+			axis[c] = static_cast<float>(b[c] - a[c]);
+			axisLength2 += axis[c] * axis[c];
+		}
+
+		float totalError = 0.0f;
+		for (int i = 0; i < 16; ++i)
+		{
+			int guess = 0;
+			if (axisLength2 > 0.0f)
+			{
+				float t = 0.0f;
+				for (int c = 0; c < 4; ++c)
+				{
+					t += (texels[i][c] - a[c]) * axis[c];
+				}
+				guess = std::clamp(roundToInt(t / axisLength2 * 15.0f), 0, 15);
+			}
+
+			// The weights aren't evenly spaced, so the neighbours of the projected index are checked too
+			float bestError = 1e30f;
+			for (int k = std::max(guess - 1, 0); k <= std::min(guess + 1, 15); ++k)
+			{
+				float error = 0.0f;
+				for (int c = 0; c < 4; ++c)
+				{
+					float d = texels[i][c] - palette[k][c];
+					error += d * d;
+				}
+				if (error < bestError)
+				{
+					bestError = error;
+					indices[i] = static_cast<uint8_t>(k);
+				}
+			}
+			totalError += bestError;
+		}
+		return totalError;
+	}
+
+	struct BC7Candidate
+	{
+		int endpoints[2][4]; // 7-bit
+		int pBits[2];
+		uint8_t indices[16];
+		float error = 1e30f;
+	};
+
+	// Quantizes a pair of endpoints and fits indices to them, replacing 'best' if the error is lower.
+	// Each endpoint takes the p-bit that quantizes it best, trying all four combinations costs twice
+	// the time for under 0.2 dB.
+	void tryBC7Endpoints(const float texels[16][4], const float low[4], const float high[4], BC7Candidate& best)
+	{
+		BC7Candidate candidate;
+		int a[4], b[4];
+		for (int e = 0; e < 2; ++e)
+		{
+			const float* value = e == 0 ? low : high;
+			int* expanded = e == 0 ? a : b;
+
+			float error[2] = {};
+			for (int p = 0; p < 2; ++p)
+			{
+				for (int c = 0; c < 4; ++c)
+				{
+					float d = value[c] - ((quantizeBC7(value[c], p) << 1) | p);
+					error[p] += d * d;
+				}
+			}
+
+			candidate.pBits[e] = error[1] < error[0] ? 1 : 0;
+			for (int c = 0; c < 4; ++c)
+			{
+				candidate.endpoints[e][c] = quantizeBC7(value[c], candidate.pBits[e]);
+				expanded[c] = (candidate.endpoints[e][c] << 1) | candidate.pBits[e];
+			}
+		}
+
+		candidate.error = assignBC7(texels, a, b, candidate.indices);
+		if (candidate.error < best.error)
+		{
+			best = candidate;
+		}
+	}
+}
+
+void BlockEncoder::encodeBC4(const uint8_t rgba[64], uint32_t channel, uint8_t out[8])
+{
+	float values[16];
+	int low = 255, high = 0;
+	for (int i = 0; i < 16; ++i)
+	{
+		int value = rgba[i * 4 + channel];
+		values[i] = static_cast<float>(value);
+		low = std::min(low, value);
+		high = std::max(high, value);
+	}
+
+	uint8_t steps[16] = {};
+	int e0 = high;
+	int e1 = low;
+
+	if (high != low)
+	{
+		float error = fitBC4(values, e0, e1, steps);
+
+		// Least squares refit of both endpoints for the chosen steps, kept if it lowers the error
+		float aa = 0.0f, ab = 0.0f, bb = 0.0f, av = 0.0f, bv = 0.0f;
+		for (int i = 0; i < 16; ++i)
+		{
+			float w = steps[i] / 7.0f;
+			aa += (1.0f - w) * (1.0f - w);
+			ab += (1.0f - w) * w;
+			bb += w * w;
+			av += (1.0f - w) * values[i];
+			bv += w * values[i];
+		}
+
+		float det = aa * bb - ab * ab;
+		if (std::abs(det) > 1e-6f)
+		{
+			int r0 = std::clamp(roundToInt((av * bb - bv * ab) / det), 0, 255);
+			int r1 = std::clamp(roundToInt((bv * aa - av * ab) / det), 0, 255);
+
+			// 8-value mode needs endpoint 0 above endpoint 1
+			if (r0 > r1)
+			{
+				uint8_t refinedSteps[16];
+				if (fitBC4(values, r0, r1, refinedSteps) < error)
+				{
+					e0 = r0;
+					e1 = r1;
+					memcpy(steps, refinedSteps, sizeof(steps));
+				}
+			}
+		}
+	}
+
+	out[0] = static_cast<uint8_t>(e0);
+	out[1] = static_cast<uint8_t>(e1);
+
+	// A flat block has e0 == e1, which selects 6-value mode, where index 0 still decodes to e0
+	uint64_t bits = 0;
+	for (int i = 0; i < 16; ++i)
+	{
+		bits |= static_cast<uint64_t>(bc4Index(steps[i])) << (3 * i);
+	}
+	for (int i = 0; i < 6; ++i)
+	{
+		out[2 + i] = static_cast<uint8_t>(bits >> (8 * i));
+	}
+}
+
+void BlockEncoder::encodeBC5(const uint8_t rgba[64], uint8_t out[16])
+{
+	encodeBC4(rgba, 0, out);
+	encodeBC4(rgba, 1, out + 8);
+}
+
+void BlockEncoder::encodeBC7(const uint8_t rgba[64], uint8_t out[16])
+{
+	float texels[16][4];
+	float mean[4] = {};
+	for (int i = 0; i < 16; ++i)
+	{
+		for (int c = 0; c < 4; ++c)
+		{
+			texels[i][c] = rgba[i * 4 + c];
+			mean[c] += texels[i][c] / 16.0f;
+		}
+	}
+
+	// Principal axis of the block's colors by power iteration on the covariance matrix
+	float covariance[4][4] = {};
+	for (int i = 0; i < 16; ++i)
+	{
+		for (int r = 0; r < 4; ++r)
+		{
+			for (int c = 0; c < 4; ++c)
+			{
+				covariance[r][c] += (texels[i][r] - mean[r]) * (texels[i][c] - mean[c]);
+			}
+		}
+	}
+
+	int widest = 0;
+	for (int c = 1; c < 4; ++c)
+	{
+		if (covariance[c][c] > covariance[widest][widest])
+		{
+			widest = c;
+		}
+	}
+
+	float axis[4];
+	for (int c = 0; c < 4; ++c)
+	{
+		axis[c] = covariance[widest][c];
+	}
+	for (int iteration = 0; iteration < 8; ++iteration)
+	{
+		float next[4] = {};
+		float length2 = 0.0f;
+		for (int r = 0; r < 4; ++r)
+		{
+			for (int c = 0; c < 4; ++c)
+			{
+				next[r] += covariance[r][c] * axis[c];
+			}
+			length2 += next[r] * next[r];
+		}
+		if (length2 < 1e-12f)
+		{
+			break;
+		}
+
+		float invLength = 1.0f / std::sqrt(length2);
+		for (int c = 0; c < 4; ++c)
+		{
+			axis[c] = next[c] * invLength;
+		}
+	}
+
+	float axisLength2 = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2] + axis[3] * axis[3];
+	float tMin = 0.0f, tMax = 0.0f;
+	if (axisLength2 > 1e-12f)
+	{
+		tMin = 1e30f;
+		tMax = -1e30f;
+		for (int i = 0; i < 16; ++i)
+		{
+			float t = 0.0f;
+			for (int c = 0; c < 4; ++c)
+			{
+				t += (texels[i][c] - mean[c]) * axis[c];
+			}
+			tMin = std::min(tMin, t / axisLength2);
+			tMax = std::max(tMax, t / axisLength2);
+		}
+	}
+
+	float low[4], high[4];
+	for (int c = 0; c < 4; ++c)
+	{
+		low[c] = std::clamp(mean[c] + axis[c] * tMin, 0.0f, 255.0f);
+		high[c] = std::clamp(mean[c] + axis[c] * tMax, 0.0f, 255.0f);
+	}
+
+	BC7Candidate best;
+	tryBC7Endpoints(texels, low, high, best);
+
+	// Least squares refit of the endpoints for the chosen indices
+	for (int iteration = 0; iteration < 2; ++iteration)
+	{
+		float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+		float av[4] = {}, bv[4] = {};
+		for (int i = 0; i < 16; ++i)
+		{
+			float w = BC7_WEIGHTS[best.indices[i]] / 64.0f;
+			aa += (1.0f - w) * (1.0f - w);
+			ab += (1.0f - w) * w;
+			bb += w * w;
+			for (int c = 0; c < 4; ++c)
+			{
+				av[c] += (1.0f - w) * texels[i][c];
+				bv[c] += w * texels[i][c];
+			}
+		}
+
+		float det = aa * bb - ab * ab;
+		if (std::abs(det) < 1e-6f)
+		{
+			break;
+		}
+
+		for (int c = 0; c < 4; ++c)
+		{
+			low[c] = std::clamp((av[c] * bb - bv[c] * ab) / det, 0.0f, 255.0f);
+			high[c] = std::clamp((bv[c] * aa - av[c] * ab) / det, 0.0f, 255.0f);
+		}
+
+		float previousError = best.error;
+		tryBC7Endpoints(texels, low, high, best);
+		if (best.error >= previousError)
+		{
+			break;
+		}
+	}
+
+	// The first texel's index is stored without its top bit, so it has to be below 8
+	if (best.indices[0] >= 8)
+	{
+		for (int c = 0; c < 4; ++c)
+		{
+			std::swap(best.endpoints[0][c], best.endpoints[1][c]);
+		}
+		std::swap(best.pBits[0], best.pBits[1]);
+		for (uint8_t& index : best.indices)
+		{
+			index = static_cast<uint8_t>(15 - index);
+		}
+	}
+
+	memset(out, 0, 16);
+	BitWriter writer{ out };
+	writer.write(1u << 6, 7); // mode 6
+	for (int c = 0; c < 4; ++c)
+	{
+		writer.write(best.endpoints[0][c], 7);
+		writer.write(best.endpoints[1][c], 7);
+	}
+	writer.write(best.pBits[0], 1);
+	writer.write(best.pBits[1], 1);
+
+	writer.write(best.indices[0], 3);
+	for (int i = 1; i < 16; ++i)
+	{
+		writer.write(best.indices[i], 4);
+	}
+}
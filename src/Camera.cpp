@@ -1,6 +1,6 @@
 #include "camera.hpp"
 
-Camera::Camera(glm::vec3 position) : Position(position) {
+Camera::Camera(glm::vec3 position, float yaw, float pitch) : Position(position), Yaw(yaw), Pitch(pitch) {
 	UpdateCameraVectors();
 }
 
@@ -68,8 +68,22 @@ void Commands::endSingleTimeCommands(VkCommandBuffer cmd)
 	submitInfo.commandBufferCount = 1;
 	submitInfo.pCommandBuffers = &cmd;
 
-	vkQueueSubmit(m_context.getGraphicsQueue(), 1, &submitInfo, VK_NULL_HANDLE);
-	vkQueueWaitIdle(m_context.getGraphicsQueue());
+	// Wait on this submission only instead of draining the whole queue
+	VkFenceCreateInfo fenceInfo{};
+	fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+	VkFence fence;
+	if (vkCreateFence(m_context.getDevice(), &fenceInfo, nullptr, &fence) != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to create single time command fence!");
+	}
+
+	if (vkQueueSubmit(m_context.getGraphicsQueue(), 1, &submitInfo, fence) != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to submit single time commands!");
+	}
+	vkWaitForFences(m_context.getDevice(), 1, &fence, VK_TRUE, UINT64_MAX);
+	vkDestroyFence(m_context.getDevice(), fence, nullptr);
 
 	vkFreeCommandBuffers(m_context.getDevice(), m_commandPool, 1, &cmd);
 }
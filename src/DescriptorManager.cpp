@@ -48,9 +48,36 @@ void DescriptorManager::updateTextureArray(const std::vector<VkImageView>& textu
 	vkUpdateDescriptorSets(m_context.getDevice(), 1, &write, 0, nullptr);
 }
 
+void DescriptorManager::updateTextureSlots(const std::vector<uint32_t>& slots, const std::vector<VkImageView>& textureViews, VkSampler sampler)
+{
+	if (slots.empty())
+	{
+		return;
+	}
+
+	std::vector<VkDescriptorImageInfo> imageInfos(slots.size());
+	std::vector<VkWriteDescriptorSet> writes(slots.size());
+	for (size_t i = 0; i < slots.size(); ++i)
+	{
+		imageInfos[i].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		imageInfos[i].imageView = textureViews[slots[i]];
+		imageInfos[i].sampler = sampler;
+
+		writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		writes[i].dstSet = m_descriptorSet;
+		writes[i].dstBinding = 1;
+		writes[i].dstArrayElement = slots[i];
+		writes[i].descriptorCount = 1;
+		writes[i].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		writes[i].pImageInfo = &imageInfos[i];
+	}
+
+	vkUpdateDescriptorSets(m_context.getDevice(), static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+}
+
 void DescriptorManager::createDescriptorSetLayout()
 {
-	std::array<VkDescriptorSetLayoutBinding, 7> bindings{};
+	std::array<VkDescriptorSetLayoutBinding, 8> bindings{};
 
 	// Storage buffer for per-object data
 	bindings[0].binding = 0;
@@ -61,7 +88,7 @@ void DescriptorManager::createDescriptorSetLayout()
 	// Texture binding
 	bindings[1].binding = 1;
 	bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-	bindings[1].descriptorCount = 1000;
+	bindings[1].descriptorCount = GPUImage::MAX_TEXTURE_SLOTS;
 	bindings[1].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
 
 	// Lighting data
@@ -94,20 +121,27 @@ void DescriptorManager::createDescriptorSetLayout()
 	bindings[6].descriptorCount = 1;
 	bindings[6].stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
 
+	// Per-mesh data, packed vertex dequantisation
+	bindings[7].binding = 7;
+	bindings[7].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	bindings[7].descriptorCount = 1;
+	bindings[7].stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+
 	// Enable descriptor indexing flags
 	VkDescriptorBindingFlags bindingFlags[] = {
 		0, // binding 0: Object data
-		VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT, // binding 1: Texture array
+		VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT, // binding 1: Texture array, streaming rewrites idle slots
 		0, // binding 2: Lighting data
 		0, // binding 3: Cubemap data
 		0, // binding 4: Visible index data
 		0, // binding 5: Shadow Map
 		0, // binding 6: Cascade data
+		0, // binding 7: Mesh data
 	};
 
 	VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo{};
 	bindingFlagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
-	bindingFlagsInfo.bindingCount = 7;
+	bindingFlagsInfo.bindingCount = 8;
 	bindingFlagsInfo.pBindingFlags = bindingFlags;
 
 	VkDescriptorSetLayoutCreateInfo layoutInfo{};
@@ -126,10 +160,11 @@ void DescriptorManager::createDescriptorSetLayout()
 
 void DescriptorManager::createDescriptorPool()
 {
-	std::array<VkDescriptorPoolSize, 3> poolSizes{};
+	std::array<VkDescriptorPoolSize, 4> poolSizes{};
 	poolSizes[0] = { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, 3 }; // Per-instance data + lighting + Visible indexes
-	poolSizes[1] = { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1005 }; // object texture + skybox + 4 shadowmaps
+	poolSizes[1] = { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, GPUImage::MAX_TEXTURE_SLOTS + 5 }; // object texture + skybox + 4 shadowmaps
 	poolSizes[2] = { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1 }; // Cascade data
+	poolSizes[3] = { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1 }; // Mesh data
 
 	VkDescriptorPoolCreateInfo poolInfo{};
 	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
@@ -200,7 +235,13 @@ void DescriptorManager::createDescriptorSet()
 	cascadeBufferInfo.offset = 0;
 	cascadeBufferInfo.range = m_buffer.getCascadeBufferSize();
 
-	std::array<VkWriteDescriptorSet, 6> persistentWrites{};
+	// Mesh buffer info
+	VkDescriptorBufferInfo meshBufferInfo{};
+	meshBufferInfo.buffer = m_buffer.getMeshBuffer();
+	meshBufferInfo.offset = 0;
+	meshBufferInfo.range = m_buffer.getMeshBufferSize();
+
+	std::array<VkWriteDescriptorSet, 7> persistentWrites{};
 
 	// Per-instance SSBO
 	persistentWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
@@ -250,5 +291,13 @@ void DescriptorManager::createDescriptorSet()
 	persistentWrites[5].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
 	persistentWrites[5].pBufferInfo = &cascadeBufferInfo;
 
+	// Mesh buffer binding
+	persistentWrites[6].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	persistentWrites[6].dstSet = m_descriptorSet;
+	persistentWrites[6].dstBinding = 7;
+	persistentWrites[6].descriptorCount = 1;
+	persistentWrites[6].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	persistentWrites[6].pBufferInfo = &meshBufferInfo;
+
 	vkUpdateDescriptorSets(m_context.getDevice(), static_cast<uint32_t>(persistentWrites.size()), persistentWrites.data(), 0, nullptr);
 }
@@ -0,0 +1,184 @@
+#include "DrawLists.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+
+uint32_t selectMeshLod(const Mesh& mesh, const glm::mat4& model, const glm::vec3& cameraPos, float worldPerPixel)
+{
+	if (mesh.lodCount <= 1)
+	{
+		return 0;
+	}
+
+	AABB worldBounds = mesh.bounds.transform(model);
+	float worldRadius = std::max(worldBounds.radius(), 1e-6f);
+
+	// Projected radius of the bounding sphere in pixels, taken at its nearest point
+	float distance = std::max(glm::length(worldBounds.center() - cameraPos) - worldRadius, 0.01f);
+	float projectedRadius = worldRadius / (distance * worldPerPixel);
+
+	// Level errors are in object space, scaling the object scales them with the sphere
+	float scale = std::max({ glm::length(glm::vec3(model[0])), glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2])) });
+	float pixelsPerUnit = projectedRadius * scale / worldRadius;
+
+	// Coarsest level that stays within the pixel error
+	uint32_t lod = 0;
+	while (lod + 1 < mesh.lodCount && mesh.lodErrors[lod + 1] * pixelsPerUnit <= LOD_PIXEL_ERROR)
+	{
+		++lod;
+	}
+	return lod;
+}
+
+DrawLists buildDrawCommands(std::vector<uint32_t>& globalVisibleIndices, const std::vector<ObjectData>& objectData, const std::vector<Mesh>& allMeshes, const std::vector<Submesh>& allSubmeshes, const std::vector<Material>& allMaterials,
+	const glm::vec3& cameraPos, float fovY, float viewportHeight, const Frustum* submeshFrustum, uint32_t firstInstance)
+{
+	DrawLists result;
+	result.opaque.resize(allMaterials.size());
+	result.transparent.resize(allMaterials.size());
+
+	// World units one pixel spans at distance 1, grows linearly with distance
+	const float worldPerPixel = 2.0f * std::tan(fovY * 0.5f) / viewportHeight;
+
+	// Group visible objects by mesh and detail level (ONE TIME), groups are ordered by first appearance
+	struct InstanceGroup
+	{
+		uint32_t meshIndex;
+		uint32_t lod;
+		std::vector<uint32_t> objectIndices;
+	};
+	std::vector<InstanceGroup> groups;
+	std::unordered_map<uint32_t, uint32_t> groupByKey;
+
+	for (uint32_t objIdx : globalVisibleIndices)
+	{
+		uint32_t meshIdx = objectData[objIdx].meshIndex;
+		uint32_t lod = selectMeshLod(allMeshes[meshIdx], objectData[objIdx].model, cameraPos, worldPerPixel);
+
+		auto [it, inserted] = groupByKey.try_emplace(meshIdx * MAX_MESH_LODS + lod, static_cast<uint32_t>(groups.size()));
+		if (inserted)
+		{
+			groups.push_back({ meshIdx, lod, {} });
+		}
+		groups[it->second].objectIndices.push_back(objIdx);
+	}
+
+	// Every group draws one contiguous instance range, so the visible index buffer is rewritten in group order
+	globalVisibleIndices.clear();
+	for (const InstanceGroup& group : groups)
+	{
+		globalVisibleIndices.insert(globalVisibleIndices.end(), group.objectIndices.begin(), group.objectIndices.end());
+	}
+
+	result.objectCount = static_cast<uint32_t>(globalVisibleIndices.size());
+
+	// Tracks where each group's instances start in the visible index buffer, the list itself is uploaded at 'firstInstance'
+	uint32_t globalInstanceOffset = firstInstance;
+
+	// Submeshes only some instances of a group see get their own instance list, these follow the groups' ranges
+	std::vector<uint32_t> submeshInstances;
+	std::vector<uint32_t> partialInstances;
+
+	for (const InstanceGroup& group : groups)
+	{
+		const Mesh& mesh = allMeshes[group.meshIndex];
+
+		uint32_t visibleInstanceCount = static_cast<uint32_t>(group.objectIndices.size());
+
+		// Process each submesh(different geometry parts with potentially different materials)
+		for (uint32_t submeshIdx = 0; submeshIdx < mesh.submeshCount; ++submeshIdx)
+		{
+			const Submesh& submesh = allSubmeshes[mesh.submeshOffset + submeshIdx];
+			const Material& material = allMaterials[submesh.materialIndex];
+			const SubmeshLod lod = submesh.getLod(group.lod);
+
+			// Second level test, a mesh of one submesh was already decided by its own bounds
+			const std::vector<uint32_t>* visibleIndices = &group.objectIndices;
+			uint32_t instanceOffset = globalInstanceOffset;
+			if (submeshFrustum && mesh.submeshCount > 1)
+			{
+				partialInstances.clear();
+				for (uint32_t objIdx : group.objectIndices)
+				{
+					AABB worldBounds = submesh.bounds.transform(objectData[objIdx].model);
+					if (submeshFrustum->isBoxVisible(worldBounds.min, worldBounds.max))
+					{
+						partialInstances.push_back(objIdx);
+					}
+				}
+
+				if (partialInstances.empty())
+				{
+					continue;
+				}
+				if (partialInstances.size() < visibleInstanceCount)
+				{
+					visibleIndices = &partialInstances;
+					instanceOffset = firstInstance + result.objectCount + static_cast<uint32_t>(submeshInstances.size());
+				}
+			}
+
+			// Construct the draw command
+			DrawCommand cmd{};
+			cmd.indexCount = lod.indexCount;
+			cmd.instanceCount = static_cast<uint32_t>(visibleIndices->size());
+			cmd.firstIndex = mesh.gpuFirstIndex + (lod.indexOffset - mesh.indexOffset);
+			cmd.vertexOffset = static_cast<int32_t>(mesh.gpuVertexOffset);
+			cmd.vertexFormat = mesh.vertexFormat;
+			cmd.indexFormat = mesh.indexFormat;
+			cmd.meshletOffset = lod.meshletOffset;
+			cmd.meshletCount = lod.meshletCount;
+			cmd.material = material;
+
+			// Split opaque vs transparent
+			if (material.alphablending == 1)
+			{
+				cmd.firstInstance = 0; // we will draw transparent objects individually
+				cmd.objectIndices = *visibleIndices;
+				result.transparent[submesh.materialIndex].push_back(cmd);
+			}
+			else
+			{
+				cmd.firstInstance = instanceOffset; // Same offset for all submeshes every instance of the group sees
+				if (visibleIndices == &partialInstances)
+				{
+					submeshInstances.insert(submeshInstances.end(), partialInstances.begin(), partialInstances.end());
+				}
+
+				// Optimization: Merge with previous draw if possible (reduces draw call count)
+				auto& opaqueList = result.opaque[submesh.materialIndex];
+				if (!opaqueList.empty())
+				{
+					DrawCommand& lastCmd = opaqueList.back();
+
+					// Can merge if: same mesh with contiguous index and meshlet ranges
+					bool canMerge = (lastCmd.vertexOffset == cmd.vertexOffset &&
+						lastCmd.vertexFormat == cmd.vertexFormat &&
+						lastCmd.indexFormat == cmd.indexFormat &&
+						lastCmd.instanceCount == cmd.instanceCount &&
+						lastCmd.firstInstance == cmd.firstInstance &&
+						lastCmd.firstIndex + lastCmd.indexCount == cmd.firstIndex &&
+						lastCmd.meshletOffset + lastCmd.meshletCount == cmd.meshletOffset);
+
+					if (canMerge)
+					{
+						// Just extend the previous command's index and meshlet ranges
+						lastCmd.indexCount += cmd.indexCount;
+						lastCmd.meshletCount += cmd.meshletCount;
+						continue; // Skip adding a new command
+					}
+				}
+
+				result.opaque[submesh.materialIndex].push_back(cmd);
+			}
+		}
+
+		// Advance the global offset by the number of visible instances of this mesh
+		// This ensures the next mesh's instanaces start at the correct position in the buffer
+		globalInstanceOffset += visibleInstanceCount;
+	}
+
+	globalVisibleIndices.insert(globalVisibleIndices.end(), submeshInstances.begin(), submeshInstances.end());
+	return result;
+}
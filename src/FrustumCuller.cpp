@@ -0,0 +1,154 @@
+#include "FrustumCuller.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <execution>
+#include <ranges>
+
+namespace
+{
+	// Padding boxes: every positive vertex lies far behind every plane, finite so fast math can't turn it into NaN
+	constexpr float EMPTY_EXTENT = 1e30f;
+}
+
+void FrustumCuller::resize(uint32_t count)
+{
+	m_count = count;
+	const size_t padded = size_t(getChunkCount()) * CHUNK_SIZE;
+
+	for (std::vector<float>* minAxis : { &m_minX, &m_minY, &m_minZ })
+	{
+		minAxis->resize(padded);
+		std::fill(minAxis->begin() + count, minAxis->end(), EMPTY_EXTENT);
+	}
+	for (std::vector<float>* maxAxis : { &m_maxX, &m_maxY, &m_maxZ })
+	{
+		maxAxis->resize(padded);
+		std::fill(maxAxis->begin() + count, maxAxis->end(), -EMPTY_EXTENT);
+	}
+
+	m_laneMasks.resize(padded / LANE_WIDTH);
+	m_chunkCounts.resize(getChunkCount());
+}
+
+void FrustumCuller::writeBounds(uint32_t index, const AABB& bounds)
+{
+	m_minX[index] = bounds.min.x;
+	m_minY[index] = bounds.min.y;
+	m_minZ[index] = bounds.min.z;
+	m_maxX[index] = bounds.max.x;
+	m_maxY[index] = bounds.max.y;
+	m_maxZ[index] = bounds.max.z;
+}
+
+void FrustumCuller::updateBounds(std::span<const ObjectData> objects, std::span<const Mesh> meshes)
+{
+	resize(static_cast<uint32_t>(objects.size()));
+
+	auto chunks = std::views::iota(0u, getChunkCount());
+	std::for_each(std::execution::par, chunks.begin(), chunks.end(),
+		[&](uint32_t chunk)
+		{
+			const uint32_t end = std::min(m_count, (chunk + 1) * CHUNK_SIZE);
+			for (uint32_t i = chunk * CHUNK_SIZE; i < end; ++i)
+			{
+				writeBounds(i, meshes[objects[i].meshIndex].bounds.transform(objects[i].model));
+			}
+		});
+}
+
+void FrustumCuller::setBounds(std::span<const AABB> worldBounds)
+{
+	resize(static_cast<uint32_t>(worldBounds.size()));
+	for (uint32_t i = 0; i < m_count; ++i)
+	{
+		writeBounds(i, worldBounds[i]);
+	}
+}
+
+void FrustumCuller::cull(const Frustum& frustum, std::vector<uint32_t>& visibleIndices, std::span<ObjectData> objects)
+{
+	// The positive vertex picks min or max per axis from the plane normal alone, so it is the same for every lane
+	struct PlaneSetup
+	{
+		const float* x;
+		const float* y;
+		const float* z;
+		float normalX, normalY, normalZ, distance;
+	};
+	std::array<PlaneSetup, 6> planes;
+	for (size_t p = 0; p < planes.size(); ++p)
+	{
+		const Plane& plane = frustum.planes[p];
+		planes[p] = {
+			plane.normal.x >= 0.0f ? m_maxX.data() : m_minX.data(),
+			plane.normal.y >= 0.0f ? m_maxY.data() : m_minY.data(),
+			plane.normal.z >= 0.0f ? m_maxZ.data() : m_minZ.data(),
+			plane.normal.x, plane.normal.y, plane.normal.z, plane.distance };
+	}
+
+	// Pass 1: lane masks and visible count per chunk
+	auto chunks = std::views::iota(0u, getChunkCount());
+	std::for_each(std::execution::par, chunks.begin(), chunks.end(),
+		[&](uint32_t chunk)
+		{
+			uint32_t visible = 0;
+			const uint32_t begin = chunk * CHUNK_SIZE;
+			for (uint32_t i = begin; i < begin + CHUNK_SIZE; i += LANE_WIDTH)
+			{
+				uint32_t mask = Simd::ALL_LANES;
+				for (const PlaneSetup& plane : planes)
+				{
+					Simd::Floats distance = Simd::mulAdd(Simd::broadcast(plane.normalX), Simd::load(plane.x + i), Simd::broadcast(plane.distance));
+					distance = Simd::mulAdd(Simd::broadcast(plane.normalY), Simd::load(plane.y + i), distance);
+					distance = Simd::mulAdd(Simd::broadcast(plane.normalZ), Simd::load(plane.z + i), distance);
+
+					mask &= Simd::nonNegativeMask(distance);
+					if (mask == 0)
+					{
+						break;
+					}
+				}
+				m_laneMasks[i / LANE_WIDTH] = mask;
+				visible += static_cast<uint32_t>(std::popcount(mask));
+			}
+			m_chunkCounts[chunk] = visible;
+		});
+
+	// Exclusive prefix sum gives every chunk its output range
+	uint32_t total = 0;
+	for (uint32_t& count : m_chunkCounts)
+	{
+		uint32_t chunkVisible = count;
+		count = total;
+		total += chunkVisible;
+	}
+	visibleIndices.resize(total);
+
+	// Pass 2: every chunk writes its visible indices in order
+	std::for_each(std::execution::par, chunks.begin(), chunks.end(),
+		[&](uint32_t chunk)
+		{
+			uint32_t* out = visibleIndices.data() + m_chunkCounts[chunk];
+			const uint32_t begin = chunk * CHUNK_SIZE;
+			for (uint32_t i = begin; i < begin + CHUNK_SIZE; i += LANE_WIDTH)
+			{
+				uint32_t mask = m_laneMasks[i / LANE_WIDTH];
+				while (mask != 0)
+				{
+					*out++ = i + static_cast<uint32_t>(std::countr_zero(mask));
+					mask &= mask - 1;
+				}
+			}
+
+			if (!objects.empty())
+			{
+				const uint32_t end = std::min(m_count, begin + CHUNK_SIZE);
+				for (uint32_t i = begin; i < end; ++i)
+				{
+					objects[i].isVisible = (m_laneMasks[i / LANE_WIDTH] >> (i % LANE_WIDTH)) & 1u;
+				}
+			}
+		});
+}
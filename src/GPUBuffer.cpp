@@ -2,18 +2,18 @@
 
 #include "GPUBuffer.hpp"
 #include "VulkanContext.hpp"
-#include "Commands.hpp"
+#include "UploadManager.hpp"
 
 #include "DebugVertex.hpp"
 
 #include <stdexcept>
 #include <iostream>
 
-GPUBuffer::GPUBuffer(VulkanContext& context, Commands& commands, const std::vector<Vertex>& vertices, const std::vector<uint32_t> indices, VkDeviceSize objectBufferSize, uint32_t maxFramesInFlight)
-	: m_context(context), m_commands(commands), m_objectBufferSize(objectBufferSize), m_maxFramesInFlight(maxFramesInFlight)
+GPUBuffer::GPUBuffer(VulkanContext& context, UploadManager& uploads, const std::vector<std::byte>& vertexStream, const std::vector<std::byte>& indexStream, VkDeviceSize wideIndexOffset, VkDeviceSize objectBufferSize, uint32_t maxFramesInFlight)
+	: m_context(context), m_uploads(uploads), m_wideIndexOffset(wideIndexOffset), m_objectBufferSize(objectBufferSize), m_maxFramesInFlight(maxFramesInFlight)
 {
-	createVertexBuffer(vertices);
-	createIndexBuffer(indices);
+	createVertexBuffer(vertexStream);
+	createIndexBuffer(indexStream);
 }
 
 GPUBuffer::~GPUBuffer()
@@ -23,6 +23,7 @@ GPUBuffer::~GPUBuffer()
 	vmaDestroyBuffer(m_context.getAllocator(), m_objectBuffer, m_objectAllocation);
 	vmaDestroyBuffer(m_context.getAllocator(), m_lightingBuffer, m_lightingAllocation);
 	vmaDestroyBuffer(m_context.getAllocator(), m_cascadeBuffer, m_cascadeAllocation);
+	vmaDestroyBuffer(m_context.getAllocator(), m_meshBuffer, m_meshAllocation);
 	vmaDestroyBuffer(m_context.getAllocator(), m_visibleIndexBuffer, m_visibleIndexAllocation);
 	vmaDestroyBuffer(m_context.getAllocator(), m_debugVertexBuffer, m_debugVertexAllocation);
 }
@@ -72,36 +73,18 @@ void GPUBuffer::updateVisibleIndexBuffer(const void* data, size_t size, uint32_t
 	memcpy((char*)m_visibleIndexBufferMapped + offset, data, size);
 }
 
-void GPUBuffer::createVertexBuffer(const std::vector<Vertex>& vertices)
+void GPUBuffer::createVertexBuffer(const std::vector<std::byte>& vertexStream)
 {
-	VkDeviceSize bufferSize = sizeof(vertices[0]) * vertices.size();
-
-	// staging buffer
-	VkBuffer stagingBuffer = VK_NULL_HANDLE;
-	VmaAllocation stagingAllocation = VK_NULL_HANDLE;
+	// Every mesh in its own vertex format, see VertexPacker
+	VkDeviceSize bufferSize = vertexStream.size();
 
+	// GPU local buffer
 	VkBufferCreateInfo  bufferInfo{};
 	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
 	bufferInfo.size = bufferSize;
-	bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+	bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
 
 	VmaAllocationCreateInfo allocInfo{};
-	allocInfo.usage = VMA_MEMORY_USAGE_AUTO;
-	allocInfo.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT;
-
-	if (vmaCreateBuffer(m_context.getAllocator(), &bufferInfo, &allocInfo, &stagingBuffer, &stagingAllocation, nullptr) != VK_SUCCESS)
-	{
-		throw std::runtime_error("Failed to create staging buffer");
-	}
-
-	// map + copy
-	void* data;
-	vmaMapMemory(m_context.getAllocator(), stagingAllocation, &data);
-	memcpy(data, vertices.data(), (size_t)bufferSize);
-	vmaUnmapMemory(m_context.getAllocator(), stagingAllocation);
-
-	// GPU local buffer
-	bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
 	allocInfo.usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE;
 
 	if (vmaCreateBuffer(m_context.getAllocator(), &bufferInfo, &allocInfo, &m_vertexBuffer, &m_vertexAllocation, nullptr) != VK_SUCCESS)
@@ -111,43 +94,22 @@ void GPUBuffer::createVertexBuffer(const std::vector<Vertex>& vertices)
 	nameObject(m_context.getDevice(), m_vertexBuffer, "VertexBuffer_Main");
 	std::cout << "Vertex Buffer created successfully" << std::endl;
 
-	// copy staging -> GPU
-	copyBuffer(stagingBuffer, m_vertexBuffer, bufferSize);
-
-	// cleanup
-	vmaDestroyBuffer(m_context.getAllocator(), stagingBuffer, stagingAllocation);
+	// Staged through the shared ring, the copy is submitted with the next upload flush
+	m_uploads.uploadBuffer(m_vertexBuffer, 0, vertexStream.data(), bufferSize);
 }
 
-void GPUBuffer::createIndexBuffer(const std::vector<uint32_t>& indices)
+void GPUBuffer::createIndexBuffer(const std::vector<std::byte>& indexStream)
 {
-	VkDeviceSize bufferSize = sizeof(indices[0]) * indices.size();
-
-	// staging buffer
-	VkBuffer stagingBuffer = VK_NULL_HANDLE;
-	VmaAllocation stagingAllocation = VK_NULL_HANDLE;
+	// 16-bit and 32-bit arenas, see IndexPacker
+	VkDeviceSize bufferSize = indexStream.size();
 
+	// GPU local buffer
 	VkBufferCreateInfo  bufferInfo{};
 	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
 	bufferInfo.size = bufferSize;
-	bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+	bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT;
 
 	VmaAllocationCreateInfo allocInfo{};
-	allocInfo.usage = VMA_MEMORY_USAGE_AUTO;
-	allocInfo.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT;
-
-	if (vmaCreateBuffer(m_context.getAllocator(), &bufferInfo, &allocInfo, &stagingBuffer, &stagingAllocation, nullptr) != VK_SUCCESS)
-	{
-		throw std::runtime_error("Failed to create Staging Buffer");
-	}
-
-	// map + copy
-	void* data;
-	vmaMapMemory(m_context.getAllocator(), stagingAllocation, &data);
-	memcpy(data, indices.data(), (size_t)bufferSize);
-	vmaUnmapMemory(m_context.getAllocator(), stagingAllocation);
-
-	// GPU local buffer
-	bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT;
 	allocInfo.usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE;
 
 	if (vmaCreateBuffer(m_context.getAllocator(), &bufferInfo, &allocInfo, &m_indexBuffer, &m_indexAllocation, nullptr) != VK_SUCCESS)
@@ -157,11 +119,7 @@ void GPUBuffer::createIndexBuffer(const std::vector<uint32_t>& indices)
 	nameObject(m_context.getDevice(), m_indexBuffer, "IndexBuffer_Main");
 	std::cout << "Index Buffer created successfully" << std::endl;
 
-	// copy staging -> GPU
-	copyBuffer(stagingBuffer, m_indexBuffer, bufferSize);
-
-	// cleanup
-	vmaDestroyBuffer(m_context.getAllocator(), stagingBuffer, stagingAllocation);
+	m_uploads.uploadBuffer(m_indexBuffer, 0, indexStream.data(), bufferSize);
 }
 
 void GPUBuffer::createOrResizeDebugVertexBuffer(size_t vertexCount)
@@ -302,6 +260,29 @@ void GPUBuffer::createObjectBuffer(size_t maxObjects)
 	std::cout << "Object dynamic SSBO created successfully (" << maxObjects << " objects)" << std::endl;
 }
 
+void GPUBuffer::createMeshBuffer(const std::vector<MeshGPUData>& meshData)
+{
+	m_meshBufferSize = sizeof(MeshGPUData) * meshData.size();
+
+	VkBufferCreateInfo bufferInfo{};
+	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferInfo.size = m_meshBufferSize;
+	bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+	bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	VmaAllocationCreateInfo allocInfo{};
+	allocInfo.usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE;
+
+	if (vmaCreateBuffer(m_context.getAllocator(), &bufferInfo, &allocInfo, &m_meshBuffer, &m_meshAllocation, nullptr) != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to create mesh SSBO");
+	}
+	nameObject(m_context.getDevice(), m_meshBuffer, "MeshBuffer_SSBO");
+	std::cout << "Mesh SSBO created successfully (" << meshData.size() << " meshes)" << std::endl;
+
+	m_uploads.uploadBuffer(m_meshBuffer, 0, meshData.data(), m_meshBufferSize);
+}
+
 void GPUBuffer::createVisibleIndexBuffer(size_t maxObjects)
 {
 	// Buffer must be large enough tn hold all object indices
@@ -335,17 +316,3 @@ void GPUBuffer::createVisibleIndexBuffer(size_t maxObjects)
 	nameObject(m_context.getDevice(), m_visibleIndexBuffer, "VisibleIndexBuffer_SSBO");
 	std::cout << "Visible Index dynamic SSBO created successfully" << std::endl;
 }
-
-
-void GPUBuffer::copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size)
-{
-	VkCommandBuffer commandBuffer = m_commands.beginSingleTimeCommands();
-
-	VkBufferCopy copyRegion{};
-	copyRegion.srcOffset = 0;
-	copyRegion.dstOffset = 0;
-	copyRegion.size = size;
-	vkCmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
-
-	m_commands.endSingleTimeCommands(commandBuffer);
-}
@@ -0,0 +1,546 @@
+#include "Utils.hpp"
+
+#include "GPUCuller.hpp"
+#include "GPUBuffer.hpp"
+#include "VulkanContext.hpp"
+#include "UploadManager.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <stdexcept>
+#include <unordered_map>
+
+static_assert(MAX_MESH_LODS == 4, "MeshRecord::lodErrors holds the errors of every level in a vec4");
+
+GPUCuller::Layout GPUCuller::buildLayout(const std::vector<ObjectData>& objects, const std::vector<Mesh>& allMeshes,
+	const std::vector<Submesh>& allSubmeshes, const std::vector<Material>& allMaterials, uint32_t firstInstance, uint32_t viewCount)
+{
+	Layout layout;
+	layout.meshes.resize(allMeshes.size(), {});
+	layout.viewCount = viewCount;
+
+	std::vector<uint32_t> objectsPerMesh(allMeshes.size(), 0);
+	for (const ObjectData& object : objects)
+	{
+		++objectsPerMesh[object.meshIndex];
+	}
+
+	// Batches are keyed by material, then vertex and index format, so the ordered map walks them in material order
+	auto batchKey = [](uint32_t materialIndex, VertexFormat vertexFormat, IndexFormat indexFormat)
+		{
+			return (uint64_t(materialIndex) * static_cast<uint32_t>(VertexFormat::Count) + static_cast<uint32_t>(vertexFormat))
+				* static_cast<uint32_t>(IndexFormat::Count) + static_cast<uint32_t>(indexFormat);
+		};
+	std::map<uint64_t, Layout::Batch> batchByKey;
+	std::vector<uint64_t> drawKeys;
+
+	for (uint32_t meshIndex = 0; meshIndex < allMeshes.size(); ++meshIndex)
+	{
+		const Mesh& mesh = allMeshes[meshIndex];
+		auto isOpaque = [&](uint32_t s) { return allMaterials[allSubmeshes[mesh.submeshOffset + s].materialIndex].alphablending != 1; };
+
+		// Meshes nobody uses and fully blended ones keep a level count of 0, the cull shader skips them
+		bool hasOpaque = false;
+		for (uint32_t s = 0; s < mesh.submeshCount; ++s)
+		{
+			hasOpaque |= isOpaque(s);
+		}
+		if (objectsPerMesh[meshIndex] == 0 || !hasOpaque)
+		{
+			continue;
+		}
+
+		Layout::MeshRecord& record = layout.meshes[meshIndex];
+		record.boundsMin = glm::vec4(mesh.bounds.min, 0.0f);
+		record.boundsMax = glm::vec4(mesh.bounds.max, 0.0f);
+		record.lodErrors = glm::vec4(mesh.lodErrors[0], mesh.lodErrors[1], mesh.lodErrors[2], mesh.lodErrors[3]);
+		record.lodCount = mesh.lodCount;
+		record.firstGroup = layout.groupCount;
+		record.firstInstance = firstInstance + layout.instanceCount;
+		record.instanceCapacity = objectsPerMesh[meshIndex];
+
+		layout.groupCount += mesh.lodCount;
+		layout.instanceCount += mesh.lodCount * objectsPerMesh[meshIndex];
+
+		for (uint32_t lod = 0; lod < mesh.lodCount; ++lod)
+		{
+			const uint32_t group = record.firstGroup + lod;
+
+			// Runs of submeshes with the same batch and adjoining index ranges become one draw, as the CPU path merges them
+			std::unordered_map<uint64_t, uint32_t> lastDrawByKey;
+			for (uint32_t s = 0; s < mesh.submeshCount; ++s)
+			{
+				if (!isOpaque(s))
+				{
+					continue;
+				}
+
+				const Submesh& submesh = allSubmeshes[mesh.submeshOffset + s];
+				const SubmeshLod level = submesh.getLod(lod);
+				const uint32_t firstIndex = mesh.gpuFirstIndex + (level.indexOffset - mesh.indexOffset);
+				const uint64_t key = batchKey(submesh.materialIndex, mesh.vertexFormat, mesh.indexFormat);
+
+				auto last = lastDrawByKey.find(key);
+				if (last != lastDrawByKey.end())
+				{
+					Layout::DrawRecord& lastDraw = layout.draws[last->second];
+					if (lastDraw.firstIndex + lastDraw.indexCount == firstIndex)
+					{
+						lastDraw.indexCount += level.indexCount;
+						continue;
+					}
+				}
+
+				lastDrawByKey[key] = static_cast<uint32_t>(layout.draws.size());
+				layout.draws.push_back({ level.indexCount, firstIndex, static_cast<int32_t>(mesh.gpuVertexOffset),
+					record.firstInstance + lod * record.instanceCapacity, group, 0, 0, 0 });
+				drawKeys.push_back(key);
+
+				Layout::Batch& batch = batchByKey[key];
+				batch.materialIndex = submesh.materialIndex;
+				batch.vertexFormat = mesh.vertexFormat;
+				batch.indexFormat = mesh.indexFormat;
+				++batch.commandCount;
+			}
+		}
+	}
+
+	// Every batch owns a contiguous range of commands, as many as it has draws
+	std::unordered_map<uint64_t, uint32_t> batchIndexByKey;
+	uint32_t firstCommand = 0;
+	for (auto& [key, batch] : batchByKey)
+	{
+		batch.firstCommand = firstCommand;
+		firstCommand += batch.commandCount;
+		batchIndexByKey[key] = static_cast<uint32_t>(layout.batches.size());
+		layout.batches.push_back(batch);
+	}
+
+	for (uint32_t d = 0; d < layout.draws.size(); ++d)
+	{
+		layout.draws[d].batch = batchIndexByKey[drawKeys[d]];
+		layout.draws[d].firstCommand = layout.batches[layout.draws[d].batch].firstCommand;
+	}
+	return layout;
+}
+
+GPUCuller::GPUCuller(VulkanContext& context, UploadManager& uploads, GPUBuffer& buffer, Layout layout, uint32_t objectCount, uint32_t maxFramesInFlight,
+	const std::string& cullShaderPath, const std::string& drawShaderPath)
+	: m_context(context), m_buffer(buffer), m_layout(std::move(layout)), m_objectCount(objectCount), m_maxFramesInFlight(maxFramesInFlight)
+{
+	createBuffers(uploads);
+	createDescriptors();
+	createPipelines(cullShaderPath, drawShaderPath);
+
+	std::cout << "GPU culler created successfully (" << m_layout.draws.size() << " draws in " << m_layout.batches.size() << " batches, "
+		<< m_layout.viewCount << " views)" << std::endl;
+}
+
+GPUCuller::~GPUCuller()
+{
+	vkDestroyPipeline(m_context.getDevice(), m_cullPipeline, nullptr);
+	vkDestroyPipeline(m_context.getDevice(), m_drawPipeline, nullptr);
+	vkDestroyPipelineLayout(m_context.getDevice(), m_pipelineLayout, nullptr);
+	vkDestroyDescriptorPool(m_context.getDevice(), m_descriptorPool, nullptr);
+	vkDestroyDescriptorSetLayout(m_context.getDevice(), m_descriptorSetLayout, nullptr);
+
+	vmaDestroyBuffer(m_context.getAllocator(), m_meshBuffer, m_meshAllocation);
+	vmaDestroyBuffer(m_context.getAllocator(), m_drawBuffer, m_drawAllocation);
+	vmaDestroyBuffer(m_context.getAllocator(), m_counterBuffer, m_counterAllocation);
+	vmaDestroyBuffer(m_context.getAllocator(), m_readbackBuffer, m_readbackAllocation);
+	vmaDestroyBuffer(m_context.getAllocator(), m_commandBuffer, m_commandAllocation);
+}
+
+void GPUCuller::recordCulling(VkCommandBuffer cmd, std::span<const Frustum> frustums, const glm::vec3& cameraPos, float worldPerPixel, float lodPixelError, uint32_t currentFrame)
+{
+	if (frustums.size() != m_layout.viewCount)
+	{
+		throw std::runtime_error("GPUCuller: expected one frustum per view");
+	}
+
+	// The views' counters are adjacent, one fill and one copy cover the whole frame
+	const VkDeviceSize frameCounterOffset = currentFrame * m_layout.viewCount * m_alignedCounterSize;
+	const VkDeviceSize frameCounterSize = m_layout.viewCount * m_alignedCounterSize;
+
+	// Instance lists and batch draw counts start empty
+	vkCmdFillBuffer(cmd, m_counterBuffer, frameCounterOffset, frameCounterSize, 0);
+
+	VkMemoryBarrier2 clearBarrier{};
+	clearBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2;
+	clearBarrier.srcStageMask = VK_PIPELINE_STAGE_2_CLEAR_BIT;
+	clearBarrier.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+	clearBarrier.dstStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+	clearBarrier.dstAccessMask = VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT;
+
+	VkDependencyInfo clearDepInfo{};
+	clearDepInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+	clearDepInfo.memoryBarrierCount = 1;
+	clearDepInfo.pMemoryBarriers = &clearBarrier;
+	vkCmdPipelineBarrier2(cmd, &clearDepInfo);
+
+	PushConstants pc{};
+	pc.cameraPos = cameraPos;
+	pc.worldPerPixel = worldPerPixel;
+	pc.objectCount = m_objectCount;
+	pc.drawCount = static_cast<uint32_t>(m_layout.draws.size());
+	pc.lodPixelError = lodPixelError;
+	pc.batchCount = static_cast<uint32_t>(m_layout.batches.size());
+
+	// Objects into instance lists, the views only differ in their planes
+	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_cullPipeline);
+	for (uint32_t view = 0; view < m_layout.viewCount; ++view)
+	{
+		for (uint32_t p = 0; p < frustums[view].planes.size(); ++p)
+		{
+			pc.planes[p] = glm::vec4(frustums[view].planes[p].normal, frustums[view].planes[p].distance);
+		}
+		bindView(cmd, view, currentFrame);
+		vkCmdPushConstants(cmd, m_pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(PushConstants), &pc);
+		vkCmdDispatch(cmd, (m_objectCount + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, 1, 1);
+	}
+
+	VkMemoryBarrier2 cullBarrier{};
+	cullBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2;
+	cullBarrier.srcStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+	cullBarrier.srcAccessMask = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT;
+	cullBarrier.dstStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+	cullBarrier.dstAccessMask = VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT;
+
+	VkDependencyInfo cullDepInfo{};
+	cullDepInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+	cullDepInfo.memoryBarrierCount = 1;
+	cullDepInfo.pMemoryBarriers = &cullBarrier;
+	vkCmdPipelineBarrier2(cmd, &cullDepInfo);
+
+	// Instance lists into draw commands, the pushed counts are the same for every view
+	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_drawPipeline);
+	for (uint32_t view = 0; view < m_layout.viewCount; ++view)
+	{
+		bindView(cmd, view, currentFrame);
+		vkCmdDispatch(cmd, (pc.drawCount + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, 1, 1);
+	}
+
+	VkMemoryBarrier2 drawBarrier{};
+	drawBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2;
+	drawBarrier.srcStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+	drawBarrier.srcAccessMask = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT;
+	drawBarrier.dstStageMask = VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_2_COPY_BIT;
+	drawBarrier.dstAccessMask = VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_TRANSFER_READ_BIT;
+
+	VkDependencyInfo drawDepInfo{};
+	drawDepInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+	drawDepInfo.memoryBarrierCount = 1;
+	drawDepInfo.pMemoryBarriers = &drawBarrier;
+	vkCmdPipelineBarrier2(cmd, &drawDepInfo);
+
+	// Counters stay on the device for the atomics, a copy comes back for the stats
+	VkBufferCopy copyRegion{};
+	copyRegion.srcOffset = frameCounterOffset;
+	copyRegion.dstOffset = frameCounterOffset;
+	copyRegion.size = frameCounterSize;
+	vkCmdCopyBuffer(cmd, m_counterBuffer, m_readbackBuffer, 1, &copyRegion);
+
+	VkMemoryBarrier2 readbackBarrier{};
+	readbackBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2;
+	readbackBarrier.srcStageMask = VK_PIPELINE_STAGE_2_COPY_BIT;
+	readbackBarrier.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+	readbackBarrier.dstStageMask = VK_PIPELINE_STAGE_2_HOST_BIT;
+	readbackBarrier.dstAccessMask = VK_ACCESS_2_HOST_READ_BIT;
+
+	VkDependencyInfo readbackDepInfo{};
+	readbackDepInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+	readbackDepInfo.memoryBarrierCount = 1;
+	readbackDepInfo.pMemoryBarriers = &readbackBarrier;
+	vkCmdPipelineBarrier2(cmd, &readbackDepInfo);
+}
+
+void GPUCuller::bindView(VkCommandBuffer cmd, uint32_t view, uint32_t currentFrame) const
+{
+	// Counters and commands are laid out frame by frame, view by view within a frame
+	const uint32_t region = currentFrame * m_layout.viewCount + view;
+	std::array<uint32_t, 4> dynamicOffsets = {
+		static_cast<uint32_t>(currentFrame * m_buffer.getAlignedObjectSize()),
+		static_cast<uint32_t>(currentFrame * m_buffer.getAlignedVisibleIndexBufferSize()),
+		static_cast<uint32_t>(region * m_alignedCounterSize),
+		static_cast<uint32_t>(region * m_alignedCommandSize),
+	};
+
+	vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipelineLayout, 0, 1, &m_descriptorSets[view],
+		static_cast<uint32_t>(dynamicOffsets.size()), dynamicOffsets.data());
+}
+
+void GPUCuller::drawBatch(VkCommandBuffer cmd, uint32_t batch, uint32_t currentFrame, uint32_t view) const
+{
+	const VkDeviceSize region = currentFrame * m_layout.viewCount + view;
+	const Layout::Batch& record = m_layout.batches[batch];
+	vkCmdDrawIndexedIndirectCount(cmd,
+		m_commandBuffer, region * m_alignedCommandSize + record.firstCommand * sizeof(VkDrawIndexedIndirectCommand),
+		m_counterBuffer, region * m_alignedCounterSize + batch * sizeof(uint32_t),
+		record.commandCount, sizeof(VkDrawIndexedIndirectCommand));
+}
+
+GPUCullStats GPUCuller::readStats(uint32_t currentFrame, uint32_t view) const
+{
+	const VkDeviceSize offset = (currentFrame * m_layout.viewCount + view) * m_alignedCounterSize;
+	vmaInvalidateAllocation(m_context.getAllocator(), m_readbackAllocation, offset, m_counterSize);
+
+	// Every visible object is in exactly one instance list
+	const uint32_t* counters = reinterpret_cast<const uint32_t*>(static_cast<const char*>(m_readbackBufferMapped) + offset);
+	const uint32_t batchCount = static_cast<uint32_t>(m_layout.batches.size());
+
+	GPUCullStats stats;
+	for (uint32_t b = 0; b < batchCount; ++b)
+	{
+		stats.drawCount += counters[b];
+	}
+	for (uint32_t g = 0; g < m_layout.groupCount; ++g)
+	{
+		stats.visibleObjects += counters[batchCount + g];
+	}
+	return stats;
+}
+
+void GPUCuller::createBuffers(UploadManager& uploads)
+{
+	VkPhysicalDeviceProperties props;
+	vkGetPhysicalDeviceProperties(m_context.getPhysicalDevice(), &props);
+	VkDeviceSize alignment = props.limits.minStorageBufferOffsetAlignment;
+
+	// Zero sized buffers are invalid, a scene without opaque draws still gets one element
+	auto createBuffer = [&](VkDeviceSize size, VkBufferUsageFlags usage, VmaAllocationCreateFlags flags, VkBuffer& buffer, VmaAllocation& allocation, const char* name)
+		{
+			VkBufferCreateInfo bufferInfo{};
+			bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+			bufferInfo.size = std::max<VkDeviceSize>(size, sizeof(uint32_t));
+			bufferInfo.usage = usage;
+			bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+			VmaAllocationCreateInfo allocInfo{};
+			allocInfo.usage = flags != 0 ? VMA_MEMORY_USAGE_AUTO : VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE;
+			allocInfo.flags = flags;
+
+			if (vmaCreateBuffer(m_context.getAllocator(), &bufferInfo, &allocInfo, &buffer, &allocation, nullptr) != VK_SUCCESS)
+			{
+				throw std::runtime_error(std::string("Failed to create ") + name);
+			}
+			nameObject(m_context.getDevice(), buffer, name);
+		};
+
+	auto alignedSize = [&](VkDeviceSize size) { return (std::max<VkDeviceSize>(size, sizeof(uint32_t)) + alignment - 1) & ~(alignment - 1); };
+
+	// Each view reads its own copy of the records, their instance offsets moved to the view's lists
+	const VkDeviceSize meshBytes = m_layout.meshes.size() * sizeof(Layout::MeshRecord);
+	m_alignedMeshSize = alignedSize(meshBytes);
+	createBuffer(m_alignedMeshSize * m_layout.viewCount, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, 0,
+		m_meshBuffer, m_meshAllocation, "CullMeshBuffer_SSBO");
+
+	const VkDeviceSize drawBytes = m_layout.draws.size() * sizeof(Layout::DrawRecord);
+	m_alignedDrawSize = alignedSize(drawBytes);
+	createBuffer(m_alignedDrawSize * m_layout.viewCount, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, 0,
+		m_drawBuffer, m_drawAllocation, "CullDrawBuffer_SSBO");
+
+	for (uint32_t view = 0; view < m_layout.viewCount; ++view)
+	{
+		const uint32_t instanceOffset = view * m_layout.instanceCount;
+		std::vector<Layout::MeshRecord> meshes = m_layout.meshes;
+		for (Layout::MeshRecord& mesh : meshes)
+		{
+			mesh.firstInstance += instanceOffset;
+		}
+		std::vector<Layout::DrawRecord> draws = m_layout.draws;
+		for (Layout::DrawRecord& draw : draws)
+		{
+			draw.firstInstance += instanceOffset;
+		}
+
+		if (meshBytes > 0)
+		{
+			uploads.uploadBuffer(m_meshBuffer, view * m_alignedMeshSize, meshes.data(), meshBytes);
+		}
+		if (drawBytes > 0)
+		{
+			uploads.uploadBuffer(m_drawBuffer, view * m_alignedDrawSize, draws.data(), drawBytes);
+		}
+	}
+
+	// Per frame and view regions, bound with dynamic offsets like the other per frame buffers
+	m_counterSize = std::max<VkDeviceSize>((m_layout.batches.size() + m_layout.groupCount) * sizeof(uint32_t), sizeof(uint32_t));
+	m_alignedCounterSize = (m_counterSize + alignment - 1) & ~(alignment - 1);
+	createBuffer(m_alignedCounterSize * m_layout.viewCount * m_maxFramesInFlight,
+		VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+		0, m_counterBuffer, m_counterAllocation, "CullCounterBuffer_SSBO");
+
+	createBuffer(m_alignedCounterSize * m_layout.viewCount * m_maxFramesInFlight, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT, m_readbackBuffer, m_readbackAllocation, "CullReadbackBuffer");
+
+	VmaAllocationInfo readbackInfo{};
+	vmaGetAllocationInfo(m_context.getAllocator(), m_readbackAllocation, &readbackInfo);
+	m_readbackBufferMapped = readbackInfo.pMappedData;
+	memset(m_readbackBufferMapped, 0, m_alignedCounterSize * m_layout.viewCount * m_maxFramesInFlight);
+
+	m_commandSize = std::max<VkDeviceSize>(m_layout.draws.size() * sizeof(VkDrawIndexedIndirectCommand), sizeof(uint32_t));
+	m_alignedCommandSize = (m_commandSize + alignment - 1) & ~(alignment - 1);
+	createBuffer(m_alignedCommandSize * m_layout.viewCount * m_maxFramesInFlight, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+		0, m_commandBuffer, m_commandAllocation, "CullCommandBuffer_SSBO");
+}
+
+void GPUCuller::createDescriptors()
+{
+	// Objects, visible indices, counters and commands move with the frame, the records are static.
+	// Every view has its own set, pointing at its copy of the records.
+	const std::array<VkDescriptorType, 6> types = {
+		VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, // 0: Object data
+		VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, // 1: Visible indices, instance lists are written behind the CPU's entries
+		VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, // 2: Mesh records
+		VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, // 3: Draw records
+		VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, // 4: Batch draw counts and instance list sizes
+		VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, // 5: Draw commands
+	};
+
+	std::array<VkDescriptorSetLayoutBinding, 6> bindings{};
+	for (uint32_t b = 0; b < bindings.size(); ++b)
+	{
+		bindings[b].binding = b;
+		bindings[b].descriptorType = types[b];
+		bindings[b].descriptorCount = 1;
+		bindings[b].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	}
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+	layoutInfo.pBindings = bindings.data();
+
+	if (vkCreateDescriptorSetLayout(m_context.getDevice(), &layoutInfo, nullptr, &m_descriptorSetLayout) != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to create cull descriptor set layout");
+	}
+	nameObject(m_context.getDevice(), m_descriptorSetLayout, "DescriptorSetLayout_Cull");
+
+	const uint32_t viewCount = m_layout.viewCount;
+	std::array<VkDescriptorPoolSize, 2> poolSizes{};
+	poolSizes[0] = { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, 4 * viewCount };
+	poolSizes[1] = { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2 * viewCount };
+
+	VkDescriptorPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+	poolInfo.pPoolSizes = poolSizes.data();
+	poolInfo.maxSets = viewCount;
+
+	if (vkCreateDescriptorPool(m_context.getDevice(), &poolInfo, nullptr, &m_descriptorPool) != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to create cull descriptor pool");
+	}
+	nameObject(m_context.getDevice(), m_descriptorPool, "DescriptorPool_Cull");
+
+	std::vector<VkDescriptorSetLayout> setLayouts(viewCount, m_descriptorSetLayout);
+	m_descriptorSets.resize(viewCount);
+
+	VkDescriptorSetAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorPool = m_descriptorPool;
+	allocInfo.descriptorSetCount = viewCount;
+	allocInfo.pSetLayouts = setLayouts.data();
+
+	if (vkAllocateDescriptorSets(m_context.getDevice(), &allocInfo, m_descriptorSets.data()) != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to allocate cull descriptor sets");
+	}
+
+	for (uint32_t view = 0; view < viewCount; ++view)
+	{
+		nameObject(m_context.getDevice(), m_descriptorSets[view], "DescriptorSet_Cull");
+
+		// Dynamic bindings span one frame's region, the records are this view's copy
+		const std::array<VkDescriptorBufferInfo, 6> bufferInfos = { {
+			{ m_buffer.getObjectBuffer(), 0, m_buffer.getAlignedObjectSize() },
+			{ m_buffer.getVisibleIndexBuffer(), 0, m_buffer.getVisibleIndexBufferSize() },
+			{ m_meshBuffer, view * m_alignedMeshSize, m_alignedMeshSize },
+			{ m_drawBuffer, view * m_alignedDrawSize, m_alignedDrawSize },
+			{ m_counterBuffer, 0, m_counterSize },
+			{ m_commandBuffer, 0, m_commandSize },
+		} };
+
+		std::array<VkWriteDescriptorSet, 6> writes{};
+		for (uint32_t b = 0; b < writes.size(); ++b)
+		{
+			writes[b].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			writes[b].dstSet = m_descriptorSets[view];
+			writes[b].dstBinding = b;
+			writes[b].descriptorCount = 1;
+			writes[b].descriptorType = types[b];
+			writes[b].pBufferInfo = &bufferInfos[b];
+		}
+		vkUpdateDescriptorSets(m_context.getDevice(), static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+	}
+}
+
+void GPUCuller::createPipelines(const std::string& cullShaderPath, const std::string& drawShaderPath)
+{
+	VkPushConstantRange pushConstantRange{};
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = sizeof(PushConstants);
+
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutInfo.setLayoutCount = 1;
+	pipelineLayoutInfo.pSetLayouts = &m_descriptorSetLayout;
+	pipelineLayoutInfo.pushConstantRangeCount = 1;
+	pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+	if (vkCreatePipelineLayout(m_context.getDevice(), &pipelineLayoutInfo, nullptr, &m_pipelineLayout) != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to create cull pipeline layout");
+	}
+	nameObject(m_context.getDevice(), m_pipelineLayout, "PipelineLayout_Cull");
+
+	m_cullPipeline = createComputePipeline(cullShaderPath, "Pipeline_CullObjects");
+	m_drawPipeline = createComputePipeline(drawShaderPath, "Pipeline_CullDraws");
+}
+
+VkPipeline GPUCuller::createComputePipeline(const std::string& path, const char* name)
+{
+	std::ifstream file(path, std::ios::ate | std::ios::binary);
+	if (!file.is_open())
+	{
+		throw std::runtime_error("Failed to open file: " + path);
+	}
+	std::vector<char> code(static_cast<size_t>(file.tellg()));
+	file.seekg(0);
+	file.read(code.data(), code.size());
+
+	VkShaderModuleCreateInfo moduleInfo{};
+	moduleInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+	moduleInfo.codeSize = code.size();
+	moduleInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
+
+	VkShaderModule shaderModule;
+	if (vkCreateShaderModule(m_context.getDevice(), &moduleInfo, nullptr, &shaderModule) != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to create shader module!");
+	}
+
+	VkComputePipelineCreateInfo pipelineInfo{};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	pipelineInfo.stage.module = shaderModule;
+	pipelineInfo.stage.pName = "main";
+	pipelineInfo.layout = m_pipelineLayout;
+
+	VkPipeline pipeline;
+	VkResult result = vkCreateComputePipelines(m_context.getDevice(), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline);
+	vkDestroyShaderModule(m_context.getDevice(), shaderModule, nullptr);
+	if (result != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to create compute pipeline: " + path);
+	}
+	nameObject(m_context.getDevice(), pipeline, name);
+	return pipeline;
+}
@@ -1,17 +1,127 @@
 #include "Utils.hpp"
 #include "Commands.hpp"
 #include "GPUImage.hpp"
+#include "TextureCache.hpp"
+#include "UploadManager.hpp"
 
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
 
+#include <algorithm>
+#include <cctype>
 #include <cmath>
+#include <execution>
+#include <filesystem>
+#include <utility>
 #include <stdexcept>
 #include <iostream>
 #include <array>
 
-GPUImage::GPUImage(VulkanContext& context, Commands& commands)
-	: m_context(context), m_commands(commands) 
+namespace
+{
+	// Streamed textures keep every level up to this size resident, about 5 KB of BC7 per texture
+	constexpr uint32_t STREAMING_TAIL_SIZE = 64;
+
+	// Upload volume streaming may add to one frame, the first resize of a frame always goes through
+	constexpr VkDeviceSize STREAMING_BYTES_PER_FRAME = 32ull << 20;
+
+	VkFormat toVkFormat(TextureFormat format, TextureType type)
+	{
+		const bool srgb = type == TextureType::Color;
+		switch (format)
+		{
+		case TextureFormat::BC4:
+			return VK_FORMAT_BC4_UNORM_BLOCK;
+		case TextureFormat::BC5:
+			return VK_FORMAT_BC5_UNORM_BLOCK;
+		case TextureFormat::BC7:
+			return srgb ? VK_FORMAT_BC7_SRGB_BLOCK : VK_FORMAT_BC7_UNORM_BLOCK;
+		default:
+			return srgb ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;
+		}
+	}
+
+	// BC4 reads back as grey like the RGBA8 original. BC5 has no blue, reading it as 1 keeps normal maps
+	// usable by shaders that don't reconstruct z.
+	VkComponentMapping toSwizzle(TextureFormat format)
+	{
+		switch (format)
+		{
+		case TextureFormat::BC4:
+			return { VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_ONE };
+		case TextureFormat::BC5:
+			return { VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_G, VK_COMPONENT_SWIZZLE_ONE, VK_COMPONENT_SWIZZLE_ONE };
+		default:
+			return {};
+		}
+	}
+
+	// Runs 'cleanup' if the scope is left before dismiss(), undoing work an exception cut short.
+	// The cleanup runs while unwinding, so it must not throw: a failure is logged and whatever it
+	// could not release is leaked rather than terminating
+	template <typename F>
+	class ScopeGuard
+	{
+	public:
+		explicit ScopeGuard(F cleanup) : m_cleanup(std::move(cleanup)) {}
+		~ScopeGuard()
+		{
+			if (!m_active)
+			{
+				return;
+			}
+			try
+			{
+				m_cleanup();
+			}
+			catch (const std::exception& e)
+			{
+				std::cerr << "Cleanup after a failed texture upload failed: " << e.what() << std::endl;
+			}
+			catch (...)
+			{
+				std::cerr << "Cleanup after a failed texture upload failed" << std::endl;
+			}
+		}
+
+		ScopeGuard(const ScopeGuard&) = delete;
+		ScopeGuard& operator=(const ScopeGuard&) = delete;
+
+		void dismiss() { m_active = false; }
+
+	private:
+		F m_cleanup;
+		bool m_active = true;
+	};
+
+	// Registry key: the same file reached through different relative paths or casing maps to one entry
+	std::string textureKey(const std::string& path, TextureType type)
+	{
+		std::error_code error;
+		std::filesystem::path canonical = std::filesystem::weakly_canonical(path, error);
+		std::string key = (error ? std::filesystem::path(path).lexically_normal() : canonical).generic_string();
+#ifdef _WIN32
+		std::transform(key.begin(), key.end(), key.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+#endif
+		key += "|" + std::to_string(static_cast<uint32_t>(type));
+		return key;
+	}
+
+	// Exceptions can't leave a parallel algorithm, the first one is rethrown afterwards
+	void rethrowFirst(const std::vector<std::exception_ptr>& errors)
+	{
+		for (const std::exception_ptr& error : errors)
+		{
+			if (error)
+			{
+				std::rethrow_exception(error);
+			}
+		}
+	}
+}
+
+GPUImage::GPUImage(VulkanContext& context, Commands& commands, UploadManager& uploads)
+	: m_context(context), m_commands(commands), m_uploads(uploads)
 {
 	createSampler();
 }
@@ -33,6 +143,11 @@ GPUImage::~GPUImage()
 		vkDestroyImageView(m_context.getDevice(), m_textures[i].view, nullptr);
 		vmaDestroyImage(m_context.getAllocator(), m_textures[i].image, m_textures[i].allocation);
 	}
+	for (const RetiredImage& retired : m_retiredImages)
+	{
+		vkDestroyImageView(m_context.getDevice(), retired.view, nullptr);
+		vmaDestroyImage(m_context.getAllocator(), retired.image, retired.allocation);
+	}
 
 	vkDestroyImageView(m_context.getDevice(), m_skyboxImageView, nullptr);
 	vmaDestroyImage(m_context.getAllocator(), m_skyboxImage, m_skyboxImageAllocation);
@@ -56,84 +171,302 @@ GPUImage::~GPUImage()
 	m_shadowMaps.clear();
 }
 
-uint32_t GPUImage::loadTexture(const std::string& path, bool is_srgb)
+uint32_t GPUImage::loadTexture(const std::string& path, TextureType type)
 {
-	Texture tex = createTextureImageFromFile(path, is_srgb);
+	uint32_t index = queueTexture(path, type);
+	uploadQueuedTextures();
+	return index;
+}
 
-	uint32_t index = static_cast<uint32_t>(m_textures.size());
-	m_textures.push_back(tex);
-	m_textureViews.push_back(tex.view);
+uint32_t GPUImage::queueTexture(const std::string& path, TextureType type)
+{
+	std::string key = textureKey(path, type);
+
+	auto existing = m_textureLookup.find(key);
+	if (existing != m_textureLookup.end())
+	{
+		++m_textureRequestCounts[existing->second];
+		return existing->second;
+	}
 
-	std::cout << "Loaded Texture [" << index << "]: " << path << std::endl;
+	// Queued textures are appended in order, so their final index is known now
+	uint32_t index = static_cast<uint32_t>(m_textures.size() + m_queuedTextures.size());
+	m_queuedTextures.push_back({ path, type });
+	m_textureLookup.emplace(std::move(key), index);
+	m_textureRequestCounts.push_back(1);
 	return index;
 }
 
-GPUImage::Texture GPUImage::createTextureImageFromFile(const std::string& path, bool is_srgb)
+TextureStats GPUImage::getTextureStats() const
+{
+	TextureStats stats{};
+	stats.uniqueTextures = static_cast<uint32_t>(m_textureRequestCounts.size());
+
+	for (size_t i = 0; i < m_textureRequestCounts.size(); ++i)
+	{
+		stats.requests += m_textureRequestCounts[i];
+
+		// Only uploaded textures have a known size
+		if (i < m_textures.size())
+		{
+			stats.bytesUploaded += m_textures[i].bytes;
+			stats.bytesUncompressed += m_textures[i].rgba8Bytes;
+			stats.bytesSaved += m_textures[i].bytes * (m_textureRequestCounts[i] - 1);
+			stats.bytesFullChains += m_textures[i].fullBytes;
+		}
+	}
+
+	stats.streamingBudget = m_streamingBudget;
+	stats.promotions = m_promotions;
+	stats.evictions = m_evictions;
+	return stats;
+}
+
+void GPUImage::uploadQueuedTextures()
+{
+	if (m_queuedTextures.empty())
+	{
+		return;
+	}
+	ScopeGuard discardOnFailure([&]() { discardQueuedTextures(); });
+
+	// Every texture is mapped from its cooked cache, or decoded and cooked first, on its own worker
+	const bool blockCompression = m_context.supportsTextureCompressionBC();
+	std::vector<std::exception_ptr> errors(m_queuedTextures.size());
+	std::for_each(std::execution::par, m_queuedTextures.begin(), m_queuedTextures.end(),
+		[&](TextureRequest& request)
+		{
+			try
+			{
+				TextureCache::prepare(request.path, request.type, blockCompression, request.cooked);
+			}
+			catch (...)
+			{
+				errors[&request - m_queuedTextures.data()] = std::current_exception();
+			}
+		});
+	rethrowFirst(errors);
+
+	// Images are created here, their data goes through the staging ring and is submitted with the next flush
+	for (TextureRequest& request : m_queuedTextures)
+	{
+		uint32_t index = static_cast<uint32_t>(m_textures.size());
+		if ((index + 1) * 2 > MAX_TEXTURE_SLOTS)
+		{
+			throw std::runtime_error("Bindless texture array is full");
+		}
+
+		Texture tex{};
+		tex.mipLevels = static_cast<uint32_t>(request.cooked.levels.size());
+		tex.source = std::move(request.cooked);
+		tex.fullBytes = levelBytes(tex, 0);
+
+		// Streamed textures start with the levels no larger than the tail size
+		if (isStreamingEnabled())
+		{
+			while (tex.tailMip + 1 < tex.mipLevels &&
+				std::max(tex.source.levels[tex.tailMip].width, tex.source.levels[tex.tailMip].height) > STREAMING_TAIL_SIZE)
+			{
+				++tex.tailMip;
+			}
+		}
+		createTextureImage(tex, tex.tailMip);
+		m_residentBytes += tex.bytes;
+
+		// The staged copy is all a fully resident texture needs
+		if (!isStreamingEnabled())
+		{
+			tex.source = CookedTexture{};
+		}
+
+		// Both slots start out with the same view
+		m_textureViews.push_back(tex.view);
+		m_textureViews.push_back(tex.view);
+		m_textures.push_back(std::move(tex));
+
+		std::cout << "Loaded Texture [" << index << "]: " << request.path << std::endl;
+	}
+	nameObject(m_context.getDevice(), m_sharedTextureSampler, "Sampler_Texture");
+
+	discardOnFailure.dismiss();
+	m_queuedTextures.clear();
+	m_uploads.flush();
+
+	TextureStats stats = getTextureStats();
+	std::cout << "Texture registry: " << stats.requests << " requests, " << stats.uniqueTextures << " unique, "
+		<< (stats.bytesUploaded >> 20) << " MB uploaded (" << (stats.bytesUncompressed >> 20) << " MB as RGBA8), "
+		<< (stats.bytesSaved >> 20) << " MB saved by reuse" << std::endl;
+}
+
+void GPUImage::discardQueuedTextures()
 {
-	int texWidth, texHeight, texChannels;
-	uint8_t* pixels = stbi_load(path.c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
+	// Textures that got no image give their index back, a retry queues them afresh
+	const uint32_t uploaded = static_cast<uint32_t>(m_textures.size());
+	std::erase_if(m_textureLookup, [&](const auto& entry) { return entry.second >= uploaded; });
+	m_textureRequestCounts.resize(uploaded);
+	m_queuedTextures.clear();
+
+	// Copies already recorded for the textures that made it are submitted as usual
+	m_uploads.flush();
+}
 
-	if (!pixels)
+uint32_t GPUImage::getTextureSlot(uint32_t index) const
+{
+	if (index == UINT32_MAX)
 	{
-		throw std::runtime_error("Failed to load texture image!");
+		return index;
 	}
-	Texture tex;
+	return index * 2 + (index < m_textures.size() ? m_textures[index].activeSlot : 0);
+}
 
-	// Conditional format selection
-	VkFormat imageFormat = is_srgb ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;
+void GPUImage::enableTextureStreaming(VkDeviceSize budget, uint32_t framesInFlight)
+{
+	m_streamingBudget = budget;
+	m_framesInFlight = framesInFlight;
 
-	// Conditionally set mip levels
-	tex.mipLevels = 1;
+	std::cout << "Texture streaming enabled (" << (budget >> 20) << " MB budget)" << std::endl;
+}
 
-	if (is_srgb)
+void GPUImage::requestTexture(uint32_t index, float uvPerPixel)
+{
+	if (!isStreamingEnabled() || index >= m_textures.size())
 	{
-		// Only caclulate full mip-chain for color maps
-		tex.mipLevels = static_cast<uint32_t>(std::floor(std::log2(std::max(texWidth, texHeight)))) + 1;
+		return;
 	}
 
-	VkDeviceSize imageSize = texWidth * texHeight * 4;
+	// Texels of level 0 under one pixel, every level halves them
+	Texture& tex = m_textures[index];
+	const TextureLevel& top = tex.source.levels[0];
+	float texelsPerPixel = uvPerPixel * static_cast<float>(std::max(top.width, top.height));
 
-	// Create staging buffer (host visible)
-	VkBuffer stagingBuffer = VK_NULL_HANDLE;
-	VmaAllocation stagingAllocation = VK_NULL_HANDLE;
+	uint32_t mip = texelsPerPixel > 1.0f ? static_cast<uint32_t>(std::log2(texelsPerPixel)) : 0;
+	tex.wantedMip = std::min(tex.wantedMip, mip);
+}
 
-	VkBufferCreateInfo bufferInfo{};
-	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-	bufferInfo.size = imageSize;
-	bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-	bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+void GPUImage::updateTextureStreaming(uint64_t frameNumber)
+{
+	m_frameNumber = frameNumber;
 
-	VmaAllocationCreateInfo allocInfo{};
-	allocInfo.usage = VMA_MEMORY_USAGE_AUTO;
-	allocInfo.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT;
+	// The last frame that could sample a retired image has finished
+	std::erase_if(m_retiredImages, [&](const RetiredImage& retired)
+		{
+			if (retired.frame + m_framesInFlight > frameNumber)
+			{
+				return false;
+			}
+			vkDestroyImageView(m_context.getDevice(), retired.view, nullptr);
+			vmaDestroyImage(m_context.getAllocator(), retired.image, retired.allocation);
+			return true;
+		});
+
+	if (!isStreamingEnabled())
+	{
+		return;
+	}
+
+	// Target level per texture, unused textures only need their tail
+	std::vector<uint32_t> targets(m_textures.size());
+	for (size_t i = 0; i < m_textures.size(); ++i)
+	{
+		Texture& tex = m_textures[i];
+		targets[i] = tex.tailMip;
+		if (tex.wantedMip != UINT32_MAX)
+		{
+			targets[i] = std::min(tex.wantedMip, tex.tailMip);
+			tex.lastUsedFrame = frameNumber;
+		}
+		tex.wantedMip = UINT32_MAX;
+	}
+
+	// A slot is rewritten only when no frame in flight can still sample it
+	auto canSwap = [&](const Texture& tex) { return tex.slotFrame + m_framesInFlight <= frameNumber; };
 
-	if (vmaCreateBuffer(m_context.getAllocator(), &bufferInfo, &allocInfo, &stagingBuffer, &stagingAllocation, nullptr) != VK_SUCCESS)
+	// Blurriest textures first
+	std::vector<uint32_t> promotions;
+	for (uint32_t i = 0; i < m_textures.size(); ++i)
 	{
-		throw std::runtime_error("Failed to create staging buffer for texture");
+		if (targets[i] < m_textures[i].residentMip && canSwap(m_textures[i]))
+		{
+			promotions.push_back(i);
+		}
+	}
+	std::sort(promotions.begin(), promotions.end(), [&](uint32_t a, uint32_t b)
+		{
+			return m_textures[a].residentMip - targets[a] > m_textures[b].residentMip - targets[b];
+		});
+
+	// Eviction candidates, least recently used first
+	std::vector<uint32_t> lru;
+	for (uint32_t i = 0; i < m_textures.size(); ++i)
+	{
+		if (m_textures[i].residentMip < m_textures[i].tailMip)
+		{
+			lru.push_back(i);
+		}
+	}
+	std::sort(lru.begin(), lru.end(), [&](uint32_t a, uint32_t b) { return m_textures[a].lastUsedFrame < m_textures[b].lastUsedFrame; });
+
+	size_t nextVictim = 0;
+	VkDeviceSize uploaded = 0;
+	for (uint32_t index : promotions)
+	{
+		if (uploaded >= STREAMING_BYTES_PER_FRAME)
+		{
+			break;
+		}
+
+		Texture& tex = m_textures[index];
+		VkDeviceSize growth = levelBytes(tex, targets[index]) - tex.bytes;
+
+		// Drop levels beyond what their texture needs this frame, unused textures go back to their tail
+		while (m_residentBytes + growth > m_streamingBudget && nextVictim < lru.size())
+		{
+			uint32_t victimIndex = lru[nextVictim++];
+			Texture& victim = m_textures[victimIndex];
+			uint32_t keepMip = victim.lastUsedFrame == frameNumber ? targets[victimIndex] : victim.tailMip;
+
+			if (victim.residentMip < keepMip && canSwap(victim))
+			{
+				setResidentMip(victimIndex, keepMip);
+				uploaded += victim.bytes;
+			}
+		}
+
+		if (m_residentBytes + growth > m_streamingBudget)
+		{
+			break;
+		}
+
+		setResidentMip(index, targets[index]);
+		uploaded += tex.bytes;
 	}
+}
 
-	// Map and copy pixel data
-	void* mapped = nullptr;
-	vmaMapMemory(m_context.getAllocator(), stagingAllocation, &mapped);
-	memcpy(mapped, pixels, static_cast<size_t>(imageSize));
-	vmaUnmapMemory(m_context.getAllocator(), stagingAllocation);
+std::vector<uint32_t> GPUImage::takeChangedTextureSlots()
+{
+	return std::exchange(m_changedSlots, {});
+}
 
-	// Free CPU pixels now they are in staging buffer
-	stbi_image_free(pixels);
+void GPUImage::createTextureImage(Texture& tex, uint32_t firstMip)
+{
+	const CookedTexture& cooked = tex.source;
+	const TextureLevel& top = cooked.levels[firstMip];
+	const uint32_t levelCount = tex.mipLevels - firstMip;
+	const VkFormat format = toVkFormat(cooked.format, cooked.type);
 
 	// Create GPU Image (Device local)
 	VkImageCreateInfo imageInfo{};
 	imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
 	imageInfo.imageType = VK_IMAGE_TYPE_2D;
-	imageInfo.extent.width = static_cast<uint32_t>(texWidth);
-	imageInfo.extent.height = static_cast<uint32_t>(texHeight);
+	imageInfo.extent.width = top.width;
+	imageInfo.extent.height = top.height;
 	imageInfo.extent.depth = 1;
-	imageInfo.mipLevels = tex.mipLevels;
+	imageInfo.mipLevels = levelCount;
 	imageInfo.arrayLayers = 1;
-	imageInfo.format = imageFormat;
+	imageInfo.format = format;
 	imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
 	imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-	imageInfo.usage = VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+	imageInfo.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
 	imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 	imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
 	imageInfo.flags = 0;
@@ -141,43 +474,88 @@ GPUImage::Texture GPUImage::createTextureImageFromFile(const std::string& path,
 	VmaAllocationCreateInfo imgAllocInfo{};
 	imgAllocInfo.usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE;
 
-	if (vmaCreateImage(m_context.getAllocator(), &imageInfo, &imgAllocInfo, &tex.image, &tex.allocation, nullptr) != VK_SUCCESS) 
+	if (vmaCreateImage(m_context.getAllocator(), &imageInfo, &imgAllocInfo, &tex.image, &tex.allocation, nullptr) != VK_SUCCESS)
 	{
 		throw std::runtime_error("Failed to create texture image");
 	}
 	nameObject(m_context.getDevice(), tex.image, "Image_Texture");
-	std::cout << "Texture Image created successfully" << std::endl;
-
-	VkCommandBuffer cmd = m_commands.beginSingleTimeCommands();
 
-	// Transition base mip level for transfer
-	transitionImageLayout(cmd, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, tex.image, VK_IMAGE_ASPECT_COLOR_BIT, 0, 1);
+	// A copy into the image may be recorded already when a later step throws, it has to complete before the image is freed.
+	// If waiting fails the image is leaked, freeing it under a pending copy would be worse
+	ScopeGuard destroyOnFailure([&]()
+		{
+			m_uploads.waitIdle();
+			vmaDestroyImage(m_context.getAllocator(), tex.image, tex.allocation);
+			tex.image = VK_NULL_HANDLE;
+			tex.allocation = VK_NULL_HANDLE;
+		});
+
+	// One region per precomputed mip level, levels are stored back to back so the resident ones are a suffix
+	std::vector<VkBufferImageCopy> regions;
+	tex.rgba8Bytes = 0;
+	for (uint32_t mip = firstMip; mip < tex.mipLevels; ++mip)
+	{
+		const TextureLevel& level = cooked.levels[mip];
+
+		VkBufferImageCopy region{};
+		region.bufferOffset = level.offset - top.offset;
+		region.bufferRowLength = 0; // tightly packed texels or blocks
+		region.bufferImageHeight = 0;
+		region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		region.imageSubresource.mipLevel = mip - firstMip;
+		region.imageSubresource.baseArrayLayer = 0;
+		region.imageSubresource.layerCount = 1;
+		region.imageOffset = { 0, 0, 0 };
+		region.imageExtent = { level.width, level.height, 1 };
+		regions.push_back(region);
+
+		tex.rgba8Bytes += VkDeviceSize(level.width) * level.height * 4;
+	}
+	m_uploads.uploadImage(tex.image, levelCount, 1, cooked.data.subspan(top.offset), regions);
+
+	createImageView(tex.image, format, VK_IMAGE_ASPECT_COLOR_BIT, tex.view, levelCount, toSwizzle(cooked.format));
+	nameObject(m_context.getDevice(), tex.view, "ImageView_Texture");
+	destroyOnFailure.dismiss();
 
-	// Copy buffer to base mip level (mip 0)
-	copyBufferToImage(cmd, stagingBuffer, tex.image, texWidth, texHeight);
+	tex.residentMip = firstMip;
+	tex.bytes = levelBytes(tex, firstMip);
+}
 
-	if (tex.mipLevels > 1)
+void GPUImage::setResidentMip(uint32_t index, uint32_t firstMip)
+{
+	Texture& tex = m_textures[index];
+	if (firstMip < tex.residentMip)
 	{
-		generateMipmaps(cmd, tex.image, tex.mipLevels, texWidth, texHeight);
+		++m_promotions;
 	}
 	else
 	{
-		// if just one mip level, manually transition to shader read
-		transitionImageLayout(cmd, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, tex.image, VK_IMAGE_ASPECT_COLOR_BIT, 0, 1);
+		++m_evictions;
 	}
 
-	m_commands.endSingleTimeCommands(cmd);
+	m_retiredImages.push_back({ tex.image, tex.allocation, tex.view, m_frameNumber });
+	m_residentBytes -= tex.bytes;
 
-	vmaDestroyBuffer(m_context.getAllocator(), stagingBuffer, stagingAllocation);
+	createTextureImage(tex, firstMip);
+	m_residentBytes += tex.bytes;
 
-	// Create view and sampler
-	createImageView(tex.image, imageInfo.format, VK_IMAGE_ASPECT_COLOR_BIT, tex.view, tex.mipLevels);
-	std::cout << "Texture Image View created successfully" << std::endl;
+	// Frames in flight keep sampling the old image through the other slot
+	tex.activeSlot ^= 1;
+	tex.slotFrame = m_frameNumber;
 
-	nameObject(m_context.getDevice(), tex.view, "ImageView_Texture");
-	nameObject(m_context.getDevice(), m_sharedTextureSampler, "Sampler_Texture");
+	uint32_t slot = index * 2 + tex.activeSlot;
+	m_textureViews[slot] = tex.view;
+	m_changedSlots.push_back(slot);
+}
 
-	return tex;
+VkDeviceSize GPUImage::levelBytes(const Texture& tex, uint32_t firstMip) const
+{
+	VkDeviceSize bytes = 0;
+	for (uint32_t mip = firstMip; mip < tex.mipLevels; ++mip)
+	{
+		bytes += tex.source.levels[mip].size;
+	}
+	return bytes;
 }
 
 void GPUImage::createDepthImage(uint32_t width, uint32_t height)
@@ -296,34 +674,13 @@ void GPUImage::createCubemap(const std::array<std::string, 6>& facePaths)
 	VkDeviceSize layerSize = texWidth * texHeight * 4;
 	VkDeviceSize imageSize = layerSize * 6;
 
-	// Create staging buffer
-	VkBuffer stagingBuffer = VK_NULL_HANDLE;
-	VmaAllocation stagingAllocation = VK_NULL_HANDLE;
-
-	VkBufferCreateInfo bufferInfo{};
-	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-	bufferInfo.size = imageSize;
-	bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-	bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-
-	VmaAllocationCreateInfo allocInfo{};
-	allocInfo.usage = VMA_MEMORY_USAGE_AUTO;
-	allocInfo.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT;
-
-	if (vmaCreateBuffer(m_context.getAllocator(), &bufferInfo, &allocInfo, &stagingBuffer, &stagingAllocation, nullptr) != VK_SUCCESS)
-	{
-		throw std::runtime_error("Failed to create staging buffer for texture");
-	}
-
-	// Copy all 6 faces into staging
-	void* mapped = nullptr;
-	vmaMapMemory(m_context.getAllocator(), stagingAllocation, &mapped);
+	// All 6 faces back to back, staged as one upload
+	std::vector<std::byte> faces(imageSize);
 	for (size_t i = 0; i < 6; ++i)
 	{
-		memcpy((uint8_t*)mapped + i * layerSize, facePixels[i], static_cast<size_t>(layerSize));
+		memcpy(faces.data() + i * layerSize, facePixels[i], static_cast<size_t>(layerSize));
 		stbi_image_free(facePixels[i]);
 	}
-	vmaUnmapMemory(m_context.getAllocator(), stagingAllocation);
 
 	// Create cubemap image
 	VkImageCreateInfo imageInfo{};
@@ -352,10 +709,6 @@ void GPUImage::createCubemap(const std::array<std::string, 6>& facePaths)
 	nameObject(m_context.getDevice(), m_skyboxImage, "Image_Cubemap");
 	std::cout << "Cubemap image created successfully" << std::endl;
 
-	VkCommandBuffer cmd = m_commands.beginSingleTimeCommands();
-
-	transitionImageLayout(cmd, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, m_skyboxImage, VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 6);
-
 	// Copy buffer to all 6 layers
 	std::array<VkBufferImageCopy, 6> regions{};
 	for (uint32_t i = 0; i < 6; ++i)
@@ -367,15 +720,7 @@ void GPUImage::createCubemap(const std::array<std::string, 6>& facePaths)
 		regions[i].imageSubresource.layerCount = 1;
 		regions[i].imageExtent = { (uint32_t)texWidth, (uint32_t)texHeight, 1 };
 	}
-
-	vkCmdCopyBufferToImage(cmd, stagingBuffer, m_skyboxImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 
-		static_cast<uint32_t>(regions.size()), regions.data());
-
-	transitionImageLayout(cmd, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, m_skyboxImage, VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 6);
-
-	m_commands.endSingleTimeCommands(cmd);
-
-	vmaDestroyBuffer(m_context.getAllocator(), stagingBuffer, stagingAllocation);
+	m_uploads.uploadImage(m_skyboxImage, 1, 6, faces, regions);
 
 	// Create cubemap image view
 	VkImageViewCreateInfo viewInfo{};
@@ -515,67 +860,6 @@ void GPUImage::cleanupMSAAResources()
 	vmaDestroyImage(m_context.getAllocator(), m_msaaColorImage, m_msaaColorImageAllocation);
 }
 
-void GPUImage::generateMipmaps(VkCommandBuffer cmd, VkImage image, uint32_t mipLevels, uint32_t width, uint32_t height)
-{
-	// Check if linear blitting is supported for our format
-	VkFormatProperties formatProps;
-	vkGetPhysicalDeviceFormatProperties(m_context.getPhysicalDevice(), VK_FORMAT_R8G8B8A8_SRGB, &formatProps);
-
-	if (!(formatProps.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT))
-	{
-		throw std::runtime_error("Linear blitting not supported for texture format!");
-	}
-
-	int32_t mipWidth = width;
-	int32_t mipHeight = height;
-
-	for (uint32_t i = 1; i < mipLevels; ++i)
-	{
-		// Transition previous mip level to TRANSFER_SRC_OPTIMAL for reading
-		transitionImageLayout(cmd, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, image, VK_IMAGE_ASPECT_COLOR_BIT, i - 1, 1);
-
-		// Transition next mip level to TRANSFER_DST_OPTIMAL for blitting
-		transitionImageLayout(cmd, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-			image, VK_IMAGE_ASPECT_COLOR_BIT, i, 1);
-
-		// Set up blit operation
-		VkImageBlit blit{};
-		blit.srcOffsets[0] = { 0,0,0 };
-		blit.srcOffsets[1] = { mipWidth, mipHeight, 1 };
-		blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-		blit.srcSubresource.mipLevel = i - 1;
-		blit.srcSubresource.baseArrayLayer = 0;
-		blit.srcSubresource.layerCount = 1;
-
-		// Calculate next mip level dimensions
-		int32_t nextMipWidth = mipWidth > 1 ? mipWidth / 2 : 1;
-		int32_t nextMipHeight = mipHeight > 1 ? mipHeight / 2 : 1;
-
-		blit.dstOffsets[0] = { 0,0,0 };
-		blit.dstOffsets[1] = { nextMipWidth, nextMipHeight, 1 };
-		blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-		blit.dstSubresource.mipLevel = i;
-		blit.dstSubresource.baseArrayLayer = 0;
-		blit.dstSubresource.layerCount = 1;
-
-		// Perform the blit (current mip level i is still in TRANSFER_DST_OPTIMAL)
-		vkCmdBlitImage(cmd, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-							image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-							1, &blit, VK_FILTER_LINEAR);
-
-		// Transition the previous mip level to SHADER_READ_ONLY_OPTIMAL
-		transitionImageLayout(cmd, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-			image, VK_IMAGE_ASPECT_COLOR_BIT, i - 1, 1);
-
-		mipWidth = nextMipWidth;
-		mipHeight = nextMipHeight;
-	}
-
-	// Transition the last mip level to SHADER_READ_ONLY_OPTIMAL
-	transitionImageLayout(cmd, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-		image, VK_IMAGE_ASPECT_COLOR_BIT, mipLevels - 1, 1);
-}
-
 void GPUImage::transitionImageLayout(VkCommandBuffer cmd, VkImageLayout oldLayout, VkImageLayout newLayout, VkImage image, VkImageAspectFlags aspectMask, uint32_t baseMipLevel, uint32_t mipLevelCount, uint32_t baseArrayLayer, uint32_t arrayLayerCount)
 {
 	VkImageMemoryBarrier2 barrier{};
@@ -664,29 +948,14 @@ void GPUImage::transitionImageLayout(VkCommandBuffer cmd, VkImageLayout oldLayou
 	vkCmdPipelineBarrier2(cmd, &depInfo);
 }
 
-void GPUImage::copyBufferToImage(VkCommandBuffer cmd, VkBuffer buffer, VkImage image, uint32_t width, uint32_t height)
-{
-	VkBufferImageCopy region{};
-	region.bufferOffset = 0;
-	region.bufferRowLength = 0;
-	region.bufferImageHeight = 0;
-	region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-	region.imageSubresource.mipLevel = 0; // Only copying to base mip level
-	region.imageSubresource.baseArrayLayer = 0;
-	region.imageSubresource.layerCount = 1;
-	region.imageOffset = { 0, 0, 0 };
-	region.imageExtent = { width, height, 1 };
-
-	vkCmdCopyBufferToImage(cmd, buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
-}
-
-void GPUImage::createImageView(VkImage image, VkFormat format, VkImageAspectFlags aspect, VkImageView& outview, uint32_t mipLevels)
+void GPUImage::createImageView(VkImage image, VkFormat format, VkImageAspectFlags aspect, VkImageView& outview, uint32_t mipLevels, VkComponentMapping components)
 {
 	VkImageViewCreateInfo viewInfo{};
 	viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
 	viewInfo.image = image;
 	viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
 	viewInfo.format = format;
+	viewInfo.components = components;
 	viewInfo.subresourceRange.aspectMask = aspect;
 	viewInfo.subresourceRange.baseMipLevel = 0;
 	viewInfo.subresourceRange.levelCount = mipLevels;
@@ -714,7 +983,7 @@ void GPUImage::createSampler()
 	samplerInfo.unnormalizedCoordinates = VK_FALSE;
 	samplerInfo.compareEnable = VK_FALSE;
 
-	// Enable mipmaps
+	// Enable mipmaps. The LOD is left unclamped here, every view's levelCount limits it to the texture's own chain.
 	samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
 	samplerInfo.mipLodBias = 0.0f;
 	samplerInfo.minLod = 0.0f;
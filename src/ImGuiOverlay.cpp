@@ -3,6 +3,9 @@
 #include "ImGuiOverlay.hpp"
 #include "VulkanContext.hpp"
 #include "DescriptorManager.hpp"
+#include "UploadManager.hpp"
+#include "GPUImage.hpp"
+#include "GPUCuller.hpp"
 
 #include <stdexcept>
 #include <iostream>
@@ -159,6 +162,12 @@ void ImGuiOverlay::drawUI()
 		ImGui::Checkbox("Enable Depth Test", &enableDepthTest);
 		ImGui::Checkbox("Enable Wireframe", &enableWireframe);
 		ImGui::Checkbox("Enable Normal Maps", &enableNormalMaps);
+		ImGui::Checkbox("Enable Submesh Culling", &enableSubmeshCulling);
+		ImGui::Checkbox("Enable Meshlet Culling", &enableMeshletCulling);
+		ImGui::Checkbox("Enable BVH Culling", &enableBVHCulling);
+		ImGui::Checkbox("Enable Occlusion Culling", &enableOcclusionCulling);
+		ImGui::Checkbox("Enable GPU-Driven Culling", &enableGPUCulling);
+		ImGui::Checkbox("Reuse Static Visibility", &enableVisibilityReuse);
 	}
 
 	if (ImGui::CollapsingHeader("Lighting"))
@@ -173,6 +182,8 @@ void ImGuiOverlay::drawUI()
 		ImGui::Checkbox("Show Submesh AABB (Green)", &showSubmeshAABB);
 		ImGui::Checkbox("Freeze Camera Frustum", &freezeFrustum);
 		ImGui::Checkbox("Show Cascade Colors", &showCascadeColors);
+		ImGui::Checkbox("Show Upload Stats", &showUploadStats);
+		ImGui::Checkbox("Show Culling Stats", &showCullingStats);
 	}
 
 	if (ImGui::CollapsingHeader("Render Targets"))
@@ -205,7 +216,8 @@ VkDescriptorSet ImGuiOverlay::createImGuiTextureDescriptor(VkImageView imageView
 
 void ImGuiOverlay::drawShadowMapVisualization(
 	const std::array<VkDescriptorSet, 4>& shadowMapDescriptorSets,
-	const std::vector<ShadowCascades::CascadeData>& cascades) const
+	const std::vector<ShadowCascades::CascadeData>& cascades,
+	const std::array<uint32_t, ShadowCascades::NUM_CASCADES>& casterCounts) const
 {
 	// 1. Check if the window should be drawn
 	if (!showShadowMap || !m_initialized)
@@ -253,6 +265,7 @@ void ImGuiOverlay::drawShadowMapVisualization(
 
 		ImGui::Text("Range: %.1fm - %.1fm", cascades[i].nearDepth, cascades[i].farDepth);
 		ImGui::Text("Depth: %.1fm", range);
+		ImGui::Text("Casters: %u", casterCounts[i]);
 		ImGui::TextColored(color, "~%.0f px/m", pixelsPerMeter);
 
 		ImGui::EndGroup();
@@ -268,6 +281,54 @@ void ImGuiOverlay::drawShadowMapVisualization(
 	ImGui::End();
 }
 
+void ImGuiOverlay::drawUploadStats(const UploadStats& stats, const TextureStats& textureStats) const
+{
+	if (!showUploadStats || !m_initialized)
+	{
+		return;
+	}
+	ImGui::Begin("Uploads", &showUploadStats);
+
+	constexpr double MB = 1024.0 * 1024.0;
+	float ringUsage = stats.ringCapacity > 0 ? static_cast<float>(stats.ringBytesInUse) / stats.ringCapacity : 0.0f;
+
+	ImGui::Text("Queue: %s", stats.asyncQueue ? "transfer" : "graphics");
+	ImGui::Text("Uploaded: %.1f MB", stats.bytesUploaded / MB);
+	ImGui::Text("Throughput: %.1f MB/s", stats.throughput / MB);
+	ImGui::ProgressBar(ringUsage, ImVec2(-1.0f, 0.0f));
+	ImGui::Text("Ring: %.1f / %.1f MB (peak %.1f MB)", stats.ringBytesInUse / MB, stats.ringCapacity / MB, stats.ringPeakBytes / MB);
+	ImGui::Text("Submissions: %u", stats.submissions);
+	ImGui::Text("Stalls: %u", stats.stalls);
+	ImGui::Text("Dedicated staging buffers: %u", stats.dedicatedBuffers);
+
+	if (textureStats.streamingBudget > 0)
+	{
+		ImGui::SeparatorText("Texture Streaming");
+		float budgetUsage = static_cast<float>(textureStats.bytesUploaded) / textureStats.streamingBudget;
+		ImGui::ProgressBar(budgetUsage, ImVec2(-1.0f, 0.0f));
+		ImGui::Text("Resident: %.1f / %.1f MB (full chains %.1f MB)", textureStats.bytesUploaded / MB,
+			textureStats.streamingBudget / MB, textureStats.bytesFullChains / MB);
+		ImGui::Text("Promotions: %u, evictions: %u", textureStats.promotions, textureStats.evictions);
+	}
+
+	ImGui::End();
+}
+
+void ImGuiOverlay::drawCullingStats(const GPUCullStats& stats, uint32_t cpuVisibleObjects) const
+{
+	if (!showCullingStats || !m_initialized)
+	{
+		return;
+	}
+	ImGui::Begin("Culling", &showCullingStats);
+
+	ImGui::Text("Visible objects (GPU): %u", stats.visibleObjects);
+	ImGui::Text("Visible objects (CPU reference): %u", cpuVisibleObjects);
+	ImGui::Text("Indirect draws: %u", stats.drawCount);
+
+	ImGui::End();
+}
+
 void ImGuiOverlay::checkVkResult(VkResult err)
 {
 	if (err == VK_SUCCESS) return;
@@ -0,0 +1,61 @@
+#include "IndexPacker.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <execution>
+#include <iostream>
+
+IndexFormat IndexPacker::chooseFormat(uint32_t vertexCount)
+{
+	return vertexCount <= MAX_SHORT_VERTICES ? IndexFormat::UInt16 : IndexFormat::UInt32;
+}
+
+std::vector<std::byte> IndexPacker::buildIndexStream(std::span<const uint32_t> indices, std::span<Mesh> meshes, size_t& wideArenaOffset)
+{
+	// First index of every mesh inside its arena, meshes keep their order within an arena
+	std::array<uint32_t, static_cast<size_t>(IndexFormat::Count)> arenaCounts{};
+	for (Mesh& mesh : meshes)
+	{
+		uint32_t& count = arenaCounts[static_cast<size_t>(mesh.indexFormat)];
+		mesh.gpuFirstIndex = count;
+		count += mesh.indexCount;
+	}
+
+	const size_t shortBytes = arenaCounts[static_cast<size_t>(IndexFormat::UInt16)] * sizeof(uint16_t);
+	const size_t wideBytes = arenaCounts[static_cast<size_t>(IndexFormat::UInt32)] * sizeof(uint32_t);
+
+	// vkCmdBindIndexBuffer offsets must be a multiple of the index size
+	wideArenaOffset = (shortBytes + sizeof(uint32_t) - 1) / sizeof(uint32_t) * sizeof(uint32_t);
+
+	std::vector<std::byte> stream(wideArenaOffset + wideBytes);
+
+	// Meshes write disjoint ranges
+	std::for_each(std::execution::par, meshes.begin(), meshes.end(),
+		[&](const Mesh& mesh)
+		{
+			std::span<const uint32_t> meshIndices = indices.subspan(mesh.indexOffset, mesh.indexCount);
+
+			if (mesh.indexFormat == IndexFormat::UInt16)
+			{
+				uint16_t* out = reinterpret_cast<uint16_t*>(stream.data()) + mesh.gpuFirstIndex;
+				std::transform(meshIndices.begin(), meshIndices.end(), out,
+					[](uint32_t index) { return static_cast<uint16_t>(index); });
+			}
+			else
+			{
+				std::memcpy(stream.data() + wideArenaOffset + mesh.gpuFirstIndex * sizeof(uint32_t), meshIndices.data(), meshIndices.size_bytes());
+			}
+		});
+
+	uint32_t shortMeshes = 0;
+	for (const Mesh& mesh : meshes)
+	{
+		shortMeshes += mesh.indexFormat == IndexFormat::UInt16 ? 1 : 0;
+	}
+
+	std::cout << "Index stream: " << stream.size() / 1024 << " KB, " << indices.size_bytes() / 1024
+		<< " KB as 32-bit (" << shortMeshes << "/" << meshes.size() << " meshes 16-bit)" << std::endl;
+
+	return stream;
+}
@@ -0,0 +1,161 @@
+#include "MappedFile.hpp"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <utility>
+
+MappedFile::~MappedFile()
+{
+	close();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+{
+	moveFrom(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+	if (this != &other)
+	{
+		close();
+		moveFrom(other);
+	}
+	return *this;
+}
+
+void MappedFile::moveFrom(MappedFile& other)
+{
+	m_data = std::exchange(other.m_data, nullptr);
+	m_size = std::exchange(other.m_size, 0);
+	m_open = std::exchange(other.m_open, false);
+#ifdef _WIN32
+	m_fileHandle = std::exchange(other.m_fileHandle, nullptr);
+	m_mappingHandle = std::exchange(other.m_mappingHandle, nullptr);
+#else
+	m_fd = std::exchange(other.m_fd, -1);
+#endif
+}
+
+bool MappedFile::open(const std::string& path)
+{
+	close();
+
+#ifdef _WIN32
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	LARGE_INTEGER fileSize{};
+	if (!GetFileSizeEx(file, &fileSize))
+	{
+		CloseHandle(file);
+		return false;
+	}
+
+	m_fileHandle = file;
+	m_size = static_cast<size_t>(fileSize.QuadPart);
+	m_open = true;
+
+	// Zero-length files cannot be mapped, they are simply empty
+	if (m_size == 0)
+	{
+		return true;
+	}
+
+	HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (mapping == nullptr)
+	{
+		close();
+		return false;
+	}
+	m_mappingHandle = mapping;
+
+	void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (view == nullptr)
+	{
+		close();
+		return false;
+	}
+	m_data = static_cast<const std::byte*>(view);
+#else
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+	{
+		return false;
+	}
+
+	struct stat st{};
+	if (fstat(fd, &st) != 0)
+	{
+		::close(fd);
+		return false;
+	}
+
+	m_fd = fd;
+	m_size = static_cast<size_t>(st.st_size);
+	m_open = true;
+
+	if (m_size == 0)
+	{
+		return true;
+	}
+
+	void* view = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (view == MAP_FAILED)
+	{
+		close();
+		return false;
+	}
+	madvise(view, m_size, MADV_SEQUENTIAL);
+	m_data = static_cast<const std::byte*>(view);
+#endif
+
+	return true;
+}
+
+void MappedFile::close()
+{
+#ifdef _WIN32
+	if (m_data)
+	{
+		UnmapViewOfFile(m_data);
+	}
+	if (m_mappingHandle)
+	{
+		CloseHandle(m_mappingHandle);
+	}
+	if (m_fileHandle)
+	{
+		CloseHandle(m_fileHandle);
+	}
+	m_mappingHandle = nullptr;
+	m_fileHandle = nullptr;
+#else
+	if (m_data)
+	{
+		munmap(const_cast<std::byte*>(m_data), m_size);
+	}
+	if (m_fd >= 0)
+	{
+		::close(m_fd);
+	}
+	m_fd = -1;
+#endif
+
+	m_data = nullptr;
+	m_size = 0;
+	m_open = false;
+}
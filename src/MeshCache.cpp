@@ -0,0 +1,255 @@
+#include "MeshCache.hpp"
+#include "Hash.hpp"
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string_view>
+
+namespace
+{
+	constexpr char CACHE_MAGIC[4] = { 'V', 'K', 'M', 'C' };
+	constexpr uint32_t CACHE_VERSION = 5;
+
+	struct MeshCacheHeader
+	{
+		char magic[4];
+		uint32_t version;
+		uint64_t sourceHash;
+
+		// Struct sizes are stored so a layout change invalidates old caches
+		uint32_t vertexStride;
+		uint32_t submeshStride;
+		uint32_t materialStride;
+		uint32_t meshletStride;
+
+		uint32_t vertexCount;
+		uint32_t indexCount;
+		uint32_t submeshCount;
+		uint32_t materialCount;
+		uint32_t meshletCount;
+		uint32_t stringBytes;
+
+		AABB bounds;
+	};
+	static_assert(sizeof(MeshCacheHeader) % 16 == 0, "Header must keep the vertex block 16-byte aligned");
+
+	void writeString(std::vector<char>& out, const std::string& str)
+	{
+		uint32_t length = static_cast<uint32_t>(str.size());
+		const char* lengthBytes = reinterpret_cast<const char*>(&length);
+		out.insert(out.end(), lengthBytes, lengthBytes + sizeof(length));
+		out.insert(out.end(), str.begin(), str.end());
+	}
+
+	bool readString(const std::byte*& cursor, const std::byte* end, std::string& out)
+	{
+		uint32_t length = 0;
+		if (end - cursor < static_cast<ptrdiff_t>(sizeof(length)))
+		{
+			return false;
+		}
+		memcpy(&length, cursor, sizeof(length));
+		cursor += sizeof(length);
+
+		if (end - cursor < static_cast<ptrdiff_t>(length))
+		{
+			return false;
+		}
+		out.assign(reinterpret_cast<const char*>(cursor), length);
+		cursor += length;
+		return true;
+	}
+}
+
+std::filesystem::path MeshCache::getCachePath(const std::filesystem::path& sourcePath)
+{
+	std::filesystem::path cachePath = sourcePath;
+	cachePath.replace_extension(".vkmesh");
+	return cachePath;
+}
+
+uint64_t MeshCache::hashSource(const std::filesystem::path& sourcePath)
+{
+	MappedFile obj;
+	if (!obj.open(sourcePath.string()))
+	{
+		throw std::runtime_error("Failed to open model " + sourcePath.string());
+	}
+
+	uint64_t hash = fnv1a(obj.data(), obj.size(), FNV_OFFSET);
+
+	// Material edits must invalidate the cache too, so fold in every referenced MTL file
+	std::string_view text(reinterpret_cast<const char*>(obj.data()), obj.size());
+	size_t lineStart = 0;
+	while (lineStart < text.size())
+	{
+		size_t lineEnd = text.find('\n', lineStart);
+		if (lineEnd == std::string_view::npos)
+		{
+			lineEnd = text.size();
+		}
+
+		std::string_view line = text.substr(lineStart, lineEnd - lineStart);
+		if (line.starts_with("mtllib"))
+		{
+			line.remove_prefix(6);
+			while (!line.empty())
+			{
+				size_t nameStart = line.find_first_not_of(" \t\r");
+				if (nameStart == std::string_view::npos)
+				{
+					break;
+				}
+				size_t nameEnd = line.find_first_of(" \t\r", nameStart);
+				std::string_view name = line.substr(nameStart, nameEnd - nameStart);
+
+				MappedFile mtl;
+				if (mtl.open((sourcePath.parent_path() / std::string(name)).string()))
+				{
+					hash = fnv1a(mtl.data(), mtl.size(), hash);
+				}
+				line.remove_prefix(nameStart + name.size());
+			}
+		}
+		lineStart = lineEnd + 1;
+	}
+
+	return hash;
+}
+
+bool MeshCache::load(const std::filesystem::path& sourcePath, uint64_t sourceHash, CachedModel& out)
+{
+	std::filesystem::path cachePath = getCachePath(sourcePath);
+	if (!out.file.open(cachePath.string()))
+	{
+		return false;
+	}
+
+	const std::byte* data = out.file.data();
+	const size_t size = out.file.size();
+	if (size < sizeof(MeshCacheHeader))
+	{
+		return false;
+	}
+
+	MeshCacheHeader header;
+	memcpy(&header, data, sizeof(header));
+
+	if (memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0 ||
+		header.version != CACHE_VERSION ||
+		header.sourceHash != sourceHash ||
+		header.vertexStride != sizeof(Vertex) ||
+		header.submeshStride != sizeof(Submesh) ||
+		header.materialStride != sizeof(Material) ||
+		header.meshletStride != sizeof(Meshlet))
+	{
+		std::cout << "Mesh cache " << cachePath.string() << " is stale, re-importing" << std::endl;
+		return false;
+	}
+
+	const size_t vertexBytes = size_t(header.vertexCount) * sizeof(Vertex);
+	const size_t indexBytes = size_t(header.indexCount) * sizeof(uint32_t);
+	const size_t submeshBytes = size_t(header.submeshCount) * sizeof(Submesh);
+	const size_t materialBytes = size_t(header.materialCount) * sizeof(Material);
+	const size_t meshletBytes = size_t(header.meshletCount) * sizeof(Meshlet);
+
+	if (size != sizeof(MeshCacheHeader) + vertexBytes + indexBytes + submeshBytes + materialBytes + meshletBytes + header.stringBytes)
+	{
+		std::cout << "Mesh cache " << cachePath.string() << " is truncated, re-importing" << std::endl;
+		return false;
+	}
+
+	// The mapping is page aligned and every block size is a multiple of 4, so the blocks can be viewed in place
+	const std::byte* cursor = data + sizeof(MeshCacheHeader);
+	out.view.vertices = { reinterpret_cast<const Vertex*>(cursor), header.vertexCount };
+	cursor += vertexBytes;
+	out.view.indices = { reinterpret_cast<const uint32_t*>(cursor), header.indexCount };
+	cursor += indexBytes;
+	out.view.submeshes = { reinterpret_cast<const Submesh*>(cursor), header.submeshCount };
+	cursor += submeshBytes;
+	out.view.materials = { reinterpret_cast<const Material*>(cursor), header.materialCount };
+	cursor += materialBytes;
+	out.view.meshlets = { reinterpret_cast<const Meshlet*>(cursor), header.meshletCount };
+	cursor += meshletBytes;
+
+	out.textures.resize(header.materialCount);
+	const std::byte* end = data + size;
+	for (MaterialTextures& textures : out.textures)
+	{
+		if (!readString(cursor, end, textures.albedo) || !readString(cursor, end, textures.normal))
+		{
+			return false;
+		}
+	}
+	out.view.textures = out.textures;
+	out.view.bounds = header.bounds;
+
+	return true;
+}
+
+void MeshCache::store(const std::filesystem::path& sourcePath, uint64_t sourceHash, const ModelData& model)
+{
+	std::vector<char> strings;
+	for (const MaterialTextures& textures : model.textures)
+	{
+		writeString(strings, textures.albedo);
+		writeString(strings, textures.normal);
+	}
+
+	MeshCacheHeader header{};
+	memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+	header.version = CACHE_VERSION;
+	header.sourceHash = sourceHash;
+	header.vertexStride = sizeof(Vertex);
+	header.submeshStride = sizeof(Submesh);
+	header.materialStride = sizeof(Material);
+	header.meshletStride = sizeof(Meshlet);
+	header.vertexCount = static_cast<uint32_t>(model.vertices.size());
+	header.indexCount = static_cast<uint32_t>(model.indices.size());
+	header.submeshCount = static_cast<uint32_t>(model.submeshes.size());
+	header.materialCount = static_cast<uint32_t>(model.materials.size());
+	header.meshletCount = static_cast<uint32_t>(model.meshlets.size());
+	header.stringBytes = static_cast<uint32_t>(strings.size());
+	header.bounds = model.bounds;
+
+	// Write to a temporary file first so an interrupted write never leaves a valid-looking cache behind
+	std::filesystem::path cachePath = getCachePath(sourcePath);
+	std::filesystem::path tempPath = cachePath;
+	tempPath += ".tmp";
+
+	{
+		std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+		if (!file)
+		{
+			std::cout << "Could not write mesh cache " << cachePath.string() << std::endl;
+			return;
+		}
+
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(reinterpret_cast<const char*>(model.vertices.data()), model.vertices.size() * sizeof(Vertex));
+		file.write(reinterpret_cast<const char*>(model.indices.data()), model.indices.size() * sizeof(uint32_t));
+		file.write(reinterpret_cast<const char*>(model.submeshes.data()), model.submeshes.size() * sizeof(Submesh));
+		file.write(reinterpret_cast<const char*>(model.materials.data()), model.materials.size() * sizeof(Material));
+		file.write(reinterpret_cast<const char*>(model.meshlets.data()), model.meshlets.size() * sizeof(Meshlet));
+		file.write(strings.data(), strings.size());
+
+		if (!file)
+		{
+			std::cout << "Could not write mesh cache " << cachePath.string() << std::endl;
+			return;
+		}
+	}
+
+	std::error_code ec;
+	std::filesystem::rename(tempPath, cachePath, ec);
+	if (ec)
+	{
+		std::filesystem::remove(tempPath, ec);
+		std::cout << "Could not write mesh cache " << cachePath.string() << std::endl;
+		return;
+	}
+
+	std::cout << "Mesh cache written to " << cachePath.string() << std::endl;
+}
@@ -0,0 +1,402 @@
+#include "MeshOptimizer.hpp"
+
+#include <algorithm>
+#include <execution>
+#include <numeric>
+#include <ranges>
+
+namespace
+{
+	constexpr uint32_t INVALID_VERTEX = UINT32_MAX;
+
+	void rethrowFirst(const std::vector<std::exception_ptr>& errors)
+	{
+		for (const std::exception_ptr& error : errors)
+		{
+			if (error)
+			{
+				std::rethrow_exception(error);
+			}
+		}
+	}
+
+	// FIFO post-transform cache: a vertex is resident while fewer than 'size' vertices were inserted after it.
+	// Clearing only advances the clock, so one timestamp array serves any number of simulations.
+	struct FifoCache
+	{
+		std::vector<uint32_t> timestamps;
+		uint32_t size;
+		uint32_t time;
+
+		FifoCache(uint32_t vertexCount, uint32_t cacheSize)
+			: timestamps(vertexCount, 0), size(cacheSize), time(cacheSize + 1)
+		{
+		}
+
+		bool contains(uint32_t vertex) const { return time - timestamps[vertex] <= size; }
+
+		// Returns true on a miss
+		bool access(uint32_t vertex)
+		{
+			if (contains(vertex))
+			{
+				return false;
+			}
+			timestamps[vertex] = time++;
+			return true;
+		}
+
+		uint32_t accessTriangle(const uint32_t* triangle)
+		{
+			return access(triangle[0]) + access(triangle[1]) + access(triangle[2]);
+		}
+
+		void clear() { time += size + 1; }
+	};
+}
+
+void MeshOptimizer::optimize(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, std::span<const Submesh> submeshes,
+	VertexCacheStats* before, VertexCacheStats* after)
+{
+	std::vector<VertexCacheStats> beforeStats(submeshes.size());
+	std::vector<VertexCacheStats> afterStats(submeshes.size());
+	std::vector<std::exception_ptr> errors(submeshes.size());
+
+	// Submeshes own disjoint index ranges, each is ordered on its own worker
+	auto submeshIndices = std::views::iota(size_t(0), submeshes.size());
+	std::for_each(std::execution::par, submeshIndices.begin(), submeshIndices.end(),
+		[&](size_t s)
+		{
+			try
+			{
+				const Submesh& sub = submeshes[s];
+				std::span<uint32_t> range(indices.data() + sub.indexOffset, sub.indexCount - sub.indexCount % 3);
+				if (range.empty())
+				{
+					return;
+				}
+
+				// Local numbering keeps every per-vertex array at submesh size
+				std::vector<uint32_t> used(range.begin(), range.end());
+				std::sort(used.begin(), used.end());
+				used.erase(std::unique(used.begin(), used.end()), used.end());
+
+				std::vector<uint32_t> local(range.size());
+				for (size_t i = 0; i < range.size(); ++i)
+				{
+					local[i] = static_cast<uint32_t>(std::lower_bound(used.begin(), used.end(), range[i]) - used.begin());
+				}
+
+				std::vector<Vertex> localVertices(used.size());
+				for (size_t v = 0; v < used.size(); ++v)
+				{
+					localVertices[v] = vertices[used[v]];
+				}
+
+				const uint32_t vertexCount = static_cast<uint32_t>(used.size());
+				beforeStats[s] = analyzeVertexCache(local, vertexCount);
+
+				optimizeVertexCache(local, vertexCount);
+				optimizeOverdraw(local, localVertices);
+
+				afterStats[s] = analyzeVertexCache(local, vertexCount);
+
+				for (size_t i = 0; i < range.size(); ++i)
+				{
+					range[i] = used[local[i]];
+				}
+			}
+			catch (...)
+			{
+				errors[s] = std::current_exception();
+			}
+		});
+
+	rethrowFirst(errors);
+
+	// Submesh ranges follow each other in the index buffer, so first use walks the submeshes in draw order
+	optimizeVertexFetch(vertices, indices);
+
+	for (size_t s = 0; s < submeshes.size(); ++s)
+	{
+		if (before)
+		{
+			*before += beforeStats[s];
+		}
+		if (after)
+		{
+			*after += afterStats[s];
+		}
+	}
+}
+
+VertexCacheStats MeshOptimizer::analyzeVertexCache(std::span<const uint32_t> indices, uint32_t vertexCount, uint32_t cacheSize)
+{
+	VertexCacheStats stats;
+	stats.triangles = static_cast<uint32_t>(indices.size() / 3);
+
+	FifoCache cache(vertexCount, cacheSize);
+	std::vector<bool> seen(vertexCount, false);
+
+	for (size_t i = 0; i < stats.triangles * 3; ++i)
+	{
+		uint32_t vertex = indices[i];
+		stats.transformedVertices += cache.access(vertex) ? 1 : 0;
+
+		if (!seen[vertex])
+		{
+			seen[vertex] = true;
+			++stats.uniqueVertices;
+		}
+	}
+	return stats;
+}
+
+void MeshOptimizer::optimizeVertexCache(std::span<uint32_t> indices, uint32_t vertexCount, uint32_t cacheSize)
+{
+	const uint32_t triangleCount = static_cast<uint32_t>(indices.size() / 3);
+	if (triangleCount == 0)
+	{
+		return;
+	}
+
+	// Triangles around every vertex, packed into one array
+	std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+	for (uint32_t i = 0; i < triangleCount * 3; ++i)
+	{
+		++adjacencyOffsets[indices[i] + 1];
+	}
+	std::partial_sum(adjacencyOffsets.begin(), adjacencyOffsets.end(), adjacencyOffsets.begin());
+
+	std::vector<uint32_t> adjacency(triangleCount * 3);
+	std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+	for (uint32_t t = 0; t < triangleCount; ++t)
+	{
+		for (uint32_t c = 0; c < 3; ++c)
+		{
+			adjacency[fill[indices[t * 3 + c]]++] = t;
+		}
+	}
+
+	// Triangles not emitted yet per vertex
+	std::vector<uint32_t> liveTriangles(vertexCount);
+	for (uint32_t v = 0; v < vertexCount; ++v)
+	{
+		liveTriangles[v] = adjacencyOffsets[v + 1] - adjacencyOffsets[v];
+	}
+
+	FifoCache cache(vertexCount, cacheSize);
+	std::vector<bool> emitted(triangleCount, false);
+	std::vector<uint32_t> deadEnd; // recently used vertices, the fallback when no candidate has live triangles
+	std::vector<uint32_t> candidates;
+	std::vector<uint32_t> output;
+	deadEnd.reserve(triangleCount * 3);
+	output.reserve(triangleCount * 3);
+	uint32_t cursor = 0; // input order scan for disconnected parts
+
+	uint32_t fanning = indices[0];
+	while (fanning != INVALID_VERTEX)
+	{
+		// Emit every remaining triangle around the fanning vertex
+		candidates.clear();
+		for (uint32_t a = adjacencyOffsets[fanning]; a < adjacencyOffsets[fanning + 1]; ++a)
+		{
+			uint32_t t = adjacency[a];
+			if (emitted[t])
+			{
+				continue;
+			}
+
+			for (uint32_t c = 0; c < 3; ++c)
+			{
+				uint32_t v = indices[t * 3 + c];
+				output.push_back(v);
+				deadEnd.push_back(v);
+				candidates.push_back(v);
+				--liveTriangles[v];
+				cache.access(v);
+			}
+			emitted[t] = true;
+		}
+
+		// Next fanning vertex: the candidate that is oldest in the cache but still stays resident while
+		// its own triangles are emitted (2 new vertices per triangle at most)
+		uint32_t best = INVALID_VERTEX;
+		int64_t bestPriority = -1;
+		for (uint32_t v : candidates)
+		{
+			if (liveTriangles[v] == 0)
+			{
+				continue;
+			}
+
+			int64_t priority = 0;
+			uint32_t age = cache.time - cache.timestamps[v];
+			if (age + 2 * liveTriangles[v] <= cacheSize)
+			{
+				priority = age;
+			}
+			if (priority > bestPriority)
+			{
+				best = v;
+				bestPriority = priority;
+			}
+		}
+
+		// Dead end: back up through recently used vertices, then continue in input order
+		while (best == INVALID_VERTEX && !deadEnd.empty())
+		{
+			uint32_t v = deadEnd.back();
+			deadEnd.pop_back();
+			if (liveTriangles[v] > 0)
+			{
+				best = v;
+			}
+		}
+		while (best == INVALID_VERTEX && cursor < vertexCount)
+		{
+			if (liveTriangles[cursor] > 0)
+			{
+				best = cursor;
+			}
+			++cursor;
+		}
+
+		fanning = best;
+	}
+
+	std::copy(output.begin(), output.end(), indices.begin());
+}
+
+void MeshOptimizer::optimizeOverdraw(std::span<uint32_t> indices, std::span<const Vertex> vertices, float threshold, uint32_t cacheSize)
+{
+	const uint32_t triangleCount = static_cast<uint32_t>(indices.size() / 3);
+	if (triangleCount < 2)
+	{
+		return;
+	}
+
+	FifoCache cache(static_cast<uint32_t>(vertices.size()), cacheSize);
+
+	// Hard boundaries: triangles that miss on all three vertices, the cache starts over there anyway
+	std::vector<uint32_t> hardClusters;
+	for (uint32_t t = 0; t < triangleCount; ++t)
+	{
+		if (cache.accessTriangle(&indices[t * 3]) == 3 || t == 0)
+		{
+			hardClusters.push_back(t);
+		}
+	}
+	hardClusters.push_back(triangleCount);
+
+	// Soft boundaries: split a hard cluster once its running ACMR is within 'threshold' of the whole cluster's,
+	// every piece then costs about as much cache as the unsplit order
+	std::vector<uint32_t> clusters;
+	for (size_t h = 0; h + 1 < hardClusters.size(); ++h)
+	{
+		const uint32_t begin = hardClusters[h];
+		const uint32_t end = hardClusters[h + 1];
+
+		cache.clear();
+		uint32_t clusterMisses = 0;
+		for (uint32_t t = begin; t < end; ++t)
+		{
+			clusterMisses += cache.accessTriangle(&indices[t * 3]);
+		}
+		const float clusterAcmr = static_cast<float>(clusterMisses) / (end - begin);
+
+		cache.clear();
+		clusters.push_back(begin);
+		uint32_t start = begin;
+		uint32_t misses = 0;
+		for (uint32_t t = begin; t < end; ++t)
+		{
+			misses += cache.accessTriangle(&indices[t * 3]);
+
+			if (t + 1 < end && static_cast<float>(misses) <= clusterAcmr * threshold * (t + 1 - start))
+			{
+				clusters.push_back(t + 1);
+				start = t + 1;
+				misses = 0;
+				cache.clear();
+			}
+		}
+	}
+	clusters.push_back(triangleCount);
+
+	// Area weighted centroid and normal of every cluster and of the whole mesh
+	const size_t clusterCount = clusters.size() - 1;
+	std::vector<glm::vec3> centroids(clusterCount, glm::vec3(0.0f));
+	std::vector<glm::vec3> normals(clusterCount, glm::vec3(0.0f));
+	glm::vec3 meshCentroid(0.0f);
+	float meshArea = 0.0f;
+
+	for (size_t c = 0; c < clusterCount; ++c)
+	{
+		float clusterArea = 0.0f;
+		glm::vec3 vertexSum(0.0f);
+		for (uint32_t t = clusters[c]; t < clusters[c + 1]; ++t)
+		{
+			const glm::vec3& p0 = vertices[indices[t * 3]].pos;
+			const glm::vec3& p1 = vertices[indices[t * 3 + 1]].pos;
+			const glm::vec3& p2 = vertices[indices[t * 3 + 2]].pos;
+
+			glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+			float area = glm::length(normal);
+			glm::vec3 center = (p0 + p1 + p2) / 3.0f;
+
+			centroids[c] += center * area;
+			normals[c] += normal;
+			clusterArea += area;
+			vertexSum += center;
+		}
+
+		meshCentroid += centroids[c];
+		meshArea += clusterArea;
+
+		// Degenerate clusters fall back to the plain average
+		uint32_t clusterTriangles = clusters[c + 1] - clusters[c];
+		centroids[c] = clusterArea > 0.0f ? centroids[c] / clusterArea : vertexSum / static_cast<float>(clusterTriangles);
+	}
+	meshCentroid = meshArea > 0.0f ? meshCentroid / meshArea : meshCentroid;
+
+	// Clusters facing away from the centre are on the outside and occlude the rest, they draw first
+	std::vector<float> sortKeys(clusterCount);
+	for (size_t c = 0; c < clusterCount; ++c)
+	{
+		float length = glm::length(normals[c]);
+		glm::vec3 normal = length > 0.0f ? normals[c] / length : glm::vec3(0.0f);
+		sortKeys[c] = glm::dot(centroids[c] - meshCentroid, normal);
+	}
+
+	std::vector<uint32_t> order(clusterCount);
+	std::iota(order.begin(), order.end(), 0u);
+	std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return sortKeys[a] > sortKeys[b]; });
+
+	std::vector<uint32_t> output;
+	output.reserve(triangleCount * 3);
+	for (uint32_t c : order)
+	{
+		output.insert(output.end(), indices.begin() + clusters[c] * 3, indices.begin() + clusters[c + 1] * 3);
+	}
+	std::copy(output.begin(), output.end(), indices.begin());
+}
+
+void MeshOptimizer::optimizeVertexFetch(std::vector<Vertex>& vertices, std::span<uint32_t> indices)
+{
+	std::vector<uint32_t> remap(vertices.size(), INVALID_VERTEX);
+	std::vector<Vertex> reordered;
+	reordered.reserve(vertices.size());
+
+	for (uint32_t& index : indices)
+	{
+		if (remap[index] == INVALID_VERTEX)
+		{
+			remap[index] = static_cast<uint32_t>(reordered.size());
+			reordered.push_back(vertices[index]);
+		}
+		index = remap[index];
+	}
+
+	vertices.swap(reordered);
+}
@@ -0,0 +1,575 @@
+#include "MeshSimplifier.hpp"
+#include "MeshOptimizer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <execution>
+#include <limits>
+#include <numeric>
+#include <ranges>
+#include <unordered_map>
+
+namespace
+{
+	constexpr uint32_t INVALID_VERTEX = UINT32_MAX;
+
+	void rethrowFirst(const std::vector<std::exception_ptr>& errors)
+	{
+		for (const std::exception_ptr& error : errors)
+		{
+			if (error)
+			{
+				std::rethrow_exception(error);
+			}
+		}
+	}
+
+	// Sum of area weighted squared plane distances, the symmetric 4x4 matrix stored as its 10 unique entries
+	struct Quadric
+	{
+		double a00 = 0.0, a11 = 0.0, a22 = 0.0;
+		double a01 = 0.0, a02 = 0.0, a12 = 0.0;
+		double b0 = 0.0, b1 = 0.0, b2 = 0.0;
+		double c = 0.0;
+		double weight = 0.0;
+
+		void addPlane(const glm::dvec3& n, double d, double w)
+		{
+			a00 += w * n.x * n.x;
+			a11 += w * n.y * n.y;
+			a22 += w * n.z * n.z;
+			a01 += w * n.x * n.y;
+			a02 += w * n.x * n.z;
+			a12 += w * n.y * n.z;
+			b0 += w * n.x * d;
+			b1 += w * n.y * d;
+			b2 += w * n.z * d;
+			c += w * d * d;
+			weight += w;
+		}
+
+		Quadric& operator+=(const Quadric& other)
+		{
+			a00 += other.a00; a11 += other.a11; a22 += other.a22;
+			a01 += other.a01; a02 += other.a02; a12 += other.a12;
+			b0 += other.b0; b1 += other.b1; b2 += other.b2;
+			c += other.c;
+			weight += other.weight;
+			return *this;
+		}
+
+		double evaluate(const glm::dvec3& p) const
+		{
+			double ax = a00 * p.x + a01 * p.y + a02 * p.z;
+			double ay = a01 * p.x + a11 * p.y + a12 * p.z;
+			double az = a02 * p.x + a12 * p.y + a22 * p.z;
+			return p.x * ax + p.y * ay + p.z * az + 2.0 * (b0 * p.x + b1 * p.y + b2 * p.z) + c;
+		}
+	};
+
+	enum class VertexKind : uint8_t
+	{
+		Manifold, // collapses onto any neighbour
+		Border,   // collapses along border edges only
+		Seam,     // one of two wedges, both collapse together along the seam
+		Locked    // corner of several seams or non-manifold, never moves
+	};
+
+	struct PositionHash
+	{
+		size_t operator()(const glm::vec3& p) const
+		{
+			// Adding 0 turns -0 into +0, both compare equal and have to hash equal
+			glm::vec3 key = p + glm::vec3(0.0f);
+			uint32_t bits[3];
+			std::memcpy(bits, &key, sizeof(bits));
+			return (bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u);
+		}
+	};
+
+	uint64_t edgeKey(uint32_t a, uint32_t b)
+	{
+		return (uint64_t(a) << 32) | b;
+	}
+}
+
+void MeshSimplifier::generateLods(std::span<const Vertex> vertices, std::vector<uint32_t>& indices, std::span<Submesh> submeshes)
+{
+	// Levels 1.. of every submesh in model vertex numbering, appended once all workers are done
+	std::vector<std::vector<std::vector<uint32_t>>> levels(submeshes.size());
+	std::vector<std::array<float, MAX_MESH_LODS - 1>> levelErrors(submeshes.size());
+	std::vector<std::exception_ptr> errors(submeshes.size());
+
+	auto submeshIndices = std::views::iota(size_t(0), submeshes.size());
+	std::for_each(std::execution::par, submeshIndices.begin(), submeshIndices.end(),
+		[&](size_t s)
+		{
+			try
+			{
+				const Submesh& sub = submeshes[s];
+				std::span<const uint32_t> range(indices.data() + sub.indexOffset, sub.indexCount - sub.indexCount % 3);
+				if (range.empty())
+				{
+					return;
+				}
+
+				// Local numbering keeps every per-vertex array at submesh size
+				std::vector<uint32_t> used(range.begin(), range.end());
+				std::sort(used.begin(), used.end());
+				used.erase(std::unique(used.begin(), used.end()), used.end());
+
+				std::vector<uint32_t> local(range.size());
+				for (size_t i = 0; i < range.size(); ++i)
+				{
+					local[i] = static_cast<uint32_t>(std::lower_bound(used.begin(), used.end(), range[i]) - used.begin());
+				}
+
+				std::vector<Vertex> localVertices(used.size());
+				AABB bounds;
+				for (size_t v = 0; v < used.size(); ++v)
+				{
+					localVertices[v] = vertices[used[v]];
+					bounds.expand(localVertices[v].pos);
+				}
+
+				// Every level starts from level 0, so errors don't compound through the chain
+				std::vector<uint32_t> lod;
+				size_t previousCount = local.size();
+				float error = 0.0f;
+				for (uint32_t level = 1; level < MAX_MESH_LODS; ++level)
+				{
+					size_t target = static_cast<size_t>(previousCount * LOD_TRIANGLE_RATIO) / 3 * 3;
+					float maxError = bounds.radius() * LOD_BASE_ERROR * static_cast<float>(1u << (level - 1));
+					float reached = simplify(localVertices, local, target, maxError, lod);
+
+					if (lod.empty() || lod.size() > previousCount * (1.0f - MIN_LOD_REDUCTION))
+					{
+						break;
+					}
+
+					MeshOptimizer::optimizeVertexCache(lod, static_cast<uint32_t>(used.size()));
+
+					// A coarser level never claims less error than the finer one
+					error = std::max(error, reached);
+					levelErrors[s][level - 1] = error;
+					previousCount = lod.size();
+
+					std::vector<uint32_t>& out = levels[s].emplace_back(lod.size());
+					for (size_t i = 0; i < lod.size(); ++i)
+					{
+						out[i] = used[lod[i]];
+					}
+				}
+			}
+			catch (...)
+			{
+				errors[s] = std::current_exception();
+			}
+		});
+
+	rethrowFirst(errors);
+
+	for (size_t s = 0; s < submeshes.size(); ++s)
+	{
+		Submesh& sub = submeshes[s];
+		sub.lodCount = static_cast<uint32_t>(levels[s].size());
+		for (uint32_t l = 0; l < sub.lodCount; ++l)
+		{
+			// Meshlets are split from the finished levels by MeshletBuilder, which fills in their range
+			sub.lods[l] = { static_cast<uint32_t>(indices.size()), static_cast<uint32_t>(levels[s][l].size()), levelErrors[s][l], 0, 0 };
+			indices.insert(indices.end(), levels[s][l].begin(), levels[s][l].end());
+		}
+	}
+}
+
+float MeshSimplifier::simplify(std::span<const Vertex> vertices, std::span<const uint32_t> indices, size_t targetIndexCount, float maxError,
+	std::vector<uint32_t>& out)
+{
+	const uint32_t vertexCount = static_cast<uint32_t>(vertices.size());
+	out.assign(indices.begin(), indices.begin() + indices.size() / 3 * 3);
+
+	// Wedges, vertices that differ only in their attributes, share the id of the first vertex at their position
+	// and are linked in a ring through 'wedgeNext'
+	std::vector<uint32_t> positionIds(vertexCount);
+	std::vector<uint32_t> wedgeCounts(vertexCount, 0);
+	std::vector<uint32_t> wedgeNext(vertexCount);
+	{
+		std::unordered_map<glm::vec3, uint32_t, PositionHash> firstAtPosition;
+		firstAtPosition.reserve(vertexCount);
+		for (uint32_t v = 0; v < vertexCount; ++v)
+		{
+			uint32_t first = firstAtPosition.try_emplace(vertices[v].pos, v).first->second;
+			positionIds[v] = first;
+			++wedgeCounts[first];
+
+			wedgeNext[v] = first == v ? v : wedgeNext[first];
+			wedgeNext[first] = v;
+		}
+	}
+
+	// Triangles around every vertex, packed into one array and rebuilt after every pass
+	std::vector<uint32_t> adjacencyOffsets;
+	std::vector<uint32_t> adjacency;
+	auto buildAdjacency = [&]()
+		{
+			adjacencyOffsets.assign(vertexCount + 1, 0);
+			for (uint32_t vertex : out)
+			{
+				++adjacencyOffsets[vertex + 1];
+			}
+			std::partial_sum(adjacencyOffsets.begin(), adjacencyOffsets.end(), adjacencyOffsets.begin());
+
+			adjacency.resize(out.size());
+			std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+			for (uint32_t i = 0; i < out.size(); ++i)
+			{
+				adjacency[fill[out[i]]++] = i / 3;
+			}
+		};
+
+	// Vertex following 'v' in the winding of a triangle around it
+	auto nextInTriangle = [&](uint32_t triangle, uint32_t v)
+		{
+			const uint32_t* corners = &out[triangle * 3];
+			return corners[0] == v ? corners[1] : corners[1] == v ? corners[2] : corners[0];
+		};
+
+	// Directed edges are found in the fan of their first vertex. An edge without its reverse lies on an open
+	// border if it is missing between positions, or on an attribute seam if only the wedges miss it.
+	auto hasWedgeEdge = [&](uint32_t a, uint32_t b)
+		{
+			for (uint32_t i = adjacencyOffsets[a]; i < adjacencyOffsets[a + 1]; ++i)
+			{
+				if (nextInTriangle(adjacency[i], a) == b)
+				{
+					return true;
+				}
+			}
+			return false;
+		};
+
+	auto hasPositionEdge = [&](uint32_t a, uint32_t b)
+		{
+			uint32_t w = a;
+			do
+			{
+				for (uint32_t i = adjacencyOffsets[w]; i < adjacencyOffsets[w + 1]; ++i)
+				{
+					if (positionIds[nextInTriangle(adjacency[i], w)] == positionIds[b])
+					{
+						return true;
+					}
+				}
+				w = wedgeNext[w];
+			} while (w != a);
+			return false;
+		};
+
+	auto isBorderEdge = [&](uint32_t a, uint32_t b)
+		{
+			return !hasPositionEdge(a, b) || !hasPositionEdge(b, a);
+		};
+
+	auto isSeamEdge = [&](uint32_t a, uint32_t b)
+		{
+			return !isBorderEdge(a, b) && (!hasWedgeEdge(a, b) || !hasWedgeEdge(b, a));
+		};
+
+	// Wedge at the position of 't' that shares an edge with 'v', INVALID_VERTEX if there is none
+	auto findWedgeTarget = [&](uint32_t v, uint32_t t)
+		{
+			uint32_t w = t;
+			do
+			{
+				if (hasWedgeEdge(v, w) || hasWedgeEdge(w, v))
+				{
+					return w;
+				}
+				w = wedgeNext[w];
+			} while (w != t);
+			return INVALID_VERTEX;
+		};
+
+	buildAdjacency();
+
+	// Same edge between the same positions in the same direction twice, the surface is non-manifold here
+	std::vector<VertexKind> kinds(vertexCount, VertexKind::Manifold);
+	{
+		std::vector<std::pair<uint64_t, uint32_t>> positionEdges(out.size());
+		for (uint32_t i = 0; i < out.size(); ++i)
+		{
+			uint32_t b = out[i - i % 3 + (i + 1) % 3];
+			positionEdges[i] = { edgeKey(positionIds[out[i]], positionIds[b]), i };
+		}
+		std::sort(positionEdges.begin(), positionEdges.end());
+
+		for (size_t e = 1; e < positionEdges.size(); ++e)
+		{
+			if (positionEdges[e].first == positionEdges[e - 1].first)
+			{
+				for (uint32_t i : { positionEdges[e].second, positionEdges[e - 1].second })
+				{
+					kinds[out[i]] = VertexKind::Locked;
+					kinds[out[i - i % 3 + (i + 1) % 3]] = VertexKind::Locked;
+				}
+			}
+		}
+	}
+
+	for (uint32_t v = 0; v < vertexCount; ++v)
+	{
+		if (wedgeCounts[positionIds[v]] > 2)
+		{
+			kinds[v] = VertexKind::Locked;
+		}
+		else if (wedgeCounts[positionIds[v]] == 2 && kinds[v] == VertexKind::Manifold)
+		{
+			kinds[v] = VertexKind::Seam;
+		}
+	}
+
+	// Plane quadrics of the surrounding triangles, border edges add a perpendicular plane
+	std::vector<Quadric> quadrics(vertexCount);
+	for (size_t i = 0; i < out.size(); i += 3)
+	{
+		const glm::dvec3 p[3] = { vertices[out[i]].pos, vertices[out[i + 1]].pos, vertices[out[i + 2]].pos };
+		glm::dvec3 normal = glm::cross(p[1] - p[0], p[2] - p[0]);
+		double length = glm::length(normal);
+		if (length <= 0.0)
+		{
+			continue;
+		}
+		normal /= length;
+
+		for (uint32_t c = 0; c < 3; ++c)
+		{
+			quadrics[out[i + c]].addPlane(normal, -glm::dot(normal, p[0]), 0.5 * length);
+		}
+
+		for (uint32_t c = 0; c < 3; ++c)
+		{
+			uint32_t a = out[i + c];
+			uint32_t b = out[i + (c + 1) % 3];
+			if (!isBorderEdge(a, b))
+			{
+				continue;
+			}
+
+			// Seams that reach a border stay where they are
+			for (uint32_t vertex : { a, b })
+			{
+				if (kinds[vertex] == VertexKind::Manifold)
+				{
+					kinds[vertex] = VertexKind::Border;
+				}
+				else if (kinds[vertex] == VertexKind::Seam)
+				{
+					kinds[vertex] = VertexKind::Locked;
+				}
+			}
+
+			glm::dvec3 edge = p[(c + 1) % 3] - p[c];
+			double edgeLength = glm::length(edge);
+			if (edgeLength <= 0.0)
+			{
+				continue;
+			}
+
+			glm::dvec3 borderNormal = glm::normalize(glm::cross(edge, normal));
+			double weight = edgeLength * edgeLength * BORDER_WEIGHT;
+			quadrics[a].addPlane(borderNormal, -glm::dot(borderNormal, p[c]), weight);
+			quadrics[b].addPlane(borderNormal, -glm::dot(borderNormal, p[c]), weight);
+		}
+	}
+
+	// Squared error of moving 'v' onto 't'
+	auto collapseCost = [&](uint32_t v, uint32_t t)
+		{
+			Quadric quadric = quadrics[v];
+			quadric += quadrics[t];
+
+			glm::dvec3 target = vertices[t].pos;
+			double geometric = quadric.weight > 0.0 ? std::max(quadric.evaluate(target), 0.0) / quadric.weight : 0.0;
+
+			double edgeSq = glm::dot(glm::dvec3(vertices[v].pos) - target, glm::dvec3(vertices[v].pos) - target);
+			glm::dvec3 normalDelta = glm::dvec3(vertices[v].normal) - glm::dvec3(vertices[t].normal);
+			return geometric + double(NORMAL_WEIGHT) * NORMAL_WEIGHT * glm::dot(normalDelta, normalDelta) * edgeSq;
+		};
+
+	std::vector<uint32_t> remap(vertexCount);
+	std::iota(remap.begin(), remap.end(), 0u);
+
+	std::vector<double> bestCosts(vertexCount);
+	std::vector<uint32_t> bestTargets(vertexCount);
+	std::vector<uint32_t> candidates;
+	std::vector<uint8_t> touched(vertexCount);
+
+	// Triangles around 'v' that don't contain 't' must keep facing the same way
+	auto flips = [&](uint32_t v, uint32_t t)
+		{
+			const glm::vec3 target = vertices[t].pos;
+			for (uint32_t a = adjacencyOffsets[v]; a < adjacencyOffsets[v + 1]; ++a)
+			{
+				const uint32_t* triangle = &out[adjacency[a] * 3];
+				if (triangle[0] == t || triangle[1] == t || triangle[2] == t)
+				{
+					continue;
+				}
+
+				glm::vec3 p[3] = { vertices[triangle[0]].pos, vertices[triangle[1]].pos, vertices[triangle[2]].pos };
+				glm::vec3 before = glm::cross(p[1] - p[0], p[2] - p[0]);
+				for (uint32_t c = 0; c < 3; ++c)
+				{
+					p[c] = triangle[c] == v ? target : p[c];
+				}
+				glm::vec3 after = glm::cross(p[1] - p[0], p[2] - p[0]);
+
+				if (glm::dot(before, after) <= 0.25f * glm::length(before) * glm::length(after))
+				{
+					return true;
+				}
+			}
+			return false;
+		};
+
+	const double maxErrorSq = double(maxError) * maxError;
+	const size_t targetTriangles = targetIndexCount / 3;
+	double resultErrorSq = 0.0;
+
+	// Every pass collapses the cheapest independent edges, fans of collapsed vertices are frozen until the next pass
+	while (out.size() > targetIndexCount)
+	{
+		const uint32_t triangleCount = static_cast<uint32_t>(out.size() / 3);
+
+		// Cheapest allowed collapse of every vertex
+		std::fill(bestCosts.begin(), bestCosts.end(), std::numeric_limits<double>::max());
+		std::fill(bestTargets.begin(), bestTargets.end(), INVALID_VERTEX);
+		for (size_t i = 0; i < out.size(); ++i)
+		{
+			uint32_t a = out[i];
+			uint32_t b = out[i - i % 3 + (i + 1) % 3];
+			for (auto [v, t] : { std::pair(a, b), std::pair(b, a) })
+			{
+				if (kinds[v] == VertexKind::Locked ||
+					(kinds[v] == VertexKind::Border && !isBorderEdge(v, t)) ||
+					(kinds[v] == VertexKind::Seam && !isSeamEdge(v, t)))
+				{
+					continue;
+				}
+
+				double cost = collapseCost(v, t);
+
+				// The other wedge follows along its side of the seam, or onto 't' where the seam ends
+				if (kinds[v] == VertexKind::Seam)
+				{
+					uint32_t partner = wedgeNext[v];
+					uint32_t partnerTarget = findWedgeTarget(partner, t);
+					if (partnerTarget == INVALID_VERTEX || (partnerTarget != t && !isSeamEdge(partner, partnerTarget)))
+					{
+						continue;
+					}
+					cost += collapseCost(partner, partnerTarget);
+				}
+
+				if (cost < bestCosts[v])
+				{
+					bestCosts[v] = cost;
+					bestTargets[v] = t;
+				}
+			}
+		}
+
+		candidates.clear();
+		for (uint32_t v = 0; v < vertexCount; ++v)
+		{
+			if (bestTargets[v] != INVALID_VERTEX && bestCosts[v] <= maxErrorSq)
+			{
+				candidates.push_back(v);
+			}
+		}
+		std::sort(candidates.begin(), candidates.end(),
+			[&](uint32_t a, uint32_t b) { return bestCosts[a] < bestCosts[b]; });
+
+		std::fill(touched.begin(), touched.end(), 0);
+		size_t trianglesLeft = triangleCount;
+		bool collapsed = false;
+
+		for (uint32_t v : candidates)
+		{
+			if (trianglesLeft <= targetTriangles)
+			{
+				break;
+			}
+
+			// Seam vertices collapse together with their other wedge
+			std::pair<uint32_t, uint32_t> moves[2] = { { v, bestTargets[v] }, { INVALID_VERTEX, INVALID_VERTEX } };
+			const uint32_t moveCount = kinds[v] == VertexKind::Seam ? 2 : 1;
+			if (moveCount == 2)
+			{
+				moves[1] = { wedgeNext[v], findWedgeTarget(wedgeNext[v], bestTargets[v]) };
+			}
+
+			// The flip test reads current positions, so the whole fan has to be unchanged this pass
+			bool blocked = false;
+			uint32_t removed = 0;
+			for (uint32_t m = 0; m < moveCount && !blocked; ++m)
+			{
+				auto [from, to] = moves[m];
+				blocked = touched[from] || touched[to];
+				for (uint32_t a = adjacencyOffsets[from]; a < adjacencyOffsets[from + 1] && !blocked; ++a)
+				{
+					const uint32_t* triangle = &out[adjacency[a] * 3];
+					blocked = touched[triangle[0]] || touched[triangle[1]] || touched[triangle[2]];
+					removed += (triangle[0] == to || triangle[1] == to || triangle[2] == to) ? 1 : 0;
+				}
+				blocked = blocked || flips(from, to);
+			}
+			if (blocked)
+			{
+				continue;
+			}
+
+			for (uint32_t m = 0; m < moveCount; ++m)
+			{
+				auto [from, to] = moves[m];
+				remap[from] = to;
+				quadrics[to] += quadrics[from];
+				for (uint32_t a = adjacencyOffsets[from]; a < adjacencyOffsets[from + 1]; ++a)
+				{
+					const uint32_t* triangle = &out[adjacency[a] * 3];
+					touched[triangle[0]] = touched[triangle[1]] = touched[triangle[2]] = 1;
+				}
+				touched[to] = 1;
+			}
+
+			trianglesLeft -= removed;
+			resultErrorSq = std::max(resultErrorSq, bestCosts[v]);
+			collapsed = true;
+		}
+
+		if (!collapsed)
+		{
+			break;
+		}
+
+		// Collapsed vertices are never referenced again, so one remap step is enough
+		size_t write = 0;
+		for (size_t i = 0; i < out.size(); i += 3)
+		{
+			uint32_t a = remap[out[i]];
+			uint32_t b = remap[out[i + 1]];
+			uint32_t c = remap[out[i + 2]];
+			if (a != b && b != c && a != c)
+			{
+				out[write++] = a;
+				out[write++] = b;
+				out[write++] = c;
+			}
+		}
+		out.resize(write);
+		buildAdjacency();
+	}
+
+	return static_cast<float>(std::sqrt(resultErrorSq));
+}
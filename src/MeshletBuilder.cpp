@@ -0,0 +1,337 @@
+#include "MeshletBuilder.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <execution>
+#include <limits>
+#include <numeric>
+#include <ranges>
+#include <tuple>
+
+namespace
+{
+	constexpr uint32_t INVALID_TRIANGLE = UINT32_MAX;
+
+	void rethrowFirst(const std::vector<std::exception_ptr>& errors)
+	{
+		for (const std::exception_ptr& error : errors)
+		{
+			if (error)
+			{
+				std::rethrow_exception(error);
+			}
+		}
+	}
+}
+
+void MeshletBuilder::buildMeshlets(std::span<const Vertex> vertices, std::span<uint32_t> indices, std::span<Submesh> submeshes,
+	std::vector<Meshlet>& meshlets)
+{
+	// Meshlets of every level of every submesh, levels own disjoint index ranges
+	std::vector<std::array<std::vector<Meshlet>, MAX_MESH_LODS>> built(submeshes.size());
+	std::vector<std::exception_ptr> errors(submeshes.size());
+
+	auto submeshIndices = std::views::iota(size_t(0), submeshes.size());
+	std::for_each(std::execution::par, submeshIndices.begin(), submeshIndices.end(),
+		[&](size_t s)
+		{
+			try
+			{
+				const Submesh& sub = submeshes[s];
+				for (uint32_t level = 0; level <= sub.lodCount; ++level)
+				{
+					SubmeshLod lod = sub.getLod(level);
+					buildRange(vertices, indices.subspan(lod.indexOffset, lod.indexCount - lod.indexCount % 3), lod.indexOffset, built[s][level]);
+				}
+			}
+			catch (...)
+			{
+				errors[s] = std::current_exception();
+			}
+		});
+
+	rethrowFirst(errors);
+
+	for (size_t s = 0; s < submeshes.size(); ++s)
+	{
+		submeshes[s].meshletOffset = static_cast<uint32_t>(meshlets.size());
+		submeshes[s].meshletCount = static_cast<uint32_t>(built[s][0].size());
+		meshlets.insert(meshlets.end(), built[s][0].begin(), built[s][0].end());
+	}
+
+	for (size_t s = 0; s < submeshes.size(); ++s)
+	{
+		for (uint32_t level = 1; level <= submeshes[s].lodCount; ++level)
+		{
+			SubmeshLod& lod = submeshes[s].lods[level - 1];
+			lod.meshletOffset = static_cast<uint32_t>(meshlets.size());
+			lod.meshletCount = static_cast<uint32_t>(built[s][level].size());
+			meshlets.insert(meshlets.end(), built[s][level].begin(), built[s][level].end());
+		}
+	}
+}
+
+void MeshletBuilder::buildRange(std::span<const Vertex> vertices, std::span<uint32_t> range, uint32_t rangeOffset, std::vector<Meshlet>& out)
+{
+	const uint32_t triangleCount = static_cast<uint32_t>(range.size() / 3);
+	if (triangleCount == 0)
+	{
+		return;
+	}
+
+	// Local numbering keeps every per-vertex array at range size
+	std::vector<uint32_t> used(range.begin(), range.end());
+	std::sort(used.begin(), used.end());
+	used.erase(std::unique(used.begin(), used.end()), used.end());
+	const uint32_t vertexCount = static_cast<uint32_t>(used.size());
+
+	std::vector<uint32_t> local(range.size());
+	for (size_t i = 0; i < range.size(); ++i)
+	{
+		local[i] = static_cast<uint32_t>(std::lower_bound(used.begin(), used.end(), range[i]) - used.begin());
+	}
+
+	// UV and normal seams split vertices, growing across them needs connectivity by position
+	std::vector<uint32_t> byPosition(vertexCount);
+	std::iota(byPosition.begin(), byPosition.end(), 0u);
+	auto positionLess = [&](uint32_t a, uint32_t b)
+		{
+			const glm::vec3& pa = vertices[used[a]].pos;
+			const glm::vec3& pb = vertices[used[b]].pos;
+			return std::tie(pa.x, pa.y, pa.z) < std::tie(pb.x, pb.y, pb.z);
+		};
+	std::sort(byPosition.begin(), byPosition.end(), positionLess);
+
+	std::vector<uint32_t> positionId(vertexCount);
+	uint32_t positionCount = 0;
+	for (uint32_t i = 0; i < vertexCount; ++i)
+	{
+		if (i > 0 && positionLess(byPosition[i - 1], byPosition[i]))
+		{
+			++positionCount;
+		}
+		positionId[byPosition[i]] = positionCount;
+	}
+	++positionCount;
+
+	// Triangles around every position, packed into one array
+	std::vector<uint32_t> adjacencyOffsets(positionCount + 1, 0);
+	for (uint32_t vertex : local)
+	{
+		++adjacencyOffsets[positionId[vertex] + 1];
+	}
+	std::partial_sum(adjacencyOffsets.begin(), adjacencyOffsets.end(), adjacencyOffsets.begin());
+
+	std::vector<uint32_t> adjacency(local.size());
+	std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+	for (uint32_t i = 0; i < local.size(); ++i)
+	{
+		adjacency[fill[positionId[local[i]]]++] = i / 3;
+	}
+
+	std::vector<glm::vec3> centroids(triangleCount);
+	for (uint32_t t = 0; t < triangleCount; ++t)
+	{
+		centroids[t] = (vertices[range[t * 3]].pos + vertices[range[t * 3 + 1]].pos + vertices[range[t * 3 + 2]].pos) / 3.0f;
+	}
+
+	std::vector<bool> emitted(triangleCount, false);
+	std::vector<uint32_t> vertexMeshlet(vertexCount, UINT32_MAX); // meshlet that currently holds the vertex
+	std::vector<uint32_t> meshletVertices;
+	std::vector<uint32_t> order; // triangles in meshlet order
+	std::vector<uint32_t> meshletEnds;
+	order.reserve(triangleCount);
+	meshletVertices.reserve(MAX_VERTICES);
+
+	uint32_t meshletId = 0;
+	uint32_t meshletTriangles = 0;
+	glm::vec3 centroidSum(0.0f);
+	uint32_t seedCursor = 0; // input order is vertex cache order, so it is a spatially coherent seed sequence
+
+	auto closeMeshlet = [&]()
+		{
+			meshletEnds.push_back(static_cast<uint32_t>(order.size()));
+			meshletVertices.clear();
+			meshletTriangles = 0;
+			centroidSum = glm::vec3(0.0f);
+			++meshletId;
+		};
+
+	while (order.size() < triangleCount)
+	{
+		uint32_t next = INVALID_TRIANGLE;
+
+		if (meshletTriangles == 0)
+		{
+			while (emitted[seedCursor])
+			{
+				++seedCursor;
+			}
+			next = seedCursor;
+		}
+		else
+		{
+			// Grow through shared vertices: fewest new vertices first, then closest to the meshlet's centre
+			const glm::vec3 centre = centroidSum / static_cast<float>(meshletTriangles);
+			uint32_t bestNew = UINT32_MAX;
+			float bestDistance = std::numeric_limits<float>::max();
+
+			for (uint32_t vertex : meshletVertices)
+			{
+				const uint32_t position = positionId[vertex];
+				for (uint32_t a = adjacencyOffsets[position]; a < adjacencyOffsets[position + 1]; ++a)
+				{
+					uint32_t t = adjacency[a];
+					if (emitted[t])
+					{
+						continue;
+					}
+
+					uint32_t newVertices = 0;
+					for (uint32_t c = 0; c < 3; ++c)
+					{
+						newVertices += vertexMeshlet[local[t * 3 + c]] != meshletId ? 1 : 0;
+					}
+					if (meshletVertices.size() + newVertices > MAX_VERTICES)
+					{
+						continue;
+					}
+
+					glm::vec3 offset = centroids[t] - centre;
+					float distance = glm::dot(offset, offset);
+					if (newVertices < bestNew || (newVertices == bestNew && distance < bestDistance))
+					{
+						next = t;
+						bestNew = newVertices;
+						bestDistance = distance;
+					}
+				}
+			}
+
+			// Nothing connected fits, a disconnected seed would only inflate the bounds
+			if (next == INVALID_TRIANGLE)
+			{
+				closeMeshlet();
+				continue;
+			}
+		}
+
+		emitted[next] = true;
+		order.push_back(next);
+		centroidSum += centroids[next];
+		++meshletTriangles;
+		for (uint32_t c = 0; c < 3; ++c)
+		{
+			uint32_t vertex = local[next * 3 + c];
+			if (vertexMeshlet[vertex] != meshletId)
+			{
+				vertexMeshlet[vertex] = meshletId;
+				meshletVertices.push_back(vertex);
+			}
+		}
+
+		if (meshletTriangles == MAX_TRIANGLES)
+		{
+			closeMeshlet();
+		}
+	}
+	if (meshletTriangles > 0)
+	{
+		closeMeshlet();
+	}
+
+	// Write the triangles back in meshlet order
+	std::vector<uint32_t> reordered(order.size() * 3);
+	for (size_t i = 0; i < order.size(); ++i)
+	{
+		for (uint32_t c = 0; c < 3; ++c)
+		{
+			reordered[i * 3 + c] = range[order[i] * 3 + c];
+		}
+	}
+	std::copy(reordered.begin(), reordered.end(), range.begin());
+
+	uint32_t begin = 0;
+	for (uint32_t end : meshletEnds)
+	{
+		Meshlet meshlet{};
+		meshlet.indexOffset = rangeOffset + begin * 3;
+		meshlet.indexCount = (end - begin) * 3;
+		computeBounds(vertices, range.subspan(begin * 3, meshlet.indexCount), meshlet);
+		out.push_back(meshlet);
+		begin = end;
+	}
+}
+
+void MeshletBuilder::computeBounds(std::span<const Vertex> vertices, std::span<const uint32_t> triangles, Meshlet& meshlet)
+{
+	AABB box;
+	for (uint32_t index : triangles)
+	{
+		box.expand(vertices[index].pos);
+	}
+
+	meshlet.center = box.center();
+	meshlet.radius = 0.0f;
+	for (uint32_t index : triangles)
+	{
+		meshlet.radius = std::max(meshlet.radius, glm::length(vertices[index].pos - meshlet.center));
+	}
+
+	// Disabled until the normals prove to be narrow enough
+	meshlet.coneApex = meshlet.center;
+	meshlet.coneAxis = glm::vec3(0.0f, 0.0f, 1.0f);
+	meshlet.coneCutoff = 1.0f;
+
+	std::array<glm::vec3, MAX_TRIANGLES> normals;
+	std::array<glm::vec3, MAX_TRIANGLES> corners;
+	uint32_t normalCount = 0;
+	glm::vec3 axis(0.0f);
+
+	for (size_t i = 0; i + 2 < triangles.size() && normalCount < MAX_TRIANGLES; i += 3)
+	{
+		const glm::vec3& p0 = vertices[triangles[i]].pos;
+		glm::vec3 normal = glm::cross(vertices[triangles[i + 1]].pos - p0, vertices[triangles[i + 2]].pos - p0);
+		float length = glm::length(normal);
+		if (length <= 0.0f)
+		{
+			continue;
+		}
+
+		normals[normalCount] = normal / length;
+		corners[normalCount] = p0;
+		axis += normals[normalCount];
+		++normalCount;
+	}
+
+	float axisLength = glm::length(axis);
+	if (normalCount == 0 || axisLength <= 0.0f)
+	{
+		return;
+	}
+	axis /= axisLength;
+
+	float minDot = 1.0f;
+	for (uint32_t n = 0; n < normalCount; ++n)
+	{
+		minDot = std::min(minDot, glm::dot(normals[n], axis));
+	}
+
+	// Past roughly 84 degrees of spread the cone would almost never cull
+	if (minDot <= 0.1f)
+	{
+		return;
+	}
+
+	// Move the apex back along the axis until it lies behind every triangle's plane
+	float maxT = 0.0f;
+	for (uint32_t n = 0; n < normalCount; ++n)
+	{
+		float t = glm::dot(meshlet.center - corners[n], normals[n]) / glm::dot(axis, normals[n]);
+		maxT = std::max(maxT, t);
+	}
+
+	meshlet.coneApex = meshlet.center - axis * maxT;
+	meshlet.coneAxis = axis;
+	meshlet.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+}
@@ -0,0 +1,400 @@
+#include "ModelLoader.hpp"
+#include "GPUImage.hpp"
+#include "IndexPacker.hpp"
+#include "TangentGen.hpp"
+#include "MeshOptimizer.hpp"
+#include "MeshletBuilder.hpp"
+#include "MeshSimplifier.hpp"
+#include "ObjReader.hpp"
+#include "TextureCache.hpp"
+#include "VertexPacker.hpp"
+
+#define TINYOBJLOADER_IMPLEMENTATION
+#include <tiny_obj_loader.h>
+
+#include <algorithm>
+#include <cmath>
+#include <execution>
+#include <iostream>
+#include <ranges>
+#include <set>
+#include <stdexcept>
+
+namespace
+{
+	void rethrowFirst(const std::vector<std::exception_ptr>& errors)
+	{
+		for (const std::exception_ptr& error : errors)
+		{
+			if (error)
+			{
+				std::rethrow_exception(error);
+			}
+		}
+	}
+}
+
+ModelLoader::ModelLoader(GPUImage& imageClass,
+	std::vector<Vertex>& allVertices,
+	std::vector<uint32_t>& allIndices,
+	std::vector<Mesh>& allMeshes,
+	std::vector<Submesh>& allSubmeshes,
+	std::vector<Meshlet>& allMeshlets,
+	std::vector<Material>& allMaterials)
+	: m_imageClass(imageClass),
+	m_allVertices(allVertices),
+	m_allIndices(allIndices),
+	m_allMeshes(allMeshes),
+	m_allSubmeshes(allSubmeshes),
+	m_allMeshlets(allMeshlets),
+	m_allMaterials(allMaterials)
+{
+}
+
+uint32_t ModelLoader::loadModel(const std::string& modelPath)
+{
+	return loadModels({ modelPath })[0];
+}
+
+std::vector<uint32_t> ModelLoader::loadModels(const std::vector<std::string>& modelPaths)
+{
+	const uint32_t modelCount = static_cast<uint32_t>(modelPaths.size());
+	std::vector<LoadedModel> models(modelCount);
+	loadAll(modelPaths, models);
+
+	// Exclusive prefix sums give every model its slot in the global arrays, in input order
+	struct MergeOffsets
+	{
+		uint32_t vertex;
+		uint32_t index;
+		uint32_t submesh;
+		uint32_t meshlet;
+		uint32_t material;
+	};
+
+	std::vector<MergeOffsets> offsets(modelCount);
+	MergeOffsets total{
+		static_cast<uint32_t>(m_allVertices.size()),
+		static_cast<uint32_t>(m_allIndices.size()),
+		static_cast<uint32_t>(m_allSubmeshes.size()),
+		static_cast<uint32_t>(m_allMeshlets.size()),
+		static_cast<uint32_t>(m_allMaterials.size())
+	};
+
+	for (uint32_t i = 0; i < modelCount; ++i)
+	{
+		offsets[i] = total;
+		total.vertex += static_cast<uint32_t>(models[i].view.vertices.size());
+		total.index += static_cast<uint32_t>(models[i].view.indices.size());
+		total.submesh += static_cast<uint32_t>(models[i].view.submeshes.size());
+		total.meshlet += static_cast<uint32_t>(models[i].view.meshlets.size());
+		total.material += static_cast<uint32_t>(models[i].view.materials.size());
+	}
+
+	const uint32_t firstMesh = static_cast<uint32_t>(m_allMeshes.size());
+	m_allVertices.resize(total.vertex);
+	m_allIndices.resize(total.index);
+	m_allSubmeshes.resize(total.submesh);
+	m_allMeshlets.resize(total.meshlet);
+	m_allMaterials.resize(total.material);
+	m_allMeshes.resize(firstMesh + modelCount);
+
+	// Every model writes a disjoint range, so the merge itself runs in parallel too
+	auto modelIndices = std::views::iota(0u, modelCount);
+	std::for_each(std::execution::par, modelIndices.begin(), modelIndices.end(),
+		[&](uint32_t i)
+		{
+			const ModelView& model = models[i].view;
+			const MergeOffsets& offset = offsets[i];
+
+			// Indices stay relative to the mesh's vertexOffset, so both arrays are a straight copy
+			std::copy(model.vertices.begin(), model.vertices.end(), m_allVertices.begin() + offset.vertex);
+			std::copy(model.indices.begin(), model.indices.end(), m_allIndices.begin() + offset.index);
+			std::copy(model.materials.begin(), model.materials.end(), m_allMaterials.begin() + offset.material);
+
+			for (size_t m = 0; m < model.meshlets.size(); ++m)
+			{
+				Meshlet meshlet = model.meshlets[m];
+				meshlet.indexOffset += offset.index;
+				m_allMeshlets[offset.meshlet + m] = meshlet;
+			}
+
+			for (size_t s = 0; s < model.submeshes.size(); ++s)
+			{
+				Submesh sub = model.submeshes[s];
+				sub.indexOffset += offset.index;
+				sub.meshletOffset += offset.meshlet;
+				for (uint32_t l = 0; l < sub.lodCount; ++l)
+				{
+					sub.lods[l].indexOffset += offset.index;
+					sub.lods[l].meshletOffset += offset.meshlet;
+				}
+
+				// convert local index to global index by adding base offset (if valid)
+				if (sub.materialIndex != UINT32_MAX)
+				{
+					sub.materialIndex += offset.material;
+				}
+				m_allSubmeshes[offset.submesh + s] = sub;
+			}
+
+			Mesh& mesh = m_allMeshes[firstMesh + i];
+			mesh.vertexOffset = offset.vertex;
+			mesh.vertexCount = static_cast<uint32_t>(model.vertices.size());
+			mesh.submeshOffset = offset.submesh;
+			mesh.submeshCount = static_cast<uint32_t>(model.submeshes.size());
+			mesh.indexOffset = offset.index;
+			mesh.indexCount = static_cast<uint32_t>(model.indices.size());
+			mesh.bounds = model.bounds;
+			mesh.indexFormat = IndexPacker::chooseFormat(mesh.vertexCount);
+
+			// A mesh level exists while any submesh still gets coarser, the others repeat their last level
+			mesh.lodCount = 1;
+			mesh.lodErrors.fill(0.0f);
+			for (const Submesh& sub : model.submeshes)
+			{
+				mesh.lodCount = std::max(mesh.lodCount, sub.lodCount + 1);
+				for (uint32_t l = 1; l < MAX_MESH_LODS; ++l)
+				{
+					mesh.lodErrors[l] = std::max(mesh.lodErrors[l], sub.getLod(l).error);
+				}
+			}
+
+			// Tangents are only read through normal maps
+			const bool hasNormalMaps = std::ranges::any_of(model.textures,
+				[](const MaterialTextures& textures) { return !textures.normal.empty(); });
+			mesh.vertexFormat = m_packVertices ? VertexPacker::chooseFormat(model.vertices, hasNormalMaps) : VertexFormat::Float;
+		});
+
+	// Textures are queued on this thread and in model order, so bindless indices match serial loading
+	std::vector<uint32_t> meshIndices(modelCount);
+	for (uint32_t i = 0; i < modelCount; ++i)
+	{
+		resolveTextures(models[i], offsets[i].material);
+
+		meshIndices[i] = firstMesh + i;
+		std::cout << "Loaded mesh [" << meshIndices[i] << "] with " << m_allMeshes[meshIndices[i]].submeshCount
+			<< " submeshes" << std::endl;
+	}
+
+	// Every texture of the batch is decoded in parallel and uploaded in one submission
+	m_imageClass.uploadQueuedTextures();
+
+	return meshIndices;
+}
+
+void ModelLoader::cookAssets(const std::vector<std::string>& modelPaths, bool blockCompression)
+{
+	std::vector<LoadedModel> models(modelPaths.size());
+	loadAll(modelPaths, models);
+
+	// Albedo maps are cooked as sRGB color, normal maps as data, each file once per color space
+	std::set<std::pair<std::string, TextureType>> textureSet;
+	for (const LoadedModel& model : models)
+	{
+		for (const MaterialTextures& textures : model.view.textures)
+		{
+			if (!textures.albedo.empty())
+			{
+				textureSet.emplace((model.directory / textures.albedo).string(), TextureType::Color);
+			}
+			if (!textures.normal.empty())
+			{
+				textureSet.emplace((model.directory / textures.normal).string(), TextureType::Normal);
+			}
+		}
+	}
+
+	std::vector<std::pair<std::string, TextureType>> textures(textureSet.begin(), textureSet.end());
+	std::vector<std::exception_ptr> errors(textures.size());
+	std::for_each(std::execution::par, textures.begin(), textures.end(),
+		[&](const std::pair<std::string, TextureType>& texture)
+		{
+			try
+			{
+				CookedTexture cooked;
+				TextureCache::prepare(texture.first, texture.second, blockCompression, cooked);
+			}
+			catch (...)
+			{
+				errors[&texture - textures.data()] = std::current_exception();
+			}
+		});
+
+	rethrowFirst(errors);
+
+	std::cout << "Cooked " << models.size() << " models and " << textures.size() << " textures" << std::endl;
+}
+
+void ModelLoader::loadAll(const std::vector<std::string>& modelPaths, std::vector<LoadedModel>& models)
+{
+	std::vector<std::exception_ptr> errors(modelPaths.size());
+
+	// Parse, weld and generate tangents for every model on its own worker.
+	// Exceptions can't leave a parallel algorithm, so they are carried back to this thread.
+	auto modelIndices = std::views::iota(size_t(0), modelPaths.size());
+	std::for_each(std::execution::par, modelIndices.begin(), modelIndices.end(),
+		[&](size_t i)
+		{
+			try
+			{
+				loadSingle(modelPaths[i], models[i]);
+			}
+			catch (...)
+			{
+				errors[i] = std::current_exception();
+			}
+		});
+
+	rethrowFirst(errors);
+}
+
+void ModelLoader::loadSingle(const std::string& modelPath, LoadedModel& out)
+{
+	std::filesystem::path objFilePath(modelPath);
+	out.directory = objFilePath.parent_path();
+
+	uint64_t sourceHash = MeshCache::hashSource(objFilePath);
+
+	// Fast path: the cooked mesh is mapped and its arrays are viewed in place, no parsing
+	if (MeshCache::load(objFilePath, sourceHash, out.cached))
+	{
+		out.view = out.cached.view;
+		return;
+	}
+
+	out.imported = importObj(modelPath);
+	MeshCache::store(objFilePath, sourceHash, out.imported);
+	out.view = out.imported.view();
+}
+
+void ModelLoader::resolveTextures(const LoadedModel& model, uint32_t materialOffset)
+{
+	for (size_t i = 0; i < model.view.materials.size(); ++i)
+	{
+		Material& mat = m_allMaterials[materialOffset + i];
+		const MaterialTextures& textures = model.view.textures[i];
+
+		if (!textures.albedo.empty())
+		{
+			std::filesystem::path texPath = model.directory / textures.albedo;
+			mat.albedoTexture = m_imageClass.queueTexture(texPath.string(), TextureType::Color);
+		}
+		else
+		{
+			mat.albedoTexture = -1;
+		}
+
+		if (!textures.normal.empty())
+		{
+			std::filesystem::path texPath = model.directory / textures.normal;
+			mat.normalTexture = m_imageClass.queueTexture(texPath.string(), TextureType::Normal);
+		}
+		else
+		{
+			mat.normalTexture = -1;
+		}
+	}
+}
+
+ModelData ModelLoader::importObj(const std::string& modelPath)
+{
+	// Everything in ModelData is local to this model, offsets into the global arrays are applied when merging
+	ModelData model{};
+	std::vector<tinyobj::material_t> materials;
+
+	// Large exports are split at line boundaries and parsed on all cores
+	bool parallel = std::filesystem::file_size(modelPath) >= ObjReader::PARALLEL_THRESHOLD;
+	ObjReader::read(modelPath, model, materials, parallel);
+
+	// MikkTSpace tangents, submeshes are generated in parallel
+	TangentGenerator::GenerateTangents(model.vertices, model.indices, model.submeshes);
+
+	// Vertex cache, overdraw and fetch order, tangents are final and move with their vertices
+	VertexCacheStats before;
+	VertexCacheStats after;
+	MeshOptimizer::optimize(model.vertices, model.indices, model.submeshes, &before, &after);
+	std::cout << "MeshOptimizer: " << modelPath << " ACMR " << before.acmr() << " -> " << after.acmr()
+		<< ", ATVR " << before.atvr() << " -> " << after.atvr() << std::endl;
+
+	// Coarser index ranges for distant instances, appended after level 0 and sharing its vertices
+	MeshSimplifier::generateLods(model.vertices, model.indices, model.submeshes);
+
+	std::array<uint32_t, MAX_MESH_LODS> lodTriangles{};
+	for (const Submesh& sub : model.submeshes)
+	{
+		for (uint32_t l = 0; l < MAX_MESH_LODS; ++l)
+		{
+			lodTriangles[l] += sub.getLod(l).indexCount / 3;
+		}
+	}
+	std::cout << "MeshSimplifier: " << modelPath << " LOD triangles " << lodTriangles[0] << " / " << lodTriangles[1]
+		<< " / " << lodTriangles[2] << " / " << lodTriangles[3] << std::endl;
+
+	// Triangles of every level regrouped into clusters that are culled on their own
+	MeshletBuilder::buildMeshlets(model.vertices, model.indices, model.submeshes, model.meshlets);
+	std::cout << "MeshletBuilder: " << modelPath << " " << model.meshlets.size() << " meshlets" << std::endl;
+
+	// Ratio of UV to world space area, the square root is how many UV units one world unit spans
+	for (Submesh& sub : model.submeshes)
+	{
+		double worldArea = 0.0;
+		double uvArea = 0.0;
+		for (uint32_t i = sub.indexOffset; i + 2 < sub.indexOffset + sub.indexCount; i += 3)
+		{
+			const Vertex& v0 = model.vertices[model.indices[i]];
+			const Vertex& v1 = model.vertices[model.indices[i + 1]];
+			const Vertex& v2 = model.vertices[model.indices[i + 2]];
+
+			worldArea += 0.5 * glm::length(glm::cross(v1.pos - v0.pos, v2.pos - v0.pos));
+
+			glm::vec2 uv1 = v1.texCoord - v0.texCoord;
+			glm::vec2 uv2 = v2.texCoord - v0.texCoord;
+			uvArea += 0.5 * std::abs(uv1.x * uv2.y - uv1.y * uv2.x);
+		}
+		sub.uvDensity = worldArea > 0.0 ? static_cast<float>(std::sqrt(uvArea / worldArea)) : 0.0f;
+	}
+
+	// Load material data, textures are only recorded here and queued in resolveTextures
+	for (const auto& mtl : materials)
+	{
+		Material mat{};
+		MaterialTextures textures{};
+
+		textures.albedo = mtl.diffuse_texname;
+		textures.normal = mtl.bump_texname;
+		mat.specularTexture = 0;
+
+		if (mtl.dissolve < 1.0f)
+		{	
+			// Alpha-blended transparency (e.g. glass)
+			mat.twosided = 1;
+			mat.alphatest = 0;
+			mat.alphablending = 1;
+		}
+		else if (!mtl.alpha_texname.empty())
+		{
+			// Alpha-tested transparency (e.g. grass, fences)
+			mat.twosided = 1;
+			mat.alphatest = 1;
+			mat.alphablending = 0;
+		}
+		else
+		{
+			// Fully opaque
+			mat.twosided = 0;
+			mat.alphatest = 0;
+			mat.alphablending = 0;
+		}
+
+		mat.shininess = mtl.shininess;
+		mat.reflectionStrength = 0.0f;
+		mat.specularStrength = 0.5f;
+		mat.alphaThreshold = 0.5f;
+
+		model.materials.push_back(mat);
+		model.textures.push_back(textures);
+	}
+
+	return model;
+}
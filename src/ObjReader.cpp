@@ -0,0 +1,737 @@
+#include "ObjReader.hpp"
+#include "MappedFile.hpp"
+#include "VertexWelder.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <charconv>
+#include <execution>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <ranges>
+#include <stdexcept>
+#include <string_view>
+#include <thread>
+
+#if defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define OBJ_READER_SSE2
+#endif
+
+namespace
+{
+	// Chunk size for both modes, bounds the number of unwelded corners held at once
+	constexpr size_t CHUNK_BYTES = 8ull << 20;
+
+	// Face corner resolved to 0-based attribute indices, -1 if the attribute is absent
+	struct Corner
+	{
+		int32_t position;
+		int32_t texCoord;
+		int32_t normal;
+	};
+
+	enum class EventType
+	{
+		Group, // 'o' or 'g'
+		Material, // 'usemtl'
+		Library // 'mtllib'
+	};
+
+	// Non-geometry statement, applied by the welding stage after 'cornerIndex' corners of the same chunk
+	struct Event
+	{
+		size_t cornerIndex;
+		EventType type;
+		std::string name;
+	};
+
+	struct AttributeCounts
+	{
+		int32_t positions = 0;
+		int32_t texCoords = 0;
+		int32_t normals = 0;
+	};
+
+	struct Attributes
+	{
+		std::vector<float> positions; // xyz
+		std::vector<float> texCoords; // uv
+		std::vector<float> normals; // xyz
+
+		AttributeCounts counts() const
+		{
+			return {
+				static_cast<int32_t>(positions.size() / 3),
+				static_cast<int32_t>(texCoords.size() / 2),
+				static_cast<int32_t>(normals.size() / 3)
+			};
+		}
+	};
+
+	// Triangulated faces of one chunk in file order
+	struct FaceStream
+	{
+		std::vector<Corner> corners;
+		std::vector<Event> events;
+	};
+
+	inline bool isSpace(char c)
+	{
+		return c == ' ' || c == '\t' || c == '\r';
+	}
+
+	inline bool isDigit(char c)
+	{
+		return static_cast<unsigned char>(c - '0') < 10;
+	}
+
+	inline const char* skipSpaces(const char* p, const char* end)
+	{
+		while (p < end && isSpace(*p))
+		{
+			++p;
+		}
+		return p;
+	}
+
+	// Newline search 16 bytes at a time
+	inline const char* findNewline(const char* p, const char* end)
+	{
+#ifdef OBJ_READER_SSE2
+		const __m128i newline = _mm_set1_epi8('\n');
+		while (end - p >= 16)
+		{
+			__m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+			unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, newline)));
+			if (mask != 0)
+			{
+				return p + std::countr_zero(mask);
+			}
+			p += 16;
+		}
+#endif
+		while (p < end && *p != '\n')
+		{
+			++p;
+		}
+		return p;
+	}
+
+	std::string_view trimmed(const char* p, const char* end)
+	{
+		p = skipSpaces(p, end);
+		while (end > p && isSpace(end[-1]))
+		{
+			--end;
+		}
+		return std::string_view(p, end - p);
+	}
+
+	// Clinger's fast path in single precision: a mantissa below 2^24 and a power of ten up to 1e10 are
+	// both exact floats, so one multiply or divide rounds correctly. Anything else goes to std::from_chars
+	const char* parseFloat(const char* p, const char* end, float& out)
+	{
+		static constexpr float POW10[] = {
+			1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f
+		};
+
+		if (p < end && *p == '+')
+		{
+			++p;
+		}
+		const char* start = p;
+
+		bool negative = false;
+		if (p < end && *p == '-')
+		{
+			negative = true;
+			++p;
+		}
+
+		uint64_t mantissa = 0;
+		int significantDigits = 0;
+		int exponent = 0;
+		bool anyDigits = false;
+		bool truncated = false;
+
+		for (; p < end && isDigit(*p); ++p)
+		{
+			anyDigits = true;
+			if (mantissa == 0 && *p == '0')
+			{
+				continue;
+			}
+			if (significantDigits < 19)
+			{
+				mantissa = mantissa * 10 + static_cast<uint64_t>(*p - '0');
+				++significantDigits;
+			}
+			else
+			{
+				++exponent;
+				truncated = true;
+			}
+		}
+
+		if (p < end && *p == '.')
+		{
+			for (++p; p < end && isDigit(*p); ++p)
+			{
+				anyDigits = true;
+				if (mantissa == 0 && *p == '0')
+				{
+					--exponent;
+					continue;
+				}
+				if (significantDigits < 19)
+				{
+					mantissa = mantissa * 10 + static_cast<uint64_t>(*p - '0');
+					++significantDigits;
+					--exponent;
+				}
+				else
+				{
+					truncated = true;
+				}
+			}
+		}
+
+		if (anyDigits && p < end && (*p == 'e' || *p == 'E'))
+		{
+			const char* e = p + 1;
+			bool negativeExponent = false;
+			if (e < end && (*e == '-' || *e == '+'))
+			{
+				negativeExponent = *e == '-';
+				++e;
+			}
+			if (e < end && isDigit(*e))
+			{
+				int value = 0;
+				for (; e < end && isDigit(*e); ++e)
+				{
+					value = std::min(value * 10 + (*e - '0'), 100000);
+				}
+				exponent += negativeExponent ? -value : value;
+				p = e;
+			}
+		}
+
+		if (anyDigits && !truncated && mantissa <= (1ull << 24) && exponent >= -10 && exponent <= 10)
+		{
+			float value = static_cast<float>(mantissa);
+			value = exponent < 0 ? value / POW10[-exponent] : value * POW10[exponent];
+			out = negative ? -value : value;
+			return p;
+		}
+
+		// More than 7-8 significant digits, large exponents, nan/inf
+		auto [ptr, ec] = std::from_chars(start, end, out);
+		if (ec == std::errc::result_out_of_range)
+		{
+			out = 0.0f;
+		}
+		else if (ec != std::errc())
+		{
+			throw std::runtime_error("ObjReader: malformed number '" + std::string(start, std::min<size_t>(end - start, 32)) + "'");
+		}
+		return ptr;
+	}
+
+	// Parses up to 'count' whitespace separated floats, missing trailing values stay 0 like tinyobj
+	inline const char* parseFloats(const char* p, const char* end, float* out, int count)
+	{
+		for (int i = 0; i < count; ++i)
+		{
+			p = skipSpaces(p, end);
+			if (p >= end || *p == '#')
+			{
+				out[i] = 0.0f;
+				continue;
+			}
+			p = parseFloat(p, end, out[i]);
+		}
+		return p;
+	}
+
+	inline const char* parseIndex(const char* p, const char* end, int32_t& out)
+	{
+		bool negative = false;
+		if (p < end && (*p == '-' || *p == '+'))
+		{
+			negative = *p == '-';
+			++p;
+		}
+		if (p >= end || !isDigit(*p))
+		{
+			throw std::runtime_error("ObjReader: malformed face index");
+		}
+
+		int64_t value = 0;
+		for (; p < end && isDigit(*p); ++p)
+		{
+			value = std::min<int64_t>(value * 10 + (*p - '0'), INT32_MAX);
+		}
+		out = static_cast<int32_t>(negative ? -value : value);
+		return p;
+	}
+
+	// OBJ indices are 1-based, negative indices count back from the last attribute defined so far
+	inline int32_t resolveIndex(int32_t index, int32_t count)
+	{
+		int32_t resolved = index > 0 ? index - 1 : count + index;
+		if (index == 0 || resolved < 0 || resolved >= count)
+		{
+			throw std::runtime_error("ObjReader: face index " + std::to_string(index) + " out of range");
+		}
+		return resolved;
+	}
+
+	bool startsWithKeyword(std::string_view line, std::string_view keyword)
+	{
+		return line.size() > keyword.size() && line.starts_with(keyword) && isSpace(line[keyword.size()]);
+	}
+
+	// Parses [begin, end), which starts on a line boundary. Attribute lines are parsed into 'attributes' and
+	// faces/events are emitted into 'faces' when those are non-null. Attribute lines are always counted,
+	// starting from 'base', so relative indices resolve correctly in either pass. 'resolved' must already hold
+	// every position a face in this range can reference, it is read for the quad split.
+	void parseRange(const char* begin, const char* end, Attributes* attributes, FaceStream* faces,
+		AttributeCounts base, const Attributes& resolved)
+	{
+		AttributeCounts counts = base;
+		std::vector<Corner> polygon;
+
+		for (const char* lineStart = begin; lineStart < end; )
+		{
+			const char* lineEnd = findNewline(lineStart, end);
+			const char* p = skipSpaces(lineStart, lineEnd);
+			const char* next = lineEnd + 1;
+
+			if (p >= lineEnd)
+			{
+				lineStart = next;
+				continue;
+			}
+
+			if (p[0] == 'v' && p + 1 < lineEnd)
+			{
+				if (isSpace(p[1]))
+				{
+					++counts.positions;
+					if (attributes)
+					{
+						float xyz[3];
+						parseFloats(p + 2, lineEnd, xyz, 3);
+						attributes->positions.insert(attributes->positions.end(), xyz, xyz + 3);
+					}
+				}
+				else if (p[1] == 't' && p + 2 < lineEnd && isSpace(p[2]))
+				{
+					++counts.texCoords;
+					if (attributes)
+					{
+						float uv[2];
+						parseFloats(p + 3, lineEnd, uv, 2);
+						attributes->texCoords.insert(attributes->texCoords.end(), uv, uv + 2);
+					}
+				}
+				else if (p[1] == 'n' && p + 2 < lineEnd && isSpace(p[2]))
+				{
+					++counts.normals;
+					if (attributes)
+					{
+						float xyz[3];
+						parseFloats(p + 3, lineEnd, xyz, 3);
+						attributes->normals.insert(attributes->normals.end(), xyz, xyz + 3);
+					}
+				}
+			}
+			else if (!faces)
+			{
+				// Attribute pass, everything else is handled by the face pass
+			}
+			else if (p[0] == 'f' && p + 1 < lineEnd && isSpace(p[1]))
+			{
+				polygon.clear();
+				for (p += 2; ; )
+				{
+					p = skipSpaces(p, lineEnd);
+					if (p >= lineEnd || *p == '#')
+					{
+						break;
+					}
+
+					int32_t value = 0;
+					Corner corner{ -1, -1, -1 };
+					p = parseIndex(p, lineEnd, value);
+					corner.position = resolveIndex(value, counts.positions);
+
+					if (p < lineEnd && *p == '/')
+					{
+						++p;
+						if (p < lineEnd && *p != '/')
+						{
+							p = parseIndex(p, lineEnd, value);
+							corner.texCoord = resolveIndex(value, counts.texCoords);
+						}
+						if (p < lineEnd && *p == '/')
+						{
+							p = parseIndex(p + 1, lineEnd, value);
+							corner.normal = resolveIndex(value, counts.normals);
+						}
+					}
+					polygon.push_back(corner);
+				}
+
+				std::vector<Corner>& out = faces->corners;
+				const size_t n = polygon.size();
+				if (n == 3)
+				{
+					out.insert(out.end(), polygon.begin(), polygon.end());
+				}
+				else if (n == 4)
+				{
+					// Split along the shorter diagonal, same choice as tinyobj
+					auto position = [&](int corner)
+						{
+							const float* v = &resolved.positions[3 * size_t(polygon[corner].position)];
+							return glm::vec3(v[0], v[1], v[2]);
+						};
+					glm::vec3 e02 = position(2) - position(0);
+					glm::vec3 e13 = position(3) - position(1);
+
+					if (glm::dot(e02, e02) < glm::dot(e13, e13))
+					{
+						out.insert(out.end(), { polygon[0], polygon[1], polygon[2], polygon[0], polygon[2], polygon[3] });
+					}
+					else
+					{
+						out.insert(out.end(), { polygon[0], polygon[1], polygon[3], polygon[1], polygon[2], polygon[3] });
+					}
+				}
+				else if (n > 4)
+				{
+					for (size_t i = 1; i + 1 < n; ++i)
+					{
+						out.insert(out.end(), { polygon[0], polygon[i], polygon[i + 1] });
+					}
+				}
+				// Points, lines and degenerate faces are skipped
+			}
+			else if ((p[0] == 'o' || p[0] == 'g') && (p + 1 == lineEnd || isSpace(p[1])))
+			{
+				faces->events.push_back({ faces->corners.size(), EventType::Group, std::string(trimmed(p + 1, lineEnd)) });
+			}
+			else
+			{
+				std::string_view line(p, lineEnd - p);
+				if (startsWithKeyword(line, "usemtl"))
+				{
+					faces->events.push_back({ faces->corners.size(), EventType::Material, std::string(trimmed(p + 6, lineEnd)) });
+				}
+				else if (startsWithKeyword(line, "mtllib"))
+				{
+					faces->events.push_back({ faces->corners.size(), EventType::Library, std::string(trimmed(p + 6, lineEnd)) });
+				}
+			}
+
+			lineStart = next;
+		}
+	}
+
+	// Welding stage: consumes face streams in file order, builds vertices and splits submeshes
+	class MeshBuilder
+	{
+	public:
+		MeshBuilder(ModelData& model, const Attributes& attributes, const std::filesystem::path& directory,
+			std::vector<tinyobj::material_t>& materials, size_t expectedVertices)
+			: m_model(model), m_attributes(attributes), m_directory(directory), m_materials(materials),
+			m_welder(model.vertices, expectedVertices)
+		{
+		}
+
+		void consume(const FaceStream& stream)
+		{
+			size_t corner = 0;
+			for (const Event& event : stream.events)
+			{
+				weldCorners(stream.corners.data() + corner, stream.corners.data() + event.cornerIndex);
+				corner = event.cornerIndex;
+				applyEvent(event);
+			}
+			weldCorners(stream.corners.data() + corner, stream.corners.data() + stream.corners.size());
+		}
+
+		void finish()
+		{
+			closeSubmesh();
+		}
+
+	private:
+		ModelData& m_model;
+		const Attributes& m_attributes;
+		std::filesystem::path m_directory;
+		std::vector<tinyobj::material_t>& m_materials;
+		std::map<std::string, int> m_materialMap;
+		VertexWelder m_welder;
+
+		uint32_t m_currentMaterial = UINT32_MAX;
+		uint32_t m_submeshStart = 0;
+		AABB m_submeshBounds;
+
+		void weldCorners(const Corner* begin, const Corner* end)
+		{
+			const float* positions = m_attributes.positions.data();
+			const float* texCoords = m_attributes.texCoords.data();
+			const float* normals = m_attributes.normals.data();
+
+			for (const Corner* corner = begin; corner != end; ++corner)
+			{
+				Vertex vertex{};
+
+				const float* pos = positions + 3 * size_t(corner->position);
+				vertex.pos = { pos[0], pos[1], pos[2] };
+
+				m_model.bounds.expand(vertex.pos);
+				m_submeshBounds.expand(vertex.pos);
+
+				if (corner->normal >= 0)
+				{
+					const float* normal = normals + 3 * size_t(corner->normal);
+					vertex.normal = { normal[0], normal[1], normal[2] };
+				}
+
+				if (corner->texCoord >= 0)
+				{
+					const float* uv = texCoords + 2 * size_t(corner->texCoord);
+					vertex.texCoord = { uv[0], 1.0f - uv[1] };
+				}
+
+				// MikkTSpace will populate later
+				vertex.tangent = glm::vec4(0.0f);
+
+				m_model.indices.push_back(m_welder.weld(vertex));
+			}
+		}
+
+		void closeSubmesh()
+		{
+			uint32_t indexCount = static_cast<uint32_t>(m_model.indices.size()) - m_submeshStart;
+			if (indexCount == 0)
+			{
+				return;
+			}
+
+			Submesh sub{};
+			sub.indexOffset = m_submeshStart;
+			sub.indexCount = indexCount;
+			sub.materialIndex = m_currentMaterial;
+			sub.bounds = m_submeshBounds;
+			m_model.submeshes.push_back(sub);
+
+			m_submeshStart = static_cast<uint32_t>(m_model.indices.size());
+			m_submeshBounds = AABB{};
+		}
+
+		void applyEvent(const Event& event)
+		{
+			switch (event.type)
+			{
+			case EventType::Group:
+				closeSubmesh();
+				break;
+
+			case EventType::Material:
+			{
+				uint32_t material = UINT32_MAX;
+				auto it = m_materialMap.find(event.name);
+				if (it != m_materialMap.end())
+				{
+					material = static_cast<uint32_t>(it->second);
+				}
+				else
+				{
+					std::cout << "ObjReader: material [ '" << event.name << "' ] not found in .mtl" << std::endl;
+				}
+
+				if (material != m_currentMaterial)
+				{
+					closeSubmesh();
+					m_currentMaterial = material;
+				}
+				break;
+			}
+
+			case EventType::Library:
+				loadLibraries(event.name);
+				break;
+			}
+		}
+
+		void loadLibraries(std::string_view names)
+		{
+			while (!names.empty())
+			{
+				size_t nameStart = names.find_first_not_of(" \t\r");
+				if (nameStart == std::string_view::npos)
+				{
+					break;
+				}
+				size_t nameEnd = names.find_first_of(" \t\r", nameStart);
+				std::string_view name = names.substr(nameStart, nameEnd - nameStart);
+				names.remove_prefix(nameStart + name.size());
+
+				std::filesystem::path mtlPath = m_directory / std::string(name);
+				std::ifstream stream(mtlPath);
+				if (!stream)
+				{
+					std::cout << "ObjReader: material library " << mtlPath.string() << " not found" << std::endl;
+					continue;
+				}
+
+				std::string warning, error;
+				tinyobj::LoadMtl(&m_materialMap, &m_materials, &stream, &warning, &error);
+				if (!warning.empty())
+				{
+					std::cout << "TinyObjReader: " << warning;
+				}
+				if (!error.empty())
+				{
+					std::cerr << "TinyObjReader: " << error;
+				}
+			}
+		}
+	};
+
+	// Chunk start pointers, every chunk but the last ends just after a newline
+	std::vector<const char*> splitChunks(const char* begin, const char* end)
+	{
+		std::vector<const char*> bounds{ begin };
+		const char* p = begin;
+		while (static_cast<size_t>(end - p) > CHUNK_BYTES)
+		{
+			p = findNewline(p + CHUNK_BYTES, end);
+			if (p < end)
+			{
+				++p;
+			}
+			bounds.push_back(p);
+		}
+		if (bounds.back() != end)
+		{
+			bounds.push_back(end);
+		}
+		return bounds;
+	}
+}
+
+void ObjReader::read(const std::string& path, ModelData& model, std::vector<tinyobj::material_t>& materials, bool parallel)
+{
+	MappedFile file;
+	if (!file.open(path))
+	{
+		throw std::runtime_error("ObjReader: failed to open " + path);
+	}
+
+	const char* begin = reinterpret_cast<const char*>(file.data());
+	const char* end = begin + file.size();
+	std::vector<const char*> chunks = splitChunks(begin, end);
+	const uint32_t chunkCount = static_cast<uint32_t>(chunks.size() - 1);
+
+	Attributes attributes;
+
+	// Rough unique vertex estimate from the text size, the welder's table grows if it falls short
+	MeshBuilder builder(model, attributes, std::filesystem::path(path).parent_path(), materials, file.size() / 64);
+
+	if (!parallel || chunkCount < 2)
+	{
+		// Single pass per chunk: attributes are appended as they appear and faces resolve against them
+		for (uint32_t i = 0; i < chunkCount; ++i)
+		{
+			FaceStream stream;
+			parseRange(chunks[i], chunks[i + 1], &attributes, &stream, attributes.counts(), attributes);
+			builder.consume(stream);
+		}
+		builder.finish();
+		return;
+	}
+
+	// One chunk per core per step keeps the unwelded corners bounded regardless of file size
+	const uint32_t batchSize = std::max(1u, std::thread::hardware_concurrency());
+
+	for (uint32_t batchStart = 0; batchStart < chunkCount; batchStart += batchSize)
+	{
+		const uint32_t batchCount = std::min(batchSize, chunkCount - batchStart);
+		auto batch = std::views::iota(0u, batchCount);
+
+		// Exceptions can't leave a parallel algorithm, they are rethrown here after each pass
+		std::vector<std::exception_ptr> errors(batchCount);
+		auto rethrowErrors = [&]()
+			{
+				for (std::exception_ptr& error : errors)
+				{
+					if (error)
+					{
+						std::rethrow_exception(error);
+					}
+				}
+			};
+
+		// Pass 1: attribute lines of every chunk into chunk-local arrays
+		std::vector<Attributes> local(batchCount);
+		std::for_each(std::execution::par, batch.begin(), batch.end(),
+			[&](uint32_t i)
+			{
+				try
+				{
+					parseRange(chunks[batchStart + i], chunks[batchStart + i + 1], &local[i], nullptr, {}, attributes);
+				}
+				catch (...)
+				{
+					errors[i] = std::current_exception();
+				}
+			});
+		rethrowErrors();
+
+		// Running counts give every chunk the attribute base its relative indices resolve against
+		std::vector<AttributeCounts> bases(batchCount);
+		for (uint32_t i = 0; i < batchCount; ++i)
+		{
+			bases[i] = attributes.counts();
+			attributes.positions.insert(attributes.positions.end(), local[i].positions.begin(), local[i].positions.end());
+			attributes.texCoords.insert(attributes.texCoords.end(), local[i].texCoords.begin(), local[i].texCoords.end());
+			attributes.normals.insert(attributes.normals.end(), local[i].normals.begin(), local[i].normals.end());
+		}
+		local.clear();
+
+		// Pass 2: faces and events of every chunk
+		std::vector<FaceStream> streams(batchCount);
+		std::for_each(std::execution::par, batch.begin(), batch.end(),
+			[&](uint32_t i)
+			{
+				try
+				{
+					parseRange(chunks[batchStart + i], chunks[batchStart + i + 1], nullptr, &streams[i], bases[i], attributes);
+				}
+				catch (...)
+				{
+					errors[i] = std::current_exception();
+				}
+			});
+
+		rethrowErrors();
+
+		for (uint32_t i = 0; i < batchCount; ++i)
+		{
+			// Welding stays serial and in file order, so vertex numbering matches the serial mode
+			builder.consume(streams[i]);
+			streams[i] = FaceStream{};
+		}
+	}
+
+	builder.finish();
+}
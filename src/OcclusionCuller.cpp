@@ -0,0 +1,380 @@
+#include "OcclusionCuller.hpp"
+#include "Simd.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cfloat>
+#include <cmath>
+#include <execution>
+#include <ranges>
+
+namespace
+{
+	constexpr uint32_t TILES_X = OcclusionCuller::WIDTH / OcclusionCuller::TILE_WIDTH;
+	constexpr uint32_t BAND_COUNT = OcclusionCuller::HEIGHT / OcclusionCuller::BAND_HEIGHT;
+	static_assert(OcclusionCuller::WIDTH % 16 == 0, "Rows must hold whole lanes of every width");
+	static_assert(OcclusionCuller::HEIGHT % OcclusionCuller::BAND_HEIGHT == 0 && OcclusionCuller::BAND_HEIGHT % OcclusionCuller::TILE_HEIGHT == 0,
+		"Bands must hold whole tiles");
+
+	// Clip space half-spaces dot(plane, v) >= 0, the near plane (Vulkan depth starts at 0) and a guard band
+	// of twice the screen that keeps edge functions of clipped triangles precise
+	constexpr float GUARD_BAND = 2.0f;
+	const std::array<glm::vec4, 5> CLIP_PLANES = {
+		glm::vec4(0.0f, 0.0f, 1.0f, 0.0f),
+		glm::vec4(1.0f, 0.0f, 0.0f, GUARD_BAND),
+		glm::vec4(-1.0f, 0.0f, 0.0f, GUARD_BAND),
+		glm::vec4(0.0f, 1.0f, 0.0f, GUARD_BAND),
+		glm::vec4(0.0f, -1.0f, 0.0f, GUARD_BAND),
+	};
+
+	// A triangle clipped by every plane has at most 3 + 5 corners
+	constexpr uint32_t MAX_CLIPPED_CORNERS = 8;
+
+	// Sutherland-Hodgman against one plane
+	uint32_t clipPolygon(const glm::vec4* in, uint32_t count, const glm::vec4& plane, glm::vec4* out)
+	{
+		uint32_t outCount = 0;
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			const glm::vec4& a = in[i];
+			const glm::vec4& b = in[(i + 1) % count];
+			float distanceA = glm::dot(plane, a);
+			float distanceB = glm::dot(plane, b);
+
+			if (distanceA >= 0.0f)
+			{
+				out[outCount++] = a;
+			}
+			if ((distanceA >= 0.0f) != (distanceB >= 0.0f))
+			{
+				out[outCount++] = a + (b - a) * (distanceA / (distanceA - distanceB));
+			}
+		}
+		return outCount;
+	}
+}
+
+void OcclusionCuller::begin(const glm::mat4& viewProj)
+{
+	m_viewProj = viewProj;
+	m_occluders.clear();
+}
+
+void OcclusionCuller::addOccluder(std::span<const Vertex> vertices, std::span<const uint32_t> indices, const glm::mat4& model, bool cullBackFaces)
+{
+	if (indices.size() >= 3)
+	{
+		m_occluders.push_back({ vertices, indices, m_viewProj * model, cullBackFaces });
+	}
+}
+
+void OcclusionCuller::rasterize()
+{
+	// Occluders are cut into batches so one large mesh still spreads over every thread
+	std::vector<std::pair<uint32_t, uint32_t>> batches; // occluder, first triangle
+	for (uint32_t o = 0; o < m_occluders.size(); ++o)
+	{
+		const uint32_t triangleCount = static_cast<uint32_t>(m_occluders[o].indices.size() / 3);
+		for (uint32_t first = 0; first < triangleCount; first += SETUP_BATCH)
+		{
+			batches.push_back({ o, first });
+		}
+	}
+
+	m_batchTriangles.resize(batches.size());
+	auto batchIndices = std::views::iota(0u, static_cast<uint32_t>(batches.size()));
+	std::for_each(std::execution::par, batchIndices.begin(), batchIndices.end(),
+		[&](uint32_t b)
+		{
+			setupBatch(m_occluders[batches[b].first], batches[b].second, m_batchTriangles[b]);
+		});
+
+	// Bands list every triangle whose rows reach into them, in submission order
+	m_bandTriangles.resize(BAND_COUNT);
+	for (std::vector<uint32_t>& bandTriangles : m_bandTriangles)
+	{
+		bandTriangles.clear();
+	}
+	m_triangleCount = 0;
+	for (uint32_t b = 0; b < m_batchTriangles.size(); ++b)
+	{
+		for (uint32_t i = 0; i < m_batchTriangles[b].size(); ++i)
+		{
+			const ScreenTriangle& triangle = m_batchTriangles[b][i];
+			for (uint32_t band = triangle.minY / BAND_HEIGHT; band <= triangle.maxY / BAND_HEIGHT; ++band)
+			{
+				m_bandTriangles[band].push_back(b * SETUP_BATCH + i);
+			}
+		}
+		m_triangleCount += static_cast<uint32_t>(m_batchTriangles[b].size());
+	}
+
+	auto bands = std::views::iota(0u, BAND_COUNT);
+	std::for_each(std::execution::par, bands.begin(), bands.end(),
+		[&](uint32_t band)
+		{
+			rasterizeBand(band);
+		});
+}
+
+void OcclusionCuller::setupBatch(const Occluder& occluder, uint32_t firstTriangle, std::vector<ScreenTriangle>& out) const
+{
+	out.clear();
+
+	auto emit = [&](glm::vec3 v0, glm::vec3 v1, glm::vec3 v2)
+		{
+			// Vulkan takes a negative cross product in y-down framebuffer space as counter-clockwise, so front facing.
+			// The rasterizer wants it positive, front faces are swapped into that winding.
+			float area = (v1.x - v0.x) * (v2.y - v0.y) - (v1.y - v0.y) * (v2.x - v0.x);
+			if (area == 0.0f || (area > 0.0f && occluder.cullBackFaces))
+			{
+				return;
+			}
+			if (area < 0.0f)
+			{
+				std::swap(v1, v2);
+				area = -area;
+			}
+
+			// Triangles past the far plane can't lower any depth
+			if (std::min({ v0.z, v1.z, v2.z }) > 1.0f)
+			{
+				return;
+			}
+
+			// Pixels that fit inside the bounding rectangle, only they can be covered whole
+			const int minX = std::max(0, static_cast<int>(std::ceil(std::min({ v0.x, v1.x, v2.x }))));
+			const int maxX = std::min(static_cast<int>(WIDTH), static_cast<int>(std::floor(std::max({ v0.x, v1.x, v2.x })))) - 1;
+			const int minY = std::max(0, static_cast<int>(std::ceil(std::min({ v0.y, v1.y, v2.y }))));
+			const int maxY = std::min(static_cast<int>(HEIGHT), static_cast<int>(std::floor(std::max({ v0.y, v1.y, v2.y })))) - 1;
+			if (minX > maxX || minY > maxY)
+			{
+				return;
+			}
+
+			// Edges are pulled in by half a pixel along their normal, a pixel centre passing all three has its whole square inside
+			ScreenTriangle triangle;
+			const glm::vec3* corners[3] = { &v0, &v1, &v2 };
+			for (uint32_t k = 0; k < 3; ++k)
+			{
+				const glm::vec3& a = *corners[k];
+				const glm::vec3& b = *corners[(k + 1) % 3];
+				triangle.edgeA[k] = a.y - b.y;
+				triangle.edgeB[k] = b.x - a.x;
+				triangle.edgeC[k] = -(triangle.edgeA[k] * a.x + triangle.edgeB[k] * a.y) - 0.5f * (std::abs(triangle.edgeA[k]) + std::abs(triangle.edgeB[k]));
+			}
+
+			// Depth is planar in screen space, half a pixel along both slopes reaches the pixel's farthest corner
+			float depthX = ((v1.z - v0.z) * (v2.y - v0.y) - (v2.z - v0.z) * (v1.y - v0.y)) / area;
+			float depthY = ((v2.z - v0.z) * (v1.x - v0.x) - (v1.z - v0.z) * (v2.x - v0.x)) / area;
+			triangle.depthA = depthX;
+			triangle.depthB = depthY;
+			triangle.depthC = v0.z - depthX * v0.x - depthY * v0.y + 0.5f * (std::abs(depthX) + std::abs(depthY));
+			triangle.maxDepth = std::max({ v0.z, v1.z, v2.z });
+
+			triangle.minX = static_cast<uint16_t>(minX);
+			triangle.maxX = static_cast<uint16_t>(maxX);
+			triangle.minY = static_cast<uint16_t>(minY);
+			triangle.maxY = static_cast<uint16_t>(maxY);
+			out.push_back(triangle);
+		};
+
+	const uint32_t endTriangle = std::min(firstTriangle + SETUP_BATCH, static_cast<uint32_t>(occluder.indices.size() / 3));
+	for (uint32_t t = firstTriangle; t < endTriangle; ++t)
+	{
+		glm::vec4 polygon[MAX_CLIPPED_CORNERS];
+		glm::vec4 clipped[MAX_CLIPPED_CORNERS];
+		for (uint32_t k = 0; k < 3; ++k)
+		{
+			polygon[k] = occluder.modelViewProj * glm::vec4(occluder.vertices[occluder.indices[t * 3 + k]].pos, 1.0f);
+		}
+
+		// Most triangles lie on one side of every plane and skip the clipper
+		uint32_t count = 3;
+		for (const glm::vec4& plane : CLIP_PLANES)
+		{
+			uint32_t inside = 0;
+			for (uint32_t k = 0; k < count; ++k)
+			{
+				inside += glm::dot(plane, polygon[k]) >= 0.0f ? 1 : 0;
+			}
+			if (inside == count)
+			{
+				continue;
+			}
+			if (inside == 0)
+			{
+				count = 0;
+				break;
+			}
+
+			count = clipPolygon(polygon, count, plane, clipped);
+			std::copy(clipped, clipped + count, polygon);
+		}
+
+		// In front of the near plane w is positive
+		glm::vec3 screen[MAX_CLIPPED_CORNERS];
+		for (uint32_t k = 0; k < count; ++k)
+		{
+			float invW = 1.0f / polygon[k].w;
+			screen[k] = glm::vec3(
+				(polygon[k].x * invW * 0.5f + 0.5f) * WIDTH,
+				(polygon[k].y * invW * 0.5f + 0.5f) * HEIGHT,
+				polygon[k].z * invW);
+		}
+
+		// Clipping keeps the polygon convex, a fan covers it
+		for (uint32_t k = 1; k + 1 < count; ++k)
+		{
+			emit(screen[0], screen[k], screen[k + 1]);
+		}
+	}
+}
+
+void OcclusionCuller::rasterizeBand(uint32_t band)
+{
+	const uint32_t bandTop = band * BAND_HEIGHT;
+	const uint32_t bandBottom = bandTop + BAND_HEIGHT - 1;
+	std::fill(m_depth.begin() + bandTop * WIDTH, m_depth.begin() + (bandBottom + 1) * WIDTH, 1.0f);
+
+	const Simd::Floats laneCentres = Simd::add(Simd::laneIndices(), Simd::broadcast(0.5f));
+	for (uint32_t id : m_bandTriangles[band])
+	{
+		const ScreenTriangle& triangle = m_batchTriangles[id / SETUP_BATCH][id % SETUP_BATCH];
+		const Simd::Floats edgeA0 = Simd::broadcast(triangle.edgeA[0]);
+		const Simd::Floats edgeA1 = Simd::broadcast(triangle.edgeA[1]);
+		const Simd::Floats edgeA2 = Simd::broadcast(triangle.edgeA[2]);
+		const Simd::Floats depthA = Simd::broadcast(triangle.depthA);
+		const Simd::Floats maxDepth = Simd::broadcast(triangle.maxDepth);
+
+		// Rows start on a lane boundary, lanes left of the triangle fail its edge tests
+		const uint32_t firstX = triangle.minX - triangle.minX % Simd::LANE_WIDTH;
+		const uint32_t firstY = std::max<uint32_t>(triangle.minY, bandTop);
+		const uint32_t lastY = std::min<uint32_t>(triangle.maxY, bandBottom);
+		for (uint32_t y = firstY; y <= lastY; ++y)
+		{
+			const float centreY = y + 0.5f;
+			const Simd::Floats row0 = Simd::broadcast(triangle.edgeB[0] * centreY + triangle.edgeC[0]);
+			const Simd::Floats row1 = Simd::broadcast(triangle.edgeB[1] * centreY + triangle.edgeC[1]);
+			const Simd::Floats row2 = Simd::broadcast(triangle.edgeB[2] * centreY + triangle.edgeC[2]);
+			const Simd::Floats rowDepth = Simd::broadcast(triangle.depthB * centreY + triangle.depthC);
+			float* depthRow = m_depth.data() + y * WIDTH;
+
+			for (uint32_t x = firstX; x <= triangle.maxX; x += Simd::LANE_WIDTH)
+			{
+				const Simd::Floats centreX = Simd::add(Simd::broadcast(static_cast<float>(x)), laneCentres);
+				Simd::Floats edges = Simd::min(Simd::mulAdd(edgeA0, centreX, row0), Simd::mulAdd(edgeA1, centreX, row1));
+				edges = Simd::min(edges, Simd::mulAdd(edgeA2, centreX, row2));
+
+				uint32_t covered = Simd::nonNegativeMask(edges);
+				if (covered == 0)
+				{
+					continue;
+				}
+
+				const Simd::Floats depth = Simd::min(Simd::mulAdd(depthA, centreX, rowDepth), maxDepth);
+				if (covered == Simd::ALL_LANES)
+				{
+					Simd::store(depthRow + x, Simd::min(Simd::load(depthRow + x), depth));
+					continue;
+				}
+
+				// Triangle edge, covered lanes one at a time
+				float depths[Simd::LANE_WIDTH];
+				Simd::store(depths, depth);
+				while (covered != 0)
+				{
+					uint32_t lane = static_cast<uint32_t>(std::countr_zero(covered));
+					depthRow[x + lane] = std::min(depthRow[x + lane], depths[lane]);
+					covered &= covered - 1;
+				}
+			}
+		}
+	}
+
+	// Farthest pixel per tile, the first level tests read
+	for (uint32_t tileY = bandTop / TILE_HEIGHT; tileY <= bandBottom / TILE_HEIGHT; ++tileY)
+	{
+		for (uint32_t tileX = 0; tileX < TILES_X; ++tileX)
+		{
+			float farthest = 0.0f;
+			for (uint32_t y = tileY * TILE_HEIGHT; y < (tileY + 1) * TILE_HEIGHT; ++y)
+			{
+				const float* depthRow = m_depth.data() + y * WIDTH + tileX * TILE_WIDTH;
+				farthest = std::max(farthest, *std::max_element(depthRow, depthRow + TILE_WIDTH));
+			}
+			m_tileMaxDepth[tileY * TILES_X + tileX] = farthest;
+		}
+	}
+}
+
+bool OcclusionCuller::isVisible(const AABB& worldBounds) const
+{
+	if (m_triangleCount == 0)
+	{
+		return true;
+	}
+
+	glm::vec2 screenMin(FLT_MAX);
+	glm::vec2 screenMax(-FLT_MAX);
+	float nearestDepth = FLT_MAX;
+	for (uint32_t c = 0; c < 8; ++c)
+	{
+		glm::vec3 corner(
+			(c & 1) ? worldBounds.max.x : worldBounds.min.x,
+			(c & 2) ? worldBounds.max.y : worldBounds.min.y,
+			(c & 4) ? worldBounds.max.z : worldBounds.min.z);
+		glm::vec4 clip = m_viewProj * glm::vec4(corner, 1.0f);
+
+		// A box reaching through the near plane surrounds the camera, nothing can hide it
+		if (clip.z < 0.0f)
+		{
+			return true;
+		}
+
+		glm::vec3 ndc = glm::vec3(clip) / clip.w;
+		glm::vec2 screen((ndc.x * 0.5f + 0.5f) * WIDTH, (ndc.y * 0.5f + 0.5f) * HEIGHT);
+		screenMin = glm::min(screenMin, screen);
+		screenMax = glm::max(screenMax, screen);
+		nearestDepth = std::min(nearestDepth, ndc.z);
+	}
+
+	// Every pixel the projected box overlaps, even partly
+	const int minX = std::max(0, static_cast<int>(std::floor(screenMin.x)));
+	const int maxX = std::min(static_cast<int>(WIDTH) - 1, static_cast<int>(std::ceil(screenMax.x)) - 1);
+	const int minY = std::max(0, static_cast<int>(std::floor(screenMin.y)));
+	const int maxY = std::min(static_cast<int>(HEIGHT) - 1, static_cast<int>(std::ceil(screenMax.y)) - 1);
+	if (minX > maxX || minY > maxY)
+	{
+		return true;
+	}
+
+	// Tiles whose farthest pixel is nearer than the box hide it whole, the others are read per pixel
+	for (int tileY = minY / static_cast<int>(TILE_HEIGHT); tileY <= maxY / static_cast<int>(TILE_HEIGHT); ++tileY)
+	{
+		for (int tileX = minX / static_cast<int>(TILE_WIDTH); tileX <= maxX / static_cast<int>(TILE_WIDTH); ++tileX)
+		{
+			if (m_tileMaxDepth[tileY * TILES_X + tileX] < nearestDepth)
+			{
+				continue;
+			}
+
+			const int x0 = std::max(minX, tileX * static_cast<int>(TILE_WIDTH));
+			const int x1 = std::min(maxX, (tileX + 1) * static_cast<int>(TILE_WIDTH) - 1);
+			const int y0 = std::max(minY, tileY * static_cast<int>(TILE_HEIGHT));
+			const int y1 = std::min(maxY, (tileY + 1) * static_cast<int>(TILE_HEIGHT) - 1);
+			for (int y = y0; y <= y1; ++y)
+			{
+				for (int x = x0; x <= x1; ++x)
+				{
+					if (m_depth[y * WIDTH + x] >= nearestDepth)
+					{
+						return true;
+					}
+				}
+			}
+		}
+	}
+	return false;
+}
@@ -11,10 +11,10 @@
 #include <iostream>
 #include <array>
 
-Pipeline::Pipeline(VulkanContext& context, Swapchain& swapchain, DescriptorManager& descriptors, uint32_t pushConstantsSize, const std::string& vertPath, const std::string& fragPath, VkFormat depthFormat, PipelineType type)
+Pipeline::Pipeline(VulkanContext& context, Swapchain& swapchain, DescriptorManager& descriptors, uint32_t pushConstantsSize, const std::string& vertPath, const std::string& fragPath, VkFormat depthFormat, PipelineType type, VertexFormat vertexFormat)
 	: m_context(context), m_swapchain(swapchain), m_descriptors(descriptors)
 {
-	createPipeline(vertPath, fragPath, m_swapchain.getFormat(), depthFormat, type, pushConstantsSize);
+	createPipeline(vertPath, fragPath, m_swapchain.getFormat(), depthFormat, type, vertexFormat, pushConstantsSize);
 }
 
 Pipeline::~Pipeline()
@@ -81,7 +81,7 @@ std::vector<char> Pipeline::readFile(const std::string& filename)
 	return buffer;
 }
 
-void Pipeline::createPipeline(const std::string& vertPath, const std::string& fragPath, VkFormat colorFormat, VkFormat depthFormat, PipelineType type, uint32_t pushConstantsSize)
+void Pipeline::createPipeline(const std::string& vertPath, const std::string& fragPath, VkFormat colorFormat, VkFormat depthFormat, PipelineType type, VertexFormat vertexFormat, uint32_t pushConstantsSize)
 {
 	std::vector<VkShaderModule> shaderModules;
 	std::vector<VkPipelineShaderStageCreateInfo> shaderStages;
@@ -129,9 +129,9 @@ void Pipeline::createPipeline(const std::string& vertPath, const std::string& fr
 
 	// Fixed-function state (vertex input, input assembly, viewport, rasterizer, multisample, color blend)
 
-	// Declare attributes and bindings for the main and debug passes
-	VkVertexInputBindingDescription bindingDescription = Vertex::getBindingDescription();
-	std::array<VkVertexInputAttributeDescription, 4> attributeDescriptions = Vertex::getAttributeDescription();
+	// Declare attributes and bindings for the main and debug passes, mesh pipelines match the vertex format of their meshes
+	VkVertexInputBindingDescription bindingDescription = Vertex::getBindingDescription(vertexFormat);
+	std::vector<VkVertexInputAttributeDescription> attributeDescriptions = Vertex::getAttributeDescription(vertexFormat);
 
 	VkVertexInputBindingDescription debugBinding;
 	std::array<VkVertexInputAttributeDescription, 2> debugAttributes;
@@ -312,6 +312,7 @@ void Pipeline::createPipeline(const std::string& vertPath, const std::string& fr
 			rasterizerInfo.depthBiasEnable = VK_TRUE;
 			rasterizerInfo.depthBiasConstantFactor = 1.25f;
 			rasterizerInfo.depthBiasSlopeFactor = 1.75f;
+			rasterizerInfo.depthClampEnable = m_context.supportsDepthClamp() ? VK_TRUE : VK_FALSE; // casters in front of the near plane land on it
 
 			// Depth test/write
 			depthStencil.depthTestEnable = VK_TRUE;
@@ -0,0 +1,587 @@
+#include "SceneFile.hpp"
+#include "Hash.hpp"
+#include "MappedFile.hpp"
+
+#include "gtc/matrix_transform.hpp"
+
+#include <charconv>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace
+{
+	constexpr char SCENE_MAGIC[4] = { 'V', 'K', 'S', 'C' };
+	constexpr uint32_t SCENE_VERSION = 2;
+
+	struct SceneHeader
+	{
+		char magic[4];
+		uint32_t version;
+		uint64_t sourceHash;
+
+		// Struct sizes are stored so a layout change invalidates old binaries
+		uint32_t objectStride;
+		uint32_t pointLightStride;
+		uint32_t spinStride;
+
+		uint32_t objectCount;
+		uint32_t pointLightCount;
+		uint32_t spinCount;
+		uint32_t modelCount;
+		uint32_t stringBytes;
+		uint32_t occluderCount;
+		uint32_t padding[3];
+
+		SceneSettings settings;
+		DirectionalLight sun;
+	};
+	static_assert(sizeof(SceneHeader) % 16 == 0, "Header must keep the object block 16-byte aligned");
+
+	void writeString(std::vector<char>& out, const std::string& str)
+	{
+		uint32_t length = static_cast<uint32_t>(str.size());
+		const char* lengthBytes = reinterpret_cast<const char*>(&length);
+		out.insert(out.end(), lengthBytes, lengthBytes + sizeof(length));
+		out.insert(out.end(), str.begin(), str.end());
+	}
+
+	bool readString(const std::byte*& cursor, const std::byte* end, std::string& out)
+	{
+		uint32_t length = 0;
+		if (end - cursor < static_cast<ptrdiff_t>(sizeof(length)))
+		{
+			return false;
+		}
+		memcpy(&length, cursor, sizeof(length));
+		cursor += sizeof(length);
+
+		if (end - cursor < static_cast<ptrdiff_t>(length))
+		{
+			return false;
+		}
+		out.assign(reinterpret_cast<const char*>(cursor), length);
+		cursor += length;
+		return true;
+	}
+
+	// Whitespace separated tokens of one scene line, errors carry the line they came from
+	class LineTokens
+	{
+	public:
+		LineTokens(std::string_view line, const std::string& sourceName, uint32_t lineNumber)
+			: m_line(line), m_sourceName(sourceName), m_lineNumber(lineNumber)
+		{
+		}
+
+		bool empty()
+		{
+			skipSpace();
+			return m_line.empty();
+		}
+
+		std::string_view next()
+		{
+			skipSpace();
+			if (m_line.empty())
+			{
+				error("unexpected end of line");
+			}
+
+			size_t end = m_line.find_first_of(" \t\r");
+			std::string_view token = m_line.substr(0, end);
+			m_line.remove_prefix(token.size());
+			return token;
+		}
+
+		float number()
+		{
+			std::string_view token = next();
+			float value = 0.0f;
+			auto [end, ec] = std::from_chars(token.data(), token.data() + token.size(), value);
+			if (ec != std::errc() || end != token.data() + token.size())
+			{
+				error("expected a number, got '" + std::string(token) + "'");
+			}
+			return value;
+		}
+
+		glm::vec3 vec3()
+		{
+			float x = number();
+			float y = number();
+			float z = number();
+			return { x, y, z };
+		}
+
+		// True if the next token is a number, without consuming it
+		bool nextIsNumber()
+		{
+			skipSpace();
+			float value = 0.0f;
+			size_t end = std::min(m_line.find_first_of(" \t\r"), m_line.size());
+			auto [last, ec] = std::from_chars(m_line.data(), m_line.data() + end, value);
+			return !m_line.empty() && ec == std::errc() && last == m_line.data() + end;
+		}
+
+		[[noreturn]] void error(const std::string& message) const
+		{
+			throw std::runtime_error("Scene " + m_sourceName + ":" + std::to_string(m_lineNumber) + ": " + message);
+		}
+
+	private:
+		std::string_view m_line;
+		const std::string& m_sourceName;
+		uint32_t m_lineNumber;
+
+		void skipSpace()
+		{
+			size_t start = m_line.find_first_not_of(" \t\r");
+			m_line.remove_prefix(start == std::string_view::npos ? m_line.size() : start);
+		}
+	};
+
+	// Model paths are written relative to the scene file
+	void resolveModelPaths(const std::filesystem::path& scenePath, SceneDescription& scene)
+	{
+		for (std::string& modelPath : scene.modelPaths)
+		{
+			modelPath = (scenePath.parent_path() / modelPath).lexically_normal().generic_string();
+		}
+	}
+}
+
+void SceneFile::load(const std::filesystem::path& path, SceneDescription& scene, std::vector<ObjectData>& objects, LightingData& lights)
+{
+	if (path.extension() == ".vkscene")
+	{
+		if (!loadBinary(path, 0, scene, objects, lights))
+		{
+			throw std::runtime_error("Failed to load scene " + path.string());
+		}
+		resolveModelPaths(path, scene);
+		return;
+	}
+
+	MappedFile text;
+	if (!text.open(path.string()))
+	{
+		throw std::runtime_error("Failed to open scene " + path.string());
+	}
+
+	const uint64_t sourceHash = fnv1a(text.data(), text.size());
+	const std::filesystem::path binaryPath = getBinaryPath(path);
+
+	if (!loadBinary(binaryPath, sourceHash, scene, objects, lights))
+	{
+		parseText(std::string_view(reinterpret_cast<const char*>(text.data()), text.size()), path.string(), scene, objects, lights);
+		writeBinary(binaryPath, sourceHash, scene, objects, lights);
+	}
+	resolveModelPaths(path, scene);
+
+	std::cout << "Loaded scene " << path.string() << " with " << objects.size() << " objects, " << scene.modelPaths.size()
+		<< " models and " << lights.numPointLights << " point lights" << std::endl;
+}
+
+std::filesystem::path SceneFile::getBinaryPath(const std::filesystem::path& textPath)
+{
+	std::filesystem::path binaryPath = textPath;
+	binaryPath.replace_extension(".vkscene");
+	return binaryPath;
+}
+
+void SceneFile::parseText(std::string_view text, const std::string& sourceName, SceneDescription& scene,
+	std::vector<ObjectData>& objects, LightingData& lights)
+{
+	scene = SceneDescription{};
+	objects.clear();
+	lights.numPointLights = 0;
+
+	std::unordered_map<std::string, uint32_t> modelByName;
+	bool hasSun = false;
+
+	uint32_t lineNumber = 0;
+	size_t lineStart = 0;
+	while (lineStart < text.size())
+	{
+		size_t lineEnd = text.find('\n', lineStart);
+		if (lineEnd == std::string_view::npos)
+		{
+			lineEnd = text.size();
+		}
+
+		std::string_view line = text.substr(lineStart, lineEnd - lineStart);
+		line = line.substr(0, line.find('#'));
+		lineStart = lineEnd + 1;
+		++lineNumber;
+
+		LineTokens tokens(line, sourceName, lineNumber);
+		if (tokens.empty())
+		{
+			continue;
+		}
+
+		std::string_view keyword = tokens.next();
+		if (keyword == "instance")
+		{
+			std::string_view modelName = tokens.next();
+			auto model = modelByName.find(std::string(modelName));
+			if (model == modelByName.end())
+			{
+				tokens.error("unknown model '" + std::string(modelName) + "'");
+			}
+
+			glm::vec3 position(0.0f);
+			glm::vec3 rotation(0.0f);
+			glm::vec3 scale(1.0f);
+			float spin = 0.0f;
+			bool occluder = false;
+
+			while (!tokens.empty())
+			{
+				std::string_view property = tokens.next();
+				if (property == "position")
+				{
+					position = tokens.vec3();
+				}
+				else if (property == "rotation")
+				{
+					rotation = tokens.vec3();
+				}
+				else if (property == "scale")
+				{
+					scale = glm::vec3(tokens.number());
+					if (tokens.nextIsNumber())
+					{
+						scale.y = tokens.number();
+						scale.z = tokens.number();
+					}
+				}
+				else if (property == "spin")
+				{
+					spin = tokens.number();
+				}
+				else if (property == "occluder")
+				{
+					occluder = true;
+				}
+				else
+				{
+					tokens.error("unknown instance property '" + std::string(property) + "'");
+				}
+			}
+
+			glm::mat4 base = glm::translate(glm::mat4(1.0f), position);
+			base = glm::rotate(base, glm::radians(rotation.y), glm::vec3(0.0f, 1.0f, 0.0f));
+			base = glm::rotate(base, glm::radians(rotation.x), glm::vec3(1.0f, 0.0f, 0.0f));
+			base = glm::rotate(base, glm::radians(rotation.z), glm::vec3(0.0f, 0.0f, 1.0f));
+
+			if (spin != 0.0f)
+			{
+				scene.spins.push_back({ base, scale, spin, static_cast<uint32_t>(objects.size()), {} });
+			}
+			if (occluder)
+			{
+				scene.occluders.push_back(static_cast<uint32_t>(objects.size()));
+			}
+			objects.push_back({ glm::scale(base, scale), model->second });
+		}
+		else if (keyword == "model")
+		{
+			std::string name(tokens.next());
+			std::string modelPath(tokens.next());
+			if (!modelByName.try_emplace(name, static_cast<uint32_t>(scene.modelPaths.size())).second)
+			{
+				tokens.error("model '" + name + "' is declared twice");
+			}
+			scene.modelPaths.push_back(modelPath);
+		}
+		else if (keyword == "light")
+		{
+			if (lights.numPointLights == MAX_POINT_LIGHTS)
+			{
+				tokens.error("more than " + std::to_string(MAX_POINT_LIGHTS) + " point lights");
+			}
+
+			PointLight light{};
+			light.color = glm::vec4(1.0f);
+			light.radius = 10.0f;
+			while (!tokens.empty())
+			{
+				std::string_view property = tokens.next();
+				if (property == "position")
+				{
+					light.position = glm::vec4(tokens.vec3(), 1.0f);
+				}
+				else if (property == "color")
+				{
+					light.color = glm::vec4(tokens.vec3(), 1.0f);
+				}
+				else if (property == "radius")
+				{
+					light.radius = tokens.number();
+				}
+				else
+				{
+					tokens.error("unknown light property '" + std::string(property) + "'");
+				}
+			}
+			lights.pointLights[lights.numPointLights++] = light;
+		}
+		else if (keyword == "sun")
+		{
+			if (hasSun)
+			{
+				tokens.error("the scene already has a sun");
+			}
+			hasSun = true;
+
+			while (!tokens.empty())
+			{
+				std::string_view property = tokens.next();
+				if (property == "direction")
+				{
+					scene.sun.direction = glm::vec4(tokens.vec3(), 0.0f);
+				}
+				else if (property == "color")
+				{
+					scene.sun.color = glm::vec4(tokens.vec3(), 1.0f);
+				}
+				else if (property == "orbit")
+				{
+					scene.settings.sunOrbitSpeed = tokens.number();
+				}
+				else
+				{
+					tokens.error("unknown sun property '" + std::string(property) + "'");
+				}
+			}
+		}
+		else if (keyword == "camera")
+		{
+			while (!tokens.empty())
+			{
+				std::string_view property = tokens.next();
+				if (property == "position")
+				{
+					scene.settings.cameraPosition = tokens.vec3();
+				}
+				else if (property == "yaw")
+				{
+					scene.settings.cameraYaw = tokens.number();
+				}
+				else if (property == "pitch")
+				{
+					scene.settings.cameraPitch = tokens.number();
+				}
+				else if (property == "fov")
+				{
+					scene.settings.fovY = tokens.number();
+				}
+				else if (property == "near")
+				{
+					scene.settings.nearPlane = tokens.number();
+				}
+				else if (property == "far")
+				{
+					scene.settings.farPlane = tokens.number();
+				}
+				else
+				{
+					tokens.error("unknown camera property '" + std::string(property) + "'");
+				}
+			}
+		}
+		else if (keyword == "skybox")
+		{
+			scene.skybox = tokens.next();
+		}
+		else
+		{
+			tokens.error("unknown keyword '" + std::string(keyword) + "'");
+		}
+
+		if (!tokens.empty())
+		{
+			tokens.error("unexpected '" + std::string(tokens.next()) + "'");
+		}
+	}
+
+	if (scene.skybox.empty())
+	{
+		throw std::runtime_error("Scene " + sourceName + " has no skybox");
+	}
+	if (scene.modelPaths.empty())
+	{
+		throw std::runtime_error("Scene " + sourceName + " has no models");
+	}
+	lights.dirLight = scene.sun;
+}
+
+void SceneFile::writeBinary(const std::filesystem::path& binaryPath, uint64_t sourceHash, const SceneDescription& scene,
+	const std::vector<ObjectData>& objects, const LightingData& lights)
+{
+	std::vector<char> strings;
+	writeString(strings, scene.skybox);
+	for (const std::string& modelPath : scene.modelPaths)
+	{
+		writeString(strings, modelPath);
+	}
+
+	SceneHeader header{};
+	memcpy(header.magic, SCENE_MAGIC, sizeof(SCENE_MAGIC));
+	header.version = SCENE_VERSION;
+	header.sourceHash = sourceHash;
+	header.objectStride = sizeof(ObjectData);
+	header.pointLightStride = sizeof(PointLight);
+	header.spinStride = sizeof(SceneSpin);
+	header.objectCount = static_cast<uint32_t>(objects.size());
+	header.pointLightCount = lights.numPointLights;
+	header.spinCount = static_cast<uint32_t>(scene.spins.size());
+	header.modelCount = static_cast<uint32_t>(scene.modelPaths.size());
+	header.stringBytes = static_cast<uint32_t>(strings.size());
+	header.occluderCount = static_cast<uint32_t>(scene.occluders.size());
+	header.settings = scene.settings;
+	header.sun = scene.sun;
+
+	// Write to a temporary file first so an interrupted write never leaves a valid-looking scene behind
+	std::filesystem::path tempPath = binaryPath;
+	tempPath += ".tmp";
+
+	{
+		std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+		if (!file)
+		{
+			std::cout << "Could not write scene " << binaryPath.string() << std::endl;
+			return;
+		}
+
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(reinterpret_cast<const char*>(objects.data()), objects.size() * sizeof(ObjectData));
+		file.write(reinterpret_cast<const char*>(lights.pointLights), lights.numPointLights * sizeof(PointLight));
+		file.write(reinterpret_cast<const char*>(scene.spins.data()), scene.spins.size() * sizeof(SceneSpin));
+		file.write(reinterpret_cast<const char*>(scene.occluders.data()), scene.occluders.size() * sizeof(uint32_t));
+		file.write(strings.data(), strings.size());
+
+		if (!file)
+		{
+			std::cout << "Could not write scene " << binaryPath.string() << std::endl;
+			return;
+		}
+	}
+
+	std::error_code ec;
+	std::filesystem::rename(tempPath, binaryPath, ec);
+	if (ec)
+	{
+		std::filesystem::remove(tempPath, ec);
+		std::cout << "Could not write scene " << binaryPath.string() << std::endl;
+		return;
+	}
+
+	std::cout << "Scene compiled to " << binaryPath.string() << std::endl;
+}
+
+bool SceneFile::loadBinary(const std::filesystem::path& binaryPath, uint64_t sourceHash, SceneDescription& scene,
+	std::vector<ObjectData>& objects, LightingData& lights)
+{
+	MappedFile file;
+	if (!file.open(binaryPath.string()))
+	{
+		return false;
+	}
+
+	const std::byte* data = file.data();
+	const size_t size = file.size();
+	if (size < sizeof(SceneHeader))
+	{
+		return false;
+	}
+
+	SceneHeader header;
+	memcpy(&header, data, sizeof(header));
+
+	if (memcmp(header.magic, SCENE_MAGIC, sizeof(SCENE_MAGIC)) != 0 ||
+		header.version != SCENE_VERSION ||
+		(sourceHash != 0 && header.sourceHash != sourceHash) ||
+		header.objectStride != sizeof(ObjectData) ||
+		header.pointLightStride != sizeof(PointLight) ||
+		header.spinStride != sizeof(SceneSpin) ||
+		header.pointLightCount > MAX_POINT_LIGHTS)
+	{
+		std::cout << "Scene " << binaryPath.string() << " is stale, recompiling" << std::endl;
+		return false;
+	}
+
+	const size_t objectBytes = size_t(header.objectCount) * sizeof(ObjectData);
+	const size_t lightBytes = size_t(header.pointLightCount) * sizeof(PointLight);
+	const size_t spinBytes = size_t(header.spinCount) * sizeof(SceneSpin);
+	const size_t occluderBytes = size_t(header.occluderCount) * sizeof(uint32_t);
+
+	if (size != sizeof(SceneHeader) + objectBytes + lightBytes + spinBytes + occluderBytes + header.stringBytes)
+	{
+		std::cout << "Scene " << binaryPath.string() << " is truncated, recompiling" << std::endl;
+		return false;
+	}
+
+	// Blocks are in the GPU layout, one copy each
+	const std::byte* cursor = data + sizeof(SceneHeader);
+	objects.resize(header.objectCount);
+	memcpy(objects.data(), cursor, objectBytes);
+	cursor += objectBytes;
+
+	lights.dirLight = header.sun;
+	lights.numPointLights = header.pointLightCount;
+	memcpy(lights.pointLights, cursor, lightBytes);
+	cursor += lightBytes;
+
+	scene.settings = header.settings;
+	scene.sun = header.sun;
+	scene.spins.resize(header.spinCount);
+	memcpy(scene.spins.data(), cursor, spinBytes);
+	cursor += spinBytes;
+	scene.occluders.resize(header.occluderCount);
+	memcpy(scene.occluders.data(), cursor, occluderBytes);
+	cursor += occluderBytes;
+
+	const std::byte* end = data + size;
+	scene.modelPaths.resize(header.modelCount);
+	if (!readString(cursor, end, scene.skybox))
+	{
+		return false;
+	}
+	for (std::string& modelPath : scene.modelPaths)
+	{
+		if (!readString(cursor, end, modelPath))
+		{
+			return false;
+		}
+	}
+
+	// A damaged file must not index past the model list or the objects
+	for (const ObjectData& object : objects)
+	{
+		if (object.meshIndex >= header.modelCount)
+		{
+			return false;
+		}
+	}
+	for (const SceneSpin& spin : scene.spins)
+	{
+		if (spin.objectIndex >= header.objectCount)
+		{
+			return false;
+		}
+	}
+	for (uint32_t occluder : scene.occluders)
+	{
+		if (occluder >= header.objectCount)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
@@ -1,6 +1,36 @@
 #include "TangentGen.hpp"
+
+#include <algorithm>
+#include <execution>
 #include <stdexcept>
 
+namespace
+{
+	// User data of one MikkTSpace run
+	struct CornerContext
+	{
+		const TangentCorners* corners;
+		glm::vec4* tangents;
+	};
+
+	const CornerContext& cornerContext(const SMikkTSpaceContext* context)
+	{
+		return *static_cast<const CornerContext*>(context->m_pUserData);
+	}
+
+	// Exceptions can't leave a parallel algorithm, the first one is rethrown afterwards
+	void rethrowFirst(const std::vector<std::exception_ptr>& errors)
+	{
+		for (const std::exception_ptr& error : errors)
+		{
+			if (error)
+			{
+				std::rethrow_exception(error);
+			}
+		}
+	}
+}
+
 // Define the static SMikkTSpaceInterface once
 SMikkTSpaceInterface& TangentGenerator::GetInterface()
 {
@@ -18,50 +48,93 @@ SMikkTSpaceInterface& TangentGenerator::GetInterface()
 	return iface;
 }
 
-void TangentGenerator::CalculateTangents(MikkTSpaceData& data)
+void TangentGenerator::GenerateTangents(std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, std::span<const Submesh> submeshes)
+{
+	// Submeshes cover disjoint index ranges, so every worker writes its own part of the corner tangents
+	std::vector<glm::vec4> cornerTangents(indices.size());
+	std::vector<std::exception_ptr> errors(submeshes.size());
+
+	std::for_each(std::execution::par, submeshes.begin(), submeshes.end(),
+		[&](const Submesh& sub)
+		{
+			try
+			{
+				TangentCorners corners;
+				GatherCorners(vertices, indices, sub.indexOffset, sub.indexCount, corners);
+				CalculateTangents(corners, std::span(cornerTangents).subspan(sub.indexOffset, sub.indexCount));
+			}
+			catch (...)
+			{
+				errors[&sub - submeshes.data()] = std::current_exception();
+			}
+		});
+
+	rethrowFirst(errors);
+
+	// Merge in submesh and index order, the last corner of a shared vertex wins
+	for (const Submesh& sub : submeshes)
+	{
+		for (uint32_t i = sub.indexOffset; i < sub.indexOffset + sub.indexCount; ++i)
+		{
+			vertices[indices[i]].tangent = cornerTangents[i];
+		}
+	}
+}
+
+void TangentGenerator::GatherCorners(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices,
+	uint32_t indexOffset, uint32_t indexCount, TangentCorners& out)
 {
 	// Ensure we are only working with triangles so our index buffer assumption holds
-	if (data.indexCount % 3 != 0)
+	if (indexCount % 3 != 0)
 	{
 		throw std::runtime_error("TangentGenerator: indexCount is not a multiple of 3 - mesh must be triangulated");
 	}
 
-	if (data.indexOffset + data.indexCount > data.allIndicesPtr->size()) {
+	if (size_t(indexOffset) + indexCount > indices.size())
+	{
 		throw std::runtime_error("TangentGenerator: index range exceeds available indices.");
 	}
 
-	SMikkTSpaceContext context{};
-	context.m_pInterface = &GetInterface();
-	context.m_pUserData = &data;
+	out.positions.resize(indexCount);
+	out.normals.resize(indexCount);
+	out.texCoords.resize(indexCount);
 
-	if (!genTangSpaceDefault(&context))
+	for (uint32_t i = 0; i < indexCount; ++i)
 	{
-		throw std::runtime_error("MikkTSpace failed to generate tangents!");
+		const Vertex& vertex = vertices[indices[indexOffset + i]];
+		out.positions[i] = vertex.pos;
+		out.normals[i] = vertex.normal;
+		out.texCoords[i] = vertex.texCoord;
 	}
 }
 
-// Helper to get the index into the global allVertices array
-uint32_t TangentGenerator::get_global_vertex_index(const SMikkTSpaceContext* context, int iface, int iVert)
+void TangentGenerator::CalculateTangents(const TangentCorners& corners, std::span<glm::vec4> tangents)
 {
-	MikkTSpaceData* data = static_cast<MikkTSpaceData*>(context->m_pUserData);
-	uint32_t relative_index_in_indices = data->indexOffset + (iface * 3) + iVert;
+	if (tangents.size() != corners.positions.size())
+	{
+		throw std::runtime_error("TangentGenerator: output size does not match the corner count.");
+	}
+
+	CornerContext data{ &corners, tangents.data() };
 
-	// The index stored in allIndices is relative to the mesh's vertexOffset
-	uint32_t mesh_local_index = (*data->allIndicesPtr)[relative_index_in_indices];
+	SMikkTSpaceContext context{};
+	context.m_pInterface = &GetInterface();
+	context.m_pUserData = &data;
 
-	// The global index in allVertices
-	return data->vertexOffset + mesh_local_index;
+	if (!genTangSpaceDefault(&context))
+	{
+		throw std::runtime_error("MikkTSpace failed to generate tangents!");
+	}
 }
 
 // 1. Get total number of faces (triangles)
 int TangentGenerator::get_num_faces(const SMikkTSpaceContext* context)
 {
-	MikkTSpaceData* data = static_cast<MikkTSpaceData*>(context->m_pUserData);
-	return data->indexCount / 3;
+	return static_cast<int>(cornerContext(context).corners->positions.size() / 3);
 }
 
 // 2. Get number of vertices per face (always 3 for triangles)
-int TangentGenerator::get_num_vertices_of_face(const SMikkTSpaceContext* context, int iFace)
+int TangentGenerator::get_num_vertices_of_face(const SMikkTSpaceContext*, int)
 {
 	return 3;
 }
@@ -69,40 +142,29 @@ int TangentGenerator::get_num_vertices_of_face(const SMikkTSpaceContext* context
 // 3. Get vertex position
 void TangentGenerator::get_position(const SMikkTSpaceContext* context, float outpos[], int iFace, int iVert)
 {
-	MikkTSpaceData* data = static_cast<MikkTSpaceData*>(context->m_pUserData);
-	uint32_t global_index = get_global_vertex_index(context, iFace, iVert);
-	const Vertex& vertex = (*data->allVerticesPtr)[global_index];
-	outpos[0] = vertex.pos.x;
-	outpos[1] = vertex.pos.y;
-	outpos[2] = vertex.pos.z;
+	const glm::vec3& pos = cornerContext(context).corners->positions[iFace * 3 + iVert];
+	outpos[0] = pos.x;
+	outpos[1] = pos.y;
+	outpos[2] = pos.z;
 }
 
 // 4. Get vertex normal
 void TangentGenerator::get_normal(const SMikkTSpaceContext* context, float outnormal[], int iFace, int iVert)
 {
-	MikkTSpaceData* data = static_cast<MikkTSpaceData*>(context->m_pUserData);
-	uint32_t global_index = get_global_vertex_index(context, iFace, iVert);
-	const Vertex& vertex = (*data->allVerticesPtr)[global_index];
-	outnormal[0] = vertex.normal.x;
-	outnormal[1] = vertex.normal.y;
-	outnormal[2] = vertex.normal.z;
+	const glm::vec3& normal = cornerContext(context).corners->normals[iFace * 3 + iVert];
+	outnormal[0] = normal.x;
+	outnormal[1] = normal.y;
+	outnormal[2] = normal.z;
 }
 
 void TangentGenerator::get_tex_coords(const SMikkTSpaceContext* context, float outuv[], int iFace, int iVert)
 {
-	MikkTSpaceData* data = static_cast<MikkTSpaceData*>(context->m_pUserData);
-	uint32_t global_index = get_global_vertex_index(context, iFace, iVert);
-	const Vertex& vertex = (*data->allVerticesPtr)[global_index];
-	outuv[0] = vertex.texCoord.x;
-	outuv[1] = vertex.texCoord.y;
+	const glm::vec2& uv = cornerContext(context).corners->texCoords[iFace * 3 + iVert];
+	outuv[0] = uv.x;
+	outuv[1] = uv.y;
 }
 
 void TangentGenerator::set_tspace_basic(const SMikkTSpaceContext* context, const float tangentu[], float fSign, int iFace, int iVert)
 {
-	MikkTSpaceData* data = static_cast<MikkTSpaceData*>(context->m_pUserData);
-	uint32_t global_index = get_global_vertex_index(context, iFace, iVert);
-	Vertex& vertex = (*data->allVerticesPtr)[global_index];
-
-	// Note: glm::vec4 tangent is already in your vertex struct
-	vertex.tangent = glm::vec4(tangentu[0], tangentu[1], tangentu[2], fSign);
+	cornerContext(context).tangents[iFace * 3 + iVert] = glm::vec4(tangentu[0], tangentu[1], tangentu[2], fSign);
 }
@@ -0,0 +1,204 @@
+#include "TextureCache.hpp"
+#include "Hash.hpp"
+
+#include <stb_image.h>
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+namespace
+{
+	constexpr char CACHE_MAGIC[4] = { 'V', 'K', 'T', 'X' };
+	constexpr uint32_t CACHE_VERSION = 2;
+
+	struct TextureCacheHeader
+	{
+		char magic[4];
+		uint32_t version;
+		uint64_t sourceHash;
+
+		uint32_t format;
+		uint32_t type;
+		uint32_t levelCount;
+		uint32_t mipSettings;
+	};
+	static_assert(sizeof(TextureCacheHeader) % 16 == 0, "Header must keep the level data 16-byte aligned");
+	static_assert(sizeof(TextureLevel) == 24, "Level index layout is part of the file format");
+
+	// Filter in the low byte, Toksvig flag above it
+	uint32_t packMipSettings(const MipSettings& settings)
+	{
+		return static_cast<uint32_t>(settings.filter) | (settings.toksvig ? 1u << 8 : 0u);
+	}
+
+	// Level data starts at the first 16 byte boundary after the level index
+	size_t dataStart(uint32_t levelCount)
+	{
+		return (sizeof(TextureCacheHeader) + levelCount * sizeof(TextureLevel) + 15) & ~size_t(15);
+	}
+}
+
+std::filesystem::path TextureCache::getCachePath(const std::filesystem::path& sourcePath, TextureType type)
+{
+	// The same image can be used as color, normals and data, each gets its own cache
+	std::filesystem::path cachePath = sourcePath;
+	switch (type)
+	{
+	case TextureType::Color:
+		cachePath += ".srgb.vktex";
+		break;
+	case TextureType::Normal:
+		cachePath += ".normal.vktex";
+		break;
+	default:
+		cachePath += ".vktex";
+		break;
+	}
+	return cachePath;
+}
+
+uint64_t TextureCache::hashSource(const std::filesystem::path& sourcePath)
+{
+	MappedFile image;
+	if (!image.open(sourcePath.string()))
+	{
+		throw std::runtime_error("Failed to open texture " + sourcePath.string());
+	}
+	return fnv1a(image.data(), image.size());
+}
+
+bool TextureCache::load(const std::filesystem::path& sourcePath, uint64_t sourceHash, TextureType type, bool blockCompression, CookedTexture& out)
+{
+	std::filesystem::path cachePath = getCachePath(sourcePath, type);
+	if (!out.file.open(cachePath.string()))
+	{
+		return false;
+	}
+
+	const std::byte* data = out.file.data();
+	const size_t size = out.file.size();
+	if (size < sizeof(TextureCacheHeader))
+	{
+		return false;
+	}
+
+	TextureCacheHeader header;
+	memcpy(&header, data, sizeof(header));
+
+	const TextureFormat format = static_cast<TextureFormat>(header.format);
+	if (memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0 ||
+		header.version != CACHE_VERSION ||
+		header.sourceHash != sourceHash ||
+		header.type != static_cast<uint32_t>(type) ||
+		header.mipSettings != packMipSettings(TextureCooker::getMipSettings(type)) ||
+		(format != TextureFormat::RGBA8) != blockCompression)
+	{
+		std::cout << "Texture cache " << cachePath.string() << " is stale, re-cooking" << std::endl;
+		return false;
+	}
+
+	const size_t start = dataStart(header.levelCount);
+	if (header.levelCount == 0 || size < start)
+	{
+		std::cout << "Texture cache " << cachePath.string() << " is truncated, re-cooking" << std::endl;
+		return false;
+	}
+
+	out.format = format;
+	out.type = type;
+	out.levels.resize(header.levelCount);
+	memcpy(out.levels.data(), data + sizeof(TextureCacheHeader), header.levelCount * sizeof(TextureLevel));
+	out.data = { data + start, size - start };
+
+	for (const TextureLevel& level : out.levels)
+	{
+		if (level.offset % 16 != 0 || level.offset + level.size > out.data.size() ||
+			level.size != TextureCooker::levelSize(format, level.width, level.height))
+		{
+			std::cout << "Texture cache " << cachePath.string() << " is truncated, re-cooking" << std::endl;
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void TextureCache::store(const std::filesystem::path& sourcePath, uint64_t sourceHash, const CookedTexture& texture)
+{
+	TextureCacheHeader header{};
+	memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+	header.version = CACHE_VERSION;
+	header.sourceHash = sourceHash;
+	header.format = static_cast<uint32_t>(texture.format);
+	header.type = static_cast<uint32_t>(texture.type);
+	header.levelCount = static_cast<uint32_t>(texture.levels.size());
+	header.mipSettings = packMipSettings(TextureCooker::getMipSettings(texture.type));
+
+	const size_t indexBytes = texture.levels.size() * sizeof(TextureLevel);
+	const size_t paddingBytes = dataStart(header.levelCount) - sizeof(TextureCacheHeader) - indexBytes;
+	const char padding[16] = {};
+
+	// Write to a temporary file first so an interrupted write never leaves a valid-looking cache behind
+	std::filesystem::path cachePath = getCachePath(sourcePath, texture.type);
+	std::filesystem::path tempPath = cachePath;
+	tempPath += ".tmp";
+
+	{
+		std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+		if (!file)
+		{
+			std::cout << "Could not write texture cache " << cachePath.string() << std::endl;
+			return;
+		}
+
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(reinterpret_cast<const char*>(texture.levels.data()), indexBytes);
+		file.write(padding, paddingBytes);
+		file.write(reinterpret_cast<const char*>(texture.data.data()), texture.data.size());
+
+		if (!file)
+		{
+			std::cout << "Could not write texture cache " << cachePath.string() << std::endl;
+			return;
+		}
+	}
+
+	std::error_code ec;
+	std::filesystem::rename(tempPath, cachePath, ec);
+	if (ec)
+	{
+		std::filesystem::remove(tempPath, ec);
+		std::cout << "Could not write texture cache " << cachePath.string() << std::endl;
+		return;
+	}
+
+	std::cout << "Texture cache written to " << cachePath.string() << std::endl;
+}
+
+void TextureCache::prepare(const std::string& path, TextureType type, bool blockCompression, CookedTexture& out)
+{
+	std::filesystem::path sourcePath(path);
+	uint64_t sourceHash = hashSource(sourcePath);
+
+	// Fast path: the levels are viewed in place in the mapped cache
+	if (load(sourcePath, sourceHash, type, blockCompression, out))
+	{
+		return;
+	}
+
+	int texWidth, texHeight, texChannels;
+	uint8_t* pixels = stbi_load(path.c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
+	if (!pixels)
+	{
+		throw std::runtime_error("Failed to load texture image: " + path);
+	}
+
+	out.file.close();
+	TextureFormat format = TextureCooker::chooseFormat(pixels, texWidth, texHeight, type, blockCompression);
+	TextureCooker::cook(pixels, texWidth, texHeight, format, type, out);
+	stbi_image_free(pixels);
+
+	store(sourcePath, sourceHash, out);
+}
@@ -0,0 +1,414 @@
+#include "TextureCooker.hpp"
+#include "BlockEncoder.hpp"
+
+#include <glm.hpp>
+#include <gtc/constants.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <execution>
+#include <ranges>
+
+namespace
+{
+	constexpr uint64_t LEVEL_ALIGNMENT = 16;
+
+	float srgbToLinear(float value)
+	{
+		return value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+	}
+
+	float linearToSrgb(float value)
+	{
+		return value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+	}
+
+	const std::array<float, 256>& srgbTable()
+	{
+		static const std::array<float, 256> table = []()
+			{
+				std::array<float, 256> values{};
+				for (int i = 0; i < 256; ++i)
+				{
+					values[i] = srgbToLinear(i / 255.0f);
+				}
+				return values;
+			}();
+		return table;
+	}
+
+	uint8_t toUnorm8(float value)
+	{
+		return static_cast<uint8_t>(std::clamp(value, 0.0f, 1.0f) * 255.0f + 0.5f);
+	}
+
+	// Filter and Toksvig per texture type, indexed by TextureType. Changing an entry re-cooks that type.
+	constexpr MipSettings MIP_SETTINGS[] = {
+		{ MipFilter::Box, false }, // Color
+		{ MipFilter::Kaiser, false }, // Normal
+		{ MipFilter::Kaiser, false } // Data
+	};
+
+	// Kaiser window as used by NVTT: radius in destination texels and window shape
+	constexpr float KAISER_WIDTH = 3.0f;
+	constexpr float KAISER_ALPHA = 4.0f;
+
+	constexpr uint32_t MAX_TAPS = 16;
+
+	// Source texels contributing to one destination texel and their normalized weights. 'first' can be
+	// negative or run past the edge, the textures repeat so taps wrap around.
+	struct FilterTap
+	{
+		int32_t first;
+		uint32_t count;
+		float weights[MAX_TAPS];
+	};
+
+	// Zeroth order modified Bessel function of the first kind, by its power series
+	float bessel0(float x)
+	{
+		float sum = 1.0f;
+		float term = 1.0f;
+		for (int k = 1; k < 32 && term > sum * 1e-7f; ++k)
+		{
+			float ratio = x / (2.0f * k);
+			term *= ratio * ratio;
+			sum += term;
+		}
+		return sum;
+	}
+
+	float kaiser(float x)
+	{
+		if (std::abs(x) >= KAISER_WIDTH)
+		{
+			return 0.0f;
+		}
+
+		float sinc = 1.0f;
+		if (x != 0.0f)
+		{
+			const float angle = glm::pi<float>() * x;
+			sinc = std::sin(angle) / angle;
+		}
+
+		const float t = x / KAISER_WIDTH;
+		return sinc * bessel0(KAISER_ALPHA * std::sqrt(1.0f - t * t)) / bessel0(KAISER_ALPHA);
+	}
+
+	// Box taps weight every source texel by its coverage. Works for any ratio between 1 and 2, so odd sizes
+	// don't shift the image like a plain 2x2 average would.
+	FilterTap boxTap(uint32_t index, uint32_t srcSize, float scale)
+	{
+		const float begin = index * scale;
+		const float end = (index + 1) * scale;
+
+		FilterTap tap{};
+		tap.first = static_cast<int32_t>(begin);
+		for (uint32_t s = tap.first; s < srcSize && static_cast<float>(s) < end && tap.count < MAX_TAPS; ++s)
+		{
+			float overlap = std::min(end, s + 1.0f) - std::max(begin, static_cast<float>(s));
+			tap.weights[tap.count++] = overlap / scale;
+		}
+		return tap;
+	}
+
+	// Kaiser taps sample the windowed sinc, stretched to the destination texel size, at every source texel center
+	FilterTap kaiserTap(uint32_t index, float scale)
+	{
+		const float center = (index + 0.5f) * scale;
+		const float radius = KAISER_WIDTH * scale;
+
+		FilterTap tap{};
+		tap.first = static_cast<int32_t>(std::floor(center - radius));
+		const int32_t last = static_cast<int32_t>(std::ceil(center + radius));
+
+		float sum = 0.0f;
+		for (int32_t s = tap.first; s < last && tap.count < MAX_TAPS; ++s)
+		{
+			float weight = kaiser((s + 0.5f - center) / scale);
+			tap.weights[tap.count++] = weight;
+			sum += weight;
+		}
+		for (uint32_t t = 0; t < tap.count; ++t)
+		{
+			tap.weights[t] /= sum;
+		}
+		return tap;
+	}
+
+	std::vector<FilterTap> filterTaps(uint32_t srcSize, uint32_t dstSize, MipFilter filter)
+	{
+		std::vector<FilterTap> taps(dstSize);
+		const float scale = static_cast<float>(srcSize) / dstSize;
+
+		for (uint32_t i = 0; i < dstSize; ++i)
+		{
+			taps[i] = filter == MipFilter::Kaiser ? kaiserTap(i, scale) : boxTap(i, srcSize, scale);
+		}
+		return taps;
+	}
+
+	uint32_t wrap(int32_t index, uint32_t size)
+	{
+		int32_t wrapped = index % static_cast<int32_t>(size);
+		return static_cast<uint32_t>(wrapped < 0 ? wrapped + static_cast<int32_t>(size) : wrapped);
+	}
+
+	// Separable downsample of a float RGBA image to the next mip size
+	std::vector<glm::vec4> downsample(const std::vector<glm::vec4>& src, uint32_t srcWidth, uint32_t srcHeight, uint32_t dstWidth, uint32_t dstHeight, MipFilter filter)
+	{
+		const std::vector<FilterTap> tapsX = filterTaps(srcWidth, dstWidth, filter);
+		const std::vector<FilterTap> tapsY = filterTaps(srcHeight, dstHeight, filter);
+
+		std::vector<glm::vec4> rows(size_t(dstWidth) * srcHeight);
+		for (uint32_t y = 0; y < srcHeight; ++y)
+		{
+			const glm::vec4* srcRow = &src[size_t(y) * srcWidth];
+			for (uint32_t x = 0; x < dstWidth; ++x)
+			{
+				glm::vec4 sum(0.0f);
+				for (uint32_t t = 0; t < tapsX[x].count; ++t)
+				{
+					sum += srcRow[wrap(tapsX[x].first + t, srcWidth)] * tapsX[x].weights[t];
+				}
+				rows[size_t(y) * dstWidth + x] = sum;
+			}
+		}
+
+		std::vector<glm::vec4> dst(size_t(dstWidth) * dstHeight);
+		for (uint32_t y = 0; y < dstHeight; ++y)
+		{
+			for (uint32_t x = 0; x < dstWidth; ++x)
+			{
+				glm::vec4 sum(0.0f);
+				for (uint32_t t = 0; t < tapsY[y].count; ++t)
+				{
+					sum += rows[size_t(wrap(tapsY[y].first + t, srcHeight)) * dstWidth + x] * tapsY[y].weights[t];
+				}
+				dst[size_t(y) * dstWidth + x] = sum;
+			}
+		}
+		return dst;
+	}
+
+	// Converts texels to the space they are filtered in: linear color, unit normal vectors or plain [0, 1] data
+	std::vector<glm::vec4> decodeTexels(const uint8_t* rgba, size_t texelCount, TextureType type)
+	{
+		const std::array<float, 256>& toLinear = srgbTable();
+
+		std::vector<glm::vec4> texels(texelCount);
+		for (size_t i = 0; i < texelCount; ++i)
+		{
+			const uint8_t* texel = rgba + i * 4;
+			switch (type)
+			{
+			case TextureType::Color:
+				texels[i] = glm::vec4(toLinear[texel[0]], toLinear[texel[1]], toLinear[texel[2]], texel[3] / 255.0f);
+				break;
+			case TextureType::Normal:
+			{
+				glm::vec3 normal = glm::vec3(texel[0], texel[1], texel[2]) / 127.5f - 1.0f;
+				float length = glm::length(normal);
+				texels[i] = glm::vec4(length > 0.0f ? normal / length : glm::vec3(0.0f, 0.0f, 1.0f), 1.0f);
+				break;
+			}
+			default:
+				texels[i] = glm::vec4(texel[0], texel[1], texel[2], texel[3]) / 255.0f;
+				break;
+			}
+		}
+		return texels;
+	}
+
+	void encodeTexels(const std::vector<glm::vec4>& texels, TextureType type, bool toksvig, std::vector<uint8_t>& out)
+	{
+		out.resize(texels.size() * 4);
+		for (size_t i = 0; i < texels.size(); ++i)
+		{
+			const glm::vec4& value = texels[i];
+			uint8_t* texel = &out[i * 4];
+			switch (type)
+			{
+			case TextureType::Color:
+				texel[0] = toUnorm8(linearToSrgb(value.r));
+				texel[1] = toUnorm8(linearToSrgb(value.g));
+				texel[2] = toUnorm8(linearToSrgb(value.b));
+				texel[3] = toUnorm8(value.a);
+				break;
+			case TextureType::Normal:
+			{
+				// A short averaged normal means the texel covers diverging detail, which is what Toksvig measures
+				glm::vec3 normal(value);
+				float length = glm::length(normal);
+				normal = length > 1e-6f ? normal / length : glm::vec3(0.0f, 0.0f, 1.0f);
+
+				texel[0] = toUnorm8(normal.x * 0.5f + 0.5f);
+				texel[1] = toUnorm8(normal.y * 0.5f + 0.5f);
+				texel[2] = toUnorm8(normal.z * 0.5f + 0.5f);
+				texel[3] = toksvig ? toUnorm8(length) : 255;
+				break;
+			}
+			default:
+				texel[0] = toUnorm8(value.r);
+				texel[1] = toUnorm8(value.g);
+				texel[2] = toUnorm8(value.b);
+				texel[3] = toUnorm8(value.a);
+				break;
+			}
+		}
+	}
+}
+
+TextureFormat TextureCooker::chooseFormat(const uint8_t* rgba, uint32_t width, uint32_t height, TextureType type, bool blockCompression)
+{
+	if (!blockCompression)
+	{
+		return TextureFormat::RGBA8;
+	}
+
+	switch (type)
+	{
+	case TextureType::Color:
+		return TextureFormat::BC7;
+	case TextureType::Normal:
+		// BC5 has no alpha channel for the Toksvig factor
+		return getMipSettings(type).toksvig ? TextureFormat::BC7 : TextureFormat::BC5;
+	default:
+		break;
+	}
+
+	const size_t texelCount = size_t(width) * height;
+	for (size_t i = 0; i < texelCount; ++i)
+	{
+		const uint8_t* texel = rgba + i * 4;
+		if (texel[0] != texel[1] || texel[0] != texel[2] || texel[3] != 255)
+		{
+			return TextureFormat::BC7;
+		}
+	}
+	return TextureFormat::BC4;
+}
+
+MipSettings TextureCooker::getMipSettings(TextureType type)
+{
+	return MIP_SETTINGS[static_cast<uint32_t>(type)];
+}
+
+uint64_t TextureCooker::levelSize(TextureFormat format, uint32_t width, uint32_t height)
+{
+	const uint64_t blocks = uint64_t((width + 3) / 4) * ((height + 3) / 4);
+	switch (format)
+	{
+	case TextureFormat::BC4:
+		return blocks * 8;
+	case TextureFormat::BC5:
+	case TextureFormat::BC7:
+		return blocks * 16;
+	default:
+		return uint64_t(width) * height * 4;
+	}
+}
+
+void TextureCooker::cook(const uint8_t* rgba, uint32_t width, uint32_t height, TextureFormat format, TextureType type, CookedTexture& out)
+{
+	out.format = format;
+	out.type = type;
+	out.levels.clear();
+
+	const MipSettings settings = getMipSettings(type);
+	const uint32_t mipLevels = static_cast<uint32_t>(std::floor(std::log2(std::max(width, height)))) + 1;
+
+	uint64_t totalSize = 0;
+	for (uint32_t mip = 0; mip < mipLevels; ++mip)
+	{
+		TextureLevel level{};
+		level.width = std::max(width >> mip, 1u);
+		level.height = std::max(height >> mip, 1u);
+		level.offset = totalSize;
+		level.size = levelSize(format, level.width, level.height);
+		out.levels.push_back(level);
+
+		totalSize += (level.size + LEVEL_ALIGNMENT - 1) & ~(LEVEL_ALIGNMENT - 1);
+	}
+
+	out.storage.assign(totalSize, std::byte{ 0 });
+	out.data = out.storage;
+
+	// Filtering happens on linear values, averaging sRGB bytes directly darkens every mip.
+	// Normals stay unnormalized in this chain, so each level's length reflects all the texels below it.
+	std::vector<glm::vec4> texels = decodeTexels(rgba, size_t(width) * height, type);
+
+	std::vector<uint8_t> encoded;
+	for (uint32_t mip = 0; mip < mipLevels; ++mip)
+	{
+		const TextureLevel& level = out.levels[mip];
+
+		if (mip > 0)
+		{
+			// Every level is filtered from the one above, which is still in full float precision
+			const TextureLevel& previous = out.levels[mip - 1];
+			texels = downsample(texels, previous.width, previous.height, level.width, level.height, settings.filter);
+		}
+
+		// Color and data keep their source bytes at the top level, normals are renormalized there too
+		if (mip == 0 && type != TextureType::Normal)
+		{
+			encodeLevel(rgba, level.width, level.height, format, out.storage.data());
+			continue;
+		}
+
+		encodeTexels(texels, type, settings.toksvig, encoded);
+		encodeLevel(encoded.data(), level.width, level.height, format, out.storage.data() + level.offset);
+	}
+}
+
+void TextureCooker::encodeLevel(const uint8_t* rgba, uint32_t width, uint32_t height, TextureFormat format, std::byte* out)
+{
+	if (format == TextureFormat::RGBA8)
+	{
+		memcpy(out, rgba, size_t(width) * height * 4);
+		return;
+	}
+
+	const uint32_t blocksX = (width + 3) / 4;
+	const uint32_t blocksY = (height + 3) / 4;
+	const size_t blockBytes = format == TextureFormat::BC4 ? 8 : 16;
+
+	// Block rows are independent, large textures are encoded on all cores
+	auto rows = std::views::iota(0u, blocksY);
+	std::for_each(std::execution::par, rows.begin(), rows.end(),
+		[&](uint32_t by)
+		{
+			uint8_t block[64];
+			for (uint32_t bx = 0; bx < blocksX; ++bx)
+			{
+				// Edge blocks repeat the last row and column
+				for (uint32_t y = 0; y < 4; ++y)
+				{
+					const uint32_t sy = std::min(by * 4 + y, height - 1);
+					for (uint32_t x = 0; x < 4; ++x)
+					{
+						const uint32_t sx = std::min(bx * 4 + x, width - 1);
+						memcpy(block + (y * 4 + x) * 4, rgba + (size_t(sy) * width + sx) * 4, 4);
+					}
+				}
+
+				uint8_t* dst = reinterpret_cast<uint8_t*>(out) + (size_t(by) * blocksX + bx) * blockBytes;
+				switch (format)
+				{
+				case TextureFormat::BC4:
+					BlockEncoder::encodeBC4(block, 0, dst);
+					break;
+				case TextureFormat::BC5:
+					BlockEncoder::encodeBC5(block, dst);
+					break;
+				default:
+					BlockEncoder::encodeBC7(block, dst);
+					break;
+				}
+			}
+		});
+}
@@ -0,0 +1,559 @@
+#include "Utils.hpp"
+
+#include "UploadManager.hpp"
+#include "VulkanContext.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+namespace
+{
+	// Block compressed copies need offsets aligned to the 16 byte block size
+	constexpr VkDeviceSize UPLOAD_ALIGNMENT = 16;
+
+	double now()
+	{
+		return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	VkCommandPool createPool(VkDevice device, uint32_t queueFamilyIndex, const char* name)
+	{
+		VkCommandPoolCreateInfo poolInfo{};
+		poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT | VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+		poolInfo.queueFamilyIndex = queueFamilyIndex;
+
+		VkCommandPool pool;
+		if (vkCreateCommandPool(device, &poolInfo, nullptr, &pool) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to create upload command pool!");
+		}
+		nameObject(device, pool, name);
+		return pool;
+	}
+
+	VkSemaphore createTimeline(VkDevice device, const char* name)
+	{
+		VkSemaphoreTypeCreateInfo typeInfo{};
+		typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+		typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+		typeInfo.initialValue = 0;
+
+		VkSemaphoreCreateInfo semaphoreInfo{};
+		semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+		semaphoreInfo.pNext = &typeInfo;
+
+		VkSemaphore semaphore;
+		if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &semaphore) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to create upload timeline semaphore!");
+		}
+		nameObject(device, semaphore, name);
+		return semaphore;
+	}
+}
+
+UploadManager::UploadManager(VulkanContext& context, VkDeviceSize ringCapacity)
+	: m_context(context), m_capacity(ringCapacity)
+{
+	VkDevice device = m_context.getDevice();
+	m_async = m_context.hasAsyncTransferQueue();
+	m_ownershipTransfer = m_context.getTransferQueueFamilyIndex() != m_context.getGraphicsQueueFamilyIndex();
+
+	m_transferPool = createPool(device, m_context.getTransferQueueFamilyIndex(), "CommandPool_Upload");
+	m_transferTimeline = createTimeline(device, "Semaphore_UploadTransfer");
+	if (m_async)
+	{
+		m_graphicsPool = createPool(device, m_context.getGraphicsQueueFamilyIndex(), "CommandPool_UploadAcquire");
+		m_graphicsTimeline = createTimeline(device, "Semaphore_UploadAcquire");
+	}
+
+	VkBufferCreateInfo bufferInfo{};
+	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferInfo.size = m_capacity;
+	bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+	bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	VmaAllocationCreateInfo allocInfo{};
+	allocInfo.usage = VMA_MEMORY_USAGE_AUTO;
+	allocInfo.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT;
+
+	VmaAllocationInfo allocationInfo{};
+	if (vmaCreateBuffer(m_context.getAllocator(), &bufferInfo, &allocInfo, &m_ringBuffer, &m_ringAllocation, &allocationInfo) != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to create staging ring");
+	}
+	m_ringMapped = static_cast<std::byte*>(allocationInfo.pMappedData);
+	nameObject(m_context.getDevice(), m_ringBuffer, "Buffer_StagingRing");
+
+	m_stats.ringCapacity = m_capacity;
+	m_stats.asyncQueue = m_async;
+	m_windowStart = now();
+
+	std::cout << "Staging ring created (" << (m_capacity >> 20) << " MB, "
+		<< (m_async ? "transfer queue" : "graphics queue") << ")" << std::endl;
+}
+
+UploadManager::~UploadManager()
+{
+	waitIdle();
+
+	vkDestroySemaphore(m_context.getDevice(), m_transferTimeline, nullptr);
+	vkDestroySemaphore(m_context.getDevice(), m_graphicsTimeline, nullptr);
+	vkDestroyCommandPool(m_context.getDevice(), m_transferPool, nullptr);
+	vkDestroyCommandPool(m_context.getDevice(), m_graphicsPool, nullptr);
+	vmaDestroyBuffer(m_context.getAllocator(), m_ringBuffer, m_ringAllocation);
+}
+
+void UploadManager::uploadBuffer(VkBuffer dstBuffer, VkDeviceSize dstOffset, const void* data, VkDeviceSize size)
+{
+	// Chunks of a quarter ring let the first parts of a large buffer transfer while the rest is staged
+	const VkDeviceSize maxChunk = std::max(m_capacity / 4, UPLOAD_ALIGNMENT);
+	const std::byte* src = static_cast<const std::byte*>(data);
+
+	while (size > 0)
+	{
+		VkDeviceSize chunk = std::min(size, maxChunk);
+		StagingAllocation staging = allocate(chunk, UPLOAD_ALIGNMENT);
+
+		memcpy(staging.mapped, src, chunk);
+		vmaFlushAllocation(m_context.getAllocator(), staging.allocation, staging.offset, chunk);
+
+		VkBufferCopy region{};
+		region.srcOffset = staging.offset;
+		region.dstOffset = dstOffset;
+		region.size = chunk;
+		vkCmdCopyBuffer(pendingCommands(), staging.buffer, dstBuffer, 1, &region);
+
+		if (m_ownershipTransfer)
+		{
+			VkBufferMemoryBarrier2 release{};
+			release.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2;
+			release.srcStageMask = VK_PIPELINE_STAGE_2_COPY_BIT;
+			release.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+			release.srcQueueFamilyIndex = m_context.getTransferQueueFamilyIndex();
+			release.dstQueueFamilyIndex = m_context.getGraphicsQueueFamilyIndex();
+			release.buffer = dstBuffer;
+			release.offset = dstOffset;
+			release.size = chunk;
+
+			VkDependencyInfo depInfo{};
+			depInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+			depInfo.bufferMemoryBarrierCount = 1;
+			depInfo.pBufferMemoryBarriers = &release;
+			vkCmdPipelineBarrier2(m_pending.cmd, &depInfo);
+
+			VkBufferMemoryBarrier2 acquire = release;
+			acquire.srcStageMask = VK_PIPELINE_STAGE_2_NONE;
+			acquire.srcAccessMask = VK_ACCESS_2_NONE;
+			acquire.dstStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+			acquire.dstAccessMask = VK_ACCESS_2_MEMORY_READ_BIT;
+			m_pending.bufferAcquires.push_back(acquire);
+		}
+
+		m_pending.uploadBytes += chunk;
+		m_stats.bytesUploaded += chunk;
+
+		src += chunk;
+		dstOffset += chunk;
+		size -= chunk;
+	}
+}
+
+void UploadManager::uploadImage(VkImage image, uint32_t mipLevels, uint32_t arrayLayers, std::span<const std::byte> data, std::span<const VkBufferImageCopy> regions)
+{
+	StagingAllocation staging = allocate(data.size(), UPLOAD_ALIGNMENT);
+
+	memcpy(staging.mapped, data.data(), data.size());
+	vmaFlushAllocation(m_context.getAllocator(), staging.allocation, staging.offset, data.size());
+
+	VkCommandBuffer cmd = pendingCommands();
+
+	VkImageMemoryBarrier2 barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+	barrier.srcStageMask = VK_PIPELINE_STAGE_2_NONE;
+	barrier.srcAccessMask = VK_ACCESS_2_NONE;
+	barrier.dstStageMask = VK_PIPELINE_STAGE_2_COPY_BIT;
+	barrier.dstAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+	barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = image;
+	barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	barrier.subresourceRange.baseMipLevel = 0;
+	barrier.subresourceRange.levelCount = mipLevels;
+	barrier.subresourceRange.baseArrayLayer = 0;
+	barrier.subresourceRange.layerCount = arrayLayers;
+
+	VkDependencyInfo depInfo{};
+	depInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+	depInfo.imageMemoryBarrierCount = 1;
+	depInfo.pImageMemoryBarriers = &barrier;
+	vkCmdPipelineBarrier2(cmd, &depInfo);
+
+	std::vector<VkBufferImageCopy> stagedRegions(regions.begin(), regions.end());
+	for (VkBufferImageCopy& region : stagedRegions)
+	{
+		region.bufferOffset += staging.offset;
+	}
+	vkCmdCopyBufferToImage(cmd, staging.buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+		static_cast<uint32_t>(stagedRegions.size()), stagedRegions.data());
+
+	barrier.srcStageMask = VK_PIPELINE_STAGE_2_COPY_BIT;
+	barrier.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+	barrier.dstStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+	barrier.dstAccessMask = VK_ACCESS_2_SHADER_READ_BIT;
+	barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+	// Another family: this is the release half, the graphics queue repeats the layout change to acquire
+	if (m_ownershipTransfer)
+	{
+		barrier.dstStageMask = VK_PIPELINE_STAGE_2_NONE;
+		barrier.dstAccessMask = VK_ACCESS_2_NONE;
+		barrier.srcQueueFamilyIndex = m_context.getTransferQueueFamilyIndex();
+		barrier.dstQueueFamilyIndex = m_context.getGraphicsQueueFamilyIndex();
+
+		VkImageMemoryBarrier2 acquire = barrier;
+		acquire.srcStageMask = VK_PIPELINE_STAGE_2_NONE;
+		acquire.srcAccessMask = VK_ACCESS_2_NONE;
+		acquire.dstStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+		acquire.dstAccessMask = VK_ACCESS_2_SHADER_READ_BIT;
+		m_pending.imageAcquires.push_back(acquire);
+	}
+	vkCmdPipelineBarrier2(cmd, &depInfo);
+
+	m_pending.uploadBytes += data.size();
+	m_stats.bytesUploaded += data.size();
+}
+
+void UploadManager::flush()
+{
+	if (m_pending.cmd == VK_NULL_HANDLE)
+	{
+		retire(false);
+		return;
+	}
+
+	// On the graphics queue the copies become visible to everything submitted after this batch,
+	// otherwise the acquire batch takes care of it
+	if (!m_async)
+	{
+		VkMemoryBarrier2 barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2;
+		barrier.srcStageMask = VK_PIPELINE_STAGE_2_COPY_BIT;
+		barrier.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+		barrier.dstStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+		barrier.dstAccessMask = VK_ACCESS_2_MEMORY_READ_BIT;
+
+		VkDependencyInfo depInfo{};
+		depInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+		depInfo.memoryBarrierCount = 1;
+		depInfo.pMemoryBarriers = &barrier;
+		vkCmdPipelineBarrier2(m_pending.cmd, &depInfo);
+	}
+
+	if (vkEndCommandBuffer(m_pending.cmd) != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to record upload commands!");
+	}
+
+	m_pending.value = ++m_submitValue;
+
+	VkCommandBufferSubmitInfo cmdInfo{};
+	cmdInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO;
+	cmdInfo.commandBuffer = m_pending.cmd;
+
+	VkSemaphoreSubmitInfo signalInfo{};
+	signalInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
+	signalInfo.semaphore = m_transferTimeline;
+	signalInfo.value = m_pending.value;
+	signalInfo.stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+
+	VkSubmitInfo2 submitInfo{};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2;
+	submitInfo.commandBufferInfoCount = 1;
+	submitInfo.pCommandBufferInfos = &cmdInfo;
+	submitInfo.signalSemaphoreInfoCount = 1;
+	submitInfo.pSignalSemaphoreInfos = &signalInfo;
+
+	if (vkQueueSubmit2(m_context.getTransferQueue(), 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to submit upload batch!");
+	}
+
+	if (m_async)
+	{
+		submitAcquire(m_pending.value);
+	}
+
+	m_inFlight.push_back(std::move(m_pending));
+	m_pending = Batch{};
+	++m_stats.submissions;
+
+	retire(false);
+}
+
+void UploadManager::waitIdle()
+{
+	flush();
+	while (!m_inFlight.empty())
+	{
+		retire(true);
+	}
+
+	if (!m_acquiresInFlight.empty())
+	{
+		VkSemaphoreWaitInfo waitInfo{};
+		waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+		waitInfo.semaphoreCount = 1;
+		waitInfo.pSemaphores = &m_graphicsTimeline;
+		waitInfo.pValues = &m_acquiresInFlight.back().first;
+		vkWaitSemaphores(m_context.getDevice(), &waitInfo, UINT64_MAX);
+		retire(false);
+	}
+}
+
+void UploadManager::submitAcquire(uint64_t value)
+{
+	VkCommandBuffer cmd = beginCommands(m_graphicsPool, m_freeGraphicsCommands, "CommandBuffer_UploadAcquire");
+
+	// The semaphore wait covers this batch only, the barrier carries the copies over to later graphics submissions
+	VkMemoryBarrier2 barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2;
+	barrier.srcStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+	barrier.srcAccessMask = VK_ACCESS_2_MEMORY_WRITE_BIT;
+	barrier.dstStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+	barrier.dstAccessMask = VK_ACCESS_2_MEMORY_READ_BIT;
+
+	VkDependencyInfo depInfo{};
+	depInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+	depInfo.memoryBarrierCount = 1;
+	depInfo.pMemoryBarriers = &barrier;
+	depInfo.bufferMemoryBarrierCount = static_cast<uint32_t>(m_pending.bufferAcquires.size());
+	depInfo.pBufferMemoryBarriers = m_pending.bufferAcquires.data();
+	depInfo.imageMemoryBarrierCount = static_cast<uint32_t>(m_pending.imageAcquires.size());
+	depInfo.pImageMemoryBarriers = m_pending.imageAcquires.data();
+	vkCmdPipelineBarrier2(cmd, &depInfo);
+
+	if (vkEndCommandBuffer(cmd) != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to record upload acquire commands!");
+	}
+
+	VkCommandBufferSubmitInfo cmdInfo{};
+	cmdInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO;
+	cmdInfo.commandBuffer = cmd;
+
+	VkSemaphoreSubmitInfo waitInfo{};
+	waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
+	waitInfo.semaphore = m_transferTimeline;
+	waitInfo.value = value;
+	waitInfo.stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+
+	VkSemaphoreSubmitInfo signalInfo = waitInfo;
+	signalInfo.semaphore = m_graphicsTimeline;
+
+	VkSubmitInfo2 submitInfo{};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2;
+	submitInfo.waitSemaphoreInfoCount = 1;
+	submitInfo.pWaitSemaphoreInfos = &waitInfo;
+	submitInfo.commandBufferInfoCount = 1;
+	submitInfo.pCommandBufferInfos = &cmdInfo;
+	submitInfo.signalSemaphoreInfoCount = 1;
+	submitInfo.pSignalSemaphoreInfos = &signalInfo;
+
+	if (vkQueueSubmit2(m_context.getGraphicsQueue(), 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to submit upload acquire batch!");
+	}
+
+	m_acquiresInFlight.emplace_back(value, cmd);
+}
+
+bool UploadManager::tryAllocate(VkDeviceSize size, VkDeviceSize alignment, StagingAllocation& out)
+{
+	// Space between the head and the oldest live allocation is free. An allocation that doesn't fit
+	// before the end of the ring starts over at 0 and the skipped tail counts as used until its batch retires.
+	VkDeviceSize offset = (m_head + alignment - 1) & ~(alignment - 1);
+	VkDeviceSize consumed = offset + size - m_head;
+	if (offset + size > m_capacity)
+	{
+		offset = 0;
+		consumed = m_capacity - m_head + size;
+	}
+
+	if (m_used + consumed > m_capacity)
+	{
+		return false;
+	}
+
+	m_head = offset + size;
+	m_used += consumed;
+	m_pending.ringBytes += consumed;
+
+	m_stats.ringBytesInUse = m_used;
+	m_stats.ringPeakBytes = std::max(m_stats.ringPeakBytes, m_used);
+
+	out = { m_ringBuffer, m_ringAllocation, offset, m_ringMapped + offset };
+	return true;
+}
+
+UploadManager::StagingAllocation UploadManager::allocate(VkDeviceSize size, VkDeviceSize alignment)
+{
+	StagingAllocation staging{};
+	if (size <= m_capacity)
+	{
+		if (tryAllocate(size, alignment, staging))
+		{
+			return staging;
+		}
+
+		// Ring is full: submit what is recorded and wait for the oldest batches until the request fits
+		++m_stats.stalls;
+		flush();
+		while (!tryAllocate(size, alignment, staging))
+		{
+			if (m_inFlight.empty())
+			{
+				throw std::runtime_error("Staging ring allocation failed");
+			}
+			retire(true);
+		}
+		return staging;
+	}
+
+	// Too large for the ring, gets its own staging buffer that lives until the batch completes
+	VkBufferCreateInfo bufferInfo{};
+	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferInfo.size = size;
+	bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+	bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	VmaAllocationCreateInfo allocInfo{};
+	allocInfo.usage = VMA_MEMORY_USAGE_AUTO;
+	allocInfo.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT;
+
+	VmaAllocationInfo allocationInfo{};
+	if (vmaCreateBuffer(m_context.getAllocator(), &bufferInfo, &allocInfo, &staging.buffer, &staging.allocation, &allocationInfo) != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to create dedicated staging buffer");
+	}
+	nameObject(m_context.getDevice(), staging.buffer, "Buffer_StagingDedicated");
+
+	staging.offset = 0;
+	staging.mapped = static_cast<std::byte*>(allocationInfo.pMappedData);
+	m_pending.dedicated.emplace_back(staging.buffer, staging.allocation);
+	++m_stats.dedicatedBuffers;
+	return staging;
+}
+
+VkCommandBuffer UploadManager::pendingCommands()
+{
+	if (m_pending.cmd == VK_NULL_HANDLE)
+	{
+		m_pending.cmd = beginCommands(m_transferPool, m_freeTransferCommands, "CommandBuffer_Upload");
+	}
+	return m_pending.cmd;
+}
+
+VkCommandBuffer UploadManager::beginCommands(VkCommandPool pool, std::vector<VkCommandBuffer>& freeList, const char* name)
+{
+	if (freeList.empty())
+	{
+		VkCommandBufferAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		allocInfo.commandPool = pool;
+		allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		allocInfo.commandBufferCount = 1;
+
+		VkCommandBuffer cmd;
+		if (vkAllocateCommandBuffers(m_context.getDevice(), &allocInfo, &cmd) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to allocate upload command buffer!");
+		}
+		nameObject(m_context.getDevice(), cmd, name);
+		freeList.push_back(cmd);
+	}
+	VkCommandBuffer cmd = freeList.back();
+	freeList.pop_back();
+
+	// Begin implicitly resets the recycled buffer
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+	if (vkBeginCommandBuffer(cmd, &beginInfo) != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to begin upload command buffer!");
+	}
+	return cmd;
+}
+
+void UploadManager::retire(bool waitForOldest)
+{
+	VkDevice device = m_context.getDevice();
+
+	if (waitForOldest && !m_inFlight.empty())
+	{
+		VkSemaphoreWaitInfo waitInfo{};
+		waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+		waitInfo.semaphoreCount = 1;
+		waitInfo.pSemaphores = &m_transferTimeline;
+		waitInfo.pValues = &m_inFlight.front().value;
+		vkWaitSemaphores(device, &waitInfo, UINT64_MAX);
+	}
+
+	// Batches complete in submission order, so ring space is released front to back. Ring space only
+	// depends on the copies, acquire batches are recycled separately once the graphics queue ran them.
+	uint64_t transferValue = 0;
+	vkGetSemaphoreCounterValue(device, m_transferTimeline, &transferValue);
+
+	while (!m_inFlight.empty() && m_inFlight.front().value <= transferValue)
+	{
+		Batch& batch = m_inFlight.front();
+
+		m_used -= batch.ringBytes;
+		m_windowBytes += batch.uploadBytes;
+
+		m_freeTransferCommands.push_back(batch.cmd);
+
+		for (const auto& [buffer, allocation] : batch.dedicated)
+		{
+			vmaDestroyBuffer(m_context.getAllocator(), buffer, allocation);
+		}
+
+		m_inFlight.pop_front();
+	}
+
+	if (!m_acquiresInFlight.empty())
+	{
+		uint64_t graphicsValue = 0;
+		vkGetSemaphoreCounterValue(device, m_graphicsTimeline, &graphicsValue);
+
+		while (!m_acquiresInFlight.empty() && m_acquiresInFlight.front().first <= graphicsValue)
+		{
+			m_freeGraphicsCommands.push_back(m_acquiresInFlight.front().second);
+			m_acquiresInFlight.pop_front();
+		}
+	}
+
+	// An empty ring starts over at 0, large uploads then never need to wrap
+	if (m_used == 0)
+	{
+		m_head = 0;
+	}
+	m_stats.ringBytesInUse = m_used;
+
+	double time = now();
+	if (time - m_windowStart >= 1.0)
+	{
+		m_stats.throughput = m_windowBytes / (time - m_windowStart);
+		m_windowStart = time;
+		m_windowBytes = 0;
+	}
+}
@@ -0,0 +1,164 @@
+#include "VertexPacker.hpp"
+
+#include <gtc/packing.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <execution>
+#include <iostream>
+
+namespace
+{
+	int16_t toSnorm16(float value)
+	{
+		return static_cast<int16_t>(std::round(std::clamp(value, -1.0f, 1.0f) * 32767.0f));
+	}
+
+	uint16_t toUnorm16(float value)
+	{
+		return static_cast<uint16_t>(std::round(std::clamp(value, 0.0f, 1.0f) * 65535.0f));
+	}
+
+	// Sign that maps 0 to +1, keeps the octahedral fold continuous on the axes
+	glm::vec2 signNotZero(const glm::vec2& v)
+	{
+		return { v.x >= 0.0f ? 1.0f : -1.0f, v.y >= 0.0f ? 1.0f : -1.0f };
+	}
+}
+
+VertexFormat VertexPacker::chooseFormat(std::span<const Vertex> vertices, bool hasNormalMaps)
+{
+	for (const Vertex& vertex : vertices)
+	{
+		if (std::abs(vertex.texCoord.x) >= MAX_PACKED_UV || std::abs(vertex.texCoord.y) >= MAX_PACKED_UV)
+		{
+			return VertexFormat::Float;
+		}
+	}
+	return hasNormalMaps ? VertexFormat::Packed : VertexFormat::PackedNoTangent;
+}
+
+std::vector<std::byte> VertexPacker::buildVertexStream(std::span<const Vertex> vertices, std::span<Mesh> meshes, std::vector<MeshGPUData>& meshData)
+{
+	// Byte offset of every mesh, rounded up to its stride
+	std::vector<size_t> byteOffsets(meshes.size());
+	size_t streamSize = 0;
+	for (size_t i = 0; i < meshes.size(); ++i)
+	{
+		const size_t stride = Vertex::getStride(meshes[i].vertexFormat);
+		streamSize = (streamSize + stride - 1) / stride * stride;
+
+		byteOffsets[i] = streamSize;
+		meshes[i].gpuVertexOffset = static_cast<uint32_t>(streamSize / stride);
+		streamSize += meshes[i].vertexCount * stride;
+	}
+
+	std::vector<std::byte> stream(streamSize);
+	meshData.assign(meshes.size(), MeshGPUData{ glm::vec4(0.0f), glm::vec4(1.0f) });
+
+	// Meshes write disjoint ranges
+	std::vector<uint32_t> meshIndices(meshes.size());
+	for (uint32_t i = 0; i < meshIndices.size(); ++i)
+	{
+		meshIndices[i] = i;
+	}
+
+	std::for_each(std::execution::par, meshIndices.begin(), meshIndices.end(),
+		[&](uint32_t i)
+		{
+			const Mesh& mesh = meshes[i];
+			std::span<const Vertex> meshVertices = vertices.subspan(mesh.vertexOffset, mesh.vertexCount);
+
+			// Quantisation range from the vertices themselves, so every position lands inside [0, 1]
+			AABB bounds;
+			for (const Vertex& vertex : meshVertices)
+			{
+				bounds.expand(vertex.pos);
+			}
+			if (meshVertices.empty())
+			{
+				bounds = { glm::vec3(0.0f), glm::vec3(0.0f) };
+			}
+
+			if (mesh.vertexFormat != VertexFormat::Float)
+			{
+				meshData[i].positionOffset = glm::vec4(bounds.min, 0.0f);
+				meshData[i].positionScale = glm::vec4(bounds.max - bounds.min, 0.0f);
+			}
+
+			packVertices(meshVertices, bounds, mesh.vertexFormat, stream.data() + byteOffsets[i]);
+		});
+
+	uint32_t packedMeshes = 0;
+	uint32_t tangentlessMeshes = 0;
+	for (const Mesh& mesh : meshes)
+	{
+		packedMeshes += mesh.vertexFormat != VertexFormat::Float ? 1 : 0;
+		tangentlessMeshes += mesh.vertexFormat == VertexFormat::PackedNoTangent ? 1 : 0;
+	}
+
+	std::cout << "Vertex stream: " << streamSize / 1024 << " KB, " << vertices.size() * sizeof(Vertex) / 1024
+		<< " KB as float (" << packedMeshes << "/" << meshes.size() << " meshes packed, "
+		<< tangentlessMeshes << " without tangents)" << std::endl;
+
+	return stream;
+}
+
+void VertexPacker::packVertices(std::span<const Vertex> vertices, const AABB& bounds, VertexFormat format, std::byte* out)
+{
+	if (format == VertexFormat::Float)
+	{
+		std::memcpy(out, vertices.data(), vertices.size_bytes());
+		return;
+	}
+
+	const size_t stride = Vertex::getStride(format);
+	const glm::vec3 extent = bounds.max - bounds.min;
+
+	for (size_t v = 0; v < vertices.size(); ++v)
+	{
+		const Vertex& vertex = vertices[v];
+		PackedVertex packed{};
+
+		// Flat axes have no extent and decode to the offset
+		for (int c = 0; c < 3; ++c)
+		{
+			packed.pos[c] = extent[c] > 0.0f ? toUnorm16((vertex.pos[c] - bounds.min[c]) / extent[c]) : 0;
+		}
+		packed.pos[3] = vertex.tangent.w < 0.0f ? 0 : 65535;
+
+		glm::vec2 normal = encodeOctahedral(vertex.normal);
+		packed.normal[0] = toSnorm16(normal.x);
+		packed.normal[1] = toSnorm16(normal.y);
+
+		packed.texCoord[0] = glm::packHalf1x16(vertex.texCoord.x);
+		packed.texCoord[1] = glm::packHalf1x16(vertex.texCoord.y);
+
+		glm::vec2 tangent = encodeOctahedral(glm::vec3(vertex.tangent));
+		packed.tangent[0] = toSnorm16(tangent.x);
+		packed.tangent[1] = toSnorm16(tangent.y);
+
+		// PackedNoTangent copies the leading 16 bytes only
+		std::memcpy(out + v * stride, &packed, stride);
+	}
+}
+
+glm::vec2 VertexPacker::encodeOctahedral(const glm::vec3& direction)
+{
+	float l1 = std::abs(direction.x) + std::abs(direction.y) + std::abs(direction.z);
+	if (l1 <= 0.0f)
+	{
+		return glm::vec2(0.0f);
+	}
+
+	glm::vec3 n = direction / l1;
+	glm::vec2 encoded(n.x, n.y);
+
+	// Fold the lower hemisphere over the diagonals
+	if (n.z < 0.0f)
+	{
+		encoded = (1.0f - glm::abs(glm::vec2(n.y, n.x))) * signNotZero(encoded);
+	}
+	return encoded;
+}
@@ -0,0 +1,91 @@
+#include "VertexWelder.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstring>
+
+VertexWelder::VertexWelder(std::vector<Vertex>& vertices, size_t expectedCorners)
+	: m_vertices(vertices)
+{
+	// Keep the load factor at or below 0.5 even if every corner turns out to be unique
+	rehash(std::bit_ceil(std::max<size_t>(expectedCorners * 2, 16)));
+}
+
+uint64_t VertexWelder::hash(const Vertex& vertex)
+{
+	// pos, normal and texCoord are the first 8 floats of Vertex. Adding 0.0f turns -0.0 into +0.0
+	// so the hash agrees with Vertex::operator==, which treats them as equal.
+	static_assert(offsetof(Vertex, texCoord) + sizeof(glm::vec2) == 8 * sizeof(float));
+	float key[8] = {
+		vertex.pos.x + 0.0f, vertex.pos.y + 0.0f, vertex.pos.z + 0.0f,
+		vertex.normal.x + 0.0f, vertex.normal.y + 0.0f, vertex.normal.z + 0.0f,
+		vertex.texCoord.x + 0.0f, vertex.texCoord.y + 0.0f
+	};
+
+	uint64_t words[4];
+	memcpy(words, key, sizeof(words));
+
+	// Multiply-rotate mixing of each word with a splitmix64 finalizer, every input bit reaches every output bit
+	uint64_t h = 0x9E3779B97F4A7C15ull;
+	for (uint64_t word : words)
+	{
+		h ^= word * 0xBF58476D1CE4E5B9ull;
+		h = std::rotl(h, 27) * 0x94D049BB133111EBull;
+	}
+	h ^= h >> 31;
+	h *= 0xBF58476D1CE4E5B9ull;
+	h ^= h >> 29;
+	return h;
+}
+
+uint32_t VertexWelder::weld(const Vertex& vertex)
+{
+	if ((m_count + 1) * 2 > m_slots.size())
+	{
+		rehash(m_slots.size() * 2);
+	}
+
+	const uint64_t h = hash(vertex);
+	const uint32_t tag = static_cast<uint32_t>(h >> 32);
+
+	for (size_t slotIndex = h & m_mask; ; slotIndex = (slotIndex + 1) & m_mask)
+	{
+		Slot& slot = m_slots[slotIndex];
+		if (slot.index == EMPTY)
+		{
+			slot.tag = tag;
+			slot.index = static_cast<uint32_t>(m_vertices.size());
+			m_vertices.push_back(vertex);
+			++m_count;
+			return slot.index;
+		}
+
+		if (slot.tag == tag && m_vertices[slot.index] == vertex)
+		{
+			return slot.index;
+		}
+	}
+}
+
+void VertexWelder::rehash(size_t capacity)
+{
+	std::vector<Slot> oldSlots = std::move(m_slots);
+	m_slots.assign(capacity, Slot{});
+	m_mask = capacity - 1;
+
+	for (const Slot& old : oldSlots)
+	{
+		if (old.index == EMPTY)
+		{
+			continue;
+		}
+
+		size_t slotIndex = hash(m_vertices[old.index]) & m_mask;
+		while (m_slots[slotIndex].index != EMPTY)
+		{
+			slotIndex = (slotIndex + 1) & m_mask;
+		}
+		m_slots[slotIndex] = old;
+	}
+}
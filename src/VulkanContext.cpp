@@ -38,6 +38,10 @@ VulkanContext::VulkanContext(GLFWwindow* window) : m_window(window)
 	nameObject(m_device, m_physicalDevice, "PhysicalDevice");
 	nameObject(m_device, m_surface, "Surface");
 	nameObject(m_device, m_graphicsQueue, "Queue_Graphics");
+	if (hasAsyncTransferQueue())
+	{
+		nameObject(m_device, m_transferQueue, "Queue_Transfer");
+	}
 }
 
 VulkanContext::~VulkanContext()
@@ -212,36 +216,98 @@ void VulkanContext::pickPhysicalDevice()
 	if (qf.queueFlags & VK_QUEUE_COMPUTE_BIT)   std::cout << "    - Compute" << std::endl;
 	if (qf.queueFlags & VK_QUEUE_TRANSFER_BIT)  std::cout << "    - Transfer" << std::endl;
 	if (qf.queueFlags & VK_QUEUE_SPARSE_BINDING_BIT) std::cout << "    - Sparse binding" << std::endl;
+
+	// Transfer: a family without graphics runs on the copy engines, next to rendering. Transfer-only families
+	// are the DMA engines and preferred over async compute. Whole mip levels are always copied, so any
+	// minImageTransferGranularity works.
+	for (uint32_t i = 0; i < families.size(); ++i)
+	{
+		VkQueueFlags flags = families[i].queueFlags;
+		if (flags & VK_QUEUE_GRAPHICS_BIT)
+		{
+			continue;
+		}
+
+		if ((flags & VK_QUEUE_TRANSFER_BIT) && !(flags & VK_QUEUE_COMPUTE_BIT))
+		{
+			m_transferQueueFamilyIndex = static_cast<int32_t>(i);
+			break;
+		}
+		if (m_transferQueueFamilyIndex == -1 && (flags & VK_QUEUE_COMPUTE_BIT))
+		{
+			m_transferQueueFamilyIndex = static_cast<int32_t>(i);
+		}
+	}
+
+	// Else a second queue of the graphics family, else uploads share the graphics queue
+	if (m_transferQueueFamilyIndex == -1)
+	{
+		m_transferQueueFamilyIndex = m_graphicsQueueFamilyIndex;
+		m_transferQueueIndex = qf.queueCount > 1 ? 1 : 0;
+	}
+
+	std::cout << "Transfer queue family index: " << m_transferQueueFamilyIndex << ", queue index: " << m_transferQueueIndex << std::endl;
 }
 
 void VulkanContext::createLogicalDevice()
 {
-	float priority = 1.0f;
-	VkDeviceQueueCreateInfo queueCreateInfo{};
-	queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
-	queueCreateInfo.queueFamilyIndex = m_graphicsQueueFamilyIndex;
-	queueCreateInfo.queueCount = 1;
-	queueCreateInfo.pQueuePriorities = &priority;
+	float priorities[] = { 1.0f, 1.0f };
+	VkDeviceQueueCreateInfo queueCreateInfos[2]{};
+	uint32_t queueCreateInfoCount = 1;
+
+	queueCreateInfos[0].sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+	queueCreateInfos[0].queueFamilyIndex = m_graphicsQueueFamilyIndex;
+	queueCreateInfos[0].queueCount = 1;
+	queueCreateInfos[0].pQueuePriorities = priorities;
+
+	if (m_transferQueueFamilyIndex != m_graphicsQueueFamilyIndex)
+	{
+		queueCreateInfos[1] = queueCreateInfos[0];
+		queueCreateInfos[1].queueFamilyIndex = m_transferQueueFamilyIndex;
+		queueCreateInfoCount = 2;
+	}
+	else
+	{
+		queueCreateInfos[0].queueCount = m_transferQueueIndex + 1;
+	}
+
+	VkPhysicalDeviceVulkan12Features supportedVulkan12Features{};
+	supportedVulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+
+	VkPhysicalDeviceFeatures2 supportedFeatures{};
+	supportedFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+	supportedFeatures.pNext = &supportedVulkan12Features;
+	vkGetPhysicalDeviceFeatures2(m_physicalDevice, &supportedFeatures);
+	m_textureCompressionBC = supportedFeatures.features.textureCompressionBC == VK_TRUE;
+	m_depthClamp = supportedFeatures.features.depthClamp == VK_TRUE;
+	m_drawIndirectCount = supportedFeatures.features.multiDrawIndirect == VK_TRUE && supportedVulkan12Features.drawIndirectCount == VK_TRUE;
 
 	VkPhysicalDeviceFeatures features{};
 	features.samplerAnisotropy = VK_TRUE;
 	features.sampleRateShading = VK_TRUE;
 	features.fillModeNonSolid = VK_TRUE;
-
-	// Enable Descriptor Indexing
-	VkPhysicalDeviceDescriptorIndexingFeatures descriptorIndexingFeatures{};
-	descriptorIndexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES;
-	descriptorIndexingFeatures.runtimeDescriptorArray = VK_TRUE;
-	descriptorIndexingFeatures.descriptorBindingPartiallyBound = VK_TRUE;
-	descriptorIndexingFeatures.shaderUniformBufferArrayNonUniformIndexing = VK_TRUE;
-	descriptorIndexingFeatures.shaderStorageBufferArrayNonUniformIndexing = VK_TRUE;
-	descriptorIndexingFeatures.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+	features.textureCompressionBC = supportedFeatures.features.textureCompressionBC;
+	features.multiDrawIndirect = m_drawIndirectCount ? VK_TRUE : VK_FALSE;
+	features.depthClamp = m_depthClamp ? VK_TRUE : VK_FALSE;
+
+	// Enable Descriptor Indexing, Timeline Semaphores (uploads on the transfer queue hand off to the graphics queue with them)
+	// and Draw Indirect Count for the GPU-driven path
+	VkPhysicalDeviceVulkan12Features vulkan12Features{};
+	vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+	vulkan12Features.runtimeDescriptorArray = VK_TRUE;
+	vulkan12Features.descriptorBindingPartiallyBound = VK_TRUE;
+	vulkan12Features.shaderUniformBufferArrayNonUniformIndexing = VK_TRUE;
+	vulkan12Features.shaderStorageBufferArrayNonUniformIndexing = VK_TRUE;
+	vulkan12Features.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+	vulkan12Features.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+	vulkan12Features.timelineSemaphore = VK_TRUE;
+	vulkan12Features.drawIndirectCount = m_drawIndirectCount ? VK_TRUE : VK_FALSE;
 
 	// Enable Extended Dynamic State 3
 	VkPhysicalDeviceExtendedDynamicState3FeaturesEXT extendedDynamicState3Features{};
 	extendedDynamicState3Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_3_FEATURES_EXT;
 	extendedDynamicState3Features.extendedDynamicState3PolygonMode = VK_TRUE;
-	extendedDynamicState3Features.pNext = &descriptorIndexingFeatures;
+	extendedDynamicState3Features.pNext = &vulkan12Features;
 
 	// Enable Dynamic Rendering
 	VkPhysicalDeviceDynamicRenderingFeatures dynamicRenderingFeatures{};
@@ -258,8 +324,8 @@ void VulkanContext::createLogicalDevice()
 	VkDeviceCreateInfo deviceCreateInfo{};
 	deviceCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
 	deviceCreateInfo.pNext = &synchronization2Features;
-	deviceCreateInfo.pQueueCreateInfos = &queueCreateInfo;
-	deviceCreateInfo.queueCreateInfoCount = 1;
+	deviceCreateInfo.pQueueCreateInfos = queueCreateInfos;
+	deviceCreateInfo.queueCreateInfoCount = queueCreateInfoCount;
 	deviceCreateInfo.pEnabledFeatures = &features;
 
 	const char* deviceExt[] = { VK_KHR_SWAPCHAIN_EXTENSION_NAME, VK_EXT_EXTENDED_DYNAMIC_STATE_3_EXTENSION_NAME };
@@ -272,6 +338,7 @@ void VulkanContext::createLogicalDevice()
 	}
 
 	vkGetDeviceQueue(m_device, m_graphicsQueueFamilyIndex, 0, &m_graphicsQueue);
+	vkGetDeviceQueue(m_device, m_transferQueueFamilyIndex, m_transferQueueIndex, &m_transferQueue);
 
 	std::cout << "Logical device and graphics queue created successfully" << std::endl;
 }
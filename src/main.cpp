@@ -5,9 +5,11 @@
 #include <unordered_map>
 #include <unordered_set>
 #include <algorithm>
+#include <memory>
 #include <filesystem>
 #include <execution> // C++ 17 parallel algorithms
 #include <ranges>
+#include <span>
 
 #include "soloud.h"
 #include "soloud_wav.h"
@@ -15,37 +17,55 @@
 
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
-#define TINYOBJLOADER_IMPLEMENTATION
 
 #include "glm.hpp"
 #include "gtc/matrix_transform.hpp"
 #include "chrono"
-#include <tiny_obj_loader.h>
 
 #include "VulkanContext.hpp" // Instance, device, surface, debug messenger
 #include "Swapchain.hpp" // Swapchain, image views
 #include "Commands.hpp" // Command pool & Command buffers
+#include "UploadManager.hpp" // Staging ring shared by all uploads
 #include "GPUBuffer.hpp" // Vertex, index, uniform, storage buffers
 #include "GPUImage.hpp" // TextureImage, SwapchainDepthImage, Shadowmaps, MSAAImage
 #include "DescriptorManager.hpp" // Bindless descriptors
 #include "Pipeline.hpp" // Shaders, pipeline layout, pipeline
 #include "Sync.hpp" // Semaphores & Fences
 #include "Vertex.hpp" // Vertex definiton
+#include "VertexPacker.hpp" // Per-mesh packed vertex formats
+#include "IndexPacker.hpp" // 16-bit and 32-bit index arenas
 #include "DebugVertex.hpp" // Vertex data for debug AABB
 #include "Utils.hpp" // Helper functions
 #include "ImGuiOverlay.hpp" // User Interface
 #include "Camera.hpp" // Free camera
 #include "Lights.hpp" // Light types
 #include "Frustum.hpp" // Camera frustum data
+#include "FrustumCuller.hpp" // SIMD culling of world bounds
+#include "BVH.hpp" // Bounding volume hierarchy over object bounds
+#include "OcclusionCuller.hpp" // CPU depth rasterizer for occlusion tests
+#include "GPUCuller.hpp" // Compute culling and indirect draws
+#include "DrawLists.hpp" // Instanced draw commands of the visible objects
 #include "AABB.hpp" // Axis-Aligned Bounding Boxes
-#include "TangentGen.hpp" // Use MikkTSpace standard to generate tangents
+#include "Mesh.hpp" // Mesh, Submesh and Material records
+#include "ModelLoader.hpp" // Parallel OBJ import and mesh cache
+#include "SceneFile.hpp" // Text and binary scene files, object and light layouts
 #include "ShadowCascades.hpp" // For Cascaded Shadow Maps
+#include "ScopedTimer.hpp" // CPU timing
+#include "Benchmarks.hpp" // CPU micro-benchmarks, enabled with RUN_BENCHMARKS
 
 // Audio test
 SoLoud::Soloud gSoLoud; // SoLoud engine
 SoLoud::Wav gWave; // Audio item
 
 static constexpr int MAX_FRAMES_IN_FLIGHT = 2;
+static constexpr VkDeviceSize STAGING_RING_BYTES = 64ull << 20;
+static constexpr VkDeviceSize TEXTURE_STREAMING_BUDGET = 512ull << 20;
+static constexpr size_t VERTEX_FORMAT_COUNT = static_cast<size_t>(VertexFormat::Count);
+static constexpr uint32_t MESHLET_CULL_MAX_INSTANCES = 4; // larger instanced draws stay whole, splitting them costs more draws than it saves
+static constexpr uint32_t MESHLET_CULL_MIN_MESHLETS = 8; // below this a draw is already about as small as its meshlets
+static constexpr uint32_t MAX_AUTO_OCCLUDERS = 8; // largest visible objects rasterized as occluders besides the authored ones
+static constexpr float OCCLUDER_MIN_SCREEN_RADIUS = 0.25f; // bounding sphere radius over the screen's half height an auto occluder needs
+static constexpr uint32_t OCCLUDER_TRIANGLE_BUDGET = 65536; // auto occluders that would take the frame past this are skipped
 uint32_t currentFrame = 0;
 
 struct PushConstants
@@ -84,72 +104,28 @@ struct ShadowPushConstants {
 	uint32_t padding2;
 } shadowPC;
 
-struct LightingData
-{
-	DirectionalLight dirLight;
-	uint32_t numPointLights = 0;
-	alignas(16) PointLight pointLights[128];
-} lights;
-
-struct Submesh
-{
-	uint32_t indexOffset;
-	uint32_t indexCount;
-	uint32_t materialIndex;
-	AABB bounds; // submesh-level AABB will be used for collision
-	uint32_t padding = 0;
-};
-
-struct Mesh
-{
-	uint32_t vertexOffset;
-	uint32_t vertexCount;
-	uint32_t submeshOffset;
-	uint32_t submeshCount;
-	AABB bounds; // used for frustum culling
-};
-
-struct Material
-{
-	uint32_t albedoTexture;
-	uint32_t normalTexture;
-	uint32_t specularTexture;
-
-	uint32_t twosided; // cull none, otherwise cull backface
-	uint32_t alphatest; // for foliage
-	uint32_t alphablending; // for windows
-
-	float shininess;
-	float reflectionStrength;
-	float specularStrength;
-	float alphaThreshold;
-};
-
-struct ObjectData
-{
-	glm::mat4 model;
-	uint32_t meshIndex;
-	uint32_t isVisible = 0; // set by frustum culling or game logic
-	uint32_t padding2 = 0;
-	uint32_t padding3 = 0;
-};
+LightingData lights;
 std::vector<ObjectData> objectData{};
 
-struct DrawCommand
-{
-	uint32_t indexCount;
-	uint32_t instanceCount;
-	uint32_t firstIndex;
-	int32_t vertexOffset;
-	uint32_t firstInstance;
-	Material material;
-	std::vector<uint32_t> objectIndices;
-};
-
-struct DrawLists
+// Results of the last frame that ran culling, reused while the views and settings are the same and nothing moved inside a view
+struct VisibilityCache
 {
-	std::vector<std::vector<DrawCommand>> opaque;
-	std::vector<std::vector<DrawCommand>> transparent;
+	bool valid = false;
+	glm::mat4 viewProj{ 1.0f };
+	Frustum cullingFrustum{};
+	std::array<glm::mat4, ShadowCascades::NUM_CASCADES> cascadeViewProjs{};
+	float viewportHeight = 0.0f;
+	uint32_t settings = 0; // culling toggles, see cullSettings in the frame loop
+
+	std::vector<uint32_t> visibleObjects; // camera's culled set, texture demand is requested from it every frame
+	std::vector<uint32_t> globalVisibleIndices;
+	DrawLists drawLists;
+	std::vector<std::vector<DrawCommand>> culledOpaque;
+	std::array<std::vector<std::vector<DrawCommand>>, ShadowCascades::NUM_CASCADES> cascadeOpaque;
+	std::array<uint32_t, ShadowCascades::NUM_CASCADES> cascadeCasterCounts{};
+	std::vector<uint32_t> frameVisibleIndices; // camera list followed by the cascades', as uploaded
+	uint32_t cpuCullReference = 0; // objects the CPU finds visible among those the GPU path draws, counted while the stats window is open
+	uint64_t version = 0; // bumped by every cull, frame slots upload the lists when theirs is older
 };
 
 // Uses 720p as a safe default, increase if you would like a higher resolution
@@ -166,34 +142,13 @@ struct AppState
 
 Camera camera;
 
-struct SceneConfig {
-	float nearPlane;
-	float farPlane;
-	std::string skybox;
-};
-extern SceneConfig scene;
-
-// Timer for CPU benchmarking
-using Clock = std::chrono::high_resolution_clock;
-using ms = std::chrono::duration<double, std::milli>;
-struct ScopedTimer
-{
-	const char* label;
-	Clock::time_point start;
-
-	ScopedTimer(const char* lbl) : label(lbl), start(Clock::now()) {}
-	~ScopedTimer()
-	{
-		auto end = Clock::now();
-		double elapsed = std::chrono::duration_cast<ms>(end - start).count();
-		std::cout << label << ": " << elapsed << " ms" << std::endl;
-	}
-};
+SceneDescription scene;
 
 std::vector<Vertex> allVertices{};
 std::vector<uint32_t> allIndices{};
 std::vector<Mesh> allMeshes{};
 std::vector<Submesh> allSubmeshes{};
+std::vector<Meshlet> allMeshlets{};
 std::vector<Material> allMaterials{};
 
 GLFWwindow* createWindow(AppState& appState);
@@ -202,53 +157,88 @@ void scrollCallback(GLFWwindow* window, double xoffset, double yoffset);
 void mouseCallback(GLFWwindow* window, double xpos, double ypos);
 void processInput(GLFWwindow* window, float deltaTime);
 
-uint32_t loadModel(const std::string& modelPath, GPUImage& imageClass);
-
-enum class MeshType
-{
-	LightCaster,
-	Sponza,
-	Grass,
-	GlassWindow,
-	GroundPlane,
-	Cube,
-	BrickWall,
-	SnakeStatue,
-	Terrain
-};
-
-void setupSceneObjects(std::vector<ObjectData>& objectData);
-void setupLighting(LightingData& lights);
-
-void updateLighting(LightingData& lights, float deltaTime);
-void updateObjects(std::vector<ObjectData>& objectData, const LightingData& lights, float deltaTime);
-
-std::vector<uint32_t> performFrustumCulling(std::vector<ObjectData>& objectData, const std::vector<Mesh>& allMeshes, const Frustum& frustum);
-DrawLists buildDrawCommands(
+void updateLighting(LightingData& lights, const SceneDescription& scene, float time);
+void updateObjects(std::vector<ObjectData>& objectData, BVH& bvh, FrustumCuller& culler, const std::vector<Mesh>& allMeshes, const SceneDescription& scene, float time,
+	std::vector<AABB>& dirtyBounds);
+
+std::vector<uint32_t> performFrustumCulling(const BVH& bvh, FrustumCuller& culler, std::vector<ObjectData>& objectData,
+	std::vector<uint32_t>& flaggedIndices, const Frustum& frustum, bool useBVH);
+bool boundsIntersectViews(const std::vector<AABB>& bounds, const Frustum& cameraFrustum, const std::array<Frustum, ShadowCascades::NUM_CASCADES>& cascadeFrustums);
+std::array<Frustum, ShadowCascades::NUM_CASCADES> getCascadeFrustums(const std::vector<ShadowCascades::CascadeData>& cascades, bool extendToLight);
+std::array<std::vector<uint32_t>, ShadowCascades::NUM_CASCADES> performShadowCasterCulling(const BVH& bvh, FrustumCuller& culler,
+	const std::array<Frustum, ShadowCascades::NUM_CASCADES>& cascadeFrustums, bool useBVH);
+void performOcclusionCulling(OcclusionCuller& culler, std::vector<uint32_t>& globalVisibleIndices, std::vector<ObjectData>& objectData,
+	const BVH& bvh, const SceneDescription& scene,
+	const std::vector<Vertex>& allVertices, const std::vector<uint32_t>& allIndices,
+	const std::vector<Mesh>& allMeshes, const std::vector<Submesh>& allSubmeshes, const std::vector<Material>& allMaterials,
+	const glm::mat4& viewProj, const glm::vec3& cameraPos, float fovY);
+void requestTextureDetail(GPUImage& image, const std::vector<uint32_t>& globalVisibleIndices, const std::vector<ObjectData>& objectData,
+	const std::vector<Mesh>& allMeshes, const std::vector<Submesh>& allSubmeshes, const std::vector<Material>& allMaterials,
+	const glm::vec3& cameraPos, float fovY, float viewportHeight);
+std::vector<std::vector<DrawCommand>> cullMeshlets(
+	const std::vector<std::vector<DrawCommand>>& opaque,
 	const std::vector<uint32_t>& globalVisibleIndices,
 	const std::vector<ObjectData>& objectData,
-	const std::vector<Mesh>& allMeshes,
-	const std::vector<Submesh>& allSubmeshes,
-	const std::vector<Material>& allMaterials);
+	const std::vector<Meshlet>& allMeshlets,
+	const Frustum& frustum,
+	const glm::vec3& cameraPos);
+void bindIndexArena(VkCommandBuffer cmd, const GPUBuffer& buffer, IndexFormat format);
 
 void generateDebugGeometry(std::vector<DebugVertex>& debugVertices,
-	const std::vector<uint32_t>& globalVisibleIndices,
+	std::span<const uint32_t> globalVisibleIndices,
 	const std::vector<ObjectData>& objectData,
 	const std::vector<Mesh>& allMeshes,
 	const std::vector<Submesh>& allSubmeshes,
 	bool showMeshAABB, bool showSubmeshAABB);
 std::vector<DebugVertex> generateAABBLines(const AABB& aabb, const glm::vec4& color);
 
+AABB get_world_aabb(const ObjectData& obj, const Mesh& mesh);
+bool check_collision(const ObjectData& objA, const ObjectData& objB, const std::vector<Mesh>& allMeshes);
+std::vector<uint32_t> find_collisions(const BVH& bvh, uint32_t objectIndex);
+
 void recreateSwapchainResources(VulkanContext& context, Swapchain& swapchain, GPUImage& image);
 
-// Scene Selection (Simply uncomment your desired scene, in V2 these files will be a JSON scene representation)
+// Scene selection, the first command line argument overrides it (.scene text or compiled .vkscene)
+static const std::string SCENES_DIRECTORY = "../Scenes";
+static const std::string DEFAULT_SCENE = SCENES_DIRECTORY + "/Outdoors.scene";
 
-//#include "../Scenes/CSMDemo.hpp"
-//#include "../Scenes/SponzaDemo.hpp"
-#include "../Scenes/Outdoors.hpp"
+// Uncomment to run the CPU micro-benchmarks instead of the renderer
+//#define RUN_BENCHMARKS
+//#define COOK_ASSETS
 
-int main()
+int main(int argc, char** argv)
 {
+#ifdef RUN_BENCHMARKS
+	Benchmarks::runAll();
+	return 0;
+#endif
+
+#ifdef COOK_ASSETS
+	// Compiles every scene and cooks the models they use, mesh and texture caches only, works on machines without a GPU
+	std::vector<std::string> cookPaths;
+	for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator(SCENES_DIRECTORY))
+	{
+		if (entry.path().extension() == ".scene")
+		{
+			SceneFile::load(entry.path(), scene, objectData, lights);
+			for (const std::string& modelPath : scene.modelPaths)
+			{
+				if (std::find(cookPaths.begin(), cookPaths.end(), modelPath) == cookPaths.end())
+				{
+					cookPaths.push_back(modelPath);
+				}
+			}
+		}
+	}
+	ModelLoader::cookAssets(cookPaths);
+	return 0;
+#endif
+
+	// Objects and lights come straight from the scene, only the models it references are loaded
+	SceneFile::load(argc > 1 ? argv[1] : DEFAULT_SCENE, scene, objectData, lights);
+	camera = Camera(scene.settings.cameraPosition, scene.settings.cameraYaw, scene.settings.cameraPitch);
+	camera.Zoom = scene.settings.fovY;
+
 	// Initialize GLFW & SoLoud
 	GLFWwindow* window = createWindow(appState);
 	gSoLoud.init();
@@ -257,9 +247,10 @@ int main()
 	VulkanContext context(window);
 	Swapchain swapchain(window, context);
 	Commands commands(context, MAX_FRAMES_IN_FLIGHT);
+	UploadManager uploads(context, STAGING_RING_BYTES);
 
 	// Create GPU Image resources
-	GPUImage image(context, commands);
+	GPUImage image(context, commands, uploads);
 	image.createDepthImage(swapchain.getExtent().width, swapchain.getExtent().height);
 	image.createMSAAColorImage(swapchain.getExtent().width, swapchain.getExtent().height, swapchain.getFormat());
 
@@ -279,40 +270,99 @@ int main()
 	};
 	image.createCubemap(skyBoxFaces);
 
-	// Load all models avaiable for use and their materials 
-	uint32_t lightCaster = loadModel("../Models/LightCaster/lightCaster.obj", image);
-	uint32_t sponza = loadModel("../Models/SponzaSeparated/sponzaAABB.obj", image);
-	uint32_t alphaTestedGrass = loadModel("../Models/Grass/untitled.obj", image);
-	uint32_t glassWindow = loadModel("../Models/GlassWindow/glassWindow.obj", image);
-	uint32_t groundPlane = loadModel("../Models/GroundPlane/groundPlane.obj", image);
-	uint32_t cube = loadModel("../Models/Cube/cube.obj", image);
-	uint32_t brickWall = loadModel("../Models/BrickWall/BrickWall.obj", image);
-	uint32_t snakeStatue = loadModel("../Models/SnakeStatue/SnakeStatue.obj", image);
-	uint32_t terrainMesh = loadModel("../Models/Terrain/Terrain.obj", image);
-
-	// Create buffers and populate scene
-	GPUBuffer buffer(context, commands, allVertices, allIndices, sizeof(ObjectData), MAX_FRAMES_IN_FLIGHT);
-
-	setupLighting(lights);
+	// Load all models and their materials, textures start at their mip tail and stream in by demand
+	image.enableTextureStreaming(TEXTURE_STREAMING_BUDGET, MAX_FRAMES_IN_FLIGHT);
+	ModelLoader modelLoader(image, allVertices, allIndices, allMeshes, allSubmeshes, allMeshlets, allMaterials);
+	const uint32_t firstMesh = modelLoader.loadModels(scene.modelPaths).front();
+
+	// Scene mesh indices count from the scene's first model
+	if (firstMesh != 0)
+	{
+		for (ObjectData& object : objectData)
+		{
+			object.meshIndex += firstMesh;
+		}
+	}
+
+	// Static objects keep the bounds the hierarchy and the flat culler start with, spinning ones are refit as they turn
+	BVH sceneBVH;
+	FrustumCuller frustumCuller;
+	{
+		std::vector<AABB> worldBounds(objectData.size());
+		for (uint32_t i = 0; i < objectData.size(); ++i)
+		{
+			worldBounds[i] = get_world_aabb(objectData[i], allMeshes[objectData[i].meshIndex]);
+		}
+		sceneBVH.build(worldBounds);
+		frustumCuller.setBounds(worldBounds);
+	}
+
+	// Create buffers and populate scene, every mesh is written in its own vertex format
+	std::vector<MeshGPUData> meshGPUData;
+	std::vector<std::byte> vertexStream = VertexPacker::buildVertexStream(allVertices, allMeshes, meshGPUData);
+	size_t wideIndexOffset = 0;
+	std::vector<std::byte> indexStream = IndexPacker::buildIndexStream(allIndices, allMeshes, wideIndexOffset);
+	GPUBuffer buffer(context, uploads, vertexStream, indexStream, wideIndexOffset, sizeof(ObjectData), MAX_FRAMES_IN_FLIGHT);
+	buffer.createMeshBuffer(meshGPUData);
+	uploads.flush();
+
 	buffer.createLightingBuffer(sizeof(LightingData));
 	buffer.updateLightingBuffer(&lights, sizeof(LightingData), currentFrame);
 
-	setupSceneObjects(objectData);
 	buffer.createObjectBuffer(objectData.size());
 	buffer.updateObjectBuffer(objectData.data(), objectData.size() * sizeof(ObjectData), currentFrame);
 
-	buffer.createVisibleIndexBuffer(objectData.size());
+	// The CPU writes the camera's visible objects followed by every cascade's casters, each view may add an instance
+	// list per submesh of multi-part meshes. The GPU-driven path writes the instance lists of the camera and every
+	// cascade behind them.
+	uint32_t viewVisibleIndexCount = 0;
+	for (const ObjectData& object : objectData)
+	{
+		const Mesh& mesh = allMeshes[object.meshIndex];
+		viewVisibleIndexCount += 1 + (mesh.submeshCount > 1 ? mesh.submeshCount : 0);
+	}
+	const uint32_t cpuVisibleIndexCount = viewVisibleIndexCount * (1 + ShadowCascades::NUM_CASCADES);
+	GPUCuller::Layout gpuCullLayout = GPUCuller::buildLayout(objectData, allMeshes, allSubmeshes, allMaterials, cpuVisibleIndexCount,
+		1 + ShadowCascades::NUM_CASCADES);
+	buffer.createVisibleIndexBuffer(cpuVisibleIndexCount + (context.supportsDrawIndirectCount() ? gpuCullLayout.viewCount * gpuCullLayout.instanceCount : 0));
 	buffer.createCascadeBuffer(sizeof(CascadeData));
 
 	// Setup descriptors and pipelines
 	DescriptorManager descriptors(context, buffer, image);
 	descriptors.updateTextureArray(image.getTextureViews(), image.getSampler());
 
-	Pipeline scenePipeline(context, swapchain, descriptors, sizeof(PushConstants), "../Shaders/vert.spv", "../Shaders/frag.spv", image.getDepthFormat(), PipelineType::Scene);
+	// Mesh pipelines exist once per vertex format (in VertexFormat order), every draw binds the one of its mesh
+	const std::array<std::string, VERTEX_FORMAT_COUNT> sceneVertexShaders = {
+		"../Shaders/vert.spv", "../Shaders/vert_packed.spv", "../Shaders/vert_packed_notangent.spv" };
+	const std::array<std::string, VERTEX_FORMAT_COUNT> shadowVertexShaders = {
+		"../Shaders/shadow_vert.spv", "../Shaders/shadow_vert_packed.spv", "../Shaders/shadow_vert_packed.spv" };
+
+	std::array<std::unique_ptr<Pipeline>, VERTEX_FORMAT_COUNT> scenePipelines;
+	std::array<std::unique_ptr<Pipeline>, VERTEX_FORMAT_COUNT> transparentPipelines;
+	std::array<std::unique_ptr<Pipeline>, VERTEX_FORMAT_COUNT> shadowPipelines;
+	for (size_t f = 0; f < VERTEX_FORMAT_COUNT; ++f)
+	{
+		VertexFormat format = static_cast<VertexFormat>(f);
+		scenePipelines[f] = std::make_unique<Pipeline>(context, swapchain, descriptors, sizeof(PushConstants), sceneVertexShaders[f], "../Shaders/frag.spv", image.getDepthFormat(), PipelineType::Scene, format);
+		transparentPipelines[f] = std::make_unique<Pipeline>(context, swapchain, descriptors, sizeof(PushConstants), sceneVertexShaders[f], "../Shaders/frag.spv", image.getDepthFormat(), PipelineType::Transparent, format);
+		shadowPipelines[f] = std::make_unique<Pipeline>(context, swapchain, descriptors, sizeof(ShadowPushConstants), shadowVertexShaders[f], "../Shaders/shadow_frag.spv", image.getDepthFormat(), PipelineType::ShadowMap, format);
+	}
+
+	// Variants of a pass share their layout and dynamic state, the Float ones stand in for all of them
+	Pipeline& scenePipeline = *scenePipelines[0];
+	Pipeline& transparentPipeline = *transparentPipelines[0];
+	Pipeline& shadowPipeline = *shadowPipelines[0];
+
 	Pipeline skyboxPipeline(context, swapchain, descriptors, sizeof(PushConstants), "../Shaders/skyboxvert.spv", "../Shaders/skyboxfrag.spv", image.getDepthFormat(), PipelineType::Skybox);
-	Pipeline transparentPipeline(context, swapchain, descriptors, sizeof(PushConstants), "../Shaders/vert.spv", "../Shaders/frag.spv", image.getDepthFormat(), PipelineType::Transparent);
 	Pipeline debugPipeline(context, swapchain, descriptors, sizeof(DebugPushConstants), "../Shaders/debug_vert.spv", "../Shaders/debug_frag.spv", image.getDepthFormat(), PipelineType::DebugAABB);
-	Pipeline shadowPipeline(context, swapchain, descriptors, sizeof(ShadowPushConstants), "../Shaders/shadow_vert.spv", "../Shaders/shadow_frag.spv", image.getDepthFormat(), PipelineType::ShadowMap);
+
+	// Without draw indirect count the CPU path is the only one
+	std::unique_ptr<GPUCuller> gpuCuller;
+	if (context.supportsDrawIndirectCount())
+	{
+		gpuCuller = std::make_unique<GPUCuller>(context, uploads, buffer, std::move(gpuCullLayout), static_cast<uint32_t>(objectData.size()),
+			MAX_FRAMES_IN_FLIGHT, "../Shaders/cull_comp.spv", "../Shaders/cull_draws_comp.spv");
+	}
 
 	// Setup syncronization and UI
 	Sync sync(context, swapchain, MAX_FRAMES_IN_FLIGHT);
@@ -329,6 +379,7 @@ int main()
 	}
 
 	//Debug labels
+	VkDebugUtilsLabelEXT cullPassLabel = makeLabel("GPU Cull Pass", 1.0f, 0.3f, 0.3f);
 	VkDebugUtilsLabelEXT shadowPassLabel = makeLabel("Shadow Pass", 0.0f, 1.0f, 1.0f);
 	VkDebugUtilsLabelEXT opaquePassLabel = makeLabel("Opaque Pass", 0.0f, 1.0f, 0.0f);
 	VkDebugUtilsLabelEXT skyboxPassLabel = makeLabel("Skybox Pass", 0.3f, 0.7f, 1.0f);
@@ -543,14 +594,45 @@ int main()
 		objectsByMesh[objectData[i].meshIndex].push_back(i);
 	}
 
+	// Blended submeshes are sorted and drawn by the CPU in both paths, the GPU-driven one culls only their objects
+	std::vector<uint8_t> meshHasBlending(allMeshes.size(), 0);
+	for (uint32_t m = 0; m < allMeshes.size(); ++m)
+	{
+		for (uint32_t s = 0; s < allMeshes[m].submeshCount; ++s)
+		{
+			meshHasBlending[m] |= allMaterials[allSubmeshes[allMeshes[m].submeshOffset + s].materialIndex].alphablending == 1 ? 1 : 0;
+		}
+	}
+	std::vector<uint32_t> blendedObjects;
+	for (uint32_t i = 0; i < objectData.size(); ++i)
+	{
+		if (meshHasBlending[objectData[i].meshIndex])
+		{
+			blendedObjects.push_back(i);
+		}
+	}
+	GPUCullStats gpuCullStats;
+	std::array<uint32_t, ShadowCascades::NUM_CASCADES> gpuCascadeCasterCounts{};
+
 	Frustum frustum;
 	Frustum frozenFrustum;
+	std::vector<uint32_t> flaggedIndices; // objects whose isVisible flag is set
+	OcclusionCuller occlusionCuller;
+
+	// Objects moved this frame (old and new bounds), and what every frame slot last uploaded
+	std::vector<AABB> dirtyBounds;
+	VisibilityCache visibility;
+	uint64_t objectVersion = 1; // bumped whenever object data changes
+	std::array<uint64_t, MAX_FRAMES_IN_FLIGHT> uploadedObjectVersions{};
+	std::array<uint64_t, MAX_FRAMES_IN_FLIGHT> uploadedVisibilityVersions{};
 
 	// Begin background music
 	// gSoLoud.play(gWave, 0.3f, 0.0f, 0.0);
 
 	ShadowCascades shadowCascades{};
 	double lastTime{};
+	float sceneTime = 0.0f;
+	uint64_t frameNumber = 0;
 
 	while (!glfwWindowShouldClose(window))
 	{
@@ -563,14 +645,19 @@ int main()
 		processInput(window, deltaTime);
 		imgui.newFrame();
 		imgui.drawUI();
-		updateLighting(lights, deltaTime);
-		updateObjects(objectData, lights, deltaTime);
+		sceneTime += deltaTime;
+		updateLighting(lights, scene, sceneTime);
+		updateObjects(objectData, sceneBVH, frustumCuller, allMeshes, scene, sceneTime, dirtyBounds);
+		if (!dirtyBounds.empty())
+		{
+			++objectVersion;
+		}
 
 		// Culling & Draw preperation
 		pc.view = camera.GetViewMatrix();
 		pc.proj = glm::perspective(glm::radians(camera.Zoom),
 			(float)appState.windowWidth / (float)appState.windowHeight,
-			scene.nearPlane, scene.farPlane);
+			scene.settings.nearPlane, scene.settings.farPlane);
 		pc.proj[1][1] *= -1; // Flip Y for Vulkan
 
 		// Calculate the new shadow cascade matrices based on the current camera view/proj
@@ -582,8 +669,8 @@ int main()
 			camera.Zoom,
 			(float)appState.windowWidth / (float)appState.windowHeight,
 			glm::normalize(glm::vec3(lights.dirLight.direction)),
-			scene.nearPlane,
-			scene.farPlane,
+			scene.settings.nearPlane,
+			scene.settings.farPlane,
 			imgui.cascadeLambda // Toggle lambda in ImGui (0.80f default)
 		);
 		const std::vector<ShadowCascades::CascadeData>& cascades = shadowCascades.getCascades();
@@ -605,21 +692,141 @@ int main()
 
 		// Choose the frustum to use for culling and perform culling, then build draw lists based on visibility
 		const Frustum& cullingFrustum = imgui.freezeFrustum ? frozenFrustum : frustum;
-		std::vector<uint32_t> globalVisibleIndices = performFrustumCulling(objectData, allMeshes, cullingFrustum);
-		DrawLists drawLists = buildDrawCommands(globalVisibleIndices, objectData, allMeshes, allSubmeshes, allMaterials);
+		const bool gpuDriven = imgui.enableGPUCulling && gpuCuller;
+		const std::array<Frustum, ShadowCascades::NUM_CASCADES> cascadeFrustums = getCascadeFrustums(cascades, context.supportsDepthClamp());
+		std::array<glm::mat4, ShadowCascades::NUM_CASCADES> cascadeViewProjs;
+		std::copy(std::begin(cascadeData.cascadeViewProjs), std::end(cascadeData.cascadeViewProjs), cascadeViewProjs.begin());
+
+		// A still camera over a still view keeps last frame's lists, objects moving outside every view don't matter
+		const uint32_t cullSettings = (imgui.enableBVHCulling ? 1u : 0u) | (imgui.enableOcclusionCulling ? 2u : 0u) |
+			(imgui.enableSubmeshCulling ? 4u : 0u) | (imgui.enableMeshletCulling ? 8u : 0u) | (gpuDriven ? 16u : 0u) |
+			(imgui.showCullingStats ? 32u : 0u);
+		const bool reuseVisibility = imgui.enableVisibilityReuse && visibility.valid &&
+			visibility.viewProj == viewProj && visibility.cullingFrustum == cullingFrustum &&
+			visibility.cascadeViewProjs == cascadeViewProjs && visibility.viewportHeight == (float)appState.windowHeight &&
+			visibility.settings == cullSettings && !boundsIntersectViews(dirtyBounds, cullingFrustum, cascadeFrustums);
+
+		std::vector<uint32_t>& globalVisibleIndices = visibility.globalVisibleIndices;
+		DrawLists& drawLists = visibility.drawLists;
+		std::vector<uint32_t>& frameVisibleIndices = visibility.frameVisibleIndices;
+		if (!reuseVisibility)
+		{
+			if (gpuDriven)
+			{
+				// Opaque geometry is culled and drawn by the GPU for the camera and every cascade. The CPU culls the objects
+				// with blended submeshes for the sorted pass, the whole scene only while streaming demand or the stats need it.
+				visibility.visibleObjects.clear();
+				visibility.cpuCullReference = 0;
+				if (image.isStreamingEnabled() || imgui.showCullingStats)
+				{
+					visibility.visibleObjects = performFrustumCulling(sceneBVH, frustumCuller, objectData, flaggedIndices, cullingFrustum, imgui.enableBVHCulling);
+					visibility.cpuCullReference = static_cast<uint32_t>(std::count_if(visibility.visibleObjects.begin(), visibility.visibleObjects.end(),
+						[&](uint32_t objectIndex) { return gpuCuller->drawsMesh(objectData[objectIndex].meshIndex); }));
+				}
+				globalVisibleIndices.clear();
+				for (uint32_t objectIndex : blendedObjects)
+				{
+					const AABB& bounds = sceneBVH.getBounds(objectIndex);
+					if (cullingFrustum.isBoxVisible(bounds.min, bounds.max))
+					{
+						globalVisibleIndices.push_back(objectIndex);
+					}
+				}
+
+				const Frustum* submeshFrustum = imgui.enableSubmeshCulling ? &cullingFrustum : nullptr;
+				drawLists = buildDrawCommands(globalVisibleIndices, objectData, allMeshes, allSubmeshes, allMaterials,
+					camera.Position, glm::radians(camera.Zoom), (float)appState.windowHeight, submeshFrustum);
+				drawLists.opaque.clear();
+				visibility.culledOpaque.clear();
+				for (uint32_t i = 0; i < ShadowCascades::NUM_CASCADES; ++i)
+				{
+					visibility.cascadeOpaque[i].clear();
+					visibility.cascadeCasterCounts[i] = 0;
+				}
+				frameVisibleIndices = globalVisibleIndices;
+			}
+			else
+			{
+				globalVisibleIndices = performFrustumCulling(sceneBVH, frustumCuller, objectData, flaggedIndices, cullingFrustum, imgui.enableBVHCulling);
+				if (imgui.enableOcclusionCulling)
+				{
+					performOcclusionCulling(occlusionCuller, globalVisibleIndices, objectData, sceneBVH, scene, allVertices, allIndices,
+						allMeshes, allSubmeshes, allMaterials, viewProj, camera.Position, glm::radians(camera.Zoom));
+				}
+				visibility.visibleObjects = globalVisibleIndices;
+
+				const Frustum* submeshFrustum = imgui.enableSubmeshCulling ? &cullingFrustum : nullptr;
+				drawLists = buildDrawCommands(globalVisibleIndices, objectData, allMeshes, allSubmeshes, allMaterials,
+					camera.Position, glm::radians(camera.Zoom), (float)appState.windowHeight, submeshFrustum);
+
+				// Camera pass only, meshlets facing away from the camera still cast shadows
+				visibility.culledOpaque.clear();
+				if (imgui.enableMeshletCulling)
+				{
+					visibility.culledOpaque = cullMeshlets(drawLists.opaque, globalVisibleIndices, objectData, allMeshlets, cullingFrustum, camera.Position);
+				}
+
+				// Every cascade draws the casters inside its own volume, their instance lists follow the camera's
+				std::array<std::vector<uint32_t>, ShadowCascades::NUM_CASCADES> cascadeCasters = performShadowCasterCulling(sceneBVH, frustumCuller,
+					cascadeFrustums, imgui.enableBVHCulling);
+				frameVisibleIndices = globalVisibleIndices;
+				for (uint32_t i = 0; i < ShadowCascades::NUM_CASCADES; ++i)
+				{
+					DrawLists cascadeLists = buildDrawCommands(cascadeCasters[i], objectData, allMeshes, allSubmeshes, allMaterials,
+						camera.Position, glm::radians(camera.Zoom), (float)appState.windowHeight,
+						imgui.enableSubmeshCulling ? &cascadeFrustums[i] : nullptr, static_cast<uint32_t>(frameVisibleIndices.size()));
+					visibility.cascadeOpaque[i] = std::move(cascadeLists.opaque);
+					visibility.cascadeCasterCounts[i] = cascadeLists.objectCount;
+					frameVisibleIndices.insert(frameVisibleIndices.end(), cascadeCasters[i].begin(), cascadeCasters[i].end());
+				}
+			}
+
+			visibility.valid = true;
+			visibility.viewProj = viewProj;
+			visibility.cullingFrustum = cullingFrustum;
+			visibility.cascadeViewProjs = cascadeViewProjs;
+			visibility.viewportHeight = (float)appState.windowHeight;
+			visibility.settings = cullSettings;
+			++visibility.version;
+			++objectVersion; // visibility flags
+		}
+		const std::vector<std::vector<DrawCommand>>& cameraOpaque = imgui.enableMeshletCulling ? visibility.culledOpaque : drawLists.opaque;
+		const std::array<std::vector<std::vector<DrawCommand>>, ShadowCascades::NUM_CASCADES>& cascadeOpaque = visibility.cascadeOpaque;
+		requestTextureDetail(image, visibility.visibleObjects, objectData, allMeshes, allSubmeshes, allMaterials,
+			camera.Position, glm::radians(camera.Zoom), (float)appState.windowHeight);
 
 		// Wait for previous frame to finish
 		vkWaitForFences(context.getDevice(), 1, sync.getInFlightFencePtr(currentFrame), VK_TRUE, UINT64_MAX);
+		if (gpuDriven)
+		{
+			gpuCullStats = gpuCuller->readStats(currentFrame, 0);
+			for (uint32_t i = 0; i < ShadowCascades::NUM_CASCADES; ++i)
+			{
+				gpuCascadeCasterCounts[i] = gpuCuller->readStats(currentFrame, i + 1).visibleObjects;
+			}
+		}
 
-		// Update GPU resources
-		buffer.updateObjectBuffer(objectData.data(), objectData.size() * sizeof(ObjectData), currentFrame);
+		// Update GPU resources, a slot's objects and lists are only rewritten when they're older than the current ones
+		if (uploadedObjectVersions[currentFrame] != objectVersion)
+		{
+			buffer.updateObjectBuffer(objectData.data(), objectData.size() * sizeof(ObjectData), currentFrame);
+			uploadedObjectVersions[currentFrame] = objectVersion;
+		}
 		buffer.updateLightingBuffer(&lights, sizeof(LightingData), currentFrame);
 		buffer.updateCascadeBuffer(&cascadeData, sizeof(CascadeData), currentFrame);
-		if (!globalVisibleIndices.empty())
+		if (uploadedVisibilityVersions[currentFrame] != visibility.version && !frameVisibleIndices.empty())
 		{
-			buffer.updateVisibleIndexBuffer(globalVisibleIndices.data(), globalVisibleIndices.size() * sizeof(uint32_t), currentFrame);
+			buffer.updateVisibleIndexBuffer(frameVisibleIndices.data(), frameVisibleIndices.size() * sizeof(uint32_t), currentFrame);
+			uploadedVisibilityVersions[currentFrame] = visibility.version;
 		}
 
+		// Stream texture levels for this frame's demand, swapped slots are rewritten before recording
+		image.updateTextureStreaming(frameNumber);
+		descriptors.updateTextureSlots(image.takeChangedTextureSlots(), image.getTextureViews(), image.getSampler());
+
+		// Submit this frame's uploads ahead of the frame itself and recycle ring space of finished ones
+		uploads.flush();
+
 		// Acquire next swapchain image
 		uint32_t imageIndex;
 		VkResult result = vkAcquireNextImageKHR(context.getDevice(), swapchain.getSwapchain(), UINT64_MAX, sync.getImageAvailableSemaphore(currentFrame), VK_NULL_HANDLE, &imageIndex);
@@ -649,6 +856,19 @@ int main()
 			static_cast<uint32_t>(currentFrame * buffer.getAlignedCascadeSize()),
 		};
 
+		// -- BEGIN GPU CULL PASS --
+		if (gpuDriven)
+		{
+			vkCmdBeginDebugUtilsLabelEXT(cmd, &cullPassLabel);
+			const float worldPerPixel = 2.0f * std::tan(glm::radians(camera.Zoom) * 0.5f) / (float)appState.windowHeight;
+			std::array<Frustum, 1 + ShadowCascades::NUM_CASCADES> viewFrustums;
+			viewFrustums[0] = cullingFrustum;
+			std::copy(cascadeFrustums.begin(), cascadeFrustums.end(), viewFrustums.begin() + 1);
+			gpuCuller->recordCulling(cmd, viewFrustums, camera.Position, worldPerPixel, LOD_PIXEL_ERROR, currentFrame);
+			vkCmdEndDebugUtilsLabelEXT(cmd);
+		}
+		// -- END GPU CULL PASS --
+
 		// -- BEGIN SHADOW RENDER PASS --
 		vkCmdBeginDebugUtilsLabelEXT(cmd, &shadowPassLabel);
 
@@ -669,7 +889,6 @@ int main()
 
 			// Render into shadow map
 			vkCmdBeginRendering(cmd, &shadowRenderingInfo);
-			vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, shadowPipeline.getPipeline());
 
 			shadowViewport.width = (float)image.getShadowMaps()[i].extent.width;
 			shadowViewport.height = (float)image.getShadowMaps()[i].extent.height;
@@ -685,19 +904,59 @@ int main()
 				static_cast<uint32_t>(dynamicOffsets.size()),
 				dynamicOffsets.data());
 
-			// Bind vertex/index buffers
+			// Bind vertex buffer, the index arena is bound per draw format
 			VkBuffer vertexBuffers[] = { buffer.getVertexBuffer() };
 			VkDeviceSize offsets[] = { 0 };
 			vkCmdBindVertexBuffers(cmd, 0, 1, vertexBuffers, offsets);
-			vkCmdBindIndexBuffer(cmd, buffer.getIndexBuffer(), 0, VK_INDEX_TYPE_UINT32);
 
-			// Draw opaque objects only
-			for (uint32_t matIdx = 0; matIdx < drawLists.opaque.size(); ++matIdx)
+			// Draw this cascade's opaque casters only
+			VertexFormat boundFormat = VertexFormat::Count;
+			IndexFormat boundIndexFormat = IndexFormat::Count;
+			if (gpuDriven)
 			{
-				const std::vector<DrawCommand>& drawCmds = drawLists.opaque[matIdx];
+				// Cascade i's instance lists and commands are view i + 1 of the cull pass
+				for (uint32_t b = 0; b < gpuCuller->getBatches().size(); ++b)
+				{
+					const GPUCuller::Layout::Batch& batch = gpuCuller->getBatches()[b];
+					const Material& material = allMaterials[batch.materialIndex];
+					if (batch.vertexFormat != boundFormat)
+					{
+						boundFormat = batch.vertexFormat;
+						vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, shadowPipelines[static_cast<size_t>(boundFormat)]->getPipeline());
+					}
+					if (batch.indexFormat != boundIndexFormat)
+					{
+						boundIndexFormat = batch.indexFormat;
+						bindIndexArena(cmd, buffer, boundIndexFormat);
+					}
+
+					shadowPC.diffuseTextureIndex = image.getTextureSlot(material.albedoTexture);
+					shadowPC.enableAlphaTest = material.alphatest;
+
+					vkCmdPushConstants(cmd, shadowPipeline.getLayout(),
+						VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+						0, sizeof(ShadowPushConstants), &shadowPC);
+
+					gpuCuller->drawBatch(cmd, b, currentFrame, i + 1);
+				}
+			}
+			for (uint32_t matIdx = 0; matIdx < cascadeOpaque[i].size(); ++matIdx)
+			{
+				const std::vector<DrawCommand>& drawCmds = cascadeOpaque[i][matIdx];
 				for (const DrawCommand& drawCmd : drawCmds)
 				{
-					shadowPC.diffuseTextureIndex = drawCmd.material.albedoTexture;
+					if (drawCmd.vertexFormat != boundFormat)
+					{
+						boundFormat = drawCmd.vertexFormat;
+						vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, shadowPipelines[static_cast<size_t>(boundFormat)]->getPipeline());
+					}
+					if (drawCmd.indexFormat != boundIndexFormat)
+					{
+						boundIndexFormat = drawCmd.indexFormat;
+						bindIndexArena(cmd, buffer, boundIndexFormat);
+					}
+
+					shadowPC.diffuseTextureIndex = image.getTextureSlot(drawCmd.material.albedoTexture);
 					shadowPC.enableAlphaTest = drawCmd.material.alphatest;
 
 					vkCmdPushConstants(cmd, shadowPipeline.getLayout(),
@@ -742,7 +1001,6 @@ int main()
 
 		VkPolygonMode polygonMode = imgui.enableWireframe ? VK_POLYGON_MODE_LINE : VK_POLYGON_MODE_FILL;
 
-		vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, scenePipeline.getPipeline());
 		scenePipeline.setViewport(cmd, viewport);
 		scenePipeline.setScissor(cmd, scissor);
 		scenePipeline.setDepthTest(cmd, imgui.enableDepthTest);
@@ -751,7 +1009,6 @@ int main()
 		VkBuffer vertexBuffers[] = { buffer.getVertexBuffer() };
 		VkDeviceSize offsets[] = { 0 };
 		vkCmdBindVertexBuffers(cmd, 0, 1, vertexBuffers, offsets);
-		vkCmdBindIndexBuffer(cmd, buffer.getIndexBuffer(), 0, VK_INDEX_TYPE_UINT32);
 
 		vkCmdBindDescriptorSets(cmd, 
 			VK_PIPELINE_BIND_POINT_GRAPHICS, 
@@ -767,9 +1024,43 @@ int main()
 		pc.showCascadeColors = imgui.showCascadeColors ? 1 : 0;
 
 		// Loop over meshes
-		for (uint32_t matIdx = 0; matIdx < drawLists.opaque.size(); ++matIdx)
+		VertexFormat boundFormat = VertexFormat::Count;
+		IndexFormat boundIndexFormat = IndexFormat::Count;
+		if (gpuDriven)
 		{
-			const auto& drawCmds = drawLists.opaque[matIdx];
+			// One indirect draw per batch, the GPU wrote how many commands it holds
+			for (uint32_t b = 0; b < gpuCuller->getBatches().size(); ++b)
+			{
+				const GPUCuller::Layout::Batch& batch = gpuCuller->getBatches()[b];
+				const Material& material = allMaterials[batch.materialIndex];
+
+				VkCullModeFlagBits cullMode = (material.twosided == 1) ? VK_CULL_MODE_NONE : VK_CULL_MODE_BACK_BIT;
+				scenePipeline.setCullMode(cmd, cullMode);
+
+				pc.enableAlphaTest = (material.alphatest == 1) ? 1 : 0;
+				pc.diffuseTextureIndex = static_cast<int>(image.getTextureSlot(material.albedoTexture));
+				pc.normalTextureIndex = static_cast<int>(image.getTextureSlot(material.normalTexture));
+				pc.reflectionStrength = material.reflectionStrength;
+
+				vkCmdPushConstants(cmd, scenePipeline.getLayout(), VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(pc), &pc);
+
+				if (batch.vertexFormat != boundFormat)
+				{
+					boundFormat = batch.vertexFormat;
+					vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, scenePipelines[static_cast<size_t>(boundFormat)]->getPipeline());
+				}
+				if (batch.indexFormat != boundIndexFormat)
+				{
+					boundIndexFormat = batch.indexFormat;
+					bindIndexArena(cmd, buffer, boundIndexFormat);
+				}
+
+				gpuCuller->drawBatch(cmd, b, currentFrame, 0);
+			}
+		}
+		for (uint32_t matIdx = 0; matIdx < cameraOpaque.size(); ++matIdx)
+		{
+			const auto& drawCmds = cameraOpaque[matIdx];
 			if (drawCmds.empty())
 			{
 				continue;
@@ -782,8 +1073,8 @@ int main()
 			scenePipeline.setCullMode(cmd, cullMode);
 
 			pc.enableAlphaTest = (material.alphatest == 1) ? 1 : 0;
-			pc.diffuseTextureIndex = static_cast<int>(material.albedoTexture);
-			pc.normalTextureIndex = static_cast<int>(material.normalTexture);
+			pc.diffuseTextureIndex = static_cast<int>(image.getTextureSlot(material.albedoTexture));
+			pc.normalTextureIndex = static_cast<int>(image.getTextureSlot(material.normalTexture));
 			pc.reflectionStrength = material.reflectionStrength;
 
 			vkCmdPushConstants(cmd, scenePipeline.getLayout(), VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(pc), &pc);
@@ -791,6 +1082,17 @@ int main()
 			// Draw all submeshes of this material
 			for (const auto& drawCmd : drawCmds)
 			{
+				if (drawCmd.vertexFormat != boundFormat)
+				{
+					boundFormat = drawCmd.vertexFormat;
+					vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, scenePipelines[static_cast<size_t>(boundFormat)]->getPipeline());
+				}
+				if (drawCmd.indexFormat != boundIndexFormat)
+				{
+					boundIndexFormat = drawCmd.indexFormat;
+					bindIndexArena(cmd, buffer, boundIndexFormat);
+				}
+
 				vkCmdDrawIndexed(cmd, drawCmd.indexCount, drawCmd.instanceCount, drawCmd.firstIndex, drawCmd.vertexOffset, drawCmd.firstInstance
 				);
 			}
@@ -819,12 +1121,14 @@ int main()
 
 		// -- BEGIN TRANSPARENCY RENDER PASS --
 		vkCmdBeginDebugUtilsLabelEXT(cmd, &transparentPassLabel);
-		vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, transparentPipeline.getPipeline());
+		boundFormat = VertexFormat::Count;
+		boundIndexFormat = IndexFormat::Count;
 
 		// Struct to hold per-instance transparent draw info
 		struct TransparentInstance {
 			uint32_t objIndex;				// Global object index
 			uint32_t materialIndex;			// Material ID for looking up draw command
+			uint32_t commandIndex;			// Draw command of the object's mesh and detail level within the material
 			float distanceToCamera;			// For front-to-back sorting
 		};
 
@@ -832,7 +1136,7 @@ int main()
 		// This is needed because the shader uses gl_InstanceIndex to index into
 		// the compact visibleIndices buffer, but we're sorting by global object index
 		std::unordered_map<uint32_t, uint32_t> objectToVisibleIndex;
-		for (uint32_t i = 0; i < globalVisibleIndices.size(); ++i)
+		for (uint32_t i = 0; i < drawLists.objectCount; ++i)
 		{
 			objectToVisibleIndex[globalVisibleIndices[i]] = i;
 		}
@@ -843,8 +1147,10 @@ int main()
 		for (uint32_t matIdx = 0; matIdx < drawLists.transparent.size(); ++matIdx)
 		{
 			auto& drawCommands = drawLists.transparent[matIdx];
-			for (auto& cmd: drawCommands)
+			for (uint32_t cmdIdx = 0; cmdIdx < drawCommands.size(); ++cmdIdx)
 			{
+				const DrawCommand& cmd = drawCommands[cmdIdx];
+
 				// Each DrawCommand has a list of visible global object indices
                 for (uint32_t i = 0; i < cmd.instanceCount; ++i)
                 {
@@ -852,7 +1158,7 @@ int main()
 					glm::vec3 objPos = glm::vec3(objectData[objIndex].model[3]);
 
                     float dist = glm::length(camera.Position - objPos);
-                    transparentObjects.push_back({ objIndex, matIdx, dist });
+                    transparentObjects.push_back({ objIndex, matIdx, cmdIdx, dist });
                 }
 			}
 		}
@@ -866,12 +1172,23 @@ int main()
 		// Draw transparent objects individually
 		for (const auto& inst: transparentObjects)
 		{
-			const auto& drawCmd = drawLists.transparent[inst.materialIndex][0];
+			const auto& drawCmd = drawLists.transparent[inst.materialIndex][inst.commandIndex];
 			const auto& mat = drawCmd.material;
 
+			if (drawCmd.vertexFormat != boundFormat)
+			{
+				boundFormat = drawCmd.vertexFormat;
+				vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, transparentPipelines[static_cast<size_t>(boundFormat)]->getPipeline());
+			}
+			if (drawCmd.indexFormat != boundIndexFormat)
+			{
+				boundIndexFormat = drawCmd.indexFormat;
+				bindIndexArena(cmd, buffer, boundIndexFormat);
+			}
+
 			pc.enableAlphaTest = mat.alphatest;
-			pc.diffuseTextureIndex = static_cast<int>(mat.albedoTexture);
-			pc.normalTextureIndex = static_cast<int>(mat.normalTexture);
+			pc.diffuseTextureIndex = static_cast<int>(image.getTextureSlot(mat.albedoTexture));
+			pc.normalTextureIndex = static_cast<int>(image.getTextureSlot(mat.normalTexture));
 			pc.reflectionStrength = mat.reflectionStrength;
 
 			vkCmdPushConstants(cmd, transparentPipeline.getLayout(),
@@ -896,7 +1213,7 @@ int main()
 		if (imgui.showMeshAABB || imgui.showSubmeshAABB)
 		{
 			std::vector<DebugVertex> debugVertices;
-			generateDebugGeometry(debugVertices, globalVisibleIndices, objectData, allMeshes, allSubmeshes,
+			generateDebugGeometry(debugVertices, std::span<const uint32_t>(globalVisibleIndices).first(drawLists.objectCount), objectData, allMeshes, allSubmeshes,
 				imgui.showMeshAABB, imgui.showSubmeshAABB);
 
 			if (!debugVertices.empty())
@@ -929,7 +1246,12 @@ int main()
 
 		// -- BEGIN UI RENDER PASS --
 		vkCmdBeginDebugUtilsLabelEXT(cmd, &imguiPassLabel);
-		imgui.drawShadowMapVisualization(shadowMapImGuiDescriptors, cascades);
+		imgui.drawShadowMapVisualization(shadowMapImGuiDescriptors, cascades, gpuDriven ? gpuCascadeCasterCounts : visibility.cascadeCasterCounts);
+		imgui.drawUploadStats(uploads.getStats(), image.getTextureStats());
+		if (gpuDriven)
+		{
+			imgui.drawCullingStats(gpuCullStats, visibility.cpuCullReference);
+		}
 		imgui.render();
 
 		imguiColorAttachment.imageView = swapchain.getSwapchainImageView(imageIndex);
@@ -974,6 +1296,7 @@ int main()
 		}
 
 		currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+		++frameNumber;
 	}
 
 	vkDeviceWaitIdle(context.getDevice());
@@ -983,332 +1306,373 @@ int main()
 	return 0;
 }
 
-uint32_t loadModel(const std::string& modelPath, GPUImage& imageClass)
+void updateLighting(LightingData& lights, const SceneDescription& scene, float time)
 {
-	namespace fs = std::filesystem;
-
-	fs::path objFilePath(modelPath);
-	fs::path objDir = objFilePath.parent_path();
-
-	tinyobj::ObjReaderConfig reader_config;
-	reader_config.mtl_search_path = objDir.string();
-	tinyobj::ObjReader reader;
-
-	if (!reader.ParseFromFile(modelPath, reader_config))
-	{
-		if (!reader.Error().empty())
-		{
-			std::cerr << "TinyObjReader: " << reader.Error();
-		}
-		exit(1);
-	}
-
-	if (!reader.Warning().empty())
+	if (scene.settings.sunOrbitSpeed == 0.0f)
 	{
-		std::cout << "TinyObjReader: " << reader.Warning();
+		return;
 	}
 
-	auto& attrib = reader.GetAttrib();
-	auto& shapes = reader.GetShapes();
-	auto& materials = reader.GetMaterials();
-
-	Mesh mesh{};
-	mesh.vertexOffset = static_cast<uint32_t>(allVertices.size());
-	mesh.submeshOffset = static_cast<uint32_t>(allSubmeshes.size());
-	AABB bounds;
-
-	std::unordered_map<Vertex, uint32_t> uniqueVertices{};
-
-	// record where new materials will start in global array
-	uint32_t baseMaterialIndex = static_cast<uint32_t>(allMaterials.size());
-
-	// iterate shapes
-	for (const auto& shape : shapes) {
-		Submesh sub{};
-		sub.indexOffset = static_cast<uint32_t>(allIndices.size());
-		AABB subBounds; 
-
-		// local material index from tinyobj
-		uint32_t matIndex = UINT32_MAX;
-		if (!shape.mesh.material_ids.empty() && shape.mesh.material_ids[0] >= 0) {
-			matIndex = static_cast<uint32_t>(shape.mesh.material_ids[0]);
-		}
+	// The authored direction gives the height and the radii of the orbit
+	float angle = glm::radians(scene.settings.sunOrbitSpeed) * time;
+	lights.dirLight.direction.x = glm::cos(angle) * glm::abs(scene.sun.direction.x);
+	lights.dirLight.direction.y = scene.sun.direction.y;
+	lights.dirLight.direction.z = glm::sin(angle) * glm::abs(scene.sun.direction.z);
+}
 
-		// convert local index to global index by adding base offset (if valid)
-		if (matIndex != UINT32_MAX)
+void updateObjects(std::vector<ObjectData>& objectData, BVH& bvh, FrustumCuller& culler, const std::vector<Mesh>& allMeshes, const SceneDescription& scene, float time,
+	std::vector<AABB>& dirtyBounds)
+{
+	dirtyBounds.clear();
+	for (const SceneSpin& spin : scene.spins)
+	{
+		ObjectData& object = objectData[spin.objectIndex];
+		glm::mat4 rotation = glm::rotate(glm::mat4(1.0f), glm::radians(spin.degreesPerSecond) * time, glm::vec3(0.0f, 1.0f, 0.0f));
+		glm::mat4 model = glm::scale(spin.base * rotation, spin.scale);
+		if (model == object.model)
 		{
-			matIndex += baseMaterialIndex;
-		}
-		sub.materialIndex = matIndex;
-
-		// Verify that all faces are triangles before processing
-		for (unsigned char fv : shape.mesh.num_face_vertices) {
-			if (fv != 3) {
-				throw std::runtime_error("Non-triangular face found in OBJ file. Please triangulate before loading.");
-			}
+			continue;
 		}
 
-		for (const tinyobj::index_t& index : shape.mesh.indices) {
-			Vertex vertex{};
-
-			vertex.pos = {
-				attrib.vertices[3 * index.vertex_index + 0],
-				attrib.vertices[3 * index.vertex_index + 1],
-				attrib.vertices[3 * index.vertex_index + 2]
-			};
-
-			// Expand bounds
-			bounds.expand(vertex.pos);
-			subBounds.expand(vertex.pos);
+		// Cached world bounds follow the transform, the swept box covers where the object was and is now
+		object.model = model;
+		AABB worldBounds = get_world_aabb(object, allMeshes[object.meshIndex]);
+		AABB sweptBounds = bvh.getBounds(spin.objectIndex);
+		sweptBounds.expand(worldBounds);
+		dirtyBounds.push_back(sweptBounds);
 
-			if (index.normal_index >= 0) {
-				vertex.normal = {
-					attrib.normals[3 * index.normal_index + 0],
-					attrib.normals[3 * index.normal_index + 1],
-					attrib.normals[3 * index.normal_index + 2]
-				};
-			}
-
-			if (index.texcoord_index >= 0) {
-				vertex.texCoord = {
-					attrib.texcoords[2 * index.texcoord_index + 0],
-					1.0f - attrib.texcoords[2 * index.texcoord_index + 1]
-				};
-			}
-
-			// MikkTSpace will populate later
-			vertex.tangent = glm::vec4(0.0f);
-
-			if (!uniqueVertices.contains(vertex)) {
-				uniqueVertices[vertex] = static_cast<uint32_t>(allVertices.size() - mesh.vertexOffset);
-				allVertices.push_back(vertex);
-			}
-
-			allIndices.push_back(uniqueVertices[vertex]);
-		}
-
-		sub.indexCount = static_cast<uint32_t>(allIndices.size()) - sub.indexOffset;
-		sub.bounds = subBounds;
-		allSubmeshes.push_back(sub);
+		bvh.refit(spin.objectIndex, worldBounds);
+		culler.refit(spin.objectIndex, worldBounds);
 	}
+}
 
-	mesh.vertexCount = static_cast<uint32_t>(allVertices.size() - mesh.vertexOffset);
-	mesh.submeshCount = static_cast<uint32_t>(allSubmeshes.size()) - mesh.submeshOffset;
-	mesh.bounds = bounds;
-
-	uint32_t meshIndex = static_cast<uint32_t>(allMeshes.size());
-	allMeshes.push_back(mesh);
+std::vector<uint32_t> performFrustumCulling(const BVH& bvh, FrustumCuller& culler, std::vector<ObjectData>& objectData,
+	std::vector<uint32_t>& flaggedIndices, const Frustum& frustum, bool useBVH)
+{
+	std::vector<uint32_t> globalVisibleIndices;
 
-	// Calculate tangents for the loaded mesh's submeshes using MikkTSpace
-	for (uint32_t i = 0; i < mesh.submeshCount; ++i)
+	// Flat reference path, every object's cached bounds are tested and every flag is written
+	if (!useBVH)
 	{
-		const Submesh& sub = allSubmeshes[mesh.submeshOffset + i];
-
-		MikkTSpaceData data;
-		data.allVerticesPtr = &allVertices;
-		data.allIndicesPtr = &allIndices; // Using a single index buffer
+		culler.cull(frustum, globalVisibleIndices, objectData);
+		flaggedIndices = globalVisibleIndices;
+		return globalVisibleIndices;
+	}
 
-		data.vertexOffset = mesh.vertexOffset; // Mesh's start vertex in allVertices
-		data.indexOffset = sub.indexOffset; // Submesh's start index in allIndices
-		data.indexCount = sub.indexCount; // Submesh's index count
+	// Hierarchy is kept current by updateObjects, cost follows the visible set rather than the scene size
+	bvh.cullFrustum(frustum, globalVisibleIndices);
 
-		// Use static helper function to run calculation
-		TangentGenerator::CalculateTangents(data);
+	for (uint32_t objectIndex : flaggedIndices)
+	{
+		objectData[objectIndex].isVisible = 0;
 	}
-
-	// Load material data
-	for (const auto& mtl : materials)
+	for (uint32_t objectIndex : globalVisibleIndices)
 	{
-		Material mat{};
+		objectData[objectIndex].isVisible = 1;
+	}
+	flaggedIndices = globalVisibleIndices;
 
-		if (!mtl.diffuse_texname.empty())
-		{
-			fs::path texPath = objDir / mtl.diffuse_texname;
-			mat.albedoTexture = imageClass.loadTexture(texPath.string(), true); // Pass true for SRGB
-		}
-		else
-		{
-			mat.albedoTexture = -1;
-		}
+	return globalVisibleIndices;
+}
 
-		if (!mtl.bump_texname.empty())
+bool boundsIntersectViews(const std::vector<AABB>& bounds, const Frustum& cameraFrustum, const std::array<Frustum, ShadowCascades::NUM_CASCADES>& cascadeFrustums)
+{
+	for (const AABB& box : bounds)
+	{
+		if (cameraFrustum.isBoxVisible(box.min, box.max))
 		{
-			fs::path texPath = objDir / mtl.bump_texname;
-			mat.normalTexture = imageClass.loadTexture(texPath.string(), false); // Pass false for UNORM/data
+			return true;
 		}
-		else
+		for (const Frustum& cascadeFrustum : cascadeFrustums)
 		{
-			mat.normalTexture = -1;
+			if (cascadeFrustum.isBoxVisible(box.min, box.max))
+			{
+				return true;
+			}
 		}
+	}
+	return false;
+}
 
-		mat.specularTexture = 0;
+std::array<Frustum, ShadowCascades::NUM_CASCADES> getCascadeFrustums(const std::vector<ShadowCascades::CascadeData>& cascades, bool extendToLight)
+{
+	std::array<Frustum, ShadowCascades::NUM_CASCADES> frustums;
+	for (uint32_t i = 0; i < ShadowCascades::NUM_CASCADES; ++i)
+	{
+		frustums[i].update(cascades[i].viewProj);
 
-		if (mtl.dissolve < 1.0f)
-		{	
-			// Alpha-blended transparency (e.g. glass)
-			mat.twosided = 1;
-			mat.alphatest = 0;
-			mat.alphablending = 1;
+		// Depth clamping flattens casters between the light and the near plane onto it, so they still cast
+		if (extendToLight)
+		{
+			frustums[i].removeNearPlane();
 		}
-		else if (!mtl.alpha_texname.empty())
+	}
+	return frustums;
+}
+
+std::array<std::vector<uint32_t>, ShadowCascades::NUM_CASCADES> performShadowCasterCulling(const BVH& bvh, FrustumCuller& culler,
+	const std::array<Frustum, ShadowCascades::NUM_CASCADES>& cascadeFrustums, bool useBVH)
+{
+	std::array<std::vector<uint32_t>, ShadowCascades::NUM_CASCADES> casters;
+	for (uint32_t i = 0; i < ShadowCascades::NUM_CASCADES; ++i)
+	{
+		// The flat path reuses the bounds the camera cull wrote this frame, visibility flags stay the camera's
+		if (useBVH)
 		{
-			// Alpha-tested transparency (e.g. grass, fences)
-			mat.twosided = 1;
-			mat.alphatest = 1;
-			mat.alphablending = 0;
+			bvh.cullFrustum(cascadeFrustums[i], casters[i]);
 		}
 		else
 		{
-			// Fully opaque
-			mat.twosided = 0;
-			mat.alphatest = 0;
-			mat.alphablending = 0;
+			culler.cull(cascadeFrustums[i], casters[i]);
 		}
-
-		mat.shininess = mtl.shininess;
-		mat.reflectionStrength = 0.0f;
-		mat.specularStrength = 0.5f;
-		mat.alphaThreshold = 0.5f;
-
-		allMaterials.push_back(mat);
 	}
-
-	std::cout << "Loaded mesh [" << meshIndex << "] with " << mesh.submeshCount
-		<< " submeshes" << std::endl;
-
-	return meshIndex;
+	return casters;
 }
 
-std::vector<uint32_t> performFrustumCulling(std::vector<ObjectData>& objectData, const std::vector<Mesh>& allMeshes, const Frustum& frustum)
+void performOcclusionCulling(OcclusionCuller& culler, std::vector<uint32_t>& globalVisibleIndices, std::vector<ObjectData>& objectData,
+	const BVH& bvh, const SceneDescription& scene,
+	const std::vector<Vertex>& allVertices, const std::vector<uint32_t>& allIndices,
+	const std::vector<Mesh>& allMeshes, const std::vector<Submesh>& allSubmeshes, const std::vector<Material>& allMaterials,
+	const glm::mat4& viewProj, const glm::vec3& cameraPos, float fovY)
 {
-	// Visibility flag per-thread
-	std::vector<uint8_t> visibility(objectData.size(), 0);
+	culler.begin(viewProj);
 
-	// Parallel visibility test using ranges, as Frustum Culling is "embarrassingly parallel"
-	auto indices = std::views::iota(0u, static_cast<uint32_t>(objectData.size()));
-	std::for_each(std::execution::par_unseq, indices.begin(), indices.end(),
-		[&](uint32_t i)
+	// Occluders use the level whose error stays under a pixel of the occlusion buffer
+	const float worldPerPixel = 2.0f * std::tan(fovY * 0.5f) / OcclusionCuller::HEIGHT;
+	auto addOccluder = [&](uint32_t objectIndex, uint32_t triangleBudget) -> uint32_t
 		{
-			// Transform mesh AABB to world space and check visibility against frustum
-			const auto& mesh = allMeshes[objectData[i].meshIndex];
-			AABB worldBounds = mesh.bounds.transform(objectData[i].model);
+			const ObjectData& object = objectData[objectIndex];
+			const Mesh& mesh = allMeshes[object.meshIndex];
+			const uint32_t lod = selectMeshLod(mesh, object.model, cameraPos, worldPerPixel);
 
-			// Sphere test is slightly faster, often used for first pass
-			//bool visible = frustum.isBoxVisible(worldBounds.min, worldBounds.max);
-			bool visible = frustum.isSphereVisible(worldBounds.center(), worldBounds.radius());
+			// Cut-out and see-through materials have holes, they never occlude
+			auto occludes = [&](const Submesh& submesh)
+				{
+					return submesh.materialIndex == UINT32_MAX ||
+						(!allMaterials[submesh.materialIndex].alphatest && !allMaterials[submesh.materialIndex].alphablending);
+				};
 
-			objectData[i].isVisible = visible ? 1 : 0;
-			visibility[i] = visible ? 1 : 0;
-		});
+			uint32_t triangles = 0;
+			for (uint32_t s = 0; s < mesh.submeshCount; ++s)
+			{
+				const Submesh& submesh = allSubmeshes[mesh.submeshOffset + s];
+				triangles += occludes(submesh) ? submesh.getLod(lod).indexCount / 3 : 0;
+			}
+			if (triangles == 0 || triangles > triangleBudget)
+			{
+				return 0;
+			}
 
-	std::vector<uint32_t> globalVisibleIndices;
-	globalVisibleIndices.reserve(objectData.size());
+			std::span<const Vertex> vertices = std::span(allVertices).subspan(mesh.vertexOffset, mesh.vertexCount);
+			for (uint32_t s = 0; s < mesh.submeshCount; ++s)
+			{
+				const Submesh& submesh = allSubmeshes[mesh.submeshOffset + s];
+				if (occludes(submesh))
+				{
+					const SubmeshLod level = submesh.getLod(lod);
+					bool twoSided = submesh.materialIndex != UINT32_MAX && allMaterials[submesh.materialIndex].twosided;
+					culler.addOccluder(vertices, std::span(allIndices).subspan(level.indexOffset, level.indexCount), object.model, !twoSided);
+				}
+			}
+			return triangles;
+		};
 
-	for (uint32_t i = 0; i < visibility.size(); ++i)
+	// Authored occluders in view are always rasterized
+	for (uint32_t objectIndex : scene.occluders)
 	{
-		if (visibility[i])
+		if (objectData[objectIndex].isVisible)
 		{
-			globalVisibleIndices.push_back(i);
+			addOccluder(objectIndex, UINT32_MAX);
 		}
 	}
 
-	return globalVisibleIndices;
-}
+	// The rest come from the largest objects on screen, a camera inside the bounds counts as filling it
+	std::vector<std::pair<float, uint32_t>> candidates;
+	const float tanHalfFov = std::tan(fovY * 0.5f);
+	for (uint32_t objectIndex : globalVisibleIndices)
+	{
+		const AABB& bounds = bvh.getBounds(objectIndex);
+		float distance = glm::length(bounds.center() - cameraPos);
+		float screenRadius = distance > bounds.radius() ? bounds.radius() / (distance * tanHalfFov) : FLT_MAX;
+		if (screenRadius >= OCCLUDER_MIN_SCREEN_RADIUS &&
+			std::find(scene.occluders.begin(), scene.occluders.end(), objectIndex) == scene.occluders.end())
+		{
+			candidates.push_back({ screenRadius, objectIndex });
+		}
+	}
+	std::sort(candidates.begin(), candidates.end(), std::greater<>());
 
-DrawLists buildDrawCommands(const std::vector<uint32_t>& globalVisibleIndices, const std::vector<ObjectData>& objectData, const std::vector<Mesh>& allMeshes, const std::vector<Submesh>& allSubmeshes, const std::vector<Material>& allMaterials)
-{
-	DrawLists result;
-	result.opaque.resize(allMaterials.size());
-	result.transparent.resize(allMaterials.size());
+	uint32_t autoOccluders = 0;
+	uint32_t triangleBudget = OCCLUDER_TRIANGLE_BUDGET;
+	for (const auto& [screenRadius, objectIndex] : candidates)
+	{
+		uint32_t triangles = addOccluder(objectIndex, triangleBudget);
+		triangleBudget -= triangles;
+		autoOccluders += triangles > 0 ? 1 : 0;
+		if (autoOccluders == MAX_AUTO_OCCLUDERS)
+		{
+			break;
+		}
+	}
 
-	// Group visible objects by mesh (ONE TIME)
-	std::unordered_map<uint32_t, std::vector<uint32_t>> visibleByMesh;
-	for (uint32_t objIdx : globalVisibleIndices)
+	culler.rasterize();
+	if (culler.getTriangleCount() == 0)
 	{
-		uint32_t meshIdx = objectData[objIdx].meshIndex;
-		visibleByMesh[meshIdx].push_back(objIdx);
+		return;
 	}
 
-	// Build sorted list of visible mesh indices for correct offset ordering
-	std::vector<uint32_t> sortedVisibleMeshIndices;
-	std::unordered_set<uint32_t> seenMeshes;
+	// Bounds come from the hierarchy, which updateObjects keeps current
+	std::vector<uint8_t> visible(globalVisibleIndices.size());
+	auto indices = std::views::iota(0u, static_cast<uint32_t>(globalVisibleIndices.size()));
+	std::for_each(std::execution::par, indices.begin(), indices.end(),
+		[&](uint32_t i)
+		{
+			visible[i] = culler.isVisible(bvh.getBounds(globalVisibleIndices[i])) ? 1 : 0;
+		});
 
-	for (uint32_t objectIndex: globalVisibleIndices)
+	uint32_t kept = 0;
+	for (uint32_t i = 0; i < globalVisibleIndices.size(); ++i)
 	{
-		uint32_t meshIndex = objectData[objectIndex].meshIndex;
-		if (seenMeshes.insert(meshIndex).second)
+		if (visible[i])
+		{
+			globalVisibleIndices[kept++] = globalVisibleIndices[i];
+		}
+		else
 		{
-			sortedVisibleMeshIndices.push_back(meshIndex);
+			objectData[globalVisibleIndices[i]].isVisible = 0;
 		}
 	}
+	globalVisibleIndices.resize(kept);
+}
+
+void requestTextureDetail(GPUImage& image, const std::vector<uint32_t>& globalVisibleIndices, const std::vector<ObjectData>& objectData,
+	const std::vector<Mesh>& allMeshes, const std::vector<Submesh>& allSubmeshes, const std::vector<Material>& allMaterials,
+	const glm::vec3& cameraPos, float fovY, float viewportHeight)
+{
+	if (!image.isStreamingEnabled())
+	{
+		return;
+	}
 
-	// Tracks where each mesh's instances start in the globalVisibleIndices buffer
-	uint32_t globalInstanceOffset = 0;
+	// World units one pixel spans at distance 1, grows linearly with distance
+	const float worldPerPixel = 2.0f * std::tan(fovY * 0.5f) / viewportHeight;
 
-	// Process each mesh in the order they first appear in objectData
-	for (uint32_t meshIndex : sortedVisibleMeshIndices)
+	for (uint32_t objIndex : globalVisibleIndices)
 	{
-		const auto& visibleIndices = visibleByMesh[meshIndex];
-		const Mesh& mesh = allMeshes[meshIndex];
+		const ObjectData& object = objectData[objIndex];
+		const Mesh& mesh = allMeshes[object.meshIndex];
+		AABB worldBounds = mesh.bounds.transform(object.model);
 
-		uint32_t visibleInstanceCount = static_cast<uint32_t>(visibleIndices.size());
+		// Nearest point of the bounding sphere is the most detailed part of the object on screen
+		float distance = std::max(glm::length(worldBounds.center() - cameraPos) - worldBounds.radius(), 0.01f);
+		float scale = std::max({ glm::length(glm::vec3(object.model[0])), glm::length(glm::vec3(object.model[1])), glm::length(glm::vec3(object.model[2])) });
+		float worldPixel = distance * worldPerPixel;
 
-		// Process each submesh(different geometry parts with potentially different materials)
-		for (uint32_t submeshIdx = 0; submeshIdx < mesh.submeshCount; ++submeshIdx)
+		for (uint32_t s = 0; s < mesh.submeshCount; ++s)
 		{
-			const Submesh& submesh = allSubmeshes[mesh.submeshOffset + submeshIdx];
+			// Without a UV spread every level looks the same, the tail is enough
+			const Submesh& submesh = allSubmeshes[mesh.submeshOffset + s];
+			if (submesh.materialIndex == UINT32_MAX || submesh.uvDensity <= 0.0f)
+			{
+				continue;
+			}
+
+			// Scaling the object up spreads the same UVs over more world space
+			float uvPerPixel = submesh.uvDensity / scale * worldPixel;
 			const Material& material = allMaterials[submesh.materialIndex];
+			image.requestTexture(material.albedoTexture, uvPerPixel);
+			image.requestTexture(material.normalTexture, uvPerPixel);
+		}
+	}
+}
 
-			// Construct the draw command
-			DrawCommand cmd{};
-			cmd.indexCount = submesh.indexCount;
-			cmd.instanceCount = visibleInstanceCount;
-			cmd.firstIndex = submesh.indexOffset;
-			cmd.vertexOffset = static_cast<uint32_t>(mesh.vertexOffset);
-			cmd.material = material;
+std::vector<std::vector<DrawCommand>> cullMeshlets(const std::vector<std::vector<DrawCommand>>& opaque, const std::vector<uint32_t>& globalVisibleIndices,
+	const std::vector<ObjectData>& objectData, const std::vector<Meshlet>& allMeshlets, const Frustum& frustum, const glm::vec3& cameraPos)
+{
+	std::vector<std::vector<DrawCommand>> result(opaque.size());
 
-			// Split opaque vs transparent
-			if (material.alphablending == 1)
-			{
-				cmd.firstInstance = 0; // we will draw transparent objects individually
-				cmd.objectIndices = visibleIndices;
-				result.transparent[submesh.materialIndex].push_back(cmd);
-			}
-			else
+	// Materials write their own list
+	auto materialIndices = std::views::iota(size_t(0), opaque.size());
+	std::for_each(std::execution::par, materialIndices.begin(), materialIndices.end(),
+		[&](size_t matIdx)
+		{
+			std::vector<DrawCommand>& culled = result[matIdx];
+
+			for (const DrawCommand& drawCmd : opaque[matIdx])
 			{
-				cmd.firstInstance = globalInstanceOffset; // Same offset for ALL submeshes of this mesh
+				if (drawCmd.instanceCount > MESHLET_CULL_MAX_INSTANCES || drawCmd.meshletCount < MESHLET_CULL_MIN_MESHLETS)
+				{
+					culled.push_back(drawCmd);
+					continue;
+				}
+
+				// Meshlets cover the command's index range in order, so their offsets map straight onto it
+				const uint32_t baseIndexOffset = allMeshlets[drawCmd.meshletOffset].indexOffset;
 
-				// Optimization: Merge with previous draw if possible (reduces draw call count)
-				auto& opaqueList = result.opaque[submesh.materialIndex];
-				if (!opaqueList.empty())
+				for (uint32_t instance = 0; instance < drawCmd.instanceCount; ++instance)
 				{
-					DrawCommand& lastCmd = opaqueList.back();
+					const glm::mat4& model = objectData[globalVisibleIndices[drawCmd.firstInstance + instance]].model;
+					const glm::mat3 linear(model);
+					const glm::vec3 axisScales(glm::length(linear[0]), glm::length(linear[1]), glm::length(linear[2]));
+					const float scale = std::max({ axisScales.x, axisScales.y, axisScales.z });
 
-					// Can merge if: same mesh with contiguous index range
-					bool canMerge = (lastCmd.vertexOffset == cmd.vertexOffset &&
-						lastCmd.instanceCount == cmd.instanceCount &&
-						lastCmd.firstInstance == cmd.firstInstance &&
-						lastCmd.firstIndex + lastCmd.indexCount == cmd.firstIndex);
+					// The cone only survives rotation and uniform scale, and back faces are drawn on two sided materials
+					const bool uniformScale = std::min({ axisScales.x, axisScales.y, axisScales.z }) >= scale * 0.99f;
+					const bool coneTest = drawCmd.material.twosided != 1 && uniformScale && glm::determinant(linear) > 0.0f;
 
-					if (canMerge)
+					DrawCommand run = drawCmd;
+					run.instanceCount = 1;
+					run.firstInstance = drawCmd.firstInstance + instance;
+					run.indexCount = 0;
+
+					for (uint32_t m = 0; m < drawCmd.meshletCount; ++m)
 					{
-						// Just extend the previous command's index range
-						lastCmd.indexCount += cmd.indexCount;
-						continue; // Skip adding a new command
+						const Meshlet& meshlet = allMeshlets[drawCmd.meshletOffset + m];
+
+						bool visible = frustum.isSphereVisible(glm::vec3(model * glm::vec4(meshlet.center, 1.0f)), meshlet.radius * scale);
+						if (visible && coneTest && meshlet.coneCutoff < 1.0f)
+						{
+							glm::vec3 apex = glm::vec3(model * glm::vec4(meshlet.coneApex, 1.0f));
+							glm::vec3 axis = linear * meshlet.coneAxis / scale;
+							visible = glm::dot(glm::normalize(apex - cameraPos), axis) < meshlet.coneCutoff;
+						}
+
+						// Consecutive visible meshlets stay one draw
+						if (visible)
+						{
+							if (run.indexCount == 0)
+							{
+								run.firstIndex = drawCmd.firstIndex + (meshlet.indexOffset - baseIndexOffset);
+							}
+							run.indexCount += meshlet.indexCount;
+						}
+						else if (run.indexCount > 0)
+						{
+							culled.push_back(run);
+							run.indexCount = 0;
+						}
 					}
-				}
 
-				result.opaque[submesh.materialIndex].push_back(cmd);
+					if (run.indexCount > 0)
+					{
+						culled.push_back(run);
+					}
+				}
 			}
-		}
+		});
 
-		// Advance the global offset by the number of visible instances of this mesh
-		// This ensures the next mesh's instanaces start at the correct position in the buffer
-		globalInstanceOffset += visibleInstanceCount;
-	}
 	return result;
 }
 
+void bindIndexArena(VkCommandBuffer cmd, const GPUBuffer& buffer, IndexFormat format)
+{
+	// In IndexFormat order
+	static constexpr std::array<VkIndexType, static_cast<size_t>(IndexFormat::Count)> indexTypes = {
+		VK_INDEX_TYPE_UINT16, VK_INDEX_TYPE_UINT32 };
+
+	vkCmdBindIndexBuffer(cmd, buffer.getIndexBuffer(), buffer.getIndexArenaOffset(format), indexTypes[static_cast<size_t>(format)]);
+}
+
 void recreateSwapchainResources(VulkanContext& context, Swapchain& swapchain, GPUImage& image)
 {
 	swapchain.recreateSwapchain();
@@ -1419,7 +1783,7 @@ GLFWwindow* createWindow(AppState& appState)
 }
 
 void generateDebugGeometry(std::vector<DebugVertex>& debugVertices,
-	const std::vector<uint32_t>& globalVisibleIndices,
+	std::span<const uint32_t> globalVisibleIndices,
 	const std::vector<ObjectData>& objectData,
 	const std::vector<Mesh>& allMeshes,
 	const std::vector<Submesh>& allSubmeshes,
@@ -1507,3 +1871,12 @@ bool check_collision(const ObjectData& objA, const ObjectData& objB, const std::
 
 	return worldA.overlaps(worldB);
 }
+
+std::vector<uint32_t> find_collisions(const BVH& bvh, uint32_t objectIndex)
+{
+	// Broad phase over the hierarchy instead of pairing the object with every other one
+	std::vector<uint32_t> collisions;
+	bvh.queryOverlaps(bvh.getBounds(objectIndex), collisions);
+	std::erase(collisions, objectIndex);
+	return collisions;
+}